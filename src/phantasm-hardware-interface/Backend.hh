@@ -76,6 +76,11 @@ public:
     /// create a buffer with optional element stride, allocation on an upload/readback heap, or allowing UAV access
     [[nodiscard]] virtual handle::resource createBuffer(arg::buffer_description const& info, char const* debug_name = nullptr) = 0;
 
+    /// create textures which share a single memory block, aliasing each other where their lifetime intervals do not overlap
+    /// at the start of each lifetime interval, a texture must be activated with cmd::barrier_aliasing before any other use
+    /// textures are freed individually, the memory block is released along with the last of them
+    virtual void createTransientTextures(cc::span<arg::transient_texture_description const> descs, cc::span<handle::resource> out_resources, char const* debug_name = nullptr) = 0;
+
     /// maps a buffer created on resource_heap::upload or ::readback to CPU-accessible memory and returns a pointer
     /// multiple (nested) maps are allowed, leaving a resource_heap::upload buffer persistently mapped is valid
     /// begin and end specify the range of CPU-side read data in bytes, end == -1 being the entire width
@@ -126,6 +131,7 @@ public:
     //
 
     /// create a graphics pipeline state
+    /// Vulkan: returns handle::null_pipeline_state if a shader binary is an invalid pre-patched SPIR-V container
     [[nodiscard]] virtual handle::pipeline_state createPipelineState(arg::vertex_format vertex_format,
                                                                      arg::framebuffer_config const& framebuffer_conf,
                                                                      arg::shader_arg_shapes shader_arg_shapes,
@@ -148,8 +154,27 @@ public:
     [[nodiscard]] virtual handle::pipeline_state createComputePipelineState(arg::compute_pipeline_state_description const& description, char const* debug_name = nullptr)
         = 0;
 
+    /// create multiple graphics pipeline states at once, writing the results to out_psos (must be the same size as descriptions)
+    /// shader processing and compilation are parallelized internally where supported
+    /// debug_names is optional, if non-empty it must be the same size as descriptions
+    /// PSOs that fail to be created are written as handle::null_pipeline_state, the others are unaffected
+    virtual void createPipelineStates(cc::span<arg::graphics_pipeline_state_description const> descriptions,
+                                      cc::span<handle::pipeline_state> out_psos,
+                                      cc::span<char const* const> debug_names = {})
+        = 0;
+
+    /// create multiple compute pipeline states at once, see createPipelineStates
+    virtual void createComputePipelineStates(cc::span<arg::compute_pipeline_state_description const> descriptions,
+                                             cc::span<handle::pipeline_state> out_psos,
+                                             cc::span<char const* const> debug_names = {})
+        = 0;
+
     virtual void free(handle::pipeline_state ps) = 0;
 
+    /// writes the native pipeline cache to disk (backend_config::pipeline_cache_path)
+    /// returns false if no path is configured, writing failed, or the backend has no persistent pipeline cache (D3D12)
+    virtual bool flushPipelineCache() = 0;
+
     //
     // Command list interface
     //
@@ -157,6 +182,10 @@ public:
     /// create a command list handle from a software command buffer
     [[nodiscard]] virtual handle::command_list recordCommandList(std::byte const* buffer, size_t size, queue_type queue = queue_type::direct) = 0;
 
+    /// create a command list handle from a software command buffer split into chunks, translated in order
+    /// (see chunked_command_stream_writer)
+    [[nodiscard]] virtual handle::command_list recordCommandList(cc::span<command_stream_chunk const> chunks, queue_type queue = queue_type::direct) = 0;
+
     /// destroy the given command list handles
     virtual void discard(cc::span<handle::command_list const> cls) = 0;
 
@@ -266,6 +295,21 @@ public:
 
     virtual gpu_info const& getGPUInfo() const = 0;
 
+    /// returns the current VRAM budget and usage of the process, with a per-heap breakdown
+    /// Vulkan: precise if VK_EXT_memory_budget is available, otherwise the budget is an estimate based on the heap sizes
+    /// also checks the soft limit (backend_config::vram_soft_limit_callback)
+    virtual vram_state_info getVRAMInfo() = 0;
+
+    //
+    // Deferred free interface
+    //
+
+    /// destroys all handles freed in deferred mode (backend_config::enable_deferred_free) whose submits have completed on the GPU
+    /// non-blocking, returns the amount of destroyed handles
+    virtual uint32_t collectGarbage() = 0;
+
+    virtual deferred_free_stats getDeferredFreeStats() = 0;
+
     //
     // Non-virtual utility
     //
@@ -316,6 +316,15 @@ public:
     }
 };
 
+struct transient_texture_description
+{
+    texture_description desc;
+    // lifetime interval (inclusive) on an arbitrary timeline, for example pass indices within a frame
+    // textures whose intervals do not overlap can share memory
+    uint32_t first_use;
+    uint32_t last_use;
+};
+
 struct buffer_description
 {
     uint32_t size_bytes;
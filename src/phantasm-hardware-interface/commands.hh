@@ -5,6 +5,8 @@
 #include <typed-geometry/types/objects/aabb.hh>
 #include <typed-geometry/types/size.hh>
 
+#include <clean-core/span.hh>
+
 #include <phantasm-hardware-interface/common/command_base.hh>
 #include <phantasm-hardware-interface/common/container/flat_vector.hh>
 #include <phantasm-hardware-interface/limits.hh>
@@ -170,6 +172,27 @@ PHI_DEFINE_CMD(barrier_uav)
     flat_vector<handle::resource, limits::max_uav_barriers> resources; // optional
 };
 
+PHI_DEFINE_CMD(barrier_aliasing)
+{
+    // Activate transient textures (see Backend::createTransientTextures) at the start of a lifetime interval
+    // waits on all previous work that might have used the shared memory and transitions the textures to the given state
+
+    // contents are undefined after activation, render and depth targets must be cleared or entirely overwritten next
+    // Vulkan: the transition is always recorded on the spot, it does not depend on the previous state
+    // D3D12: the transition follows the rules of cmd::transition_resources
+
+    flat_vector<transition_info, limits::max_resource_transitions> resources;
+
+public:
+    /// activate resource [res] and transition it into state [target]
+    /// if the target state is a CBV/SRV/UAV, depending_shader must be
+    /// the union of shaders depending upon this resource next (can be omitted on d3d12)
+    void add(handle::resource res, resource_state target, shader_stage_flags_t depending_shader = {})
+    {
+        resources.push_back(transition_info{res, target, depending_shader});
+    }
+};
+
 
 PHI_DEFINE_CMD(draw)
 {
@@ -270,6 +293,59 @@ public:
     }
 };
 
+PHI_DEFINE_CMD(draw_batch)
+{
+    // Execute many draw calls sharing the pipeline state, shader arguments and vertex / index buffers
+    // must occur inside of a render pass
+    //
+    // per-draw parameters are read from an array of draw_record in CPU memory, referenced by pointer
+    // the array must stay alive until the command list is recorded (it is not required for submission)
+    // state is bound once, the draws are translated in a tight loop without redundancy checks
+
+    struct draw_record
+    {
+        uint32_t num_indices = 0;   ///< amount of indices drawn (or amount of vertices if no index buffer specified)
+        uint32_t index_offset = 0;  ///< location of the first index (or first vertex if no index buffer specified)
+        int32_t vertex_offset = 0;  ///< added to the vertex index before indexing into the vertex buffer
+        uint32_t num_instances = 1; ///< amount of instances to draw
+        uint32_t cbv_offset = 0;    ///< offset into the CBV of shader argument cbv_argument_index, if enabled
+        std::byte root_constants[limits::max_root_constant_bytes];
+    };
+
+    flat_vector<shader_argument, limits::max_shader_arguments> shader_arguments;
+    handle::pipeline_state pipeline_state = handle::null_pipeline_state;
+
+    handle::resource vertex_buffers[limits::max_vertex_buffers] = {handle::null_resource,  // vertex buffers - optional
+                                                                   handle::null_resource,  //
+                                                                   handle::null_resource,  //
+                                                                   handle::null_resource}; //
+    handle::resource index_buffer = handle::null_resource;                                 // optional
+
+    draw_record const* records = nullptr;
+    uint32_t num_records = 0;
+
+    /// amount of root constant bytes set per draw from draw_record::root_constants, multiple of 4
+    uint32_t num_root_constant_bytes = 0;
+
+    /// index of the shader argument whose CBV offset is set per draw from draw_record::cbv_offset, -1 to disable
+    uint8_t cbv_argument_index = uint8_t(-1);
+
+public:
+    void init(handle::pipeline_state pso, cc::span<draw_record const> draws, handle::resource vb = handle::null_resource, handle::resource ib = handle::null_resource)
+    {
+        pipeline_state = pso;
+        records = draws.data();
+        num_records = uint32_t(draws.size());
+        vertex_buffers[0] = vb;
+        index_buffer = ib;
+    }
+
+    void add_shader_arg(handle::resource cbv, uint32_t cbv_off = 0, handle::shader_view sv = handle::null_shader_view)
+    {
+        shader_arguments.push_back(shader_argument{cbv, sv, cbv_off});
+    }
+};
+
 PHI_DEFINE_CMD(dispatch)
 {
     // Execute a compute dispatch
@@ -335,6 +411,139 @@ public:
     }
 };
 
+// Compact state-delta commands
+//
+// an alternative to cmd::draw and cmd::dispatch for streams with many similar draws or dispatches
+// each command only carries the state that changes, the rest persists from previous commands
+//
+// rules:
+// - set_pipeline_state must precede the other commands, it resets the shader arguments if their layout changes
+// - state does not persist across cmd::begin_render_pass / cmd::end_render_pass
+// - cmd::draw and cmd::dispatch overwrite the state with their own, set_pipeline_state must be repeated after them
+//
+// example:
+//      writer.add_command(cmd::set_pipeline_state{pso});
+//      writer.add_command(cmd::set_vertex_buffers{vertex_buffer, index_buffer});
+//      for (auto const& mesh : meshes)
+//      {
+//          auto& args = writer.emplace_command_with_payload<cmd::set_shader_arguments>(cmd::set_shader_arguments::get_payload_size(1, sizeof(mesh.id)));
+//          args.write_payload(mesh.shader_args, &mesh.id, sizeof(mesh.id));
+//          writer.add_command(cmd::draw_only{mesh.num_indices, mesh.index_offset});
+//      }
+
+PHI_DEFINE_CMD(set_pipeline_state)
+{
+    // Bind a graphics (inside of a render pass) or compute (outside of render passes) pipeline state
+
+    handle::pipeline_state pipeline_state = handle::null_pipeline_state;
+
+    /// whether this is a compute pipeline state, used for all following set_shader_arguments commands
+    bool is_compute = false;
+
+public:
+    set_pipeline_state() = default;
+    set_pipeline_state(handle::pipeline_state pso, bool compute = false) : pipeline_state(pso), is_compute(compute) {}
+};
+
+PHI_DEFINE_CMD(set_shader_arguments)
+{
+    // Set shader arguments and root constants of the current pipeline state
+    // variable size: the shader arguments and root constant bytes directly follow this command in the stream,
+    // write using command_stream_writer::emplace_command_with_payload
+
+    static constexpr bool s_has_payload = true;
+    static constexpr size_t s_max_payload_size = limits::max_shader_arguments * sizeof(shader_argument) + limits::max_root_constant_bytes;
+
+    uint8_t num_shader_arguments = 0;
+    uint16_t num_root_constant_bytes = 0; ///< multiple of 4, at most limits::max_root_constant_bytes, 0 leaves them unchanged
+
+public:
+    [[nodiscard]] static constexpr size_t get_payload_size(size_t num_args, size_t num_root_const_bytes)
+    {
+        return num_args * sizeof(shader_argument) + num_root_const_bytes;
+    }
+
+    [[nodiscard]] size_t get_size_bytes() const { return sizeof(set_shader_arguments) + get_payload_size(num_shader_arguments, num_root_constant_bytes); }
+
+    [[nodiscard]] shader_argument const* get_shader_arguments() const { return reinterpret_cast<shader_argument const*>(this + 1); }
+    [[nodiscard]] shader_argument* get_shader_arguments() { return reinterpret_cast<shader_argument*>(this + 1); }
+
+    [[nodiscard]] std::byte const* get_root_constants() const
+    {
+        return reinterpret_cast<std::byte const*>(this + 1) + num_shader_arguments * sizeof(shader_argument);
+    }
+
+    /// write the payload, the command must have been emplaced with get_payload_size(args.size(), root_consts_size)
+    void write_payload(cc::span<shader_argument const> args, void const* root_consts = nullptr, size_t root_consts_size = 0)
+    {
+        CC_ASSERT(args.size() <= limits::max_shader_arguments && "too many shader arguments");
+        CC_ASSERT(root_consts_size <= limits::max_root_constant_bytes && root_consts_size % 4 == 0 && "invalid root constant size");
+        num_shader_arguments = uint8_t(args.size());
+        num_root_constant_bytes = uint16_t(root_consts_size);
+
+        if (!args.empty())
+            std::memcpy(get_shader_arguments(), args.data(), args.size() * sizeof(shader_argument));
+
+        if (root_consts_size > 0)
+            std::memcpy(get_shader_arguments() + args.size(), root_consts, root_consts_size);
+    }
+};
+
+PHI_DEFINE_CMD(set_vertex_buffers)
+{
+    // Set the vertex buffers and index buffer (optional) used by following draw_only commands
+
+    handle::resource vertex_buffers[limits::max_vertex_buffers] = {handle::null_resource, handle::null_resource, handle::null_resource, handle::null_resource};
+    handle::resource index_buffer = handle::null_resource;
+
+public:
+    set_vertex_buffers() = default;
+    set_vertex_buffers(handle::resource vb, handle::resource ib = handle::null_resource) : index_buffer(ib) { vertex_buffers[0] = vb; }
+};
+
+PHI_DEFINE_CMD(set_scissor)
+{
+    // Set the scissor rectangle, must occur inside of a render pass
+    // left, top, right, bottom of the rectangle in absolute pixel values
+
+    tg::iaabb2 scissor = tg::iaabb2(-1, -1);
+
+public:
+    set_scissor() = default;
+    set_scissor(int32_t left, int32_t top, int32_t right, int32_t bot) : scissor({left, top}, {right, bot}) {}
+};
+
+PHI_DEFINE_CMD(draw_only)
+{
+    // Execute a draw call using the state of previous compact commands
+    // must occur inside of a render pass, indexed if an index buffer is set
+
+    uint32_t num_indices = 0;   ///< amount of indices drawn (or amount of vertices if no index buffer is set)
+    uint32_t index_offset = 0;  ///< location of the first index (or first vertex if no index buffer is set)
+    int32_t vertex_offset = 0;  ///< added to the vertex index before indexing into the vertex buffer
+    uint32_t num_instances = 1; ///< amount of instances to draw
+
+public:
+    draw_only() = default;
+    draw_only(uint32_t num_ind, uint32_t ind_offset = 0, int32_t vert_offset = 0, uint32_t num_inst = 1)
+      : num_indices(num_ind), index_offset(ind_offset), vertex_offset(vert_offset), num_instances(num_inst)
+    {
+    }
+};
+
+PHI_DEFINE_CMD(dispatch_only)
+{
+    // Execute a compute dispatch using the state of previous compact commands
+
+    uint32_t dispatch_x = 0;
+    uint32_t dispatch_y = 0;
+    uint32_t dispatch_z = 0;
+
+public:
+    dispatch_only() = default;
+    dispatch_only(uint32_t x, uint32_t y = 1, uint32_t z = 1) : dispatch_x(x), dispatch_y(y), dispatch_z(z) {}
+};
+
 PHI_DEFINE_CMD(copy_buffer)
 {
     // Copy data between buffers
@@ -474,6 +683,7 @@ PHI_DEFINE_CMD(write_timestamp)
     // Write the current GPU queue timestamp into a slot of a query range
 
     // see cmd::resolve_queries to receive the data afterwards
+    // a query can be written multiple times per command list, but at most once per render pass
 
     handle::query_range query_range = handle::null_query_range; ///< the query_range in which to write a timestamp query
     uint32_t index = 0;                                         ///< relative index into the query_range, element to write to
@@ -531,6 +741,8 @@ PHI_DEFINE_CMD(begin_profile_scope)
     // close it using cmd::end_profile_scope
     // usage depends on enabled profilers, see CMake options
 
+    char const* name = nullptr; ///< optional, shown by phi::GpuProfiler (see features/gpu_profiler.hh)
+
 #ifdef PHI_HAS_OPTICK
     // point to a manually allocated Optick EventDescription
     // create one using PHI_CREATE_OPTICK_EVENT(VariableName, NameString)
@@ -690,6 +902,7 @@ public:
     {
         static_assert(std::is_base_of_v<cmd::detail::cmd_base, CMDT>, "not a command");
         static_assert(std::is_trivially_copyable_v<CMDT>, "command not trivially copyable");
+        static_assert(!CMDT::s_has_payload, "use emplace_command_with_payload");
         CC_ASSERT(can_accomodate_t<CMDT>() && "command_stream_writer full");
         new (cc::placement_new, _out_buffer + _cursor) CMDT(command);
         _cursor += sizeof(CMDT);
@@ -700,12 +913,25 @@ public:
     {
         static_assert(std::is_base_of_v<cmd::detail::cmd_base, CMDT>, "not a command");
         static_assert(std::is_trivially_copyable_v<CMDT>, "command not trivially copyable");
+        static_assert(!CMDT::s_has_payload, "use emplace_command_with_payload");
         CC_ASSERT(can_accomodate_t<CMDT>() && "command_stream_writer full");
         CMDT* const res = new (cc::placement_new, _out_buffer + _cursor) CMDT();
         _cursor += sizeof(CMDT);
         return *res;
     }
 
+    /// write a command followed by an uninitialized payload of the given size, for commands with s_has_payload
+    template <class CMDT>
+    [[nodiscard]] CMDT& emplace_command_with_payload(size_t payload_size)
+    {
+        static_assert(std::is_base_of_v<cmd::detail::cmd_base, CMDT>, "not a command");
+        static_assert(CMDT::s_has_payload, "command has no payload");
+        CC_ASSERT(can_accomodate(sizeof(CMDT) + payload_size) && "command_stream_writer full");
+        CMDT* const res = new (cc::placement_new, _out_buffer + _cursor) CMDT();
+        _cursor += sizeof(CMDT) + payload_size;
+        return *res;
+    }
+
     void advance_cursor(size_t amount) { _cursor += amount; }
 
 public:
@@ -736,4 +962,12 @@ private:
     size_t _max_size = 0;
     size_t _cursor = 0;
 };
+
+/// a contiguous section of a command stream, see Backend::recordCommandList
+/// commands never straddle chunks
+struct command_stream_chunk
+{
+    std::byte const* buffer = nullptr;
+    size_t size = 0;
+};
 }
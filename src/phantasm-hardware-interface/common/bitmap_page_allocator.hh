@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <clean-core/alloc_array.hh>
+#include <clean-core/assert.hh>
+#include <clean-core/bits.hh>
+#include <clean-core/utility.hh>
+
+namespace phi
+{
+/// drop-in replacement for page_allocator, first-fit over a bitmap of allocated pages
+/// allocations scan 64 pages per step with ctz, frees only clear the bits of the allocation
+/// words before the first one with a free page are skipped entirely
+struct bitmap_page_allocator
+{
+    void initialize(unsigned num_elements, unsigned num_elems_per_page, cc::allocator* static_alloc)
+    {
+        auto const num_pages = cc::int_div_ceil(num_elements, num_elems_per_page);
+        _page_size = static_cast<int>(num_elems_per_page);
+        _num_pages = int(num_pages);
+        _allocation_sizes = cc::alloc_array<int>::filled(num_pages, 0, static_alloc);
+        _words = cc::alloc_array<uint64_t>::filled(cc::int_div_ceil(num_pages, 64u), 0, static_alloc);
+        free_all();
+    }
+
+    /// allocate a block of the given size, returns the resulting page or -1
+    [[nodiscard]] int allocate(int size)
+    {
+        int const num_pages = cc::int_div_ceil(size, _page_size);
+        int const res = num_pages == 1 ? find_single_page() : find_contiguous_pages(num_pages);
+        if (res == -1)
+            return -1;
+
+        _allocation_sizes[unsigned(res)] = num_pages;
+        set_bits(res, num_pages, true);
+
+        while (_first_free_word < _words.size() && _words[_first_free_word] == ~uint64_t(0))
+            ++_first_free_word;
+
+        return res;
+    }
+
+    /// free the given page
+    void free(int page)
+    {
+        if (page < 0)
+            return;
+
+        int& num_pages = _allocation_sizes[unsigned(page)];
+        CC_ASSERT(num_pages > 0 && "page is not the start of an allocation");
+        set_bits(page, num_pages, false);
+        num_pages = 0;
+
+        _first_free_word = cc::min(_first_free_word, unsigned(page) / 64);
+    }
+
+    void free_all()
+    {
+        std::memset(_allocation_sizes.data(), 0, _allocation_sizes.size_bytes());
+        std::memset(_words.data(), 0, _words.size_bytes());
+
+        // the bits past the last page are permanently allocated, the scans need no bounds checks
+        if (_num_pages % 64 != 0)
+            _words[_words.size() - 1] = ~uint64_t(0) << (_num_pages % 64);
+
+        _first_free_word = 0;
+    }
+
+public:
+    /// returns amount of elements per page
+    int get_page_size() const { return _page_size; }
+
+    /// returns amount of pages
+    int get_num_pages() const { return _num_pages; }
+
+    /// returns amount of elements in total
+    int get_num_elements() const { return get_page_size() * get_num_pages(); }
+
+    /// NOTE: this is the size given to ::allocate, ceiled to _page_size
+    int get_allocation_size_in_elements(int page) const { return _allocation_sizes[unsigned(page)] * _page_size; }
+
+private:
+    int find_single_page() const
+    {
+        for (auto w = _first_free_word; w < _words.size(); ++w)
+        {
+            if (_words[w] != ~uint64_t(0))
+                return int(w * 64 + cc::count_trailing_zeros(~_words[w]));
+        }
+
+        return -1;
+    }
+
+    int find_contiguous_pages(int num_pages) const
+    {
+        int run_start = int(_first_free_word * 64);
+        int run_length = 0;
+
+        for (auto w = _first_free_word; w < _words.size(); ++w)
+        {
+            uint64_t const word = _words[w];
+            if (word == 0)
+            {
+                run_length += 64;
+                if (run_length >= num_pages)
+                    return run_start;
+
+                continue;
+            }
+
+            if (word == ~uint64_t(0))
+            {
+                run_start = int((w + 1) * 64);
+                run_length = 0;
+                continue;
+            }
+
+            // alternate between runs of free and allocated bits within the word
+            unsigned bit = 0;
+            while (bit < 64)
+            {
+                uint64_t const remaining = word >> bit;
+                if (remaining == 0)
+                {
+                    run_length += int(64 - bit);
+                    break;
+                }
+
+                unsigned const num_free = cc::count_trailing_zeros(remaining);
+                run_length += int(num_free);
+                if (run_length >= num_pages)
+                    return run_start;
+
+                // the shift fills the top with zeros, the inverse is never 0 as the word is not fully allocated
+                bit += num_free;
+                bit += cc::count_trailing_zeros(~(word >> bit));
+                run_start = int(w * 64 + bit);
+                run_length = 0;
+            }
+
+            if (run_length >= num_pages)
+                return run_start;
+        }
+
+        return -1;
+    }
+
+    void set_bits(int first_page, int num_pages, bool allocated)
+    {
+        unsigned page = unsigned(first_page);
+        unsigned const end = page + unsigned(num_pages);
+        while (page < end)
+        {
+            unsigned const bit = page % 64;
+            unsigned const num_bits = cc::min(64 - bit, end - page);
+            uint64_t const mask = (num_bits == 64 ? ~uint64_t(0) : ((uint64_t(1) << num_bits) - 1)) << bit;
+
+            if (allocated)
+                _words[page / 64] |= mask;
+            else
+                _words[page / 64] &= ~mask;
+
+            page += num_bits;
+        }
+    }
+
+private:
+    cc::alloc_array<uint64_t> _words;       // one bit per page, set if allocated
+    cc::alloc_array<int> _allocation_sizes; // the amount of pages of the allocation starting at this page, 0 otherwise
+    unsigned _first_free_word = 0;          // all words before this one are fully allocated
+    int _num_pages = 0;
+    int _page_size = 0; // the amount of elements per page
+};
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstring>
+#include <type_traits>
+
+#include <clean-core/alloc_vector.hh>
+#include <clean-core/assert.hh>
+#include <clean-core/span.hh>
+
+namespace phi
+{
+/// growable counterpart to byte_reader, using the same layout for sized arrays
+struct byte_writer
+{
+    byte_writer() = default;
+    explicit byte_writer(cc::allocator* alloc, size_t initial_capacity = 1024) { initialize(alloc, initial_capacity); }
+
+    void initialize(cc::allocator* alloc, size_t initial_capacity = 1024) { _buffer.reset_reserve(alloc, initial_capacity); }
+
+    template <class T>
+    void write_t(T const& data)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "T not memcpyable");
+        write(cc::span{reinterpret_cast<std::byte const*>(&data), sizeof(T)});
+    }
+
+    void write(cc::span<std::byte const> data)
+    {
+        size_t const offset = _buffer.size();
+        _buffer.resize(offset + data.size());
+        if (!data.empty())
+            std::memcpy(_buffer.data() + offset, data.data(), data.size());
+    }
+
+    // in memory: [size_t: num] [T] [T] .. x num .. [T]
+    template <class T>
+    void write_sized_array(cc::span<T const> elements)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "T not memcpyable");
+        write_t(size_t(elements.size()));
+        write(cc::span{reinterpret_cast<std::byte const*>(elements.data()), elements.size() * sizeof(T)});
+    }
+
+    /// overwrite previously written data at the given offset
+    template <class T>
+    void patch_t(size_t offset, T const& data)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "T not memcpyable");
+        CC_ASSERT(offset + sizeof(T) <= _buffer.size() && "patch OOB");
+        std::memcpy(_buffer.data() + offset, &data, sizeof(T));
+    }
+
+    void reset() { _buffer.clear(); }
+
+    size_t size() const { return _buffer.size(); }
+    std::byte const* data() const { return _buffer.data(); }
+    cc::span<std::byte const> get_span() const { return cc::span{_buffer.data(), _buffer.size()}; }
+
+private:
+    cc::alloc_vector<std::byte> _buffer;
+};
+}
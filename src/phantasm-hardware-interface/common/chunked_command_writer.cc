@@ -0,0 +1,107 @@
+#include "chunked_command_writer.hh"
+
+#include <clean-core/assert.hh>
+
+#include <phantasm-hardware-interface/common/command_reading.hh>
+
+void phi::command_page_pool::initialize(size_t page_size, cc::allocator* alloc)
+{
+    CC_ASSERT(page_size >= cmd::detail::compute_max_command_size() && "command pages must be able to hold the largest command");
+
+    _page_size = page_size;
+    _alloc = alloc;
+    _free_pages.reset_reserve(alloc, 64);
+    _all_pages.reset_reserve(alloc, 64);
+}
+
+void phi::command_page_pool::destroy()
+{
+    CC_ASSERT(_free_pages.size() == _all_pages.size() && "command pages still in use on destruction");
+
+    for (std::byte* const page : _all_pages)
+        _alloc->free(page);
+
+    _free_pages = {};
+    _all_pages = {};
+}
+
+std::byte* phi::command_page_pool::acquire()
+{
+    auto lg = std::lock_guard(_mutex);
+
+    if (!_free_pages.empty())
+    {
+        std::byte* const res = _free_pages.back();
+        _free_pages.pop_back();
+        return res;
+    }
+
+    std::byte* const res = static_cast<std::byte*>(_alloc->alloc(_page_size, alignof(std::max_align_t)));
+    _all_pages.push_back(res);
+    return res;
+}
+
+void phi::command_page_pool::release(cc::span<std::byte* const> pages)
+{
+    auto lg = std::lock_guard(_mutex);
+
+    for (std::byte* const page : pages)
+        _free_pages.push_back(page);
+}
+
+void phi::chunked_command_stream_writer::initialize(command_page_pool* pool, cc::allocator* alloc)
+{
+    _pool = pool;
+    _current = {};
+    _size_finished_chunks = 0;
+    _pages.reset_reserve(alloc, 16);
+    _chunks.reset_reserve(alloc, 16);
+}
+
+void phi::chunked_command_stream_writer::destroy()
+{
+    reset();
+    _pages = {};
+    _chunks = {};
+    _pool = nullptr;
+}
+
+void phi::chunked_command_stream_writer::reset()
+{
+    if (!_pages.empty())
+        _pool->release(_pages);
+
+    _pages.clear();
+    _chunks.clear();
+    _current = {};
+    _size_finished_chunks = 0;
+}
+
+cc::span<phi::command_stream_chunk const> phi::chunked_command_stream_writer::get_chunks()
+{
+    // the chunk of the current page is still growing
+    if (!_chunks.empty())
+        _chunks.back().size = _current.size();
+
+    return _chunks;
+}
+
+void phi::chunked_command_stream_writer::ensure_space(size_t size)
+{
+    if (_current.can_accomodate(size))
+        return;
+
+    CC_ASSERT(size <= _pool->get_page_size() && "command larger than command_page_pool page size");
+
+    // close the current chunk, commands never straddle pages
+    if (!_chunks.empty())
+    {
+        _chunks.back().size = _current.size();
+        _size_finished_chunks += _current.size();
+    }
+
+    std::byte* const page = _pool->acquire();
+    _pages.push_back(page);
+    _chunks.push_back(command_stream_chunk{page, 0});
+    _current.initialize(page, _pool->get_page_size());
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+
+#include <clean-core/alloc_vector.hh>
+#include <clean-core/span.hh>
+
+#include <phantasm-hardware-interface/commands.hh>
+
+namespace phi
+{
+/// a pool of fixed-size pages backing chunked_command_stream_writers
+/// pages are allocated on demand and recycled, memory scales with the peak amount of pages in use
+/// synchronized
+struct command_page_pool
+{
+    /// page_size must be able to hold the largest command, see cmd::detail::compute_max_command_size
+    void initialize(size_t page_size, cc::allocator* alloc);
+    void destroy();
+
+    [[nodiscard]] std::byte* acquire();
+    void release(cc::span<std::byte* const> pages);
+
+    size_t get_page_size() const { return _page_size; }
+    size_t get_num_allocated_pages() const { return _all_pages.size(); }
+
+private:
+    size_t _page_size = 0;
+    cc::allocator* _alloc = nullptr;
+
+    std::mutex _mutex;
+    cc::alloc_vector<std::byte*> _free_pages;
+    cc::alloc_vector<std::byte*> _all_pages;
+};
+
+/// a command_stream_writer that grows by acquiring pages from a command_page_pool
+/// record using Backend::recordCommandList(writer.get_chunks()), then return the pages with reset()
+/// unsynchronized, use one per thread
+///
+/// example:
+///     writer.add_command(cmd::set_pipeline_state{pso});
+///     ...
+///     auto const list = backend.recordCommandList(writer.get_chunks());
+///     writer.reset();
+struct chunked_command_stream_writer
+{
+    void initialize(command_page_pool* pool, cc::allocator* alloc);
+    void destroy();
+
+    template <class CMDT>
+    void add_command(CMDT const& command)
+    {
+        ensure_space(sizeof(CMDT));
+        _current.add_command(command);
+    }
+
+    template <class CMDT>
+    [[nodiscard]] CMDT& emplace_command()
+    {
+        ensure_space(sizeof(CMDT));
+        return _current.emplace_command<CMDT>();
+    }
+
+    template <class CMDT>
+    [[nodiscard]] CMDT& emplace_command_with_payload(size_t payload_size)
+    {
+        ensure_space(sizeof(CMDT) + payload_size);
+        return _current.emplace_command_with_payload<CMDT>(payload_size);
+    }
+
+    /// returns all pages to the pool, invalidates the chunks
+    void reset();
+
+    /// returns the written chunks in order, valid until the next write or reset
+    [[nodiscard]] cc::span<command_stream_chunk const> get_chunks();
+
+    /// returns the size of all written chunks in bytes
+    size_t size() const { return _size_finished_chunks + _current.size(); }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    void ensure_space(size_t size);
+
+private:
+    command_page_pool* _pool = nullptr;
+    command_stream_writer _current;
+    size_t _size_finished_chunks = 0;
+
+    cc::alloc_vector<std::byte*> _pages;
+    cc::alloc_vector<command_stream_chunk> _chunks;
+};
+}
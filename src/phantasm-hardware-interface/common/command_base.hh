@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace phi::cmd::detail
@@ -29,7 +30,15 @@ namespace phi::cmd::detail
     PHI_X(clear_textures)          \
     PHI_X(code_location_marker)    \
     PHI_X(begin_profile_scope)     \
-    PHI_X(end_profile_scope)
+    PHI_X(end_profile_scope)       \
+    PHI_X(barrier_aliasing)        \
+    PHI_X(set_pipeline_state)      \
+    PHI_X(set_shader_arguments)    \
+    PHI_X(set_vertex_buffers)      \
+    PHI_X(set_scissor)             \
+    PHI_X(draw_only)               \
+    PHI_X(dispatch_only)           \
+    PHI_X(draw_batch)
 
 enum class cmd_type : uint8_t
 {
@@ -40,6 +49,11 @@ enum class cmd_type : uint8_t
 
 struct cmd_base
 {
+    /// commands with a variable-length payload following them in the stream override these
+    /// and provide get_size_bytes(), see get_command_size
+    static constexpr bool s_has_payload = false;
+    static constexpr size_t s_max_payload_size = 0;
+
     cmd_type s_internal_type;
     cmd_base(cmd_type t) : s_internal_type(t) {}
 };
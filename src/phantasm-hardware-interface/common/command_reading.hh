@@ -14,15 +14,24 @@ namespace phi::cmd::detail
 PHI_CMD_TYPE_VALUES
 #undef PHI_X
 
-    /// returns the size in bytes of the given command
-    [[nodiscard]] inline size_t
-    get_command_size(detail::cmd_type type)
+    /// returns the size in bytes of the given command, including its payload if variable-length
+    template <class CmdT>
+    [[nodiscard]] size_t get_command_size_t(CmdT const& cmd)
 {
-    switch (type)
+    if constexpr (CmdT::s_has_payload)
+        return cmd.get_size_bytes();
+    else
+        return sizeof(CmdT);
+}
+
+/// returns the size in bytes of the given command, including its payload if variable-length
+[[nodiscard]] inline size_t get_command_size(detail::cmd_base const& base)
+{
+    switch (base.s_internal_type)
     {
 #define PHI_X(_val_)              \
     case detail::cmd_type::_val_: \
-        return sizeof(::phi::cmd::_val_);
+        return get_command_size_t(static_cast<::phi::cmd::_val_ const&>(base));
         PHI_CMD_TYPE_VALUES
 #undef PHI_X
     }
@@ -64,7 +73,7 @@ void dynamic_dispatch(detail::cmd_base const& base, F& callback)
 [[nodiscard]] constexpr size_t compute_max_command_size()
 {
     size_t res = 0;
-#define PHI_X(_val_) res = cc::max(res, sizeof(::phi::cmd::_val_));
+#define PHI_X(_val_) res = cc::max(res, sizeof(::phi::cmd::_val_) + ::phi::cmd::_val_::s_max_payload_size);
     PHI_CMD_TYPE_VALUES
 #undef PHI_X
     return res;
@@ -91,7 +100,7 @@ public:
 
         iterator& operator++()
         {
-            auto const advance = cmd::detail::get_command_size(_pos->s_internal_type);
+            auto const advance = cmd::detail::get_command_size(*_pos);
             _pos = reinterpret_cast<cmd::detail::cmd_base const*>(reinterpret_cast<std::byte const*>(_pos) + advance);
             _remaining_size -= advance;
             return *this;
@@ -0,0 +1,390 @@
+#include "command_stream_optimizer.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include <clean-core/assert.hh>
+
+#include <phantasm-hardware-interface/common/command_reading.hh>
+
+namespace
+{
+using phi::cmd::detail::cmd_base;
+using phi::cmd::detail::cmd_type;
+
+bool is_debug_marker(cmd_type type)
+{
+    return type == cmd_type::begin_debug_label || type == cmd_type::end_debug_label || type == cmd_type::code_location_marker;
+}
+
+/// the state a draw binds, in order of switching cost
+struct draw_sort_key
+{
+    uint64_t values[5];
+
+    bool operator<(draw_sort_key const& rhs) const { return std::lexicographical_compare(values, values + 5, rhs.values, rhs.values + 5); }
+};
+
+template <class DrawT>
+draw_sort_key make_sort_key(DrawT const& draw)
+{
+    phi::shader_argument const first_arg = draw.shader_arguments.empty() ? phi::shader_argument{} : draw.shader_arguments[0];
+    return {{uint64_t(draw.pipeline_state._value), uint64_t(first_arg.shader_view._value), uint64_t(first_arg.constant_buffer._value),
+             uint64_t(draw.index_buffer._value), uint64_t(draw.vertex_buffers[0]._value)}};
+}
+
+draw_sort_key get_sort_key(cmd_base const& cmd)
+{
+    switch (cmd.s_internal_type)
+    {
+    case cmd_type::draw:
+        return make_sort_key(static_cast<phi::cmd::draw const&>(cmd));
+    case cmd_type::draw_indirect:
+        return make_sort_key(static_cast<phi::cmd::draw_indirect const&>(cmd));
+    case cmd_type::draw_batch:
+        return make_sort_key(static_cast<phi::cmd::draw_batch const&>(cmd));
+    default:
+        CC_UNREACHABLE("not a self-contained draw");
+        return {};
+    }
+}
+}
+
+void phi::command_stream_optimizer::initialize(cc::allocator* alloc, uint32_t initial_num_resources)
+{
+    _known_states.initialize(alloc, initial_num_resources);
+    _render_pass_body.reset_reserve(alloc, 256);
+}
+
+void phi::command_stream_optimizer::destroy()
+{
+    _known_states.destroy();
+    _render_pass_body = {};
+}
+
+phi::command_stream_optimizer_stats phi::command_stream_optimizer::optimize(cc::span<command_stream_chunk const> chunks,
+                                                                            command_stream_writer& out_writer,
+                                                                            command_stream_optimizer_options const& options)
+{
+    _writer = &out_writer;
+    _options = &options;
+    _stats = {};
+
+    _known_states.reset();
+    _has_pending_transitions = false;
+    _render_pass_begin = nullptr;
+    _render_pass_body.clear();
+    _render_pass_index = 0;
+
+    for (command_stream_chunk const& chunk : chunks)
+    {
+        command_stream_parser parser(chunk.buffer, chunk.size);
+        for (auto const& cmd : parser)
+        {
+            ++_stats.num_commands_in;
+            process_command(cmd);
+        }
+    }
+
+    flush_transitions();
+
+    // a render pass left open is closed at the end of the list, write it unchanged
+    if (_render_pass_begin != nullptr)
+    {
+        emit(*_render_pass_begin);
+        for (cmd_base const* body_cmd : _render_pass_body)
+            emit(*body_cmd);
+
+        _render_pass_begin = nullptr;
+        _render_pass_body.clear();
+    }
+
+    _writer = nullptr;
+    _options = nullptr;
+    return _stats;
+}
+
+void phi::command_stream_optimizer::process_command(cmd::detail::cmd_base const& cmd)
+{
+    cmd_type const type = cmd.s_internal_type;
+
+    if (_options->drop_debug_markers && is_debug_marker(type))
+    {
+        ++_stats.num_debug_markers_dropped;
+        return;
+    }
+
+    if (type == cmd_type::transition_resources && _render_pass_begin == nullptr)
+    {
+        add_transitions(static_cast<cmd::transition_resources const&>(cmd));
+        return;
+    }
+
+    // any other command ends a run of transitions
+    flush_transitions();
+
+    // these change resource states without being tracked here
+    switch (type)
+    {
+    case cmd_type::transition_resources:
+        for (auto const& transition : static_cast<cmd::transition_resources const&>(cmd).transitions)
+            forget_state(transition.resource);
+        break;
+    case cmd_type::transition_image_slices:
+    {
+        auto const& slices = static_cast<cmd::transition_image_slices const&>(cmd);
+        for (auto const& transition : slices.transitions)
+            forget_state(transition.resource);
+        for (auto const& reset : slices.state_resets)
+            forget_state(reset.resource);
+        break;
+    }
+    case cmd_type::barrier_aliasing:
+        for (auto const& activation : static_cast<cmd::barrier_aliasing const&>(cmd).resources)
+            forget_state(activation.resource);
+        break;
+    default:
+        break;
+    }
+
+    if (_render_pass_begin != nullptr)
+    {
+        if (type == cmd_type::end_render_pass)
+            end_render_pass(&cmd);
+        else
+            _render_pass_body.push_back(&cmd);
+
+        return;
+    }
+
+    if (type == cmd_type::begin_render_pass)
+    {
+        _render_pass_begin = &cmd;
+        _render_pass_body.clear();
+        return;
+    }
+
+    emit(cmd);
+}
+
+void phi::command_stream_optimizer::add_transitions(cmd::transition_resources const& transitions)
+{
+    if (!_options->merge_transitions)
+    {
+        flush_transitions();
+        _pending_transitions = transitions;
+        _has_pending_transitions = true;
+        flush_transitions();
+        return;
+    }
+
+    if (_has_pending_transitions)
+        ++_stats.num_transition_commands_merged;
+    else
+        _pending_transitions.transitions.clear();
+
+    _has_pending_transitions = true;
+
+    for (transition_info const& transition : transitions.transitions)
+    {
+        // no commands occur between transitions of a run, usually only the last target state of a resource matters
+        transition_info* superseded = nullptr;
+        for (transition_info& pending : _pending_transitions.transitions)
+        {
+            if (pending.resource == transition.resource)
+            {
+                superseded = &pending;
+                break;
+            }
+        }
+
+        if (superseded != nullptr)
+        {
+            if (can_collapse(*superseded, transition))
+            {
+                *superseded = transition;
+                ++_stats.num_transitions_dropped;
+                continue;
+            }
+
+            // the intermediate state orders accesses before and after the run (ie. UAV -> SRV -> UAV between two writing dispatches),
+            // end the run so both transitions are recorded
+            flush_transitions();
+            _pending_transitions.transitions.clear();
+            _has_pending_transitions = true;
+        }
+        else if (_pending_transitions.transitions.full())
+        {
+            // the merged command is full, continue the run in a new one
+            flush_transitions();
+            _pending_transitions.transitions.clear();
+            _has_pending_transitions = true;
+        }
+
+        _pending_transitions.transitions.push_back(transition);
+    }
+}
+
+bool phi::command_stream_optimizer::can_collapse(transition_info const& superseded, transition_info const& transition)
+{
+    // collapsing into a transition to the same state drops nothing
+    if (superseded.target_state == transition.target_state)
+        return true;
+
+    // the run has not been flushed yet, the known state is the one before the superseded transition
+    known_state const* const known = _known_states.find(transition.resource);
+    if (known == nullptr || !known->is_known)
+        return false;
+
+    // otherwise the superseded transition can only be dropped if it was redundant, targeting the start state
+    return superseded.target_state == known->state;
+}
+
+void phi::command_stream_optimizer::flush_transitions()
+{
+    if (!_has_pending_transitions)
+        return;
+
+    _has_pending_transitions = false;
+
+    cmd::transition_resources result;
+    for (transition_info const& transition : _pending_transitions.transitions)
+    {
+        known_state* const known = _known_states.find(transition.resource);
+
+        if (_options->drop_redundant_transitions && known != nullptr && known->is_known && known->state == transition.target_state
+            && known->dependencies == transition.dependent_shaders)
+        {
+            ++_stats.num_transitions_dropped;
+            continue;
+        }
+
+        if (known != nullptr)
+            *known = known_state{transition.resource, transition.target_state, transition.dependent_shaders, true};
+        else
+            _known_states.insert(known_state{transition.resource, transition.target_state, transition.dependent_shaders, true});
+
+        result.transitions.push_back(transition);
+    }
+
+    if (!result.transitions.empty())
+        emit(result);
+}
+
+void phi::command_stream_optimizer::forget_state(handle::resource res)
+{
+    if (known_state* const known = _known_states.find(res))
+        known->is_known = false;
+}
+
+void phi::command_stream_optimizer::end_render_pass(cmd::detail::cmd_base const* end_cmd)
+{
+    uint32_t const index = _render_pass_index++;
+
+    if (_options->drop_empty_render_passes && is_render_pass_empty())
+    {
+        ++_stats.num_render_passes_dropped;
+    }
+    else
+    {
+        bool const is_order_independent = _options->sort_draws
+                                          || std::find(_options->order_independent_render_passes.begin(),
+                                                       _options->order_independent_render_passes.end(), index)
+                                                 != _options->order_independent_render_passes.end();
+
+        if (is_order_independent && is_render_pass_sortable())
+            sort_render_pass_draws();
+
+        emit(*_render_pass_begin);
+        for (cmd_base const* body_cmd : _render_pass_body)
+            emit(*body_cmd);
+        emit(*end_cmd);
+    }
+
+    _render_pass_begin = nullptr;
+    _render_pass_body.clear();
+}
+
+bool phi::command_stream_optimizer::is_render_pass_empty() const
+{
+    auto const& begin_rp = static_cast<cmd::begin_render_pass const&>(*_render_pass_begin);
+
+    // clears are observable
+    for (auto const& rt : begin_rp.render_targets)
+    {
+        if (rt.clear_type == rt_clear_type::clear)
+            return false;
+    }
+
+    if (begin_rp.depth_target.rv.resource.is_valid() && begin_rp.depth_target.clear_type == rt_clear_type::clear)
+        return false;
+
+    // state changes without draws are not
+    for (cmd_base const* body_cmd : _render_pass_body)
+    {
+        switch (body_cmd->s_internal_type)
+        {
+        case cmd_type::set_pipeline_state:
+        case cmd_type::set_shader_arguments:
+        case cmd_type::set_vertex_buffers:
+        case cmd_type::set_scissor:
+        case cmd_type::code_location_marker:
+            break;
+        default:
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool phi::command_stream_optimizer::is_render_pass_sortable() const
+{
+    if (_render_pass_body.size() < 2)
+        return false;
+
+    // a draw without a scissor uses the one set by the draw before it, unless no draw sets any
+    bool has_draw_without_scissor = false;
+    bool has_draw_with_scissor = false;
+
+    for (cmd_base const* body_cmd : _render_pass_body)
+    {
+        switch (body_cmd->s_internal_type)
+        {
+        case cmd_type::draw:
+            if (static_cast<cmd::draw const*>(body_cmd)->scissor.min.x != -1)
+                has_draw_with_scissor = true;
+            else
+                has_draw_without_scissor = true;
+            break;
+        case cmd_type::draw_indirect:
+        case cmd_type::draw_batch:
+            has_draw_without_scissor = true;
+            break;
+        default:
+            // compact commands depend on the state of previous ones, others might be order-dependent
+            return false;
+        }
+    }
+
+    return !(has_draw_with_scissor && has_draw_without_scissor);
+}
+
+void phi::command_stream_optimizer::sort_render_pass_draws()
+{
+    // stable, equal draws keep their relative order and the result is deterministic
+    std::stable_sort(_render_pass_body.begin(), _render_pass_body.end(),
+                     [](cmd_base const* lhs, cmd_base const* rhs) { return get_sort_key(*lhs) < get_sort_key(*rhs); });
+
+    ++_stats.num_render_passes_sorted;
+}
+
+void phi::command_stream_optimizer::emit(cmd::detail::cmd_base const& cmd)
+{
+    size_t const size = cmd::detail::get_command_size(cmd);
+    CC_ASSERT(_writer->can_accomodate(size) && "command_stream_optimizer output writer full");
+
+    std::memcpy(_writer->buffer_head(), &cmd, size);
+    _writer->advance_cursor(size);
+    ++_stats.num_commands_out;
+}
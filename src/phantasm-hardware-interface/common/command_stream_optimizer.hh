@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+
+#include <clean-core/alloc_vector.hh>
+#include <clean-core/span.hh>
+
+#include <phantasm-hardware-interface/commands.hh>
+#include <phantasm-hardware-interface/common/incomplete_state_cache.hh>
+
+namespace phi
+{
+/// the rewrites performed by command_stream_optimizer
+/// none of them change the results of the stream, except sort_draws and order_independent_render_passes which rely on the caller
+struct command_stream_optimizer_options
+{
+    /// merge runs of adjacent cmd::transition_resources into one
+    /// a resource transitioned more than once within a run is transitioned once, into its last target state,
+    /// unless an intermediate state differs from both its start and end state (ie. UAV -> SRV -> UAV orders two writes),
+    /// or the start state is not known, in which case the run is split at the second transition
+    bool merge_transitions = true;
+
+    /// drop transitions into the state and shader dependencies a resource is already in from an earlier transition in the stream
+    bool drop_redundant_transitions = true;
+
+    /// drop render passes that contain no draws and do not clear any of their targets
+    bool drop_empty_render_passes = true;
+
+    /// drop cmd::begin_debug_label, cmd::end_debug_label and cmd::code_location_marker, usually enabled in release builds
+    bool drop_debug_markers = false;
+
+    /// sort the draws of all render passes by pipeline state and arguments, the caller asserts that their order does not matter
+    bool sort_draws = false;
+
+    /// indices of render passes (in stream order) whose draws are sorted, in addition to sort_draws
+    cc::span<uint32_t const> order_independent_render_passes = {};
+};
+
+struct command_stream_optimizer_stats
+{
+    uint32_t num_commands_in = 0;
+    uint32_t num_commands_out = 0;
+
+    /// cmd::transition_resources merged into a preceding one
+    uint32_t num_transition_commands_merged = 0;
+    /// individual transitions dropped as redundant or superseded within a merged run
+    uint32_t num_transitions_dropped = 0;
+    uint32_t num_render_passes_dropped = 0;
+    uint32_t num_debug_markers_dropped = 0;
+    uint32_t num_render_passes_sorted = 0;
+
+    uint32_t get_num_removed_commands() const { return num_commands_in - num_commands_out; }
+};
+
+/// an optional, backend-independent pass over a command stream before it is recorded, writing a rewritten stream
+/// render passes are sorted only if they consist entirely of self-contained draws (cmd::draw, draw_indirect, draw_batch)
+/// that do not depend on a scissor set by a previous draw
+/// memory is kept across uses, unsynchronized
+///
+/// example:
+///     auto const stats = optimizer.optimize(writer.get_chunks(), out_writer, options);
+///     auto const list = backend.recordCommandList(out_writer.buffer(), out_writer.size());
+struct command_stream_optimizer
+{
+    void initialize(cc::allocator* alloc, uint32_t initial_num_resources = 64);
+    void destroy();
+
+    /// writes the optimized stream to the writer, which must have room for at least the size of the input
+    command_stream_optimizer_stats optimize(cc::span<command_stream_chunk const> chunks,
+                                            command_stream_writer& out_writer,
+                                            command_stream_optimizer_options const& options = {});
+
+    command_stream_optimizer_stats optimize(std::byte const* buffer, size_t size, command_stream_writer& out_writer, command_stream_optimizer_options const& options = {})
+    {
+        command_stream_chunk const chunk = {buffer, size};
+        return optimize(cc::span<command_stream_chunk const>(&chunk, 1), out_writer, options);
+    }
+
+private:
+    void process_command(cmd::detail::cmd_base const& cmd);
+
+    void add_transitions(cmd::transition_resources const& transitions);
+    /// whether the pending transition of a resource can be replaced by a following one in the same run
+    [[nodiscard]] bool can_collapse(transition_info const& superseded, transition_info const& transition);
+    void flush_transitions();
+    void forget_state(handle::resource res);
+
+    void end_render_pass(cmd::detail::cmd_base const* end_cmd);
+    [[nodiscard]] bool is_render_pass_empty() const;
+    [[nodiscard]] bool is_render_pass_sortable() const;
+    void sort_render_pass_draws();
+
+    void emit(cmd::detail::cmd_base const& cmd);
+
+private:
+    struct known_state
+    {
+        handle::resource ptr;
+        resource_state state;
+        shader_stage_flags_t dependencies;
+        bool is_known;
+    };
+
+    // the state of each resource after the most recent transition in the stream
+    detail::generic_incomplete_state_cache<known_state> _known_states;
+
+    // the current run of adjacent transitions
+    cmd::transition_resources _pending_transitions;
+    bool _has_pending_transitions = false;
+
+    // the currently open render pass, its body is buffered until cmd::end_render_pass
+    cmd::detail::cmd_base const* _render_pass_begin = nullptr;
+    cc::alloc_vector<cmd::detail::cmd_base const*> _render_pass_body;
+    uint32_t _render_pass_index = 0;
+
+    // per call
+    command_stream_writer* _writer = nullptr;
+    command_stream_optimizer_options const* _options = nullptr;
+    command_stream_optimizer_stats _stats;
+};
+}
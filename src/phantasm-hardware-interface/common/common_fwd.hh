@@ -4,7 +4,7 @@
 
 namespace phi::detail
 {
-template <class StateT>
+template <class EntryT>
 struct generic_incomplete_state_cache;
 
 template <class KeyT, class ValT>
@@ -13,6 +13,8 @@ template <class KeyT, class ValT, size_t N>
 struct capped_flat_map;
 template <class KeyT, class ValueT, class HashT>
 struct stable_map;
+template <class KeyT, class ValueT, class HashT, bool IsConcurrent>
+struct growable_map;
 
 }
 
@@ -24,6 +26,8 @@ struct linked_pool;
 template <class T, uint8_t N>
 struct flat_vector;
 
+struct bitmap_page_allocator;
+struct mapped_file;
 struct page_allocator;
 struct thread_association;
 struct unique_buffer;
@@ -0,0 +1,345 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include <clean-core/alloc_array.hh>
+#include <clean-core/alloc_vector.hh>
+#include <clean-core/assert.hh>
+#include <clean-core/bits.hh>
+#include <clean-core/hash.hh>
+#include <clean-core/new.hh>
+#include <clean-core/utility.hh>
+
+namespace phi::detail
+{
+/// open addressing hash map with stable element addresses, growing on demand
+///
+/// the index is a power-of-two array of (hash, element index) pairs probed linearly, 4 slots per cache line
+/// elements live in fixed-size chunks which are never relocated, growth only rebuilds the index from the stored hashes
+/// erasing shifts back the probe chain instead of leaving tombstones, erased elements are recycled
+///
+/// with IsConcurrent, all operations are internally synchronized
+/// references to elements remain valid across inserts from other threads until they are erased
+/// without it, the map is unsynchronized
+template <class KeyT, class ValueT, class HashT = cc::hash<KeyT>, bool IsConcurrent = false>
+struct growable_map
+{
+public:
+    struct element
+    {
+        KeyT key;
+        ValueT value;
+
+        template <class T>
+        explicit element(T const& k) : key(k), value()
+        {
+        }
+    };
+
+    static constexpr uint32_t num_elements_per_chunk = 64;
+
+public:
+    growable_map() = default;
+    growable_map(growable_map const&) = delete;
+    growable_map(growable_map&&) noexcept = delete;
+    ~growable_map() { destroy(); }
+
+    void initialize(size_t initial_capacity, cc::allocator* alloc)
+    {
+        CC_ASSERT(_alloc == nullptr && "double initialize");
+        _alloc = alloc;
+
+        // the index grows once it is half full, so reserve twice the requested capacity
+        size_t const num_slots = cc::max<size_t>(cc::ceil_pow2(initial_capacity * 2), 16);
+        _slots = cc::alloc_array<slot>::defaulted(num_slots, alloc);
+        _chunks.reset_reserve(alloc, (initial_capacity + num_elements_per_chunk - 1) / num_elements_per_chunk);
+        _free_elements.reset_reserve(alloc, 16);
+    }
+
+    /// destroys all elements and frees all memory
+    void destroy()
+    {
+        if (_alloc == nullptr)
+            return;
+
+        reset();
+        for (element* const chunk : _chunks)
+            _alloc->free(chunk);
+
+        _chunks = {};
+        _free_elements = {};
+        _slots = {};
+        _num_allocated_elements = 0;
+        _alloc = nullptr;
+    }
+
+    /// returns the element of the key, inserting it if not present
+    /// on insert, on_create(ValueT&) is called on the value-initialized value, in concurrent mode while still holding the lock
+    template <class T, class F>
+    element& get_or_create(T const& key, F&& on_create)
+    {
+        auto lg = acquire_lock();
+
+        uint64_t const hash = HashT{}(key);
+        uint32_t slot_idx = get_ideal_slot(hash);
+        while (_slots[slot_idx].element_index != 0)
+        {
+            slot const& s = _slots[slot_idx];
+            if (s.hash == hash)
+            {
+                element& elem = get_element(s.element_index - 1);
+                if (elem.key == key)
+                    return elem;
+            }
+
+            slot_idx = next_slot(slot_idx);
+        }
+
+        // not found, insert
+        if ((_num_elements + 1) * 2 > _slots.size())
+        {
+            grow();
+
+            slot_idx = get_ideal_slot(hash);
+            while (_slots[slot_idx].element_index != 0)
+                slot_idx = next_slot(slot_idx);
+        }
+
+        uint32_t const elem_index = acquire_element_index();
+        element* const elem = new (cc::placement_new, get_element_storage(elem_index)) element(key);
+
+        _slots[slot_idx] = slot{hash, elem_index + 1};
+        ++_num_elements;
+
+        on_create(elem->value);
+        return *elem;
+    }
+
+    /// returns the element of the key, inserting a value-initialized one if not present
+    template <class T>
+    ValueT& operator[](T const& key)
+    {
+        return get_or_create(key, [](ValueT&) {}).value;
+    }
+
+    /// returns the value of the key or nullptr
+    template <class T>
+    ValueT* find(T const& key)
+    {
+        auto lg = acquire_lock();
+
+        uint32_t const slot_idx = find_slot(key);
+        return slot_idx == invalid_slot ? nullptr : &get_element(_slots[slot_idx].element_index - 1).value;
+    }
+
+    template <class T>
+    ValueT const* find(T const& key) const
+    {
+        auto lg = acquire_lock();
+
+        uint32_t const slot_idx = find_slot(key);
+        return slot_idx == invalid_slot ? nullptr : &get_element(_slots[slot_idx].element_index - 1).value;
+    }
+
+    template <class T>
+    bool contains_key(T const& key) const
+    {
+        auto lg = acquire_lock();
+        return find_slot(key) != invalid_slot;
+    }
+
+    /// destroys the element of the key, returns false if not present
+    template <class T>
+    bool erase(T const& key)
+    {
+        auto lg = acquire_lock();
+
+        uint32_t const slot_idx = find_slot(key);
+        if (slot_idx == invalid_slot)
+            return false;
+
+        uint32_t const elem_index = _slots[slot_idx].element_index - 1;
+        get_element(elem_index).~element();
+        _free_elements.push_back(elem_index);
+
+        erase_slot(slot_idx);
+        return true;
+    }
+
+    /// calls func(ValueT&) for all elements, must not be called concurrently with modifications
+    template <class F>
+    void iterate_elements(F&& func)
+    {
+        for (auto const& s : _slots)
+        {
+            if (s.element_index != 0)
+                func(get_element(s.element_index - 1).value);
+        }
+    }
+
+    /// destroys all elements, keeps memory allocated
+    void reset()
+    {
+        auto lg = acquire_lock();
+
+        _free_elements.clear();
+        for (auto& s : _slots)
+        {
+            if (s.element_index != 0)
+                get_element(s.element_index - 1).~element();
+
+            s = slot{};
+        }
+
+        // all allocated elements are free now
+        for (uint32_t i = _num_allocated_elements; i > 0; --i)
+            _free_elements.push_back(i - 1);
+
+        _num_elements = 0;
+    }
+
+    size_t size() const { return _num_elements; }
+    size_t capacity() const { return _slots.size() / 2; }
+
+    /// amount of operations which had to wait for the lock (IsConcurrent only)
+    uint64_t get_num_contended_locks() const { return _num_contended.load(std::memory_order_relaxed); }
+
+private:
+    struct slot
+    {
+        uint64_t hash = 0;
+        uint32_t element_index = 0; ///< index + 1, 0 marks an empty slot
+        uint32_t _pad = 0;
+    };
+
+    static constexpr uint32_t invalid_slot = uint32_t(-1);
+
+    struct null_lock
+    {
+    };
+
+    auto acquire_lock() const
+    {
+        if constexpr (IsConcurrent)
+        {
+            auto lock = std::unique_lock(_mutex, std::try_to_lock);
+            if (!lock.owns_lock())
+            {
+                _num_contended.fetch_add(1, std::memory_order_relaxed);
+                lock.lock();
+            }
+
+            return lock;
+        }
+        else
+        {
+            return null_lock{};
+        }
+    }
+
+    uint32_t get_ideal_slot(uint64_t hash) const
+    {
+        // fibonacci hashing, the upper bits are well distributed even for weak input hashes
+        return uint32_t((hash * 0x9E3779B97F4A7C15ull) >> 32) & (uint32_t(_slots.size()) - 1);
+    }
+
+    uint32_t next_slot(uint32_t slot_idx) const { return (slot_idx + 1) & (uint32_t(_slots.size()) - 1); }
+
+    template <class T>
+    uint32_t find_slot(T const& key) const
+    {
+        if (_num_elements == 0)
+            return invalid_slot;
+
+        uint64_t const hash = HashT{}(key);
+        uint32_t slot_idx = get_ideal_slot(hash);
+        while (_slots[slot_idx].element_index != 0)
+        {
+            slot const& s = _slots[slot_idx];
+            if (s.hash == hash && get_element(s.element_index - 1).key == key)
+                return slot_idx;
+
+            slot_idx = next_slot(slot_idx);
+        }
+
+        return invalid_slot;
+    }
+
+    void erase_slot(uint32_t slot_idx)
+    {
+        uint32_t const mask = uint32_t(_slots.size()) - 1;
+
+        uint32_t hole = slot_idx;
+        uint32_t next = next_slot(hole);
+        while (_slots[next].element_index != 0)
+        {
+            uint32_t const ideal = get_ideal_slot(_slots[next].hash);
+
+            // move the element into the hole if the hole lies cyclically within [ideal, next)
+            if (((next - ideal) & mask) >= ((next - hole) & mask))
+            {
+                _slots[hole] = _slots[next];
+                hole = next;
+            }
+
+            next = next_slot(next);
+        }
+
+        _slots[hole] = slot{};
+        --_num_elements;
+    }
+
+    void grow()
+    {
+        auto old_slots = cc::move(_slots);
+        _slots = cc::alloc_array<slot>::defaulted(old_slots.size() * 2, _alloc);
+
+        // elements stay in place, only the index is rebuilt
+        for (auto const& s : old_slots)
+        {
+            if (s.element_index == 0)
+                continue;
+
+            uint32_t slot_idx = get_ideal_slot(s.hash);
+            while (_slots[slot_idx].element_index != 0)
+                slot_idx = next_slot(slot_idx);
+
+            _slots[slot_idx] = s;
+        }
+    }
+
+    uint32_t acquire_element_index()
+    {
+        if (!_free_elements.empty())
+        {
+            uint32_t const res = _free_elements.back();
+            _free_elements.pop_back();
+            return res;
+        }
+
+        if (_num_allocated_elements == _chunks.size() * num_elements_per_chunk)
+        {
+            auto* const new_chunk = static_cast<element*>(_alloc->alloc(sizeof(element) * num_elements_per_chunk, alignof(element)));
+            _chunks.push_back(new_chunk);
+        }
+
+        return _num_allocated_elements++;
+    }
+
+    element* get_element_storage(uint32_t index) const { return _chunks[index / num_elements_per_chunk] + index % num_elements_per_chunk; }
+    element& get_element(uint32_t index) const { return *get_element_storage(index); }
+
+private:
+    cc::allocator* _alloc = nullptr;
+    cc::alloc_array<slot> _slots;
+    cc::alloc_vector<element*> _chunks;
+    cc::alloc_vector<uint32_t> _free_elements;
+    uint32_t _num_elements = 0;
+    uint32_t _num_allocated_elements = 0;
+
+    mutable std::mutex _mutex;
+    mutable std::atomic<uint64_t> _num_contended = {0};
+};
+}
@@ -0,0 +1,100 @@
+#include "mapped_file.hh"
+
+#include <clean-core/macros.hh>
+
+#ifdef CC_OS_WINDOWS
+#include <clean-core/native/win32_sanitized.hh>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+phi::mapped_file::mapped_file(mapped_file&& rhs) noexcept
+{
+    _ptr = rhs._ptr;
+    _size = rhs._size;
+    rhs._ptr = nullptr;
+    rhs._size = 0;
+}
+
+phi::mapped_file& phi::mapped_file::operator=(mapped_file&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        unmap();
+        _ptr = rhs._ptr;
+        _size = rhs._size;
+        rhs._ptr = nullptr;
+        rhs._size = 0;
+    }
+
+    return *this;
+}
+
+phi::mapped_file phi::mapped_file::create_from_binary_file(char const* filename)
+{
+    mapped_file res;
+
+#ifdef CC_OS_WINDOWS
+    HANDLE const file = ::CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return res;
+
+    LARGE_INTEGER file_size;
+    if (::GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+    {
+        // the view keeps the mapping alive, both handles can be closed right away
+        HANDLE const mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr)
+        {
+            void* const view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (view != nullptr)
+            {
+                res._ptr = static_cast<std::byte const*>(view);
+                res._size = size_t(file_size.QuadPart);
+            }
+
+            ::CloseHandle(mapping);
+        }
+    }
+
+    ::CloseHandle(file);
+#else
+    int const fd = ::open(filename, O_RDONLY);
+    if (fd == -1)
+        return res;
+
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+    {
+        // the mapping stays valid after closing the descriptor
+        void* const view = ::mmap(nullptr, size_t(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED)
+        {
+            res._ptr = static_cast<std::byte const*>(view);
+            res._size = size_t(file_stat.st_size);
+        }
+    }
+
+    ::close(fd);
+#endif
+
+    return res;
+}
+
+void phi::mapped_file::unmap()
+{
+    if (_ptr == nullptr)
+        return;
+
+#ifdef CC_OS_WINDOWS
+    ::UnmapViewOfFile(_ptr);
+#else
+    ::munmap(const_cast<std::byte*>(_ptr), _size);
+#endif
+
+    _ptr = nullptr;
+    _size = 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+#include <clean-core/span.hh>
+
+#include <phantasm-hardware-interface/common/api.hh>
+
+namespace phi
+{
+/// read-only memory mapping of a whole file, the read-only counterpart to unique_buffer without copying the contents
+/// pages are loaded on first access and shared with the OS page cache
+struct PHI_API mapped_file
+{
+    explicit mapped_file() = default;
+
+    mapped_file(mapped_file const&) = delete;
+    mapped_file& operator=(mapped_file const&) = delete;
+
+    mapped_file(mapped_file&& rhs) noexcept;
+    mapped_file& operator=(mapped_file&& rhs) noexcept;
+
+    ~mapped_file() { unmap(); }
+
+    std::byte const* data() const { return _ptr; }
+    size_t size() const { return _size; }
+    cc::span<std::byte const> get_span() const { return {_ptr, _size}; }
+
+    /// empty files are mapped successfully but are not valid
+    bool is_valid() const { return _ptr != nullptr; }
+
+    /// returns an invalid mapped_file on failure
+    [[nodiscard]] static mapped_file create_from_binary_file(char const* filename);
+
+private:
+    void unmap();
+
+    std::byte const* _ptr = nullptr;
+    size_t _size = 0;
+};
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include <clean-core/alloc_vector.hh>
+#include <clean-core/assert.hh>
+#include <clean-core/span.hh>
+
+#include <phantasm-hardware-interface/types.hh>
+
+namespace phi
+{
+/// a queue of handles whose destruction is deferred until the GPU has finished all work submitted before they were freed
+/// each queue_type has a submit timeline, incremented by the backend on every submit and signalled on the GPU
+/// frees are batched by the timeline values at the time of the free and reclaimed in bulk once all of them have been reached
+/// synchronized
+struct deferred_free_queue
+{
+    static constexpr uint32_t num_queue_types = 3;
+
+    enum class handle_type : uint8_t
+    {
+        resource,
+        shader_view,
+        pipeline_state,
+        accel_struct
+    };
+
+    struct entry
+    {
+        handle_type type;
+        handle::handle_t value;
+    };
+
+    void initialize(cc::allocator* dynamic_alloc)
+    {
+        _entries.reset_reserve(dynamic_alloc, 256);
+        _batches.reset_reserve(dynamic_alloc, 16);
+    }
+
+    void destroy()
+    {
+        CC_ASSERT(_batches.empty() && "deferred frees must be collected before destruction");
+        _entries = {};
+        _batches = {};
+    }
+
+    /// returns the timeline value to signal on the given queue with the next submit
+    /// submits to a single queue_type are externally synchronized, values increase strictly in submission order
+    [[nodiscard]] uint64_t increment_submit_value(queue_type queue)
+    {
+        return _last_submit_values[static_cast<uint8_t>(queue)].fetch_add(1, std::memory_order_acq_rel) + 1;
+    }
+
+    /// enqueue handles to be freed once all work submitted up to now has completed, invalid handles are ignored
+    template <class HandleT>
+    void enqueue(handle_type type, cc::span<HandleT> handles)
+    {
+        auto lg = std::lock_guard(_mutex);
+
+        uint64_t values[num_queue_types];
+        for (auto i = 0u; i < num_queue_types; ++i)
+            values[i] = _last_submit_values[i].load(std::memory_order_acquire);
+
+        // values are read under the lock and never decrease, so batches are ordered component-wise
+        if (_batches.empty() || !_batches.back().has_values(values))
+        {
+            batch& new_batch = _batches.emplace_back();
+            for (auto i = 0u; i < num_queue_types; ++i)
+                new_batch.submit_values[i] = values[i];
+            new_batch.num_entries = 0;
+        }
+
+        batch& current_batch = _batches.back();
+        for (auto const h : handles)
+        {
+            if (!h.is_valid())
+                continue;
+
+            _entries.push_back(entry{type, h._value});
+            ++current_batch.num_entries;
+            ++_num_enqueued;
+        }
+    }
+
+    /// calls destroy_func(entry) for all entries whose submit values have been reached by the completed values
+    /// pass nullptr as completed_values to reclaim everything regardless (only after a full GPU flush)
+    /// returns the amount of reclaimed entries
+    template <class F>
+    uint32_t collect(uint64_t const* completed_values, F&& destroy_func)
+    {
+        auto lg = std::lock_guard(_mutex);
+        ++_num_collections;
+
+        // batches are ordered component-wise, the reclaimable ones are always a prefix
+        size_t num_ready_batches = 0;
+        size_t num_ready_entries = 0;
+        while (num_ready_batches < _batches.size() && (completed_values == nullptr || _batches[num_ready_batches].is_reached(completed_values)))
+        {
+            num_ready_entries += _batches[num_ready_batches].num_entries;
+            ++num_ready_batches;
+        }
+
+        if (num_ready_batches == 0)
+            return 0;
+
+        for (auto i = 0u; i < num_ready_entries; ++i)
+            destroy_func(_entries[i]);
+
+        // shift the remainder to the front
+        for (auto i = num_ready_entries; i < _entries.size(); ++i)
+            _entries[i - num_ready_entries] = _entries[i];
+        _entries.resize(_entries.size() - num_ready_entries);
+
+        for (auto i = num_ready_batches; i < _batches.size(); ++i)
+            _batches[i - num_ready_batches] = _batches[i];
+        _batches.resize(_batches.size() - num_ready_batches);
+
+        _num_reclaimed += num_ready_entries;
+        return uint32_t(num_ready_entries);
+    }
+
+    [[nodiscard]] deferred_free_stats get_stats()
+    {
+        auto lg = std::lock_guard(_mutex);
+
+        deferred_free_stats res;
+        res.num_enqueued = _num_enqueued;
+        res.num_reclaimed = _num_reclaimed;
+        res.num_collections = _num_collections;
+        res.num_pending = uint32_t(_entries.size());
+        res.num_pending_batches = uint32_t(_batches.size());
+        return res;
+    }
+
+private:
+    struct batch
+    {
+        uint64_t submit_values[num_queue_types];
+        uint32_t num_entries;
+
+        bool has_values(uint64_t const* values) const
+        {
+            for (auto i = 0u; i < num_queue_types; ++i)
+                if (submit_values[i] != values[i])
+                    return false;
+
+            return true;
+        }
+
+        bool is_reached(uint64_t const* completed_values) const
+        {
+            for (auto i = 0u; i < num_queue_types; ++i)
+                if (completed_values[i] < submit_values[i])
+                    return false;
+
+            return true;
+        }
+    };
+
+    std::atomic<uint64_t> _last_submit_values[num_queue_types] = {};
+
+    cc::alloc_vector<entry> _entries;
+    cc::alloc_vector<batch> _batches;
+
+    uint64_t _num_enqueued = 0;
+    uint64_t _num_reclaimed = 0;
+    uint64_t _num_collections = 0;
+
+    std::mutex _mutex;
+};
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <clean-core/alloc_array.hh>
+#include <clean-core/assert.hh>
+#include <clean-core/move.hh>
+#include <clean-core/utility.hh>
+
+#include <phantasm-hardware-interface/common/container/growable_map.hh>
+#include <phantasm-hardware-interface/types.hh>
+
+namespace phi::detail
+{
+/// backend-agnostic storage of an incomplete state cache, EntryT must be trivially copyable and have a handle::resource member "ptr"
+/// entries are stored densely in insertion order, lookups are linear for few entries and go through
+/// an index keyed by the resource handle beyond that
+/// capacity starts at the configured amount and grows on demand, memory is kept across resets
+/// unsynchronized
+template <class EntryT>
+struct generic_incomplete_state_cache
+{
+    /// up to this amount of entries, lookups are a linear scan and the index is not maintained
+    static constexpr uint32_t max_num_linear_entries = 16;
+
+    void initialize(cc::allocator* alloc, uint32_t initial_capacity)
+    {
+        CC_ASSERT(_alloc == nullptr && "double init");
+        _alloc = alloc;
+        entries = cc::alloc_array<EntryT>::uninitialized(cc::max(initial_capacity, 1u), _alloc);
+        _index.initialize(cc::max(initial_capacity, max_num_linear_entries + 1), _alloc);
+        num_entries = 0;
+    }
+
+    void destroy()
+    {
+        entries = {};
+        _index.destroy();
+        num_entries = 0;
+        _alloc = nullptr;
+    }
+
+    void reset()
+    {
+        if (num_entries > max_num_linear_entries)
+            _index.reset();
+
+        num_entries = 0;
+    }
+
+    /// returns the entry of the given resource, or nullptr if it is not in the cache
+    EntryT* find(handle::resource res)
+    {
+        uint32_t const index = find_index(res);
+        return index == invalid_index ? nullptr : &entries[index];
+    }
+
+    bool contains(handle::resource res) const { return find_index(res) != invalid_index; }
+
+    /// appends a new entry, the resource must not be in the cache yet
+    EntryT& insert(EntryT const& entry)
+    {
+        if (num_entries == entries.size())
+            grow();
+
+        entries[num_entries] = entry;
+        ++num_entries;
+
+        if (num_entries == max_num_linear_entries + 1)
+        {
+            // switching from linear lookups to the index
+            for (auto i = 0u; i < num_entries; ++i)
+                _index[entries[i].ptr] = i;
+        }
+        else if (num_entries > max_num_linear_entries)
+        {
+            _index[entry.ptr] = num_entries - 1;
+        }
+
+        return entries[num_entries - 1];
+    }
+
+    uint32_t num_entries = 0;
+    cc::alloc_array<EntryT> entries;
+
+private:
+    static constexpr uint32_t invalid_index = uint32_t(-1);
+
+    struct resource_hasher
+    {
+        uint64_t operator()(handle::resource res) const noexcept { return res._value; }
+    };
+
+    uint32_t find_index(handle::resource res) const
+    {
+        if (num_entries <= max_num_linear_entries)
+        {
+            for (auto i = 0u; i < num_entries; ++i)
+            {
+                if (entries[i].ptr == res)
+                    return i;
+            }
+
+            return invalid_index;
+        }
+
+        uint32_t const* const index = _index.find(res);
+        return index == nullptr ? invalid_index : *index;
+    }
+
+    void grow()
+    {
+        auto new_entries = cc::alloc_array<EntryT>::uninitialized(entries.size() * 2, _alloc);
+        std::memcpy(new_entries.data(), entries.data(), sizeof(EntryT) * num_entries);
+        entries = cc::move(new_entries);
+    }
+
+    cc::allocator* _alloc = nullptr;
+    /// index from resource handle to entry index, only maintained beyond max_num_linear_entries
+    growable_map<handle::resource, uint32_t, resource_hasher> _index;
+};
+}
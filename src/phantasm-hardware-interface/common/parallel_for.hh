@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include <clean-core/capped_vector.hh>
+#include <clean-core/utility.hh>
+
+namespace phi::util
+{
+/// maximum amount of threads used by parallel_for, including the calling thread
+inline constexpr uint32_t parallel_for_max_threads = 32;
+
+/// calls func(i) for all i in [0, num_items), distributed dynamically across short-lived worker threads and the calling thread
+/// blocks until all items are done, func must be thread-safe
+/// used for expensive, init-time work only (PSO creation), not on hot paths
+/// the worker threads are not associated with the backend and must not make backend calls requiring a thread component
+template <class F>
+void parallel_for(uint32_t num_items, F&& func, uint32_t max_num_threads = 0)
+{
+    if (max_num_threads == 0)
+        max_num_threads = cc::max(1u, std::thread::hardware_concurrency());
+
+    uint32_t const num_threads = cc::min(cc::min(max_num_threads, parallel_for_max_threads), num_items);
+
+    if (num_threads <= 1)
+    {
+        for (auto i = 0u; i < num_items; ++i)
+            func(i);
+
+        return;
+    }
+
+    std::atomic<uint32_t> next_index = {0};
+
+    auto f_work = [&] {
+        for (uint32_t i = next_index.fetch_add(1, std::memory_order_relaxed); i < num_items; i = next_index.fetch_add(1, std::memory_order_relaxed))
+            func(i);
+    };
+
+    cc::capped_vector<std::thread, parallel_for_max_threads> workers;
+    for (auto i = 1u; i < num_threads; ++i)
+        workers.emplace_back(f_work);
+
+    f_work();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+}
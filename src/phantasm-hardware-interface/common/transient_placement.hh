@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include <clean-core/alloc_array.hh>
+#include <clean-core/assert.hh>
+#include <clean-core/span.hh>
+#include <clean-core/utility.hh>
+
+namespace phi
+{
+/// memory requirements and lifetime interval (inclusive) of a resource placed in a shared memory block
+struct transient_placement_request
+{
+    uint64_t size = 0;
+    uint64_t alignment = 1;
+    uint32_t first_use = 0;
+    uint32_t last_use = 0;
+
+    bool is_alive_during(transient_placement_request const& rhs) const { return first_use <= rhs.last_use && rhs.first_use <= last_use; }
+};
+
+/// computes offsets into a single memory block so that resources with overlapping lifetimes never overlap in memory
+/// greedy: resources are placed from largest to smallest, each at the lowest aligned offset that does not intersect
+/// the already placed resources alive at the same time
+/// returns the required size of the memory block
+[[nodiscard]] inline uint64_t compute_transient_placement(cc::span<transient_placement_request const> requests, cc::span<uint64_t> out_offsets, cc::allocator* scratch_alloc)
+{
+    CC_ASSERT(requests.size() == out_offsets.size() && "output span size mismatch");
+
+    struct occupied_range
+    {
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    auto placement_order = cc::alloc_array<uint32_t>::uninitialized(requests.size(), scratch_alloc);
+    for (auto i = 0u; i < placement_order.size(); ++i)
+        placement_order[i] = i;
+
+    std::sort(placement_order.begin(), placement_order.end(), [&](uint32_t lhs, uint32_t rhs) {
+        if (requests[lhs].size != requests[rhs].size)
+            return requests[lhs].size > requests[rhs].size;
+        return lhs < rhs;
+    });
+
+    auto occupied = cc::alloc_array<occupied_range>::uninitialized(requests.size(), scratch_alloc);
+
+    uint64_t block_size = 0;
+    for (auto i = 0u; i < placement_order.size(); ++i)
+    {
+        transient_placement_request const& req = requests[placement_order[i]];
+        CC_ASSERT(req.first_use <= req.last_use && "invalid lifetime interval");
+        CC_ASSERT(req.alignment > 0 && "invalid alignment");
+
+        // memory ranges of all previously placed resources alive at the same time
+        uint32_t num_occupied = 0;
+        for (auto j = 0u; j < i; ++j)
+        {
+            uint32_t const placed_index = placement_order[j];
+            if (requests[placed_index].is_alive_during(req))
+                occupied[num_occupied++] = {out_offsets[placed_index], out_offsets[placed_index] + requests[placed_index].size};
+        }
+
+        std::sort(occupied.begin(), occupied.begin() + num_occupied, [](occupied_range const& lhs, occupied_range const& rhs) { return lhs.begin < rhs.begin; });
+
+        // first fit into the gaps between them
+        auto const f_align = [&](uint64_t offset) { return (offset + req.alignment - 1) / req.alignment * req.alignment; };
+
+        uint64_t candidate = 0;
+        for (auto j = 0u; j < num_occupied; ++j)
+        {
+            if (f_align(candidate) + req.size <= occupied[j].begin)
+                break;
+
+            candidate = cc::max(candidate, occupied[j].end);
+        }
+
+        uint64_t const offset = f_align(candidate);
+        out_offsets[placement_order[i]] = offset;
+        block_size = cc::max(block_size, offset + req.size);
+    }
+
+    return block_size;
+}
+}
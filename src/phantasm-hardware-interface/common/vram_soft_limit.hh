@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+
+#include <phantasm-hardware-interface/config.hh>
+#include <phantasm-hardware-interface/types.hh>
+
+namespace phi
+{
+/// invokes backend_config::vram_soft_limit_callback once whenever the device-local VRAM usage rises above the configured fraction of the budget
+/// re-arms once usage drops below it again
+/// synchronized
+struct vram_soft_limit
+{
+    void initialize(backend_config const& config)
+    {
+        _callback = config.vram_soft_limit_callback;
+        _userdata = config.vram_soft_limit_userdata;
+        _fraction = config.vram_soft_limit_fraction;
+    }
+
+    bool is_enabled() const { return _callback != nullptr; }
+
+    void check(vram_state_info const& info)
+    {
+        if (!is_enabled() || info.os_budget_bytes == 0)
+            return;
+
+        bool const is_above = info.get_usage_fraction() >= _fraction;
+        bool const was_above = _is_above.exchange(is_above, std::memory_order_relaxed);
+
+        if (is_above && !was_above)
+            _callback(info, _userdata);
+    }
+
+private:
+    void (*_callback)(vram_state_info const& info, void* userdata) = nullptr;
+    void* _userdata = nullptr;
+    float _fraction = 1.f;
+    std::atomic<bool> _is_above = {false};
+};
+}
@@ -4,6 +4,8 @@
 
 #include <clean-core/fwd.hh>
 
+#include <phantasm-hardware-interface/fwd.hh>
+
 namespace phi
 {
 enum class adapter_preference : uint8_t
@@ -93,10 +95,27 @@ struct backend_config
     // whether to print basic information on init
     bool print_startup_message = true;
 
+    // whether to defer frees of resources, shader views, pipeline states and accel structs
+    // until all GPU work submitted before the free has completed
+    // deferred handles are destroyed in bulk by Backend::collectGarbage, which should be called regularly (ie. once per frame)
+    bool enable_deferred_free = false;
+
+    // Vulkan: path of the file used to persist the VkPipelineCache across runs, nullptr to disable persistence
+    // loaded on init if compatible with the chosen GPU and driver, written on Backend::flushPipelineCache and on shutdown
+    // the cache of patched and reflected SPIR-V is persisted alongside it, at the same path with a ".spirv" suffix
+    char const* pipeline_cache_path = nullptr;
+
     // amount of threads to accomodate
     // backend calls must only be made from <= [num_threads] unique OS threads
     uint32_t num_threads = 1;
 
+    // Vulkan: amount of backend-owned worker threads translating large render passes in parallel, 0 disables this
+    // render passes with at least parallel_translation_min_draws draws are split into up to one segment per worker plus one for the recording thread,
+    // recorded into secondary command buffers and executed in stream order, the result is independent of scheduling
+    // render passes containing profile scopes, or debug labels crossing their boundaries, are always translated serially
+    uint32_t num_translation_worker_threads = 0;
+    uint32_t parallel_translation_min_draws = 512;
+
     // allocator for init-time allocations, only hit during init and shutdown
     cc::allocator* static_allocator = cc::system_allocator;
     // allocator for runtime allocations, must be thread-safe
@@ -105,6 +124,9 @@ struct backend_config
     //
     // resource limits
     //
+    // Vulkan: the shader view and descriptor limits are split into one descriptor pool block per thread,
+    // threads claim additional blocks on demand, single shader views larger than a block use a shared pool with the full limits
+    //
 
     // maximum amount of handle::swapchain objects
     uint32_t max_num_swapchains = 32;
@@ -127,6 +149,13 @@ struct backend_config
     uint32_t max_num_accel_structs = 2048;
     // maximum amount of raytracing handle::pipeline_state objects
     uint32_t max_num_raytrace_pipeline_states = 256;
+    // Vulkan: maximum amount of framebuffers (and their attachment image views) kept alive for reuse across render passes
+    // once full, the least recently used framebuffer is evicted if it has not been used in the last framebuffer_cache_eviction_age submits to the direct queue,
+    // otherwise the render pass falls back to a transient framebuffer
+    // the eviction age must exceed the amount of direct queue submits in flight on the GPU (backbuffers times submits per frame),
+    // and command lists must be submitted or discarded within that amount of submits
+    uint32_t max_num_cached_framebuffers = 256;
+    uint32_t framebuffer_cache_eviction_age = 32;
 
     // command list allocators per thread, split into queue types
     // maximum amount of handle::command_list objects is computed as:
@@ -137,13 +166,26 @@ struct backend_config
     uint32_t num_compute_cmdlists_per_allocator = 5;
     uint32_t num_copy_cmdlist_allocators_per_thread = 3;
     uint32_t num_copy_cmdlists_per_allocator = 3;
+    // Vulkan: secondary command buffers per allocator of each translation worker and recording thread, which use num_direct_cmdlist_allocators_per_thread allocators
+    uint32_t num_secondary_cmdlists_per_allocator = 16;
 
     // command list limits
+    // initial capacity of the per-cmdlist resource state caches, they grow on demand beyond it
     uint32_t max_num_unique_transitions_per_cmdlist = 64;
 
     // query heap sizes
     uint32_t num_timestamp_queries = 1024;
     uint32_t num_occlusion_queries = 1024;
     uint32_t num_pipeline_stat_queries = 256;
+
+    //
+    // VRAM budget
+    //
+
+    // optional, called when the device-local VRAM usage crosses vram_soft_limit_fraction of the OS budget (see Backend::getVRAMInfo)
+    // checked on Backend::getVRAMInfo and after resource creation, called once per crossing from the thread that caused the check
+    void (*vram_soft_limit_callback)(vram_state_info const& info, void* userdata) = nullptr;
+    void* vram_soft_limit_userdata = nullptr;
+    float vram_soft_limit_fraction = 0.9f;
 };
 } // namespace phi
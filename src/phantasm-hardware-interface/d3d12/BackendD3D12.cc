@@ -88,6 +88,20 @@ void phi::d3d12::BackendD3D12::initialize(const phi::backend_config& config)
         mPoolSwapchains.initialize(&mAdapter.getFactory(), device, mDirectQueue.command_queue, config.max_num_swapchains, config.static_allocator);
     }
 
+    mVRAMSoftLimit.initialize(config);
+
+    // Deferred free timelines
+    mIsDeferredFreeEnabled = config.enable_deferred_free;
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.initialize(config.dynamic_allocator);
+
+        for (auto& timeline : mSubmitTimelines)
+        {
+            timeline.initialize(*device);
+        }
+    }
+
     // Per-thread components and command list pool
     {
 #ifdef PHI_HAS_OPTICK
@@ -114,7 +128,7 @@ void phi::d3d12::BackendD3D12::initialize(const phi::backend_config& config)
                                  int(config.num_compute_cmdlist_allocators_per_thread), int(config.num_compute_cmdlists_per_allocator), //
                                  int(config.num_copy_cmdlist_allocators_per_thread), int(config.num_copy_cmdlists_per_allocator),
                                  config.max_num_unique_transitions_per_cmdlist, //
-                                 thread_allocator_ptrs);
+                                 thread_allocator_ptrs, config.dynamic_allocator);
     }
 
     mDiagnostics.init();
@@ -138,6 +152,18 @@ void phi::d3d12::BackendD3D12::destroy()
     {
         flushGPU();
 
+        if (mIsDeferredFreeEnabled)
+        {
+            // the GPU is idle, reclaim everything
+            mDeferredFreeQueue.collect(nullptr, [&](deferred_free_queue::entry const& entry) { destroyDeferredFree(entry); });
+            mDeferredFreeQueue.destroy();
+
+            for (auto& timeline : mSubmitTimelines)
+            {
+                timeline.destroy();
+            }
+        }
+
         mDiagnostics.free();
 
         //        mSwapchain.setFullscreen(false);
@@ -192,6 +218,20 @@ void phi::d3d12::BackendD3D12::flushGPU()
     ::WaitForSingleObject(mFlushEvent, INFINITE);
 }
 
+uint32_t phi::d3d12::BackendD3D12::collectGarbage()
+{
+    if (!mIsDeferredFreeEnabled)
+        return 0;
+
+    uint64_t completed_values[deferred_free_queue::num_queue_types];
+    for (auto i = 0u; i < deferred_free_queue::num_queue_types; ++i)
+    {
+        completed_values[i] = mSubmitTimelines[i].getCurrentValue();
+    }
+
+    return mDeferredFreeQueue.collect(completed_values, [&](deferred_free_queue::entry const& entry) { destroyDeferredFree(entry); });
+}
+
 phi::handle::swapchain phi::d3d12::BackendD3D12::createSwapchain(const phi::window_handle& window_handle, tg::isize2 initial_size, phi::present_mode mode, uint32_t num_backbuffers)
 {
     ::HWND native_hwnd = nullptr;
@@ -245,21 +285,57 @@ phi::format phi::d3d12::BackendD3D12::getBackbufferFormat(handle::swapchain /*sc
 
 phi::handle::resource phi::d3d12::BackendD3D12::createTexture(arg::texture_description const& desc, char const* debug_name)
 {
-    return mPoolResources.createTexture(desc, debug_name);
+    auto const res = mPoolResources.createTexture(desc, debug_name);
+
+    if (mVRAMSoftLimit.is_enabled())
+        mVRAMSoftLimit.check(nativeGetVRAMStateInfo());
+
+    return res;
 }
 
 phi::handle::resource phi::d3d12::BackendD3D12::createBuffer(arg::buffer_description const& desc, char const* debug_name)
 {
-    return mPoolResources.createBuffer(desc, debug_name);
+    auto const res = mPoolResources.createBuffer(desc, debug_name);
+
+    if (mVRAMSoftLimit.is_enabled())
+        mVRAMSoftLimit.check(nativeGetVRAMStateInfo());
+
+    return res;
+}
+
+void phi::d3d12::BackendD3D12::createTransientTextures(cc::span<arg::transient_texture_description const> descs, cc::span<handle::resource> out_resources, char const* debug_name)
+{
+    mPoolResources.createTransientTextures(descs, out_resources, debug_name, mDynamicAllocator);
+
+    if (mVRAMSoftLimit.is_enabled())
+        mVRAMSoftLimit.check(nativeGetVRAMStateInfo());
 }
 
 std::byte* phi::d3d12::BackendD3D12::mapBuffer(phi::handle::resource res, int begin, int end) { return mPoolResources.mapBuffer(res, begin, end); }
 
 void phi::d3d12::BackendD3D12::unmapBuffer(phi::handle::resource res, int begin, int end) { return mPoolResources.unmapBuffer(res, begin, end); }
 
-void phi::d3d12::BackendD3D12::free(phi::handle::resource res) { mPoolResources.free(res); }
+void phi::d3d12::BackendD3D12::free(phi::handle::resource res)
+{
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.enqueue(deferred_free_queue::handle_type::resource, cc::span{res});
+        return;
+    }
 
-void phi::d3d12::BackendD3D12::freeRange(cc::span<const phi::handle::resource> resources) { mPoolResources.free(resources); }
+    mPoolResources.free(res);
+}
+
+void phi::d3d12::BackendD3D12::freeRange(cc::span<const phi::handle::resource> resources)
+{
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.enqueue(deferred_free_queue::handle_type::resource, resources);
+        return;
+    }
+
+    mPoolResources.free(resources);
+}
 
 phi::handle::shader_view phi::d3d12::BackendD3D12::createShaderView(cc::span<const phi::resource_view> srvs,
                                                                     cc::span<const phi::resource_view> uavs,
@@ -289,9 +365,27 @@ void phi::d3d12::BackendD3D12::writeShaderViewSamplers(handle::shader_view sv, u
     mPoolShaderViews.writeShaderViewSamplers(sv, offset, samplers);
 }
 
-void phi::d3d12::BackendD3D12::free(phi::handle::shader_view sv) { mPoolShaderViews.free(sv); }
+void phi::d3d12::BackendD3D12::free(phi::handle::shader_view sv)
+{
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.enqueue(deferred_free_queue::handle_type::shader_view, cc::span{sv});
+        return;
+    }
 
-void phi::d3d12::BackendD3D12::freeRange(cc::span<const phi::handle::shader_view> svs) { mPoolShaderViews.free(svs); }
+    mPoolShaderViews.free(sv);
+}
+
+void phi::d3d12::BackendD3D12::freeRange(cc::span<const phi::handle::shader_view> svs)
+{
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.enqueue(deferred_free_queue::handle_type::shader_view, svs);
+        return;
+    }
+
+    mPoolShaderViews.free(svs);
+}
 
 phi::handle::pipeline_state phi::d3d12::BackendD3D12::createPipelineState(phi::arg::vertex_format vertex_format,
                                                                           const phi::arg::framebuffer_config& framebuffer_conf,
@@ -323,14 +417,56 @@ phi::handle::pipeline_state phi::d3d12::BackendD3D12::createComputePipelineState
     return mPoolPSOs.createComputePipelineState(description.shader_arg_shapes, description.shader, description.has_root_constants, debug_name);
 }
 
-void phi::d3d12::BackendD3D12::free(phi::handle::pipeline_state ps) { mPoolPSOs.free(ps); }
+void phi::d3d12::BackendD3D12::createPipelineStates(cc::span<const arg::graphics_pipeline_state_description> descriptions,
+                                                    cc::span<handle::pipeline_state> out_psos,
+                                                    cc::span<char const* const> debug_names)
+{
+    CC_ASSERT(out_psos.size() == descriptions.size() && "output span must have the same size as descriptions");
+    CC_ASSERT((debug_names.empty() || debug_names.size() == descriptions.size()) && "debug name span must be empty or have the same size as descriptions");
+
+    // D3D12 PSO creation takes DXIL as-is without patching or reflection, create serially
+    for (auto i = 0u; i < descriptions.size(); ++i)
+    {
+        out_psos[i] = createPipelineState(descriptions[i], debug_names.empty() ? nullptr : debug_names[i]);
+    }
+}
+
+void phi::d3d12::BackendD3D12::createComputePipelineStates(cc::span<const arg::compute_pipeline_state_description> descriptions,
+                                                           cc::span<handle::pipeline_state> out_psos,
+                                                           cc::span<char const* const> debug_names)
+{
+    CC_ASSERT(out_psos.size() == descriptions.size() && "output span must have the same size as descriptions");
+    CC_ASSERT((debug_names.empty() || debug_names.size() == descriptions.size()) && "debug name span must be empty or have the same size as descriptions");
+
+    for (auto i = 0u; i < descriptions.size(); ++i)
+    {
+        out_psos[i] = createComputePipelineState(descriptions[i], debug_names.empty() ? nullptr : debug_names[i]);
+    }
+}
+
+void phi::d3d12::BackendD3D12::free(phi::handle::pipeline_state ps)
+{
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.enqueue(deferred_free_queue::handle_type::pipeline_state, cc::span{ps});
+        return;
+    }
+
+    mPoolPSOs.free(ps);
+}
 
 phi::handle::command_list phi::d3d12::BackendD3D12::recordCommandList(std::byte const* buffer, size_t size, queue_type queue)
+{
+    command_stream_chunk const chunk = {buffer, size};
+    return recordCommandList(cc::span<command_stream_chunk const>(&chunk, 1), queue);
+}
+
+phi::handle::command_list phi::d3d12::BackendD3D12::recordCommandList(cc::span<command_stream_chunk const> chunks, queue_type queue)
 {
     auto& thread_comp = getCurrentThreadComponent();
     ID3D12GraphicsCommandList5* raw_list5;
     auto const res = mPoolCmdLists.create(raw_list5, thread_comp.cmd_list_allocator, queue);
-    thread_comp.translator.translateCommandList(raw_list5, queue, mPoolCmdLists.getStateCache(res), buffer, size);
+    thread_comp.translator.translateCommandList(raw_list5, queue, mPoolCmdLists.getStateCache(res), chunks);
     return res;
 }
 
@@ -364,17 +500,17 @@ void phi::d3d12::BackendD3D12::submit(cc::span<const phi::handle::command_list>
         uint32_t numBarriers = 0;
         D3D12_RESOURCE_BARRIER* barrierPtr = barriers_sbo;
 
-        if (state_cache->num_entries > CC_COUNTOF(barriers_sbo))
+        if (state_cache->num_entries() > CC_COUNTOF(barriers_sbo))
         {
-            barriers_heap.reset(mDynamicAllocator, state_cache->num_entries);
+            barriers_heap.reset(mDynamicAllocator, state_cache->num_entries());
             barrierPtr = barriers_heap.data();
         }
 
         auto f_addBarrier = [&](D3D12_RESOURCE_BARRIER const& barrier) -> void { barrierPtr[numBarriers++] = barrier; };
 
-        for (auto i = 0u; i < state_cache->num_entries; ++i)
+        for (auto i = 0u; i < state_cache->num_entries(); ++i)
         {
-            auto const& entry = state_cache->entries[i];
+            auto const& entry = state_cache->get_entry(i);
 
             D3D12_RESOURCE_STATES const master_before = mPoolResources.getResourceState(entry.ptr);
 
@@ -415,6 +551,11 @@ void phi::d3d12::BackendD3D12::submit(cc::span<const phi::handle::command_list>
         mPoolFences.signalGPU(signal_op.fence, signal_op.value, target_queue);
     }
 
+    if (mIsDeferredFreeEnabled)
+    {
+        mSubmitTimelines[static_cast<uint8_t>(queue)].signalGPU(mDeferredFreeQueue.increment_submit_value(queue), *target_queue);
+    }
+
     mPoolCmdLists.freeOnSubmit(barrier_lists, *target_queue);
     mPoolCmdLists.freeOnSubmit(cls, *target_queue);
 }
@@ -488,12 +629,26 @@ void phi::d3d12::BackendD3D12::writeShaderTable(std::byte* dest, handle::pipelin
 void phi::d3d12::BackendD3D12::free(phi::handle::accel_struct as)
 {
     CC_ASSERT(isRaytracingEnabled() && "raytracing is not enabled");
+
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.enqueue(deferred_free_queue::handle_type::accel_struct, cc::span{as});
+        return;
+    }
+
     mPoolAccelStructs.free(as);
 }
 
 void phi::d3d12::BackendD3D12::freeRange(cc::span<const phi::handle::accel_struct> as)
 {
     CC_ASSERT(isRaytracingEnabled() && "raytracing is not enabled");
+
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.enqueue(deferred_free_queue::handle_type::accel_struct, as);
+        return;
+    }
+
     mPoolAccelStructs.free(as);
 }
 
@@ -530,6 +685,13 @@ uint64_t phi::d3d12::BackendD3D12::getGPUTimestampFrequency() const
 
 bool phi::d3d12::BackendD3D12::isRaytracingEnabled() const { return mDevice.hasRaytracing(); }
 
+phi::vram_state_info phi::d3d12::BackendD3D12::getVRAMInfo()
+{
+    auto const res = nativeGetVRAMStateInfo();
+    mVRAMSoftLimit.check(res);
+    return res;
+}
+
 phi::vram_state_info phi::d3d12::BackendD3D12::nativeGetVRAMStateInfo()
 {
     DXGI_QUERY_VIDEO_MEMORY_INFO nativeInfo = {};
@@ -540,6 +702,19 @@ phi::vram_state_info phi::d3d12::BackendD3D12::nativeGetVRAMStateInfo()
     res.current_usage_bytes = nativeInfo.CurrentUsage;
     res.available_for_reservation_bytes = nativeInfo.AvailableForReservation;
     res.current_reservation_bytes = nativeInfo.CurrentReservation;
+
+    // heap 0: local, heap 1: non-local (system memory, zero-sized on UMA adapters)
+    res.heaps[0].budget_bytes = nativeInfo.Budget;
+    res.heaps[0].usage_bytes = nativeInfo.CurrentUsage;
+    res.heaps[0].is_device_local = true;
+
+    DXGI_QUERY_VIDEO_MEMORY_INFO nativeInfoNonLocal = {};
+    PHI_D3D12_VERIFY(mAdapter.getAdapter().QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &nativeInfoNonLocal));
+    res.heaps[1].budget_bytes = nativeInfoNonLocal.Budget;
+    res.heaps[1].usage_bytes = nativeInfoNonLocal.CurrentUsage;
+    res.heaps[1].is_device_local = false;
+
+    res.num_heaps = 2;
     return res;
 }
 
@@ -551,3 +726,22 @@ phi::d3d12::BackendD3D12::per_thread_component& phi::d3d12::BackendD3D12::getCur
                   "recordCommandList() and submit() must only be used from at most backend_config::num_threads unique OS threads in total");
     return mThreadComponents[current_index];
 }
+
+void phi::d3d12::BackendD3D12::destroyDeferredFree(const deferred_free_queue::entry& entry)
+{
+    switch (entry.type)
+    {
+    case deferred_free_queue::handle_type::resource:
+        mPoolResources.free(handle::resource{entry.value});
+        break;
+    case deferred_free_queue::handle_type::shader_view:
+        mPoolShaderViews.free(handle::shader_view{entry.value});
+        break;
+    case deferred_free_queue::handle_type::pipeline_state:
+        mPoolPSOs.free(handle::pipeline_state{entry.value});
+        break;
+    case deferred_free_queue::handle_type::accel_struct:
+        mPoolAccelStructs.free(handle::accel_struct{entry.value});
+        break;
+    }
+}
@@ -5,10 +5,13 @@
 #include <phantasm-hardware-interface/Backend.hh>
 #include <phantasm-hardware-interface/types.hh>
 
+#include <phantasm-hardware-interface/common/deferred_free_queue.hh>
 #include <phantasm-hardware-interface/common/thread_association.hh>
+#include <phantasm-hardware-interface/common/vram_soft_limit.hh>
 
 #include "Adapter.hh"
 #include "Device.hh"
+#include "Fence.hh"
 #include "Queue.hh"
 
 #include "common/diagnostic_util.hh"
@@ -69,6 +72,8 @@ public:
 
     [[nodiscard]] handle::resource createBuffer(arg::buffer_description const& desc, char const* debug_name = nullptr) override;
 
+    void createTransientTextures(cc::span<arg::transient_texture_description const> descs, cc::span<handle::resource> out_resources, char const* debug_name = nullptr) override;
+
     [[nodiscard]] std::byte* mapBuffer(handle::resource res, int begin = 0, int end = -1) override;
 
     void unmapBuffer(handle::resource res, int begin = 0, int end = -1) override;
@@ -121,13 +126,25 @@ public:
     [[nodiscard]] handle::pipeline_state createComputePipelineState(arg::compute_pipeline_state_description const& description,
                                                                     char const* debug_name = nullptr) override;
 
+    void createPipelineStates(cc::span<arg::graphics_pipeline_state_description const> descriptions,
+                              cc::span<handle::pipeline_state> out_psos,
+                              cc::span<char const* const> debug_names = {}) override;
+
+    void createComputePipelineStates(cc::span<arg::compute_pipeline_state_description const> descriptions,
+                                     cc::span<handle::pipeline_state> out_psos,
+                                     cc::span<char const* const> debug_names = {}) override;
+
     void free(handle::pipeline_state ps) override;
 
+    bool flushPipelineCache() override { return false; }
+
     //
     // Command list interface
     //
 
     [[nodiscard]] handle::command_list recordCommandList(std::byte const* buffer, size_t size, queue_type queue = queue_type::direct) override;
+
+    [[nodiscard]] handle::command_list recordCommandList(cc::span<command_stream_chunk const> chunks, queue_type queue = queue_type::direct) override;
     void discard(cc::span<handle::command_list const> cls) override;
     void submit(cc::span<handle::command_list const> cls,
                 queue_type queue = queue_type::direct,
@@ -216,9 +233,20 @@ public:
 
     gpu_info const& getGPUInfo() const override { return mAdapter.getGPUInfo(); }
 
+    vram_state_info getVRAMInfo() override;
+
+    //
+    // Deferred free interface
+    //
+
+    uint32_t collectGarbage() override;
+
+    deferred_free_stats getDeferredFreeStats() override { return mDeferredFreeQueue.get_stats(); }
+
 public:
     // non virtual - d3d12 specific
 
+    /// same as getVRAMInfo without the soft limit check
     vram_state_info nativeGetVRAMStateInfo();
 
     ID3D12Device5* nativeGetDevice() { return mDevice.getDevice(); }
@@ -239,6 +267,8 @@ private:
     struct per_thread_component;
     per_thread_component& getCurrentThreadComponent();
 
+    void destroyDeferredFree(deferred_free_queue::entry const& entry);
+
 private:
     // Core components
     Adapter mAdapter;
@@ -262,6 +292,11 @@ private:
     AccelStructPool mPoolAccelStructs;
     QueryPool mPoolQueries;
 
+    // Deferred frees, tracked against a fence per queue type signalled on every submit
+    bool mIsDeferredFreeEnabled = false;
+    deferred_free_queue mDeferredFreeQueue;
+    SimpleFence mSubmitTimelines[deferred_free_queue::num_queue_types];
+
     // Logic
     per_thread_component* mThreadComponents;
     uint32_t mNumThreadComponents;
@@ -272,5 +307,6 @@ private:
 
     // Misc
     util::diagnostic_state mDiagnostics;
+    vram_soft_limit mVRAMSoftLimit;
 };
 }
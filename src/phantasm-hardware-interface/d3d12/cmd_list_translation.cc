@@ -53,8 +53,10 @@ void phi::d3d12::command_list_translator::initialize(
 
 void phi::d3d12::command_list_translator::destroy() { _thread_local.destroy(); }
 
-void phi::d3d12::command_list_translator::translateCommandList(
-    ID3D12GraphicsCommandList5* list, queue_type type, incomplete_state_cache* state_cache, std::byte const* buffer, size_t buffer_size)
+void phi::d3d12::command_list_translator::translateCommandList(ID3D12GraphicsCommandList5* list,
+                                                               queue_type type,
+                                                               incomplete_state_cache* state_cache,
+                                                               cc::span<command_stream_chunk const> chunks)
 {
     _cmd_list = list;
     _current_queue_type = type;
@@ -76,10 +78,13 @@ void phi::d3d12::command_list_translator::translateCommandList(
         _cmd_list->SetDescriptorHeaps(UINT(gpu_heaps.size()), gpu_heaps.data());
 
         // translate all contained commands
-        command_stream_parser parser(buffer, buffer_size);
-        for (auto const& cmd : parser)
+        for (command_stream_chunk const& chunk : chunks)
         {
-            cmd::detail::dynamic_dispatch(cmd, *this);
+            command_stream_parser parser(chunk.buffer, chunk.size);
+            for (auto const& cmd : parser)
+            {
+                cmd::detail::dynamic_dispatch(cmd, *this);
+            }
         }
 
         // end last pending optick event
@@ -180,6 +185,7 @@ void phi::d3d12::command_list_translator::execute(const phi::cmd::draw& draw)
     auto const& pso_node = _globals.pool_pipeline_states->get(draw.pipeline_state);
 
     // PSO
+    _bound.is_compute = false;
     if (_bound.update_pso(draw.pipeline_state))
     {
         _cmd_list->SetPipelineState(pso_node.raw_pso);
@@ -282,6 +288,7 @@ void phi::d3d12::command_list_translator::execute(const phi::cmd::draw_indirect&
     auto const& pso_node = _globals.pool_pipeline_states->get(draw_indirect.pipeline_state);
 
     // PSO
+    _bound.is_compute = false;
     if (_bound.update_pso(draw_indirect.pipeline_state))
     {
         _cmd_list->SetPipelineState(pso_node.raw_pso);
@@ -379,11 +386,104 @@ void phi::d3d12::command_list_translator::execute(const phi::cmd::draw_indirect&
     _cmd_list->ExecuteIndirect(comsig, draw_indirect.num_arguments, raw_arg_buffer, draw_indirect.argument_buffer_offset_bytes, nullptr, 0);
 }
 
+void phi::d3d12::command_list_translator::execute(const phi::cmd::draw_batch& batch)
+{
+    CC_ASSERT(_current_queue_type == queue_type::direct && "graphics commands are only valid on queue_type::direct");
+    CC_ASSERT(batch.pipeline_state.is_valid() && "invalid PSO handle");
+    CC_ASSERT(batch.records != nullptr || batch.num_records == 0);
+    CC_ASSERT(batch.num_root_constant_bytes <= limits::max_root_constant_bytes && batch.num_root_constant_bytes % sizeof(DWORD32) == 0
+              && "invalid root constant size");
+
+    auto const& pso_node = _globals.pool_pipeline_states->get(batch.pipeline_state);
+    auto const& root_sig = *pso_node.associated_root_sig;
+
+    // PSO
+    _bound.is_compute = false;
+    if (_bound.update_pso(batch.pipeline_state))
+    {
+        _cmd_list->SetPipelineState(pso_node.raw_pso);
+        _cmd_list->IASetPrimitiveTopology(pso_node.primitive_topology);
+    }
+
+    // Root signature
+    if (_bound.update_root_sig(root_sig.raw_root_sig))
+    {
+        _cmd_list->SetGraphicsRootSignature(_bound.raw_root_sig);
+    }
+
+    // Index buffer (optional)
+    if (batch.index_buffer != _bound.index_buffer)
+    {
+        _bound.index_buffer = batch.index_buffer;
+        if (batch.index_buffer.is_valid())
+        {
+            auto const ibv = _globals.pool_resources->getIndexBufferView(batch.index_buffer);
+            _cmd_list->IASetIndexBuffer(&ibv);
+        }
+    }
+
+    // Vertex buffers
+    bind_vertex_buffers(batch.vertex_buffers);
+
+    // shared shader arguments, root constants are set per draw
+    bind_shader_arguments(root_sig, nullptr, 0, batch.shader_arguments, false);
+
+    // per-draw state
+    UINT const root_const_param = root_sig.argument_maps.empty() ? UINT(-1) : root_sig.argument_maps[0].root_const_param;
+    bool const set_root_constants = batch.num_root_constant_bytes > 0 && root_const_param != UINT(-1);
+    UINT const num_root_const_dwords = UINT(batch.num_root_constant_bytes / sizeof(DWORD32));
+
+    bool const set_cbv_offset = batch.cbv_argument_index != uint8_t(-1);
+    UINT cbv_param = UINT(-1);
+    D3D12_GPU_VIRTUAL_ADDRESS cbv_va = 0;
+    if (set_cbv_offset)
+    {
+        CC_ASSERT(batch.cbv_argument_index < batch.shader_arguments.size() && "cbv_argument_index out of bounds");
+        handle::resource const cbv = batch.shader_arguments[batch.cbv_argument_index].constant_buffer;
+        CC_ASSERT(cbv.is_valid() && root_sig.argument_maps[batch.cbv_argument_index].cbv_param != uint32_t(-1) && "draw_batch argument CBV is missing");
+        cbv_param = root_sig.argument_maps[batch.cbv_argument_index].cbv_param;
+        cbv_va = _globals.pool_resources->getBufferInfo(cbv).gpu_va;
+    }
+
+    bool const is_indexed = batch.index_buffer.is_valid();
+
+    for (auto i = 0u; i < batch.num_records; ++i)
+    {
+        cmd::draw_batch::draw_record const& draw = batch.records[i];
+
+        if (set_root_constants)
+        {
+            _cmd_list->SetGraphicsRoot32BitConstants(root_const_param, num_root_const_dwords, draw.root_constants, 0);
+        }
+
+        if (set_cbv_offset)
+        {
+            _cmd_list->SetGraphicsRootConstantBufferView(cbv_param, cbv_va + draw.cbv_offset);
+        }
+
+        if (is_indexed)
+        {
+            _cmd_list->DrawIndexedInstanced(draw.num_indices, draw.num_instances, draw.index_offset, draw.vertex_offset, 0);
+        }
+        else
+        {
+            _cmd_list->DrawInstanced(draw.num_indices, draw.num_instances, draw.index_offset, 0);
+        }
+    }
+
+    // keep the bound CBV offset in sync
+    if (set_cbv_offset && batch.num_records > 0)
+    {
+        _bound.shader_args[batch.cbv_argument_index].cbv_offset = batch.records[batch.num_records - 1].cbv_offset;
+    }
+}
+
 void phi::d3d12::command_list_translator::execute(const phi::cmd::dispatch& dispatch)
 {
     auto const& pso_node = _globals.pool_pipeline_states->get(dispatch.pipeline_state);
 
     // PSO
+    _bound.is_compute = true;
     if (_bound.update_pso(dispatch.pipeline_state))
     {
         _cmd_list->SetPipelineState(pso_node.raw_pso);
@@ -454,6 +554,7 @@ void phi::d3d12::command_list_translator::execute(cmd::dispatch_indirect const&
     auto const& pso_node = _globals.pool_pipeline_states->get(dispatch_indirect.pipeline_state);
 
     // PSO
+    _bound.is_compute = true;
     if (_bound.update_pso(dispatch_indirect.pipeline_state))
     {
         _cmd_list->SetPipelineState(pso_node.raw_pso);
@@ -531,6 +632,91 @@ void phi::d3d12::command_list_translator::execute(cmd::dispatch_indirect const&
     _cmd_list->ExecuteIndirect(comsig, dispatch_indirect.num_arguments, raw_arg_buffer, dispatch_indirect.argument_buffer_addr.offset_bytes, nullptr, 0);
 }
 
+void phi::d3d12::command_list_translator::execute(const phi::cmd::set_pipeline_state& set_pso)
+{
+    CC_ASSERT(set_pso.pipeline_state.is_valid() && "invalid PSO handle");
+    CC_ASSERT((set_pso.is_compute || _current_queue_type == queue_type::direct) && "graphics commands are only valid on queue_type::direct");
+
+    auto const& pso_node = _globals.pool_pipeline_states->get(set_pso.pipeline_state);
+    _bound.is_compute = set_pso.is_compute;
+
+    // PSO
+    if (_bound.update_pso(set_pso.pipeline_state))
+    {
+        _cmd_list->SetPipelineState(pso_node.raw_pso);
+
+        if (!set_pso.is_compute)
+            _cmd_list->IASetPrimitiveTopology(pso_node.primitive_topology);
+    }
+
+    // Root signature
+    if (_bound.update_root_sig(pso_node.associated_root_sig->raw_root_sig))
+    {
+        if (set_pso.is_compute)
+            _cmd_list->SetComputeRootSignature(_bound.raw_root_sig);
+        else
+            _cmd_list->SetGraphicsRootSignature(_bound.raw_root_sig);
+    }
+}
+
+void phi::d3d12::command_list_translator::execute(const phi::cmd::set_shader_arguments& set_args)
+{
+    CC_ASSERT(_bound.pipeline_state.is_valid() && "cmd::set_shader_arguments requires a previous cmd::set_pipeline_state");
+
+    auto const& root_sig = *_globals.pool_pipeline_states->get(_bound.pipeline_state).associated_root_sig;
+    bind_shader_arguments(root_sig, set_args.get_root_constants(), set_args.num_root_constant_bytes,
+                          cc::span<shader_argument const>(set_args.get_shader_arguments(), set_args.num_shader_arguments), _bound.is_compute);
+}
+
+void phi::d3d12::command_list_translator::execute(const phi::cmd::set_vertex_buffers& set_buffers)
+{
+    CC_ASSERT(_current_queue_type == queue_type::direct && "graphics commands are only valid on queue_type::direct");
+
+    // Index buffer (optional)
+    if (set_buffers.index_buffer != _bound.index_buffer)
+    {
+        _bound.index_buffer = set_buffers.index_buffer;
+        if (set_buffers.index_buffer.is_valid())
+        {
+            auto const ibv = _globals.pool_resources->getIndexBufferView(set_buffers.index_buffer);
+            _cmd_list->IASetIndexBuffer(&ibv);
+        }
+    }
+
+    // Vertex buffers
+    bind_vertex_buffers(set_buffers.vertex_buffers);
+}
+
+void phi::d3d12::command_list_translator::execute(const phi::cmd::set_scissor& scissor_cmd)
+{
+    CC_ASSERT(_current_queue_type == queue_type::direct && "graphics commands are only valid on queue_type::direct");
+
+    D3D12_RECT scissor_rect = {scissor_cmd.scissor.min.x, scissor_cmd.scissor.min.y, scissor_cmd.scissor.max.x, scissor_cmd.scissor.max.y};
+    _cmd_list->RSSetScissorRects(1, &scissor_rect);
+}
+
+void phi::d3d12::command_list_translator::execute(const phi::cmd::draw_only& draw)
+{
+    CC_ASSERT(_current_queue_type == queue_type::direct && "graphics commands are only valid on queue_type::direct");
+    CC_ASSERT(_bound.pipeline_state.is_valid() && !_bound.is_compute && "cmd::draw_only requires a previous graphics cmd::set_pipeline_state");
+
+    if (_bound.index_buffer.is_valid())
+    {
+        _cmd_list->DrawIndexedInstanced(draw.num_indices, draw.num_instances, draw.index_offset, draw.vertex_offset, 0);
+    }
+    else
+    {
+        _cmd_list->DrawInstanced(draw.num_indices, draw.num_instances, draw.index_offset, 0);
+    }
+}
+
+void phi::d3d12::command_list_translator::execute(const phi::cmd::dispatch_only& dispatch)
+{
+    CC_ASSERT(_bound.pipeline_state.is_valid() && _bound.is_compute && "cmd::dispatch_only requires a previous compute cmd::set_pipeline_state");
+
+    _cmd_list->Dispatch(dispatch.dispatch_x, dispatch.dispatch_y, dispatch.dispatch_z);
+}
+
 void phi::d3d12::command_list_translator::execute(const phi::cmd::end_render_pass&)
 {
     CC_ASSERT(_current_queue_type == queue_type::direct && "graphics commands are only valid on queue_type::direct");
@@ -616,6 +802,42 @@ void phi::d3d12::command_list_translator::execute(const phi::cmd::barrier_uav& b
     _cmd_list->ResourceBarrier(UINT(barriers.size()), barriers.data());
 }
 
+void phi::d3d12::command_list_translator::execute(const phi::cmd::barrier_aliasing& barrier)
+{
+    // aliasing barriers first, followed by the regular transitions
+    cc::capped_vector<D3D12_RESOURCE_BARRIER, limits::max_resource_transitions * 2> barriers;
+
+    for (auto const& activation : barrier.resources)
+    {
+        if (!_globals.pool_resources->isAliased(activation.resource))
+            continue;
+
+        D3D12_RESOURCE_BARRIER& desc = barriers.emplace_back();
+        desc.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+        desc.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+        desc.Aliasing.pResourceBefore = nullptr;
+        desc.Aliasing.pResourceAfter = _globals.pool_resources->getRawResource(activation.resource);
+    }
+
+    for (auto const& activation : barrier.resources)
+    {
+        D3D12_RESOURCE_STATES const after = util::to_native(activation.target_state);
+        D3D12_RESOURCE_STATES before;
+
+        bool const before_known = _state_cache->transition_resource(activation.resource, after, before);
+
+        if (before_known && before != after)
+        {
+            barriers.push_back(util::get_barrier_desc(_globals.pool_resources->getRawResource(activation.resource), before, after));
+        }
+    }
+
+    if (!barriers.empty())
+    {
+        _cmd_list->ResourceBarrier(UINT(barriers.size()), barriers.data());
+    }
+}
+
 void phi::d3d12::command_list_translator::execute(const phi::cmd::copy_buffer& copy_buf)
 {
     CC_ASSERT(_globals.pool_resources->isBufferAccessInBounds(copy_buf.source, copy_buf.source_offset_bytes, copy_buf.size) && "copy_buffer source OOB");
@@ -844,6 +1066,7 @@ void phi::d3d12::command_list_translator::execute(const phi::cmd::update_top_lev
 
 void phi::d3d12::command_list_translator::execute(const cmd::dispatch_rays& dispatch_rays)
 {
+    _bound.is_compute = false; // raytracing bind point, cmd::dispatch_only requires a new compute cmd::set_pipeline_state
     if (_bound.update_pso(dispatch_rays.pso))
     {
         _cmd_list->SetPipelineState1(_globals.pool_pipeline_states->getRaytrace(dispatch_rays.pso).raw_state_object);
@@ -942,6 +1165,73 @@ void phi::d3d12::command_list_translator::execute(cmd::code_location_marker cons
     _last_code_location.line = marker.line;
 }
 
+void phi::d3d12::command_list_translator::bind_shader_arguments(root_signature const& root_sig,
+                                                                std::byte const* root_consts,
+                                                                uint32_t root_consts_size,
+                                                                cc::span<shader_argument const> shader_args,
+                                                                bool is_compute)
+{
+    // root constants
+    if (root_consts_size > 0 && !root_sig.argument_maps.empty() && root_sig.argument_maps[0].root_const_param != unsigned(-1))
+    {
+        CC_ASSERT(root_consts_size % sizeof(DWORD32) == 0 && "root constant size not divisible by dword32 size");
+        auto const root_const_param = root_sig.argument_maps[0].root_const_param;
+        auto const num_dwords = UINT(root_consts_size / sizeof(DWORD32));
+
+        if (is_compute)
+            _cmd_list->SetComputeRoot32BitConstants(root_const_param, num_dwords, root_consts, 0);
+        else
+            _cmd_list->SetGraphicsRoot32BitConstants(root_const_param, num_dwords, root_consts, 0);
+    }
+
+    CC_ASSERT(shader_args.size() <= root_sig.argument_maps.size() && "given amount of shader arguments exceeds pipeline state configuration");
+    for (uint8_t i = 0; i < shader_args.size(); ++i)
+    {
+        auto& bound_arg = _bound.shader_args[i];
+        auto const& arg = shader_args[i];
+        auto const& map = root_sig.argument_maps[i];
+
+        if (map.cbv_param != uint32_t(-1))
+        {
+            CC_ASSERT(arg.constant_buffer.is_valid() && "argument CBV is missing");
+
+            // Set the CBV / offset if it has changed
+            if (bound_arg.update_cbv(arg.constant_buffer, arg.constant_buffer_offset))
+            {
+                CC_ASSERT(_globals.pool_resources->isBufferAccessInBounds(arg.constant_buffer, arg.constant_buffer_offset, 1) && "CBV offset OOB");
+
+                auto const cbv_va = _globals.pool_resources->getBufferInfo(arg.constant_buffer).gpu_va + arg.constant_buffer_offset;
+                if (is_compute)
+                    _cmd_list->SetComputeRootConstantBufferView(map.cbv_param, cbv_va);
+                else
+                    _cmd_list->SetGraphicsRootConstantBufferView(map.cbv_param, cbv_va);
+            }
+        }
+
+        // Set the shader view if it has changed
+        if (bound_arg.update_shader_view(arg.shader_view))
+        {
+            if (map.srv_uav_table_param != uint32_t(-1))
+            {
+                auto const sv_desc_table = _globals.pool_shader_views->getSRVUAVGPUHandle(arg.shader_view);
+                if (is_compute)
+                    _cmd_list->SetComputeRootDescriptorTable(map.srv_uav_table_param, sv_desc_table);
+                else
+                    _cmd_list->SetGraphicsRootDescriptorTable(map.srv_uav_table_param, sv_desc_table);
+            }
+
+            if (map.sampler_table_param != uint32_t(-1))
+            {
+                auto const sampler_desc_table = _globals.pool_shader_views->getSamplerGPUHandle(arg.shader_view);
+                if (is_compute)
+                    _cmd_list->SetComputeRootDescriptorTable(map.sampler_table_param, sampler_desc_table);
+                else
+                    _cmd_list->SetGraphicsRootDescriptorTable(map.sampler_table_param, sampler_desc_table);
+            }
+        }
+    }
+}
+
 void phi::d3d12::command_list_translator::bind_vertex_buffers(handle::resource const vertex_buffers[limits::max_vertex_buffers])
 {
     uint64_t const vert_hash = phi::util::sse_hash_type<handle::resource>(vertex_buffers, limits::max_vertex_buffers);
@@ -51,7 +51,7 @@ struct command_list_translator
     void initialize(ID3D12Device* device, ShaderViewPool* sv_pool, ResourcePool* resource_pool, PipelineStateObjectPool* pso_pool, AccelStructPool* as_pool, QueryPool* query_pool);
     void destroy();
 
-    void translateCommandList(ID3D12GraphicsCommandList5* list, queue_type type, incomplete_state_cache* state_cache, std::byte const* buffer, size_t buffer_size);
+    void translateCommandList(ID3D12GraphicsCommandList5* list, queue_type type, incomplete_state_cache* state_cache, cc::span<command_stream_chunk const> chunks);
 
     void execute(cmd::begin_render_pass const& begin_rp);
 
@@ -59,10 +59,24 @@ struct command_list_translator
 
     void execute(cmd::draw_indirect const& draw_indirect);
 
+    void execute(cmd::draw_batch const& batch);
+
     void execute(cmd::dispatch const& dispatch);
 
     void execute(cmd::dispatch_indirect const& dispatch_indirect);
 
+    void execute(cmd::set_pipeline_state const& set_pso);
+
+    void execute(cmd::set_shader_arguments const& set_args);
+
+    void execute(cmd::set_vertex_buffers const& set_buffers);
+
+    void execute(cmd::set_scissor const& scissor_cmd);
+
+    void execute(cmd::draw_only const& draw);
+
+    void execute(cmd::dispatch_only const& dispatch);
+
     void execute(cmd::end_render_pass const& end_rp);
 
     void execute(cmd::transition_resources const& transition_res);
@@ -71,6 +85,8 @@ struct command_list_translator
 
     void execute(cmd::barrier_uav const& barrier);
 
+    void execute(cmd::barrier_aliasing const& barrier);
+
     void execute(cmd::copy_buffer const& copy_buf);
 
     void execute(cmd::copy_texture const& copy_text);
@@ -106,6 +122,8 @@ struct command_list_translator
 private:
     void bind_vertex_buffers(handle::resource const vertex_buffers[limits::max_vertex_buffers]);
 
+    void bind_shader_arguments(root_signature const& root_sig, std::byte const* root_consts, uint32_t root_consts_size, cc::span<shader_argument const> shader_args, bool is_compute);
+
 private:
     // non-owning constant (global)
     translator_global_memory _globals;
@@ -124,6 +142,7 @@ private:
         handle::pipeline_state pipeline_state = handle::null_pipeline_state;
         handle::resource index_buffer = handle::null_resource;
         uint64_t vertex_buffer_hash = uint64_t(-1);
+        bool is_compute = false; // bind point of the last command that set pipeline_state
 
         ID3D12RootSignature* raw_root_sig = nullptr;
 
@@ -171,6 +190,7 @@ private:
             pipeline_state = handle::null_pipeline_state;
             index_buffer = handle::null_resource;
             vertex_buffer_hash = uint64_t(-1);
+            is_compute = false;
 
             set_root_sig(nullptr);
         }
@@ -1,7 +1,6 @@
 #pragma once
 
-#include <clean-core/span.hh>
-
+#include <phantasm-hardware-interface/common/incomplete_state_cache.hh>
 #include <phantasm-hardware-interface/types.hh>
 
 #include "d3d12_fwd.hh"
@@ -33,33 +32,30 @@ struct incomplete_state_cache
     /// returns true if the before state is known, or false otherwise
     bool transition_resource(handle::resource res, D3D12_RESOURCE_STATES after, D3D12_RESOURCE_STATES& out_before)
     {
-        for (auto i = 0u; i < num_entries; ++i)
+        if (cache_entry* const entry = _storage.find(res))
         {
-            cache_entry& entry = entries[i];
-            if (entry.ptr == res)
-            {
-                // resource is in cache
-                out_before = entry.current;
-                entry.current = after;
-                return true;
-            }
+            // resource is in cache
+            out_before = entry->current;
+            entry->current = after;
+            return true;
         }
 
-        CC_ASSERT(num_entries < entries.size() && "state cache full, increase increase PHI config : max_num_unique_transitions_per_cmdlist");
-        entries[num_entries++] = {res, after, after};
+        _storage.insert({res, after, after});
         return false;
     }
 
-    void reset() { num_entries = 0; }
+    void reset() { _storage.reset(); }
 
-    void initialize(cc::span<cache_entry> memory)
-    {
-        num_entries = 0;
-        entries = memory;
-    }
+    void initialize(cc::allocator* alloc, uint32_t initial_capacity) { _storage.initialize(alloc, initial_capacity); }
+    void destroy() { _storage.destroy(); }
+
+    /// returns true if the resource was transitioned in this cache
+    [[nodiscard]] bool contains(handle::resource res) const { return _storage.contains(res); }
+
+    [[nodiscard]] uint32_t num_entries() const { return _storage.num_entries; }
+    [[nodiscard]] cache_entry const& get_entry(uint32_t i) const { return _storage.entries[i]; }
 
-    // linear map for now
-    unsigned num_entries = 0;
-    cc::span<cache_entry> entries;
+private:
+    phi::detail::generic_incomplete_state_cache<cache_entry> _storage;
 };
 }
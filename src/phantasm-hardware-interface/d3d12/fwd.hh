@@ -19,4 +19,5 @@ class CPUDescriptorLinearAllocator;
 
 struct command_list_translator;
 struct incomplete_state_cache;
+struct root_signature;
 }
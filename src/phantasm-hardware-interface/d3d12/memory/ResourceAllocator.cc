@@ -50,3 +50,31 @@ D3D12MA::Allocation* phi::d3d12::ResourceAllocator::allocate(const D3D12_RESOURC
     PHI_D3D12_VERIFY_FULL(mAllocator->CreateResource(&allocation_desc, &desc, initial_state, clear_value, &res, __uuidof(ID3D12Resource), nullptr), mDevice);
     return res;
 }
+
+D3D12MA::Allocation* phi::d3d12::ResourceAllocator::allocateMemory(const D3D12_RESOURCE_ALLOCATION_INFO& info, D3D12_HEAP_FLAGS heap_flags) const
+{
+    constexpr uint64_t c_size_granularity = 64 * 1024;
+
+    D3D12MA::ALLOCATION_DESC allocation_desc = {};
+    allocation_desc.Flags = D3D12MA::ALLOCATION_FLAG_NONE;
+    allocation_desc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
+
+    D3D12_RESOURCE_ALLOCATION_INFO padded_info = info;
+    padded_info.SizeInBytes = (info.SizeInBytes + c_size_granularity - 1) / c_size_granularity * c_size_granularity;
+
+    D3D12MA::Allocation* res;
+    PHI_D3D12_VERIFY_FULL(mAllocator->AllocateMemory(&allocation_desc, heap_flags, &padded_info, &res), mDevice);
+    return res;
+}
+
+ID3D12Resource* phi::d3d12::ResourceAllocator::createPlacedResource(
+    D3D12MA::Allocation* memory, uint64_t offset, const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initial_state, const D3D12_CLEAR_VALUE* clear_value) const
+{
+    CC_ASSERT(offset + getAllocationInfo(desc).SizeInBytes <= memory->GetSize() && "placed resource out of bounds");
+
+    ID3D12Resource* res;
+    PHI_D3D12_VERIFY_FULL(mDevice->CreatePlacedResource(memory->GetHeap(), memory->GetOffset() + offset, &desc, initial_state, clear_value,
+                                                        __uuidof(ID3D12Resource), reinterpret_cast<void**>(&res)),
+                          mDevice);
+    return res;
+}
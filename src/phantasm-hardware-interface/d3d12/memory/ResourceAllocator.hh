@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include <clean-core/fwd.hh>
 
 #include <phantasm-hardware-interface/d3d12/common/d3d12_sanitized.hh>
@@ -24,6 +26,22 @@ public:
                                                 D3D12_CLEAR_VALUE* clear_value = nullptr,
                                                 D3D12_HEAP_TYPE heap_type = D3D12_HEAP_TYPE_DEFAULT) const;
 
+    /// allocate memory without a resource, for placed resources, thread safe
+    /// the size is rounded up to 64KB as required by D3D12MA
+    [[nodiscard]] D3D12MA::Allocation* allocateMemory(D3D12_RESOURCE_ALLOCATION_INFO const& info, D3D12_HEAP_FLAGS heap_flags) const;
+
+    /// create a resource placed at an offset into memory from allocateMemory, thread safe
+    [[nodiscard]] ID3D12Resource* createPlacedResource(D3D12MA::Allocation* memory,
+                                                       uint64_t offset,
+                                                       D3D12_RESOURCE_DESC const& desc,
+                                                       D3D12_RESOURCE_STATES initial_state,
+                                                       D3D12_CLEAR_VALUE const* clear_value) const;
+
+    [[nodiscard]] D3D12_RESOURCE_ALLOCATION_INFO getAllocationInfo(D3D12_RESOURCE_DESC const& desc) const
+    {
+        return mDevice->GetResourceAllocationInfo(0, 1, &desc);
+    }
+
 private:
     D3D12MA::Allocator* mAllocator = nullptr;
     ID3D12Device* mDevice = nullptr;
@@ -186,7 +186,8 @@ void phi::d3d12::CommandListPool::initialize(phi::d3d12::BackendD3D12& backend,
                                              int num_copy_allocs,
                                              int num_copy_lists_per_alloc,
                                              int max_num_unique_transitions_per_cmdlist,
-                                             cc::span<CommandAllocatorsPerThread*> thread_allocators)
+                                             cc::span<CommandAllocatorsPerThread*> thread_allocators,
+                                             cc::allocator* dynamic_alloc)
 {
 #ifdef PHI_HAS_OPTICK
     OPTICK_EVENT();
@@ -210,8 +211,9 @@ void phi::d3d12::CommandListPool::initialize(phi::d3d12::BackendD3D12& backend,
     mPoolCopy.initialize(num_copy_lists_total, static_alloc);
     mRawListsCopy = mRawListsCopy.uninitialized(num_copy_lists_total, static_alloc);
 
-    mNumStateCacheEntriesPerCmdlist = max_num_unique_transitions_per_cmdlist;
-    mFlatStateCacheEntries = mFlatStateCacheEntries.uninitialized(num_lists_total * max_num_unique_transitions_per_cmdlist, static_alloc);
+    mStateCaches = mStateCaches.defaulted(num_lists_total, static_alloc);
+    for (incomplete_state_cache& state_cache : mStateCaches)
+        state_cache.initialize(dynamic_alloc, uint32_t(max_num_unique_transitions_per_cmdlist));
 
     // initialize the three allocator bundles (direct, compute, copy)
     for (auto i = 0u; i < thread_allocators.size(); ++i)
@@ -244,6 +246,9 @@ void phi::d3d12::CommandListPool::destroy()
 
     for (auto const list : mRawListsCopy)
         list->Release();
+
+    for (incomplete_state_cache& state_cache : mStateCaches)
+        state_cache.destroy();
 }
 
 phi::handle::command_list phi::d3d12::CommandListPool::acquireNodeInternal(phi::queue_type type,
@@ -256,7 +261,8 @@ phi::handle::command_list phi::d3d12::CommandListPool::acquireNodeInternal(phi::
     unsigned const res_flat_index = pool.get_handle_index(res) + getFlatIndexOffset(type);
 
     out_node = &pool.get(res);
-    out_node->state_cache.initialize(cc::span(mFlatStateCacheEntries).subspan(res_flat_index * mNumStateCacheEntriesPerCmdlist, mNumStateCacheEntriesPerCmdlist));
+    out_node->state_cache = &mStateCaches[res_flat_index];
+    out_node->state_cache->reset();
 
     auto const res_with_padding_flags = AddHandlePaddingFlags(res, type);
     out_cmdlist = getList(res_with_padding_flags, type);
@@ -152,7 +152,8 @@ private:
         // - the command list is freshly reset using an appropriate allocator
         // - the responsible_allocator must be informed on submit or discard
         cmd_allocator_node* responsible_allocator;
-        incomplete_state_cache state_cache;
+        // points into mStateCaches
+        incomplete_state_cache* state_cache;
     };
 
     using cmdlist_linked_pool_t = cc::atomic_linked_pool<cmd_list_node>;
@@ -251,7 +252,7 @@ public:
         return getList(cl, type);
     }
 
-    incomplete_state_cache* getStateCache(handle::command_list cl) { return &getNodeInternal(cl)->state_cache; }
+    incomplete_state_cache* getStateCache(handle::command_list cl) { return getNodeInternal(cl)->state_cache; }
 
 public:
     void initialize(BackendD3D12& backend,
@@ -263,7 +264,8 @@ public:
                     int num_copy_allocs,
                     int num_copy_lists_per_alloc,
                     int max_num_unique_transitions_per_cmdlist,
-                    cc::span<CommandAllocatorsPerThread*> thread_allocators);
+                    cc::span<CommandAllocatorsPerThread*> thread_allocators,
+                    cc::allocator* dynamic_alloc);
     void destroy();
 
 
@@ -291,9 +293,9 @@ private:
     cmdlist_linked_pool_t mPoolCompute;
     cmdlist_linked_pool_t mPoolCopy;
 
-    // flat memory for the state caches
-    int mNumStateCacheEntriesPerCmdlist;
-    cc::alloc_array<incomplete_state_cache::cache_entry> mFlatStateCacheEntries;
+    // the state caches, flat-indexed across the three pools
+    // their memory grows on demand and is kept across uses
+    cc::alloc_array<incomplete_state_cache> mStateCaches;
 
     // parallel arrays to the pools, identically indexed
     // the cmdlists must stay alive even while "unallocated"
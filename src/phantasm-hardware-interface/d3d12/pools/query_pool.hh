@@ -2,7 +2,7 @@
 
 #include <mutex>
 
-#include <phantasm-hardware-interface/common/page_allocator.hh>
+#include <phantasm-hardware-interface/common/bitmap_page_allocator.hh>
 #include <phantasm-hardware-interface/types.hh>
 
 #include <phantasm-hardware-interface/d3d12/common/d3d12_sanitized.hh>
@@ -47,7 +47,7 @@ public:
 
 private:
     ID3D12QueryHeap* mHeap;
-    phi::page_allocator mPageAllocator;
+    phi::bitmap_page_allocator mPageAllocator;
     D3D12_QUERY_HEAP_TYPE mType;
 };
 
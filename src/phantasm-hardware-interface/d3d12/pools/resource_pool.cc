@@ -6,6 +6,7 @@
 #include <phantasm-hardware-interface/common/byte_util.hh>
 #include <phantasm-hardware-interface/common/format_size.hh>
 #include <phantasm-hardware-interface/common/log.hh>
+#include <phantasm-hardware-interface/common/transient_placement.hh>
 
 #include <phantasm-hardware-interface/d3d12/common/d3dx12.hh>
 #include <phantasm-hardware-interface/d3d12/common/dxgi_format.hh>
@@ -60,12 +61,79 @@ constexpr D3D12_RESOURCE_STATES d3d12_get_initial_state_by_heap(phi::resource_he
 
     return D3D12_RESOURCE_STATE_COMMON;
 }
+
+struct d3d12_texture_creation_info
+{
+    D3D12_RESOURCE_DESC desc = {};
+    D3D12_RESOURCE_STATES initial_state = D3D12_RESOURCE_STATE_COMMON;
+    D3D12_CLEAR_VALUE clear_value = {};
+    bool has_clear_value = false;
+
+    D3D12_CLEAR_VALUE* get_clear_value() { return has_clear_value ? &clear_value : nullptr; }
+};
+
+d3d12_texture_creation_info d3d12_get_texture_creation_info(phi::arg::texture_description const& description)
+{
+    d3d12_texture_creation_info res;
+
+    D3D12_RESOURCE_DESC& desc = res.desc;
+    desc.Dimension = phi::d3d12::util::to_native(description.dim);
+    desc.Format = phi::d3d12::util::to_dxgi_format(description.fmt);
+    desc.Width = description.width;
+    desc.Height = description.height;
+    desc.DepthOrArraySize = UINT16(description.depth_or_array_size);
+    desc.MipLevels = UINT16(description.num_mips);
+    desc.SampleDesc.Count = description.num_samples;
+    desc.SampleDesc.Quality = desc.SampleDesc.Count != 1 ? DXGI_STANDARD_MULTISAMPLE_QUALITY_PATTERN : 0;
+
+    desc.Flags = phi::d3d12::util::to_native_resource_usage_flags(description.usage);
+
+    desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    desc.Alignment = 0;
+
+    D3D12_CLEAR_VALUE& clear_value = res.clear_value;
+    clear_value.Format = desc.Format;
+
+    auto const unpacked_clearval = ::phi::util::unpack_rgba8(description.optimized_clear_value);
+
+    if (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)
+    {
+        res.initial_state = phi::d3d12::util::to_native(phi::resource_state::depth_write);
+
+        if (description.usage & phi::resource_usage_flags::use_optimized_clear_value)
+        {
+            clear_value.DepthStencil.Depth = float(unpacked_clearval.r) / 255.f;
+            clear_value.DepthStencil.Stencil = unpacked_clearval.g;
+            res.has_clear_value = true;
+        }
+    }
+    else if (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET)
+    {
+        res.initial_state = phi::d3d12::util::to_native(phi::resource_state::render_target);
+
+        if (description.usage & phi::resource_usage_flags::use_optimized_clear_value)
+        {
+            clear_value.Color[0] = float(unpacked_clearval.r) / 255.f;
+            clear_value.Color[1] = float(unpacked_clearval.g) / 255.f;
+            clear_value.Color[2] = float(unpacked_clearval.b) / 255.f;
+            clear_value.Color[3] = float(unpacked_clearval.a) / 255.f;
+            res.has_clear_value = true;
+        }
+    }
+    else
+    {
+        res.initial_state = phi::d3d12::util::to_native(phi::resource_state::copy_dest);
+    }
+
+    return res;
+}
 }
 
 void phi::d3d12::ResourcePool::initialize(ID3D12Device* device, uint32_t max_num_resources, uint32_t max_num_swapchains, cc::allocator* static_alloc, cc::allocator* dynamic_alloc)
 {
     mAllocator.initialize(device, dynamic_alloc);
     mPool.initialize(max_num_resources + max_num_swapchains, static_alloc); // additional resources for swapchain backbuffers
+    mAliasingBlocks.initialize(max_num_resources, static_alloc);
 
     mParallelResourceDescriptions.reset(static_alloc, mPool.max_size());
 
@@ -98,7 +166,7 @@ void phi::d3d12::ResourcePool::destroy()
             auto const strlen = util::get_object_name(leaked_node.resource, debugname_buffer);
             PHI_LOG("  leaked handle::resource - {}", cc::string_view(debugname_buffer, cc::min<UINT>(strlen, sizeof(debugname_buffer))));
 
-            leaked_node.allocation->Release();
+            internalFree(leaked_node);
         }
     });
 
@@ -108,6 +176,7 @@ void phi::d3d12::ResourcePool::destroy()
     }
 
     mPool.destroy();
+    mAliasingBlocks.destroy();
     mParallelResourceDescriptions = {};
 
     mAllocator.destroy();
@@ -133,63 +202,80 @@ phi::handle::resource phi::d3d12::ResourcePool::createTexture(arg::texture_descr
 {
     CC_CONTRACT(description.width > 0 && description.height > 0);
 
-    D3D12_RESOURCE_DESC desc = {};
-    desc.Dimension = util::to_native(description.dim);
-    desc.Format = util::to_dxgi_format(description.fmt);
-    desc.Width = description.width;
-    desc.Height = description.height;
-    desc.DepthOrArraySize = UINT16(description.depth_or_array_size);
-    desc.MipLevels = UINT16(description.num_mips);
-    desc.SampleDesc.Count = description.num_samples;
-    desc.SampleDesc.Quality = desc.SampleDesc.Count != 1 ? DXGI_STANDARD_MULTISAMPLE_QUALITY_PATTERN : 0;
+    auto info = d3d12_get_texture_creation_info(description);
 
-    desc.Flags = util::to_native_resource_usage_flags(description.usage);
+    auto* const alloc = mAllocator.allocate(info.desc, info.initial_state, info.get_clear_value(), D3D12_HEAP_TYPE_DEFAULT);
+    auto const realNumMipmaps = alloc->GetResource()->GetDesc().MipLevels;
+    util::set_object_name(alloc->GetResource(), "tex%s[%u] %s (%ux%u, %u mips)", d3d12_get_tex_dim_literal(description.dim),
+                          description.depth_or_array_size, dbg_name ? dbg_name : "", description.width, description.height, realNumMipmaps);
 
-    desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-    desc.Alignment = 0;
+    return acquireImage(alloc, info.initial_state, description, realNumMipmaps);
+}
 
-    D3D12_RESOURCE_STATES initial_state;
-    D3D12_CLEAR_VALUE* clear_value_ptr = nullptr;
-    D3D12_CLEAR_VALUE clear_value;
-    clear_value.Format = desc.Format;
+void phi::d3d12::ResourcePool::createTransientTextures(cc::span<arg::transient_texture_description const> descriptions,
+                                                      cc::span<handle::resource> out_resources,
+                                                      char const* dbg_name,
+                                                      cc::allocator* scratch_alloc)
+{
+    CC_CONTRACT(descriptions.size() == out_resources.size());
+    if (descriptions.empty())
+        return;
 
-    auto const unpacked_clearval = ::phi::util::unpack_rgba8(description.optimized_clear_value);
+    auto infos = cc::alloc_array<d3d12_texture_creation_info>::uninitialized(descriptions.size(), scratch_alloc);
+    auto requests = cc::alloc_array<transient_placement_request>::uninitialized(descriptions.size(), scratch_alloc);
+    auto offsets = cc::alloc_array<uint64_t>::uninitialized(descriptions.size(), scratch_alloc);
 
-    if (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)
-    {
-        initial_state = util::to_native(resource_state::depth_write);
+    D3D12_RESOURCE_ALLOCATION_INFO block_info = {};
+    block_info.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
 
-        if (description.usage & phi::resource_usage_flags::use_optimized_clear_value)
-        {
-            clear_value.DepthStencil.Depth = float(unpacked_clearval.r) / 255.f;
-            clear_value.DepthStencil.Stencil = unpacked_clearval.g;
-            clear_value_ptr = &clear_value;
-        }
-    }
-    else if (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET)
+    uint32_t num_rt_ds_textures = 0;
+    for (auto i = 0u; i < descriptions.size(); ++i)
     {
-        initial_state = util::to_native(resource_state::render_target);
+        CC_CONTRACT(descriptions[i].desc.width > 0 && descriptions[i].desc.height > 0);
 
-        if (description.usage & phi::resource_usage_flags::use_optimized_clear_value)
-        {
-            clear_value.Color[0] = float(unpacked_clearval.r) / 255.f;
-            clear_value.Color[1] = float(unpacked_clearval.g) / 255.f;
-            clear_value.Color[2] = float(unpacked_clearval.b) / 255.f;
-            clear_value.Color[3] = float(unpacked_clearval.a) / 255.f;
-            clear_value_ptr = &clear_value;
-        }
+        infos[i] = d3d12_get_texture_creation_info(descriptions[i].desc);
+        auto const alloc_info = mAllocator.getAllocationInfo(infos[i].desc);
+
+        requests[i] = transient_placement_request{alloc_info.SizeInBytes, alloc_info.Alignment, descriptions[i].first_use, descriptions[i].last_use};
+        block_info.Alignment = cc::max(block_info.Alignment, alloc_info.Alignment);
+
+        if (infos[i].desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+            ++num_rt_ds_textures;
     }
-    else
+
+    block_info.SizeInBytes = compute_transient_placement(requests, offsets, scratch_alloc);
+
+    // on resource heap tier 1, render- and depth targets cannot share a heap with other textures
+    D3D12_HEAP_FLAGS heap_flags = D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+    if (num_rt_ds_textures == descriptions.size())
+        heap_flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+    else if (num_rt_ds_textures == 0)
+        heap_flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+
+    D3D12MA::Allocation* const block_alloc = mAllocator.allocateMemory(block_info, heap_flags);
+
+    uint32_t const block_index = mAliasingBlocks.acquire();
+    aliasing_block& block = mAliasingBlocks.get(block_index);
+    block.allocation = block_alloc;
+    block.num_alive_resources.store(uint32_t(descriptions.size()), std::memory_order_relaxed);
+
+    for (auto i = 0u; i < descriptions.size(); ++i)
     {
-        initial_state = util::to_native(resource_state::copy_dest);
-    }
+        auto const& description = descriptions[i].desc;
+        ID3D12Resource* const raw_resource
+            = mAllocator.createPlacedResource(block_alloc, offsets[i], infos[i].desc, infos[i].initial_state, infos[i].get_clear_value());
 
-    auto* const alloc = mAllocator.allocate(desc, initial_state, clear_value_ptr, D3D12_HEAP_TYPE_DEFAULT);
-    auto const realNumMipmaps = alloc->GetResource()->GetDesc().MipLevels;
-    util::set_object_name(alloc->GetResource(), "tex%s[%u] %s (%ux%u, %u mips)", d3d12_get_tex_dim_literal(description.dim),
-                          description.depth_or_array_size, dbg_name ? dbg_name : "", description.width, description.height, realNumMipmaps);
+        auto const realNumMipmaps = raw_resource->GetDesc().MipLevels;
+        util::set_object_name(raw_resource, "transient tex%s[%u] %s (%ux%u, %u mips, +%uB)", d3d12_get_tex_dim_literal(description.dim),
+                              description.depth_or_array_size, dbg_name ? dbg_name : "", description.width, description.height, realNumMipmaps,
+                              unsigned(offsets[i]));
+
+        out_resources[i] = acquireImage(block_alloc, infos[i].initial_state, description, realNumMipmaps);
 
-    return acquireImage(alloc, initial_state, description, realNumMipmaps);
+        resource_node& node = internalGet(out_resources[i]);
+        node.resource = raw_resource;
+        node.aliasing_block = block_index;
+    }
 }
 
 phi::handle::resource phi::d3d12::ResourcePool::createBuffer(arg::buffer_description const& description, const char* dbg_name)
@@ -265,8 +351,7 @@ void phi::d3d12::ResourcePool::free(phi::handle::resource res)
     CC_ASSERT(!isBackbuffer(res) && "the backbuffer resource must not be freed");
 
     resource_node& freed_node = mPool.get(res._value);
-    // This requires no synchronization, as D3D12MA internally syncs
-    freed_node.allocation->Release();
+    internalFree(freed_node);
 
     mPool.release(res._value);
 }
@@ -292,6 +377,7 @@ phi::handle::resource phi::d3d12::ResourcePool::acquireBuffer(D3D12MA::Allocatio
     resource_node& new_node = mPool.get(res);
     new_node.allocation = alloc;
     new_node.resource = alloc->GetResource();
+    new_node.aliasing_block = uint32_t(-1);
     new_node.type = resource_node::resource_type::buffer;
     new_node.heap = desc.heap;
     new_node.master_state = initial_state;
@@ -314,6 +400,7 @@ phi::handle::resource phi::d3d12::ResourcePool::acquireImage(D3D12MA::Allocation
     resource_node& new_node = mPool.get(res);
     new_node.allocation = alloc;
     new_node.resource = alloc->GetResource();
+    new_node.aliasing_block = uint32_t(-1);
     new_node.type = resource_node::resource_type::image;
     new_node.heap = resource_heap::gpu;
     new_node.master_state = initial_state;
@@ -328,3 +415,24 @@ phi::handle::resource phi::d3d12::ResourcePool::acquireImage(D3D12MA::Allocation
 
     return {res};
 }
+
+void phi::d3d12::ResourcePool::internalFree(resource_node& node)
+{
+    // This requires no synchronization, as D3D12MA internally syncs
+    if (node.aliasing_block != uint32_t(-1))
+    {
+        // transient, the memory block is shared and freed along with the last resource
+        node.resource->Release();
+
+        aliasing_block& block = mAliasingBlocks.get(node.aliasing_block);
+        if (block.num_alive_resources.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            block.allocation->Release();
+            mAliasingBlocks.release(node.aliasing_block);
+        }
+    }
+    else
+    {
+        node.allocation->Release();
+    }
+}
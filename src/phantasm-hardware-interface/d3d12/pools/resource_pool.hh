@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 #include <clean-core/atomic_linked_pool.hh>
 
 #include <phantasm-hardware-interface/types.hh>
@@ -21,6 +23,12 @@ public:
     /// create a buffer, with an element stride if its an index or vertex buffer
     handle::resource createBuffer(arg::buffer_description const& desc, char const* dbg_name);
 
+    /// create textures placed in a single shared memory block, aliasing where their lifetimes do not overlap
+    void createTransientTextures(cc::span<arg::transient_texture_description const> descriptions,
+                                 cc::span<handle::resource> out_resources,
+                                 char const* dbg_name,
+                                 cc::allocator* scratch_alloc);
+
     [[nodiscard]] std::byte* mapBuffer(handle::resource res, int begin = 0, int end = -1);
 
     void unmapBuffer(handle::resource res, int begin = 0, int end = -1);
@@ -71,6 +79,9 @@ public:
         D3D12_RESOURCE_STATES master_state = D3D12_RESOURCE_STATE_COMMON;
         resource_type type;
         phi::resource_heap heap;
+
+        /// index into the aliasing block pool for transient resources (which share their allocation), or -1
+        uint32_t aliasing_block = uint32_t(-1);
     };
 
 public:
@@ -87,6 +98,7 @@ public:
     ID3D12Resource* getRawResource(buffer_address const& addr) const { return internalGet(addr.buffer).resource; }
 
     // Additional information
+    bool isAliased(handle::resource res) const { return internalGet(res).aliasing_block != uint32_t(-1); }
     bool isImage(handle::resource res) const { return internalGet(res).type == resource_node::resource_type::image; }
     bool isBuffer(handle::resource res) const { return internalGet(res).type == resource_node::resource_type::buffer; }
     resource_node::image_info const& getImageInfo(handle::resource res) const { return internalGet(res).image; }
@@ -189,6 +201,8 @@ private:
 
     [[nodiscard]] handle::resource acquireImage(D3D12MA::Allocation* alloc, D3D12_RESOURCE_STATES initial_state, arg::texture_description const& desc, UINT16 realNumMipmaps);
 
+    void internalFree(resource_node& node);
+
     [[nodiscard]] resource_node const& internalGet(handle::resource res) const
     {
         CC_ASSERT(res.is_valid() && "invalid resource handle");
@@ -200,9 +214,20 @@ private:
         return mPool.get(res._value);
     }
 
+private:
+    /// a memory block shared by transient resources, freed along with the last of them
+    struct aliasing_block
+    {
+        D3D12MA::Allocation* allocation;
+        std::atomic<uint32_t> num_alive_resources;
+    };
+
 private:
     /// The main pool - always gen checked
     cc::atomic_linked_pool<resource_node, true> mPool;
+
+    /// Shared memory blocks of transient resources, sized like the main pool
+    cc::atomic_linked_pool<aliasing_block> mAliasingBlocks;
     /// Amount of handles (from the start) reserved for backbuffer injection
     uint32_t mNumReservedBackbuffers;
 
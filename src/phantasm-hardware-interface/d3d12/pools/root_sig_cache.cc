@@ -25,7 +25,11 @@ char const* get_root_sig_type_literal(phi::d3d12::root_signature_type type)
 
 void phi::d3d12::RootSignatureCache::initialize(unsigned max_num_root_sigs, cc::allocator* alloc) { mCache.initialize(max_num_root_sigs, alloc); }
 
-void phi::d3d12::RootSignatureCache::destroy() { reset(); }
+void phi::d3d12::RootSignatureCache::destroy()
+{
+    reset();
+    mCache.destroy();
+}
 
 phi::d3d12::root_signature* phi::d3d12::RootSignatureCache::getOrCreate(ID3D12Device& device, arg::shader_arg_shapes arg_shapes, bool has_root_constants, root_signature_type type)
 {
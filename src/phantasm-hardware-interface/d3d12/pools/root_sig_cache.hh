@@ -3,7 +3,7 @@
 #include <clean-core/capped_vector.hh>
 
 #include <phantasm-hardware-interface/arguments.hh>
-#include <phantasm-hardware-interface/common/container/stable_map.hh>
+#include <phantasm-hardware-interface/common/container/growable_map.hh>
 #include <phantasm-hardware-interface/common/hash.hh>
 
 #include <phantasm-hardware-interface/d3d12/common/d3d12_fwd.hh>
@@ -59,7 +59,7 @@ private:
         uint64_t operator()(rootsig_key const& v) const noexcept { return cc::make_hash(hash::compute(v.arg_shapes), v.type, v.has_root_constants); }
     };
 
-    phi::detail::stable_map<rootsig_key, root_signature, rootsig_hasher> mCache;
+    phi::detail::growable_map<rootsig_key, root_signature, rootsig_hasher> mCache;
 };
 
 }
@@ -0,0 +1,437 @@
+#include "command_capture.hh"
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+
+#include <phantasm-hardware-interface/commands.hh>
+#include <phantasm-hardware-interface/common/log.hh>
+
+namespace
+{
+void writeString(phi::byte_writer& writer, char const* str)
+{
+    size_t const length = str == nullptr ? 0 : std::strlen(str);
+    writer.write_t(length);
+    writer.write(cc::span{reinterpret_cast<std::byte const*>(str), length});
+}
+
+void writeBinary(phi::byte_writer& writer, phi::arg::shader_binary const& binary)
+{
+    writer.write_t(binary.size);
+    writer.write(cc::span{binary.data, binary.size});
+}
+
+template <class HandleT>
+void writeHandles(phi::byte_writer& writer, cc::span<HandleT const> handles)
+{
+    writer.write_t(size_t(handles.size()));
+    for (auto const h : handles)
+        writer.write_t(h._value);
+}
+}
+
+phi::CaptureBackend::CaptureBackend(phi::Backend& inner, cc::allocator* alloc) : mInner(inner)
+{
+    mWriter.initialize(alloc, 1024 * 64);
+}
+
+bool phi::CaptureBackend::writeCaptureFile(char const* path)
+{
+    auto lg = std::lock_guard(mMutex);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.good())
+    {
+        PHI_LOG_ERROR("failed to open capture file {} for writing", path);
+        return false;
+    }
+
+    capture::file_header header;
+    header.backend = mInner.getBackendType();
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    file.write(reinterpret_cast<char const*>(mWriter.data()), long(mWriter.size()));
+    file.close();
+
+    if (file.fail())
+    {
+        PHI_LOG_ERROR("failed to write capture file {}", path);
+        return false;
+    }
+
+    PHI_LOG("wrote capture file {} ({} KB)", path, (mWriter.size() + sizeof(header)) / 1024);
+    return true;
+}
+
+void phi::CaptureBackend::resetCapture()
+{
+    auto lg = std::lock_guard(mMutex);
+    mWriter.reset();
+}
+
+phi::handle::resource phi::CaptureBackend::acquireBackbuffer(phi::handle::swapchain sc)
+{
+    auto lg = std::lock_guard(mMutex);
+
+    handle::resource const res = mInner.acquireBackbuffer(sc);
+    if (res.is_valid())
+    {
+        auto const ev = beginEvent(capture::event_type::acquire_backbuffer);
+        mWriter.write_t(res._value);
+        mWriter.write_t(mInner.getBackbufferFormat(sc));
+        mWriter.write_t(mInner.getBackbufferSize(sc));
+        endEvent(ev);
+    }
+
+    return res;
+}
+
+phi::handle::resource phi::CaptureBackend::createTexture(const phi::arg::texture_description& desc, char const* debug_name)
+{
+    auto lg = std::lock_guard(mMutex);
+
+    handle::resource const res = mInner.createTexture(desc, debug_name);
+
+    auto const ev = beginEvent(capture::event_type::create_texture);
+    mWriter.write_t(res._value);
+    mWriter.write_t(desc);
+    endEvent(ev);
+
+    return res;
+}
+
+phi::handle::resource phi::CaptureBackend::createBuffer(const phi::arg::buffer_description& desc, char const* debug_name)
+{
+    auto lg = std::lock_guard(mMutex);
+
+    handle::resource const res = mInner.createBuffer(desc, debug_name);
+
+    auto const ev = beginEvent(capture::event_type::create_buffer);
+    mWriter.write_t(res._value);
+    mWriter.write_t(desc);
+    endEvent(ev);
+
+    return res;
+}
+
+void phi::CaptureBackend::createTransientTextures(cc::span<arg::transient_texture_description const> descs, cc::span<handle::resource> out_resources, char const* debug_name)
+{
+    auto lg = std::lock_guard(mMutex);
+
+    mInner.createTransientTextures(descs, out_resources, debug_name);
+
+    // captured as regular textures, replays do not alias
+    for (auto i = 0u; i < descs.size(); ++i)
+    {
+        auto const ev = beginEvent(capture::event_type::create_texture);
+        mWriter.write_t(out_resources[i]._value);
+        mWriter.write_t(descs[i].desc);
+        endEvent(ev);
+    }
+}
+
+void phi::CaptureBackend::freeRange(cc::span<const phi::handle::resource> resources)
+{
+    {
+        auto lg = std::lock_guard(mMutex);
+        auto const ev = beginEvent(capture::event_type::free_resources);
+        writeHandles(mWriter, resources);
+        endEvent(ev);
+    }
+
+    mInner.freeRange(resources);
+}
+
+phi::handle::shader_view phi::CaptureBackend::createShaderView(cc::span<const phi::resource_view> srvs,
+                                                               cc::span<const phi::resource_view> uavs,
+                                                               cc::span<const phi::sampler_config> samplers,
+                                                               bool usage_compute)
+{
+    auto lg = std::lock_guard(mMutex);
+
+    handle::shader_view const res = mInner.createShaderView(srvs, uavs, samplers, usage_compute);
+
+    auto const ev = beginEvent(capture::event_type::create_shader_view);
+    mWriter.write_t(res._value);
+    mWriter.write_t(usage_compute);
+    mWriter.write_sized_array(srvs);
+    mWriter.write_sized_array(uavs);
+    mWriter.write_sized_array(samplers);
+    endEvent(ev);
+
+    return res;
+}
+
+phi::handle::shader_view phi::CaptureBackend::createEmptyShaderView(const phi::arg::shader_view_description& desc, bool usage_compute)
+{
+    auto lg = std::lock_guard(mMutex);
+
+    handle::shader_view const res = mInner.createEmptyShaderView(desc, usage_compute);
+
+    auto const ev = beginEvent(capture::event_type::create_empty_shader_view);
+    mWriter.write_t(res._value);
+    mWriter.write_t(usage_compute);
+    mWriter.write_t(desc.num_srvs);
+    mWriter.write_sized_array(desc.srv_entries);
+    mWriter.write_t(desc.num_uavs);
+    mWriter.write_sized_array(desc.uav_entries);
+    mWriter.write_t(desc.num_samplers);
+    endEvent(ev);
+
+    return res;
+}
+
+void phi::CaptureBackend::writeShaderViewSRVs(phi::handle::shader_view sv, uint32_t offset, cc::span<const phi::resource_view> srvs)
+{
+    {
+        auto lg = std::lock_guard(mMutex);
+        auto const ev = beginEvent(capture::event_type::write_shader_view_srvs);
+        mWriter.write_t(sv._value);
+        mWriter.write_t(offset);
+        mWriter.write_sized_array(srvs);
+        endEvent(ev);
+    }
+
+    mInner.writeShaderViewSRVs(sv, offset, srvs);
+}
+
+void phi::CaptureBackend::writeShaderViewUAVs(phi::handle::shader_view sv, uint32_t offset, cc::span<const phi::resource_view> uavs)
+{
+    {
+        auto lg = std::lock_guard(mMutex);
+        auto const ev = beginEvent(capture::event_type::write_shader_view_uavs);
+        mWriter.write_t(sv._value);
+        mWriter.write_t(offset);
+        mWriter.write_sized_array(uavs);
+        endEvent(ev);
+    }
+
+    mInner.writeShaderViewUAVs(sv, offset, uavs);
+}
+
+void phi::CaptureBackend::writeShaderViewSamplers(phi::handle::shader_view sv, uint32_t offset, cc::span<const phi::sampler_config> samplers)
+{
+    {
+        auto lg = std::lock_guard(mMutex);
+        auto const ev = beginEvent(capture::event_type::write_shader_view_samplers);
+        mWriter.write_t(sv._value);
+        mWriter.write_t(offset);
+        mWriter.write_sized_array(samplers);
+        endEvent(ev);
+    }
+
+    mInner.writeShaderViewSamplers(sv, offset, samplers);
+}
+
+void phi::CaptureBackend::freeRange(cc::span<const phi::handle::shader_view> svs)
+{
+    {
+        auto lg = std::lock_guard(mMutex);
+        auto const ev = beginEvent(capture::event_type::free_shader_views);
+        writeHandles(mWriter, svs);
+        endEvent(ev);
+    }
+
+    mInner.freeRange(svs);
+}
+
+phi::handle::pipeline_state phi::CaptureBackend::createPipelineState(phi::arg::vertex_format vertex_format,
+                                                                     const phi::arg::framebuffer_config& framebuffer_conf,
+                                                                     phi::arg::shader_arg_shapes shader_arg_shapes,
+                                                                     bool has_root_constants,
+                                                                     phi::arg::graphics_shaders shaders,
+                                                                     const phi::pipeline_config& primitive_config,
+                                                                     char const* debug_name)
+{
+    arg::graphics_pipeline_state_description description;
+    description.config = primitive_config;
+    description.framebuffer = framebuffer_conf;
+    description.vertices = vertex_format;
+    description.has_root_constants = has_root_constants;
+
+    for (auto const& shader : shaders)
+        description.shader_binaries.push_back(shader);
+
+    for (auto const& shape : shader_arg_shapes)
+        description.shader_arg_shapes.push_back(shape);
+
+    return createPipelineState(description, debug_name);
+}
+
+phi::handle::pipeline_state phi::CaptureBackend::createPipelineState(const phi::arg::graphics_pipeline_state_description& description, char const* debug_name)
+{
+    auto lg = std::lock_guard(mMutex);
+
+    handle::pipeline_state const res = mInner.createPipelineState(description, debug_name);
+    writeGraphicsPSOEvent(res, description);
+    return res;
+}
+
+phi::handle::pipeline_state phi::CaptureBackend::createComputePipelineState(phi::arg::shader_arg_shapes shader_arg_shapes,
+                                                                            phi::arg::shader_binary shader,
+                                                                            bool has_root_constants,
+                                                                            char const* debug_name)
+{
+    arg::compute_pipeline_state_description description;
+    description.shader = shader;
+    description.has_root_constants = has_root_constants;
+
+    for (auto const& shape : shader_arg_shapes)
+        description.shader_arg_shapes.push_back(shape);
+
+    return createComputePipelineState(description, debug_name);
+}
+
+phi::handle::pipeline_state phi::CaptureBackend::createComputePipelineState(const phi::arg::compute_pipeline_state_description& description, char const* debug_name)
+{
+    auto lg = std::lock_guard(mMutex);
+
+    handle::pipeline_state const res = mInner.createComputePipelineState(description, debug_name);
+    writeComputePSOEvent(res, description);
+    return res;
+}
+
+void phi::CaptureBackend::createPipelineStates(cc::span<const phi::arg::graphics_pipeline_state_description> descriptions,
+                                               cc::span<phi::handle::pipeline_state> out_psos,
+                                               cc::span<char const* const> debug_names)
+{
+    auto lg = std::lock_guard(mMutex);
+
+    mInner.createPipelineStates(descriptions, out_psos, debug_names);
+
+    for (auto i = 0u; i < descriptions.size(); ++i)
+        writeGraphicsPSOEvent(out_psos[i], descriptions[i]);
+}
+
+void phi::CaptureBackend::createComputePipelineStates(cc::span<const phi::arg::compute_pipeline_state_description> descriptions,
+                                                      cc::span<phi::handle::pipeline_state> out_psos,
+                                                      cc::span<char const* const> debug_names)
+{
+    auto lg = std::lock_guard(mMutex);
+
+    mInner.createComputePipelineStates(descriptions, out_psos, debug_names);
+
+    for (auto i = 0u; i < descriptions.size(); ++i)
+        writeComputePSOEvent(out_psos[i], descriptions[i]);
+}
+
+void phi::CaptureBackend::free(phi::handle::pipeline_state ps)
+{
+    {
+        auto lg = std::lock_guard(mMutex);
+        auto const ev = beginEvent(capture::event_type::free_pso);
+        mWriter.write_t(ps._value);
+        endEvent(ev);
+    }
+
+    mInner.free(ps);
+}
+
+phi::handle::command_list phi::CaptureBackend::recordCommandList(std::byte const* buffer, size_t size, phi::queue_type queue)
+{
+    command_stream_chunk const chunk = {buffer, size};
+    return recordCommandList(cc::span<command_stream_chunk const>(&chunk, 1), queue);
+}
+
+phi::handle::command_list phi::CaptureBackend::recordCommandList(cc::span<command_stream_chunk const> chunks, phi::queue_type queue)
+{
+    {
+        // the list is captured before it is translated, all handles it refers to have been captured already
+        // chunks are concatenated, replays record a single contiguous buffer
+        size_t size = 0;
+        for (auto const& chunk : chunks)
+            size += chunk.size;
+
+        auto lg = std::lock_guard(mMutex);
+        auto const ev = beginEvent(capture::event_type::record_command_list);
+        mWriter.write_t(queue);
+        mWriter.write_t(size);
+        for (auto const& chunk : chunks)
+            mWriter.write(cc::span{chunk.buffer, chunk.size});
+        endEvent(ev);
+    }
+
+    return mInner.recordCommandList(chunks, queue);
+}
+
+phi::handle::query_range phi::CaptureBackend::createQueryRange(phi::query_type type, uint32_t size)
+{
+    auto lg = std::lock_guard(mMutex);
+
+    handle::query_range const res = mInner.createQueryRange(type, size);
+
+    auto const ev = beginEvent(capture::event_type::create_query_range);
+    mWriter.write_t(res._value);
+    mWriter.write_t(type);
+    mWriter.write_t(size);
+    endEvent(ev);
+
+    return res;
+}
+
+void phi::CaptureBackend::free(phi::handle::query_range query_range)
+{
+    {
+        auto lg = std::lock_guard(mMutex);
+        auto const ev = beginEvent(capture::event_type::free_query_range);
+        mWriter.write_t(query_range._value);
+        endEvent(ev);
+    }
+
+    mInner.free(query_range);
+}
+
+size_t phi::CaptureBackend::beginEvent(phi::capture::event_type type)
+{
+    size_t const offset = mWriter.size();
+    mWriter.write_t(capture::event_header{type, 0});
+    return offset;
+}
+
+void phi::CaptureBackend::endEvent(size_t header_offset)
+{
+    size_t const payload_size = mWriter.size() - header_offset - sizeof(capture::event_header);
+    CC_ASSERT(payload_size <= size_t(uint32_t(-1)) && "capture event too large");
+
+    mWriter.patch_t(header_offset + offsetof(capture::event_header, payload_size_bytes), uint32_t(payload_size));
+}
+
+void phi::CaptureBackend::writeGraphicsPSOEvent(phi::handle::pipeline_state pso, const phi::arg::graphics_pipeline_state_description& description)
+{
+    auto const ev = beginEvent(capture::event_type::create_graphics_pso);
+    mWriter.write_t(pso._value);
+    mWriter.write_t(description.config);
+    mWriter.write_t(description.framebuffer);
+    mWriter.write_t(description.vertices.vertex_sizes_bytes);
+
+    // vertex attributes reference their semantic names
+    mWriter.write_t(size_t(description.vertices.attributes.size()));
+    for (auto const& attr : description.vertices.attributes)
+    {
+        writeString(mWriter, attr.semantic_name);
+        mWriter.write_t(attr.offset);
+        mWriter.write_t(attr.fmt);
+        mWriter.write_t(attr.vertex_buffer_i);
+    }
+
+    mWriter.write_t(size_t(description.shader_binaries.size()));
+    for (auto const& shader : description.shader_binaries)
+    {
+        mWriter.write_t(shader.stage);
+        writeBinary(mWriter, shader.binary);
+    }
+
+    mWriter.write_t(description.shader_arg_shapes);
+    mWriter.write_t(description.has_root_constants);
+    endEvent(ev);
+}
+
+void phi::CaptureBackend::writeComputePSOEvent(phi::handle::pipeline_state pso, const phi::arg::compute_pipeline_state_description& description)
+{
+    auto const ev = beginEvent(capture::event_type::create_compute_pso);
+    mWriter.write_t(pso._value);
+    mWriter.write_t(description.shader_arg_shapes);
+    mWriter.write_t(description.has_root_constants);
+    writeBinary(mWriter, description.shader);
+    endEvent(ev);
+}
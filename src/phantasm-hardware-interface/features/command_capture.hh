@@ -0,0 +1,305 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include <clean-core/allocator.hh>
+
+#include <phantasm-hardware-interface/Backend.hh>
+#include <phantasm-hardware-interface/arguments.hh>
+#include <phantasm-hardware-interface/common/byte_writer.hh>
+#include <phantasm-hardware-interface/types.hh>
+
+namespace phi::capture
+{
+/// capture file layout:
+/// [file_header] [event_header] [payload] [event_header] [payload] ...
+/// payloads are written with byte_writer and read with byte_reader, handles are the values of the capturing process
+inline constexpr uint32_t file_magic = 0x43494850; // "PHIC"
+inline constexpr uint32_t file_version = 2; // 2: cmd::begin_profile_scope::name
+
+struct file_header
+{
+    uint32_t magic = file_magic;
+    uint32_t version = file_version;
+    backend_type backend;
+    uint8_t _pad[3] = {};
+};
+
+enum class event_type : uint32_t
+{
+    create_texture,
+    create_buffer,
+    acquire_backbuffer,
+    free_resources,
+
+    create_shader_view,
+    create_empty_shader_view,
+    write_shader_view_srvs,
+    write_shader_view_uavs,
+    write_shader_view_samplers,
+    free_shader_views,
+
+    create_graphics_pso,
+    create_compute_pso,
+    free_pso,
+
+    create_query_range,
+    free_query_range,
+
+    record_command_list,
+};
+
+struct event_header
+{
+    event_type type;
+    uint32_t payload_size_bytes;
+};
+}
+
+namespace phi
+{
+/// A backend forwarding all calls to a wrapped backend, capturing recorded command lists
+/// along with the creation calls of every object they can refer to
+/// the capture can be written to a file and replayed against a fresh backend, see command_replay.hh
+///
+/// not captured: swapchains (backbuffers are replayed as render targets of the same format and size),
+/// mapped memory contents, fences, raytracing objects and cmd::draw_batch records (lists using them are skipped on replay)
+///
+/// creation calls are serialized internally so the capture order is consistent with all possible uses of the created handles
+class PHI_API CaptureBackend final : public Backend
+{
+public:
+    /// the wrapped backend is not owned and must outlive this one
+    explicit CaptureBackend(Backend& inner, cc::allocator* alloc = cc::system_allocator);
+
+    /// writes everything captured so far to a file, returns false on failure
+    bool writeCaptureFile(char const* path);
+
+    /// discards everything captured so far, handles created before this call cannot be used in lists recorded afterwards
+    void resetCapture();
+
+    [[nodiscard]] Backend& getInner() const { return mInner; }
+
+public:
+    void initialize(backend_config const& config) override { mInner.initialize(config); }
+    void destroy() override { mInner.destroy(); }
+    void flushGPU() override { mInner.flushGPU(); }
+
+    //
+    // Swapchain interface
+    //
+
+    [[nodiscard]] handle::swapchain createSwapchain(window_handle const& window_handle,
+                                                    tg::isize2 initial_size,
+                                                    present_mode mode = present_mode::synced,
+                                                    uint32_t num_backbuffers = 3) override
+    {
+        return mInner.createSwapchain(window_handle, initial_size, mode, num_backbuffers);
+    }
+
+    void free(handle::swapchain sc) override { mInner.free(sc); }
+    [[nodiscard]] handle::resource acquireBackbuffer(handle::swapchain sc) override;
+    void present(handle::swapchain sc) override { mInner.present(sc); }
+    void onResize(handle::swapchain sc, tg::isize2 size) override { mInner.onResize(sc, size); }
+    tg::isize2 getBackbufferSize(handle::swapchain sc) const override { return mInner.getBackbufferSize(sc); }
+    format getBackbufferFormat(handle::swapchain sc) const override { return mInner.getBackbufferFormat(sc); }
+    uint32_t getNumBackbuffers(handle::swapchain sc) const override { return mInner.getNumBackbuffers(sc); }
+    [[nodiscard]] bool clearPendingResize(handle::swapchain sc) override { return mInner.clearPendingResize(sc); }
+
+    //
+    // Resource interface
+    //
+
+    [[nodiscard]] handle::resource createTexture(arg::texture_description const& desc, char const* debug_name = nullptr) override;
+    [[nodiscard]] handle::resource createBuffer(arg::buffer_description const& desc, char const* debug_name = nullptr) override;
+    void createTransientTextures(cc::span<arg::transient_texture_description const> descs, cc::span<handle::resource> out_resources, char const* debug_name = nullptr) override;
+
+    [[nodiscard]] std::byte* mapBuffer(handle::resource res, int invalidate_begin = 0, int invalidate_end = -1) override
+    {
+        return mInner.mapBuffer(res, invalidate_begin, invalidate_end);
+    }
+
+    void unmapBuffer(handle::resource res, int flush_begin = 0, int flush_end = -1) override { mInner.unmapBuffer(res, flush_begin, flush_end); }
+
+    void free(handle::resource res) override { freeRange(cc::span{res}); }
+    void freeRange(cc::span<handle::resource const> resources) override;
+
+    //
+    // Shader view interface
+    //
+
+    [[nodiscard]] handle::shader_view createShaderView(cc::span<resource_view const> srvs,
+                                                       cc::span<resource_view const> uavs,
+                                                       cc::span<sampler_config const> samplers,
+                                                       bool usage_compute = false) override;
+
+    [[nodiscard]] handle::shader_view createEmptyShaderView(arg::shader_view_description const& desc, bool usage_compute = false) override;
+
+    void writeShaderViewSRVs(handle::shader_view sv, uint32_t offset, cc::span<resource_view const> srvs) override;
+    void writeShaderViewUAVs(handle::shader_view sv, uint32_t offset, cc::span<resource_view const> uavs) override;
+    void writeShaderViewSamplers(handle::shader_view sv, uint32_t offset, cc::span<sampler_config const> samplers) override;
+
+    void free(handle::shader_view sv) override { freeRange(cc::span{sv}); }
+    void freeRange(cc::span<handle::shader_view const> svs) override;
+
+    //
+    // Pipeline state interface
+    //
+
+    [[nodiscard]] handle::pipeline_state createPipelineState(arg::vertex_format vertex_format,
+                                                             arg::framebuffer_config const& framebuffer_conf,
+                                                             arg::shader_arg_shapes shader_arg_shapes,
+                                                             bool has_root_constants,
+                                                             arg::graphics_shaders shaders,
+                                                             phi::pipeline_config const& primitive_config,
+                                                             char const* debug_name = nullptr) override;
+
+    [[nodiscard]] handle::pipeline_state createPipelineState(arg::graphics_pipeline_state_description const& description, char const* debug_name = nullptr) override;
+
+    [[nodiscard]] handle::pipeline_state createComputePipelineState(arg::shader_arg_shapes shader_arg_shapes,
+                                                                    arg::shader_binary shader,
+                                                                    bool has_root_constants = false,
+                                                                    char const* debug_name = nullptr) override;
+
+    [[nodiscard]] handle::pipeline_state createComputePipelineState(arg::compute_pipeline_state_description const& description,
+                                                                    char const* debug_name = nullptr) override;
+
+    void createPipelineStates(cc::span<arg::graphics_pipeline_state_description const> descriptions,
+                              cc::span<handle::pipeline_state> out_psos,
+                              cc::span<char const* const> debug_names = {}) override;
+
+    void createComputePipelineStates(cc::span<arg::compute_pipeline_state_description const> descriptions,
+                                     cc::span<handle::pipeline_state> out_psos,
+                                     cc::span<char const* const> debug_names = {}) override;
+
+    void free(handle::pipeline_state ps) override;
+
+    bool flushPipelineCache() override { return mInner.flushPipelineCache(); }
+
+    //
+    // Command list interface
+    //
+
+    [[nodiscard]] handle::command_list recordCommandList(std::byte const* buffer, size_t size, queue_type queue = queue_type::direct) override;
+    [[nodiscard]] handle::command_list recordCommandList(cc::span<command_stream_chunk const> chunks, queue_type queue = queue_type::direct) override;
+    void discard(cc::span<handle::command_list const> cls) override { mInner.discard(cls); }
+
+    void submit(cc::span<handle::command_list const> cls,
+                queue_type queue = queue_type::direct,
+                cc::span<fence_operation const> fence_waits_before = {},
+                cc::span<fence_operation const> fence_signals_after = {}) override
+    {
+        mInner.submit(cls, queue, fence_waits_before, fence_signals_after);
+    }
+
+    //
+    // Fence interface
+    //
+
+    [[nodiscard]] handle::fence createFence() override { return mInner.createFence(); }
+    [[nodiscard]] uint64_t getFenceValue(handle::fence fence) override { return mInner.getFenceValue(fence); }
+    void signalFenceCPU(handle::fence fence, uint64_t new_value) override { mInner.signalFenceCPU(fence, new_value); }
+    void waitFenceCPU(handle::fence fence, uint64_t wait_value) override { mInner.waitFenceCPU(fence, wait_value); }
+    void free(cc::span<handle::fence const> fences) override { mInner.free(fences); }
+
+    //
+    // Query interface
+    //
+
+    [[nodiscard]] handle::query_range createQueryRange(query_type type, uint32_t size) override;
+    void free(handle::query_range query_range) override;
+
+    //
+    // Raytracing interface (not captured)
+    //
+
+    [[nodiscard]] handle::pipeline_state createRaytracingPipelineState(arg::raytracing_pipeline_state_description const& description) override
+    {
+        return mInner.createRaytracingPipelineState(description);
+    }
+
+    [[nodiscard]] handle::accel_struct createBottomLevelAccelStruct(cc::span<arg::blas_element const> elements,
+                                                                    accel_struct_build_flags_t flags,
+                                                                    uint64_t* out_native_handle = nullptr) override
+    {
+        return mInner.createBottomLevelAccelStruct(elements, flags, out_native_handle);
+    }
+
+    [[nodiscard]] handle::accel_struct createTopLevelAccelStruct(uint32_t num_instances, accel_struct_build_flags_t flags) override
+    {
+        return mInner.createTopLevelAccelStruct(num_instances, flags);
+    }
+
+    [[nodiscard]] uint64_t getAccelStructNativeHandle(handle::accel_struct as) override { return mInner.getAccelStructNativeHandle(as); }
+
+    [[nodiscard]] shader_table_strides calculateShaderTableStrides(arg::shader_table_record const& ray_gen_record,
+                                                                   arg::shader_table_records miss_records,
+                                                                   arg::shader_table_records hit_group_records,
+                                                                   arg::shader_table_records callable_records = {}) override
+    {
+        return mInner.calculateShaderTableStrides(ray_gen_record, miss_records, hit_group_records, callable_records);
+    }
+
+    void writeShaderTable(std::byte* dest, handle::pipeline_state pso, uint32_t stride, arg::shader_table_records records) override
+    {
+        mInner.writeShaderTable(dest, pso, stride, records);
+    }
+
+    void free(handle::accel_struct as) override { mInner.free(as); }
+    void freeRange(cc::span<handle::accel_struct const> as) override { mInner.freeRange(as); }
+
+    //
+    // Resource info interface
+    //
+
+    arg::resource_description const& getResourceDescription(handle::resource res) const override { return mInner.getResourceDescription(res); }
+    arg::texture_description const& getResourceTextureDescription(handle::resource res) const override
+    {
+        return mInner.getResourceTextureDescription(res);
+    }
+    arg::buffer_description const& getResourceBufferDescription(handle::resource res) const override
+    {
+        return mInner.getResourceBufferDescription(res);
+    }
+
+    //
+    // Debug interface
+    //
+
+    void setDebugName(handle::resource res, cc::string_view name) override { mInner.setDebugName(res, name); }
+    bool startForcedDiagnosticCapture() override { return mInner.startForcedDiagnosticCapture(); }
+    bool endForcedDiagnosticCapture() override { return mInner.endForcedDiagnosticCapture(); }
+
+    //
+    // GPU info interface
+    //
+
+    uint64_t getGPUTimestampFrequency() const override { return mInner.getGPUTimestampFrequency(); }
+    bool isRaytracingEnabled() const override { return mInner.isRaytracingEnabled(); }
+    backend_type getBackendType() const override { return mInner.getBackendType(); }
+    gpu_info const& getGPUInfo() const override { return mInner.getGPUInfo(); }
+    vram_state_info getVRAMInfo() override { return mInner.getVRAMInfo(); }
+
+    //
+    // Deferred free interface
+    //
+
+    uint32_t collectGarbage() override { return mInner.collectGarbage(); }
+    deferred_free_stats getDeferredFreeStats() override { return mInner.getDeferredFreeStats(); }
+
+private:
+    /// starts an event, returns the offset of its header, mMutex must be held
+    size_t beginEvent(capture::event_type type);
+    /// finalizes the payload size of an event, mMutex must be held
+    void endEvent(size_t header_offset);
+
+    void writeGraphicsPSOEvent(handle::pipeline_state pso, arg::graphics_pipeline_state_description const& description);
+    void writeComputePSOEvent(handle::pipeline_state pso, arg::compute_pipeline_state_description const& description);
+
+private:
+    Backend& mInner;
+    byte_writer mWriter;
+    std::mutex mMutex;
+};
+}
@@ -0,0 +1,633 @@
+#include "command_replay.hh"
+
+#include <chrono>
+#include <cstring>
+
+#include <clean-core/alloc_array.hh>
+#include <clean-core/utility.hh>
+
+#include <phantasm-hardware-interface/Backend.hh>
+#include <phantasm-hardware-interface/arguments.hh>
+#include <phantasm-hardware-interface/commands.hh>
+#include <phantasm-hardware-interface/common/byte_reader.hh>
+#include <phantasm-hardware-interface/common/command_reading.hh>
+#include <phantasm-hardware-interface/common/container/growable_map.hh>
+#include <phantasm-hardware-interface/common/log.hh>
+
+#include "command_capture.hh"
+
+namespace
+{
+/// map from captured handle values to replayed ones
+/// freed handles are mapped to null instead of being erased
+struct handle_remap_table
+{
+    void initialize(cc::allocator* alloc) { _map.initialize(256, alloc); }
+
+    void set(uint32_t captured, uint32_t replayed)
+    {
+        CC_ASSERT(captured != phi::handle::null_handle_value);
+        _map[captured] = replayed;
+    }
+
+    uint32_t get(uint32_t captured) const
+    {
+        uint32_t const* const replayed = _map.find(captured);
+        return replayed == nullptr ? phi::handle::null_handle_value : *replayed;
+    }
+
+    template <class F>
+    void for_each_live(F&& func)
+    {
+        _map.iterate_elements([&](uint32_t value) {
+            if (value != phi::handle::null_handle_value)
+                func(value);
+        });
+    }
+
+private:
+    phi::detail::growable_map<uint32_t, uint32_t> _map;
+};
+
+struct replay_state
+{
+    handle_remap_table resources;
+    handle_remap_table shader_views;
+    handle_remap_table pipeline_states;
+    handle_remap_table query_ranges;
+
+    void initialize(cc::allocator* alloc)
+    {
+        resources.initialize(alloc);
+        shader_views.initialize(alloc);
+        pipeline_states.initialize(alloc);
+        query_ranges.initialize(alloc);
+    }
+
+    void remap(phi::handle::resource& h) const { h._value = resources.get(h._value); }
+    void remap(phi::handle::shader_view& h) const { h._value = shader_views.get(h._value); }
+    void remap(phi::handle::pipeline_state& h) const { h._value = pipeline_states.get(h._value); }
+    void remap(phi::handle::query_range& h) const { h._value = query_ranges.get(h._value); }
+
+    void remap(phi::resource_view& rv) const
+    {
+        if (rv.dimension == phi::resource_view_dimension::raytracing_accel_struct)
+        {
+            // acceleration structures are not captured
+            rv.accel_struct_info.accel_struct = phi::handle::null_accel_struct;
+            return;
+        }
+
+        remap(rv.resource);
+    }
+
+    void remap(phi::shader_argument& arg) const
+    {
+        remap(arg.constant_buffer);
+        remap(arg.shader_view);
+    }
+};
+
+/// rewrites all handles in a command to the replayed ones, see phi::cmd::detail::dynamic_dispatch
+struct command_remapper
+{
+    replay_state const& state;
+    bool uses_uncaptured_objects = false;
+
+    template <class CmdT>
+    void remap_arguments(CmdT& cmd)
+    {
+        for (auto& arg : cmd.shader_arguments)
+            state.remap(arg);
+
+        state.remap(cmd.pipeline_state);
+    }
+
+    void execute(phi::cmd::draw const& cmd_const)
+    {
+        auto& cmd = const_cast<phi::cmd::draw&>(cmd_const);
+        remap_arguments(cmd);
+        for (auto& vb : cmd.vertex_buffers)
+            state.remap(vb);
+        state.remap(cmd.index_buffer);
+    }
+
+    void execute(phi::cmd::draw_indirect const& cmd_const)
+    {
+        auto& cmd = const_cast<phi::cmd::draw_indirect&>(cmd_const);
+        remap_arguments(cmd);
+        state.remap(cmd.indirect_argument_buffer);
+        for (auto& vb : cmd.vertex_buffers)
+            state.remap(vb);
+        state.remap(cmd.index_buffer);
+    }
+
+    // per-draw records are a pointer into the capturing process
+    void execute(phi::cmd::draw_batch const&) { uses_uncaptured_objects = true; }
+
+    void execute(phi::cmd::dispatch const& cmd_const) { remap_arguments(const_cast<phi::cmd::dispatch&>(cmd_const)); }
+
+    void execute(phi::cmd::dispatch_indirect const& cmd_const)
+    {
+        auto& cmd = const_cast<phi::cmd::dispatch_indirect&>(cmd_const);
+        remap_arguments(cmd);
+        state.remap(cmd.argument_buffer_addr.buffer);
+    }
+
+    void execute(phi::cmd::set_pipeline_state const& cmd_const) { state.remap(const_cast<phi::cmd::set_pipeline_state&>(cmd_const).pipeline_state); }
+
+    void execute(phi::cmd::set_shader_arguments const& cmd_const)
+    {
+        auto& cmd = const_cast<phi::cmd::set_shader_arguments&>(cmd_const);
+        for (auto i = 0u; i < cmd.num_shader_arguments; ++i)
+            state.remap(cmd.get_shader_arguments()[i]);
+    }
+
+    void execute(phi::cmd::set_vertex_buffers const& cmd_const)
+    {
+        auto& cmd = const_cast<phi::cmd::set_vertex_buffers&>(cmd_const);
+        for (auto& vb : cmd.vertex_buffers)
+            state.remap(vb);
+        state.remap(cmd.index_buffer);
+    }
+
+    void execute(phi::cmd::set_scissor const&) {}
+    void execute(phi::cmd::draw_only const&) {}
+    void execute(phi::cmd::dispatch_only const&) {}
+
+    void execute(phi::cmd::transition_resources const& cmd_const)
+    {
+        auto& cmd = const_cast<phi::cmd::transition_resources&>(cmd_const);
+        for (auto& transition : cmd.transitions)
+            state.remap(transition.resource);
+    }
+
+    void execute(phi::cmd::barrier_uav const& cmd_const)
+    {
+        auto& cmd = const_cast<phi::cmd::barrier_uav&>(cmd_const);
+        for (auto& res : cmd.resources)
+            state.remap(res);
+    }
+
+    void execute(phi::cmd::barrier_aliasing const& cmd_const)
+    {
+        auto& cmd = const_cast<phi::cmd::barrier_aliasing&>(cmd_const);
+        for (auto& activation : cmd.resources)
+            state.remap(activation.resource);
+    }
+
+    void execute(phi::cmd::transition_image_slices const& cmd_const)
+    {
+        auto& cmd = const_cast<phi::cmd::transition_image_slices&>(cmd_const);
+        for (auto& transition : cmd.transitions)
+            state.remap(transition.resource);
+        for (auto& reset : cmd.state_resets)
+            state.remap(reset.resource);
+    }
+
+    template <class CmdT>
+    void remap_copy(CmdT const& cmd_const)
+    {
+        auto& cmd = const_cast<CmdT&>(cmd_const);
+        state.remap(cmd.source);
+        state.remap(cmd.destination);
+    }
+
+    void execute(phi::cmd::copy_buffer const& cmd) { remap_copy(cmd); }
+    void execute(phi::cmd::copy_texture const& cmd) { remap_copy(cmd); }
+    void execute(phi::cmd::copy_buffer_to_texture const& cmd) { remap_copy(cmd); }
+    void execute(phi::cmd::copy_texture_to_buffer const& cmd) { remap_copy(cmd); }
+    void execute(phi::cmd::resolve_texture const& cmd) { remap_copy(cmd); }
+
+    void execute(phi::cmd::begin_render_pass const& cmd_const)
+    {
+        auto& cmd = const_cast<phi::cmd::begin_render_pass&>(cmd_const);
+        for (auto& rt : cmd.render_targets)
+            state.remap(rt.rv);
+        state.remap(cmd.depth_target.rv);
+    }
+
+    void execute(phi::cmd::end_render_pass const&) {}
+
+    void execute(phi::cmd::write_timestamp const& cmd_const) { state.remap(const_cast<phi::cmd::write_timestamp&>(cmd_const).query_range); }
+
+    void execute(phi::cmd::resolve_queries const& cmd_const)
+    {
+        auto& cmd = const_cast<phi::cmd::resolve_queries&>(cmd_const);
+        state.remap(cmd.dest_buffer);
+        state.remap(cmd.src_query_range);
+    }
+
+    // strings are pointers into the capturing process
+    void execute(phi::cmd::begin_debug_label const& cmd_const) { const_cast<phi::cmd::begin_debug_label&>(cmd_const).string = "captured label"; }
+
+    void execute(phi::cmd::end_debug_label const&) {}
+
+    void execute(phi::cmd::update_bottom_level const&) { uses_uncaptured_objects = true; }
+    void execute(phi::cmd::update_top_level const&) { uses_uncaptured_objects = true; }
+    void execute(phi::cmd::dispatch_rays const&) { uses_uncaptured_objects = true; }
+
+    void execute(phi::cmd::clear_textures const& cmd_const)
+    {
+        auto& cmd = const_cast<phi::cmd::clear_textures&>(cmd_const);
+        for (auto& op : cmd.clear_ops)
+            state.remap(op.rv);
+    }
+
+    void execute(phi::cmd::code_location_marker const& cmd_const)
+    {
+        auto& cmd = const_cast<phi::cmd::code_location_marker&>(cmd_const);
+        cmd.function = "captured function";
+        cmd.file = "captured file";
+    }
+
+    void execute(phi::cmd::begin_profile_scope const& cmd_const)
+    {
+        auto& cmd = const_cast<phi::cmd::begin_profile_scope&>(cmd_const);
+        cmd.name = cmd.name != nullptr ? "captured scope" : nullptr;
+#ifdef PHI_HAS_OPTICK
+        cmd.optick_event = nullptr;
+#endif
+    }
+
+    void execute(phi::cmd::end_profile_scope const&) {}
+};
+
+void remapResourceViews(replay_state const& state, cc::span<phi::resource_view const> captured, cc::alloc_vector<phi::resource_view>& out_views)
+{
+    out_views.clear();
+    for (auto const& rv : captured)
+    {
+        out_views.push_back(rv);
+        state.remap(out_views.back());
+    }
+}
+
+/// reads a string written by CaptureBackend into null-terminated storage
+char const* readString(phi::byte_reader& reader, cc::alloc_vector<cc::alloc_array<char>>& storage, cc::allocator* alloc)
+{
+    size_t length;
+    auto const* const data = static_cast<char const*>(reader.read_size_and_skip(length));
+
+    auto& str = storage.emplace_back(cc::alloc_array<char>::filled(length + 1, '\0', alloc));
+    std::memcpy(str.data(), data, length);
+    return str.data();
+}
+
+phi::arg::shader_binary readBinary(phi::byte_reader& reader)
+{
+    phi::arg::shader_binary res;
+    res.data = static_cast<std::byte const*>(reader.read_size_and_skip(res.size));
+    return res;
+}
+
+template <class HandleT>
+HandleT readHandle(phi::byte_reader& reader)
+{
+    HandleT res;
+    reader.read_t(res._value);
+    return res;
+}
+}
+
+phi::replay_result phi::replay_capture(phi::Backend& backend, cc::span<const std::byte> capture_data, uint32_t num_iterations, cc::allocator* alloc)
+{
+    replay_result res;
+    res.list_timings.reset_reserve(alloc, 256);
+
+    byte_reader reader(capture_data);
+
+    capture::file_header header;
+    if (reader.size_left() < sizeof(header))
+    {
+        PHI_LOG_ERROR("replay: capture data too small");
+        return res;
+    }
+
+    reader.read_t(header);
+    if (header.magic != capture::file_magic || header.version != capture::file_version)
+    {
+        PHI_LOG_ERROR("replay: invalid capture file or unsupported version {} (expected {})", header.version, capture::file_version);
+        return res;
+    }
+
+    if (header.backend != backend.getBackendType())
+    {
+        PHI_LOG_ERROR("replay: capture was recorded on a different backend, shader binaries are incompatible");
+        return res;
+    }
+
+    num_iterations = cc::max(num_iterations, 1u);
+
+    replay_state state;
+    state.initialize(alloc);
+
+    // scratch memory reused across events
+    cc::alloc_vector<resource_view> scratch_views(alloc);
+    cc::alloc_vector<std::byte> scratch_cmd_buffer(alloc);
+    cc::alloc_vector<vertex_attribute_info> scratch_attributes(alloc);
+    cc::alloc_vector<cc::alloc_array<char>> scratch_strings(alloc);
+
+    uint32_t list_index = 0;
+    bool warned_unknown_event = false;
+    bool is_truncated = false;
+
+    while (reader.size_left() > 0)
+    {
+        capture::event_header ev_header;
+        if (reader.size_left() < sizeof(ev_header))
+        {
+            is_truncated = true;
+            break;
+        }
+
+        reader.read_t(ev_header);
+
+        if (reader.size_left() < ev_header.payload_size_bytes)
+        {
+            is_truncated = true;
+            break;
+        }
+
+        byte_reader payload(cc::span{reader.head(), ev_header.payload_size_bytes});
+        reader.skip(ev_header.payload_size_bytes);
+
+        switch (ev_header.type)
+        {
+        case capture::event_type::create_texture:
+        {
+            auto const captured = readHandle<handle::resource>(payload);
+            arg::texture_description desc;
+            payload.read_t(desc);
+            state.resources.set(captured._value, backend.createTexture(desc, "replayed texture")._value);
+            break;
+        }
+        case capture::event_type::create_buffer:
+        {
+            auto const captured = readHandle<handle::resource>(payload);
+            arg::buffer_description desc;
+            payload.read_t(desc);
+            state.resources.set(captured._value, backend.createBuffer(desc, "replayed buffer")._value);
+            break;
+        }
+        case capture::event_type::acquire_backbuffer:
+        {
+            auto const captured = readHandle<handle::resource>(payload);
+            format fmt;
+            tg::isize2 size;
+            payload.read_t(fmt);
+            payload.read_t(size);
+
+            // backbuffers are substituted by render targets, created once per captured backbuffer handle
+            if (!state.resources.get(captured._value))
+                state.resources.set(captured._value, backend.createRenderTarget(fmt, size, 1, 1, nullptr, "replayed backbuffer")._value);
+            break;
+        }
+        case capture::event_type::free_resources:
+        {
+            for (auto const h : payload.read_sized_array<handle::resource>())
+            {
+                handle::resource replayed = h;
+                state.remap(replayed);
+                if (replayed.is_valid())
+                {
+                    backend.free(replayed);
+                    state.resources.set(h._value, handle::null_handle_value);
+                }
+            }
+            break;
+        }
+        case capture::event_type::create_shader_view:
+        {
+            auto const captured = readHandle<handle::shader_view>(payload);
+            bool usage_compute;
+            payload.read_t(usage_compute);
+            auto const srvs = payload.read_sized_array<resource_view>();
+            auto const uavs = payload.read_sized_array<resource_view>();
+            auto const samplers = payload.read_sized_array<sampler_config>();
+
+            remapResourceViews(state, srvs, scratch_views);
+            auto const num_srvs = scratch_views.size();
+            for (auto const& rv : uavs)
+            {
+                scratch_views.push_back(rv);
+                state.remap(scratch_views.back());
+            }
+
+            auto const views = cc::span<resource_view const>(scratch_views.data(), scratch_views.size());
+            auto const replayed = backend.createShaderView(views.subspan(0, num_srvs), views.subspan(num_srvs), samplers, usage_compute);
+            state.shader_views.set(captured._value, replayed._value);
+            break;
+        }
+        case capture::event_type::create_empty_shader_view:
+        {
+            auto const captured = readHandle<handle::shader_view>(payload);
+            bool usage_compute;
+            payload.read_t(usage_compute);
+
+            arg::shader_view_description desc;
+            payload.read_t(desc.num_srvs);
+            desc.srv_entries = payload.read_sized_array<arg::descriptor_entry>();
+            payload.read_t(desc.num_uavs);
+            desc.uav_entries = payload.read_sized_array<arg::descriptor_entry>();
+            payload.read_t(desc.num_samplers);
+
+            state.shader_views.set(captured._value, backend.createEmptyShaderView(desc, usage_compute)._value);
+            break;
+        }
+        case capture::event_type::write_shader_view_srvs:
+        case capture::event_type::write_shader_view_uavs:
+        {
+            auto sv = readHandle<handle::shader_view>(payload);
+            uint32_t offset;
+            payload.read_t(offset);
+            remapResourceViews(state, payload.read_sized_array<resource_view>(), scratch_views);
+
+            state.remap(sv);
+            if (ev_header.type == capture::event_type::write_shader_view_srvs)
+                backend.writeShaderViewSRVs(sv, offset, scratch_views);
+            else
+                backend.writeShaderViewUAVs(sv, offset, scratch_views);
+            break;
+        }
+        case capture::event_type::write_shader_view_samplers:
+        {
+            auto sv = readHandle<handle::shader_view>(payload);
+            uint32_t offset;
+            payload.read_t(offset);
+            auto const samplers = payload.read_sized_array<sampler_config>();
+
+            state.remap(sv);
+            backend.writeShaderViewSamplers(sv, offset, samplers);
+            break;
+        }
+        case capture::event_type::free_shader_views:
+        {
+            for (auto const h : payload.read_sized_array<handle::shader_view>())
+            {
+                handle::shader_view replayed = h;
+                state.remap(replayed);
+                if (replayed.is_valid())
+                {
+                    backend.free(replayed);
+                    state.shader_views.set(h._value, handle::null_handle_value);
+                }
+            }
+            break;
+        }
+        case capture::event_type::create_graphics_pso:
+        {
+            auto const captured = readHandle<handle::pipeline_state>(payload);
+
+            arg::graphics_pipeline_state_description desc;
+            payload.read_t(desc.config);
+            payload.read_t(desc.framebuffer);
+            payload.read_t(desc.vertices.vertex_sizes_bytes);
+
+            size_t num_attributes;
+            payload.read_t(num_attributes);
+            scratch_attributes.clear();
+            scratch_strings.clear();
+            for (auto i = 0u; i < num_attributes; ++i)
+            {
+                vertex_attribute_info& attr = scratch_attributes.emplace_back();
+                attr.semantic_name = readString(payload, scratch_strings, alloc);
+                payload.read_t(attr.offset);
+                payload.read_t(attr.fmt);
+                payload.read_t(attr.vertex_buffer_i);
+            }
+            desc.vertices.attributes = cc::span<vertex_attribute_info const>(scratch_attributes.data(), scratch_attributes.size());
+
+            size_t num_shaders;
+            payload.read_t(num_shaders);
+            for (auto i = 0u; i < num_shaders; ++i)
+            {
+                arg::graphics_shader shader;
+                payload.read_t(shader.stage);
+                shader.binary = readBinary(payload);
+                desc.shader_binaries.push_back(shader);
+            }
+
+            payload.read_t(desc.shader_arg_shapes);
+            payload.read_t(desc.has_root_constants);
+
+            state.pipeline_states.set(captured._value, backend.createPipelineState(desc, "replayed graphics PSO")._value);
+            break;
+        }
+        case capture::event_type::create_compute_pso:
+        {
+            auto const captured = readHandle<handle::pipeline_state>(payload);
+
+            arg::compute_pipeline_state_description desc;
+            payload.read_t(desc.shader_arg_shapes);
+            payload.read_t(desc.has_root_constants);
+            desc.shader = readBinary(payload);
+
+            state.pipeline_states.set(captured._value, backend.createComputePipelineState(desc, "replayed compute PSO")._value);
+            break;
+        }
+        case capture::event_type::free_pso:
+        {
+            auto const captured = readHandle<handle::pipeline_state>(payload);
+            handle::pipeline_state replayed = captured;
+            state.remap(replayed);
+            if (replayed.is_valid())
+            {
+                backend.free(replayed);
+                state.pipeline_states.set(captured._value, handle::null_handle_value);
+            }
+            break;
+        }
+        case capture::event_type::create_query_range:
+        {
+            auto const captured = readHandle<handle::query_range>(payload);
+            query_type type;
+            uint32_t size;
+            payload.read_t(type);
+            payload.read_t(size);
+            state.query_ranges.set(captured._value, backend.createQueryRange(type, size)._value);
+            break;
+        }
+        case capture::event_type::free_query_range:
+        {
+            auto const captured = readHandle<handle::query_range>(payload);
+            handle::query_range replayed = captured;
+            state.remap(replayed);
+            if (replayed.is_valid())
+            {
+                backend.free(replayed);
+                state.query_ranges.set(captured._value, handle::null_handle_value);
+            }
+            break;
+        }
+        case capture::event_type::record_command_list:
+        {
+            queue_type queue;
+            size_t size;
+            payload.read_t(queue);
+            payload.read_t(size);
+
+            scratch_cmd_buffer.resize(size);
+            payload.read(cc::span{scratch_cmd_buffer.data(), size});
+
+            command_remapper remapper{state};
+            uint32_t num_commands = 0;
+            for (cmd::detail::cmd_base const& cmd : command_stream_parser(scratch_cmd_buffer.data(), size))
+            {
+                cmd::detail::dynamic_dispatch(cmd, remapper);
+                ++num_commands;
+            }
+
+            if (remapper.uses_uncaptured_objects)
+            {
+                ++res.num_lists_skipped;
+                ++list_index;
+                break;
+            }
+
+            double min_ms = 0.0;
+            for (auto i = 0u; i < num_iterations; ++i)
+            {
+                auto const start = std::chrono::high_resolution_clock::now();
+                handle::command_list const cl = backend.recordCommandList(scratch_cmd_buffer.data(), size, queue);
+                auto const end = std::chrono::high_resolution_clock::now();
+
+                backend.discard(cc::span{cl});
+
+                double const ms = std::chrono::duration<double, std::milli>(end - start).count();
+                min_ms = i == 0 ? ms : cc::min(min_ms, ms);
+            }
+
+            res.list_timings.push_back(replay_list_timing{list_index, queue, uint32_t(size), num_commands, min_ms});
+            ++res.num_lists_replayed;
+            ++list_index;
+            break;
+        }
+        default:
+        {
+            // events of newer minor revisions are skippable by their payload size
+            if (!warned_unknown_event)
+            {
+                PHI_LOG_WARN("replay: skipping unknown capture event type {}", uint32_t(ev_header.type));
+                warned_unknown_event = true;
+            }
+            break;
+        }
+        }
+    }
+
+    // free everything still alive
+    state.resources.for_each_live([&](uint32_t value) { backend.free(handle::resource{value}); });
+    state.shader_views.for_each_live([&](uint32_t value) { backend.free(handle::shader_view{value}); });
+    state.pipeline_states.for_each_live([&](uint32_t value) { backend.free(handle::pipeline_state{value}); });
+    state.query_ranges.for_each_live([&](uint32_t value) { backend.free(handle::query_range{value}); });
+
+    if (is_truncated)
+    {
+        PHI_LOG_ERROR("replay: truncated capture file, stopped after {} command lists", list_index);
+        return res;
+    }
+
+    res.success = true;
+    return res;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+#include <clean-core/alloc_vector.hh>
+#include <clean-core/allocator.hh>
+#include <clean-core/span.hh>
+
+#include <phantasm-hardware-interface/common/api.hh>
+#include <phantasm-hardware-interface/fwd.hh>
+#include <phantasm-hardware-interface/types.hh>
+
+namespace phi
+{
+struct replay_list_timing
+{
+    uint32_t list_index;   ///< index of the list in capture order
+    queue_type queue;      ///< queue the list was recorded for
+    uint32_t num_bytes;    ///< size of the software command buffer
+    uint32_t num_commands; ///< amount of commands in the list
+    double translation_ms; ///< CPU time of Backend::recordCommandList, minimum across iterations
+};
+
+struct replay_result
+{
+    bool success = false;
+    uint32_t num_lists_replayed = 0;
+    uint32_t num_lists_skipped = 0; ///< lists using commands which are not captured (raytracing, cmd::draw_batch)
+    cc::alloc_vector<replay_list_timing> list_timings;
+};
+
+/// replays a capture written by CaptureBackend (see command_capture.hh) against an initialized backend
+/// all captured objects are recreated, handles inside the command lists are remapped to them
+/// each list is translated num_iterations times using recordCommandList and discarded, never submitted
+/// the backend type must match the capture as shader binaries are backend-specific
+/// all objects created during the replay are freed before returning
+[[nodiscard]] PHI_API replay_result replay_capture(Backend& backend,
+                                                   cc::span<std::byte const> capture_data,
+                                                   uint32_t num_iterations = 1,
+                                                   cc::allocator* alloc = cc::system_allocator);
+}
@@ -0,0 +1,364 @@
+#include "gpu_profiler.hh"
+
+#include <cstdio>
+#include <cstring>
+
+#include <clean-core/assert.hh>
+#include <clean-core/utility.hh>
+
+#include <phantasm-hardware-interface/Backend.hh>
+#include <phantasm-hardware-interface/commands.hh>
+#include <phantasm-hardware-interface/common/command_reading.hh>
+#include <phantasm-hardware-interface/common/log.hh>
+#include <phantasm-hardware-interface/util.hh>
+
+namespace
+{
+uint32_t appendName(cc::alloc_vector<char>& names, char const* name)
+{
+    auto const offset = uint32_t(names.size());
+    size_t const length = std::strlen(name);
+    names.resize(offset + length + 1);
+    std::memcpy(names.data() + offset, name, length + 1);
+    return offset;
+}
+
+void writeTimestamp(phi::command_stream_writer& writer, phi::handle::query_range queries, uint32_t index)
+{
+    writer.add_command(phi::cmd::write_timestamp{queries, index});
+}
+
+double timestampToMs(uint64_t origin, uint64_t timestamp, uint64_t frequency)
+{
+    // timestamps of unrelated queues are not necessarily ordered
+    return timestamp > origin ? phi::util::get_timestamp_difference_milliseconds(origin, timestamp, frequency) : 0.0;
+}
+
+void writeJsonString(FILE* file, char const* str)
+{
+    std::fputc('"', file);
+    for (; *str != '\0'; ++str)
+    {
+        char const c = *str;
+        if (c == '"' || c == '\\')
+            std::fprintf(file, "\\%c", c);
+        else if (uint8_t(c) < 0x20)
+            std::fprintf(file, "\\u%04x", unsigned(c));
+        else
+            std::fputc(c, file);
+    }
+    std::fputc('"', file);
+}
+}
+
+void phi::GpuProfiler::initialize(phi::Backend& backend, phi::gpu_profiler_config const& config)
+{
+    CC_ASSERT(mBackend == nullptr && "double initialize");
+    CC_ASSERT(config.num_frames_in_flight > 0 && config.num_history_frames > 0 && config.max_scopes_per_frame > 0 && "invalid config");
+
+    mBackend = &backend;
+    mAlloc = config.alloc;
+    mMaxScopesPerFrame = config.max_scopes_per_frame;
+    mTimestampFrequency = backend.getGPUTimestampFrequency();
+
+    uint32_t const num_queries = mMaxScopesPerFrame * 2;
+
+    mSlots = cc::alloc_array<frame_slot>::defaulted(config.num_frames_in_flight, mAlloc);
+    for (auto& slot : mSlots)
+    {
+        slot.queries = backend.createQueryRange(query_type::timestamp, num_queries);
+        slot.readback = backend.createBuffer(num_queries * sizeof(uint64_t), sizeof(uint64_t), resource_heap::readback, false, "phi GPU profiler readback");
+        slot.scopes.reset_reserve(mAlloc, mMaxScopesPerFrame);
+        slot.names.reset_reserve(mAlloc, mMaxScopesPerFrame * 32);
+    }
+
+    mHistory = cc::alloc_array<gpu_frame_timings>::defaulted(config.num_history_frames, mAlloc);
+    for (auto& frame : mHistory)
+    {
+        frame.nodes.reset_reserve(mAlloc, mMaxScopesPerFrame);
+        frame.names.reset_reserve(mAlloc, mMaxScopesPerFrame * 32);
+    }
+
+    mScopeStack.reset_reserve(mAlloc, 32);
+    mFence = backend.createFence();
+}
+
+void phi::GpuProfiler::destroy()
+{
+    if (mBackend == nullptr)
+        return;
+
+    // the GPU might still write to the readback buffers
+    mBackend->waitFenceCPU(mFence, mLastFenceValue);
+
+    for (auto& slot : mSlots)
+    {
+        mBackend->free(slot.queries);
+        mBackend->free(slot.readback);
+    }
+
+    mBackend->free(cc::span{mFence});
+
+    mSlots = {};
+    mHistory = {};
+    mScopeStack = {};
+    mNumResolvedFrames = 0;
+    mBackend = nullptr;
+}
+
+phi::handle::command_list phi::GpuProfiler::recordCommandList(std::byte const* buffer, size_t size, phi::queue_type queue)
+{
+    command_stream_chunk const chunk = {buffer, size};
+    return recordCommandList(cc::span<command_stream_chunk const>(&chunk, 1), queue);
+}
+
+phi::handle::command_list phi::GpuProfiler::recordCommandList(cc::span<command_stream_chunk const> chunks, phi::queue_type queue)
+{
+    // the timestamp query heap cannot be used on the copy queue
+    if (queue == queue_type::copy)
+        return mBackend->recordCommandList(chunks, queue);
+
+    // worst case: a timestamp pair for every scope and the list itself
+    size_t size = 0;
+    size_t num_scopes = 1;
+    for (auto const& chunk : chunks)
+    {
+        size += chunk.size;
+        for (auto const& cmd : command_stream_parser(chunk.buffer, chunk.size))
+        {
+            if (cmd.s_internal_type == cmd::detail::cmd_type::begin_debug_label || cmd.s_internal_type == cmd::detail::cmd_type::begin_profile_scope)
+                ++num_scopes;
+        }
+    }
+
+    size_t const max_size = size + num_scopes * 2 * sizeof(cmd::write_timestamp);
+    auto instrumented = cc::alloc_array<std::byte>::uninitialized(max_size, mAlloc);
+    command_stream_writer writer(instrumented.data(), max_size);
+
+    {
+        auto lg = std::lock_guard(mMutex);
+
+        frame_slot& slot = mSlots[mCurrentSlot];
+        uint32_t const list_index = slot.num_lists++;
+
+        char list_name[32];
+        std::snprintf(list_name, sizeof(list_name), "command list %u", list_index);
+
+        mScopeStack.clear();
+        mScopeStack.push_back(beginScope(slot, writer, list_name, list_index));
+
+        for (auto const& chunk : chunks)
+        {
+            for (auto const& cmd : command_stream_parser(chunk.buffer, chunk.size))
+            {
+                auto const type = cmd.s_internal_type;
+                bool const is_end = type == cmd::detail::cmd_type::end_debug_label || type == cmd::detail::cmd_type::end_profile_scope;
+
+                // the end timestamp goes before the closing command, unmatched ends are ignored
+                if (is_end && mScopeStack.size() > 1)
+                {
+                    uint32_t const scope = mScopeStack.back();
+                    mScopeStack.pop_back();
+                    if (scope != uint32_t(-1))
+                        writeTimestamp(writer, slot.queries, scope * 2 + 1);
+                }
+
+                size_t const cmd_size = cmd::detail::get_command_size(cmd);
+                std::memcpy(writer.buffer_head(), &cmd, cmd_size);
+                writer.advance_cursor(cmd_size);
+
+                // the begin timestamp goes after the opening command, so the timed range is contained in the label
+                if (type == cmd::detail::cmd_type::begin_debug_label)
+                {
+                    auto const& label = static_cast<cmd::begin_debug_label const&>(cmd);
+                    mScopeStack.push_back(beginScope(slot, writer, label.string != nullptr ? label.string : "debug label", list_index));
+                }
+                else if (type == cmd::detail::cmd_type::begin_profile_scope)
+                {
+                    auto const& scope = static_cast<cmd::begin_profile_scope const&>(cmd);
+                    mScopeStack.push_back(beginScope(slot, writer, scope.name != nullptr ? scope.name : "profile scope", list_index));
+                }
+            }
+        }
+
+        // close scopes left open by the list, and the list itself
+        while (!mScopeStack.empty())
+        {
+            uint32_t const scope = mScopeStack.back();
+            mScopeStack.pop_back();
+            if (scope != uint32_t(-1))
+                writeTimestamp(writer, slot.queries, scope * 2 + 1);
+        }
+    }
+
+    return mBackend->recordCommandList(writer.buffer(), writer.size(), queue);
+}
+
+void phi::GpuProfiler::endFrame()
+{
+    frame_slot& slot = mSlots[mCurrentSlot];
+    slot.frame_index = mFrameIndex;
+
+    if (!slot.scopes.empty())
+    {
+        cmd::resolve_queries resolve;
+        resolve.init(slot.readback, slot.queries, 0, uint32_t(slot.scopes.size()) * 2);
+
+        std::byte buffer[sizeof(cmd::resolve_queries)];
+        command_stream_writer writer(buffer, sizeof(buffer));
+        writer.add_command(resolve);
+
+        auto const list = mBackend->recordCommandList(writer.buffer(), writer.size(), queue_type::direct);
+
+        fence_operation const signal = {mFence, ++mLastFenceValue};
+        mBackend->submit(cc::span{list}, queue_type::direct, {}, cc::span{signal});
+        slot.fence_value = signal.value;
+    }
+
+    ++mFrameIndex;
+    mCurrentSlot = (mCurrentSlot + 1) % uint32_t(mSlots.size());
+
+    // resolve in frame order, the slot about to be reused is the oldest and must be resolved regardless
+    uint64_t const completed_fence_value = mBackend->getFenceValue(mFence);
+    for (auto i = 0u; i < mSlots.size(); ++i)
+    {
+        frame_slot& in_flight = mSlots[(mCurrentSlot + i) % mSlots.size()];
+        if (in_flight.fence_value == 0)
+        {
+            // frames without scopes are not resolved, still reset their state
+            in_flight.num_lists = 0;
+            in_flight.num_dropped_scopes = 0;
+            continue;
+        }
+
+        if (i > 0 && in_flight.fence_value > completed_fence_value)
+            break;
+
+        resolveSlot(in_flight);
+    }
+}
+
+phi::gpu_frame_timings const& phi::GpuProfiler::getResolvedFrame(uint32_t age) const
+{
+    CC_ASSERT(age < mNumResolvedFrames && "resolved frame not available");
+    return mHistory[(mHistoryHead + uint32_t(mHistory.size()) - 1 - age) % uint32_t(mHistory.size())];
+}
+
+bool phi::GpuProfiler::writeChromeTrace(char const* path) const
+{
+    FILE* const file = std::fopen(path, "w");
+    if (file == nullptr)
+        return false;
+
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    bool is_first = true;
+    for (auto age = mNumResolvedFrames; age > 0; --age)
+    {
+        gpu_frame_timings const& frame = getResolvedFrame(age - 1);
+        for (auto const& node : frame.nodes)
+        {
+            // one thread per command list, timestamps in microseconds
+            std::fprintf(file, "%s\n{\"name\":", is_first ? "" : ",");
+            writeJsonString(file, frame.get_name(node));
+            std::fprintf(file, ",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}", node.list_index,
+                         (frame.gpu_time_ms + node.begin_ms) * 1000.0, node.get_duration_ms() * 1000.0, (unsigned long long)frame.frame_index);
+            is_first = false;
+        }
+    }
+
+    std::fprintf(file, "\n]}\n");
+    bool const success = std::ferror(file) == 0;
+    std::fclose(file);
+    return success;
+}
+
+uint32_t phi::GpuProfiler::beginScope(frame_slot& slot, phi::command_stream_writer& writer, char const* name, uint32_t list_index)
+{
+    if (slot.scopes.size() == mMaxScopesPerFrame)
+    {
+        ++slot.num_dropped_scopes;
+        return uint32_t(-1);
+    }
+
+    // the innermost timed scope is the parent, dropped ones are skipped
+    uint32_t parent_index = uint32_t(-1);
+    uint32_t depth = 0;
+    for (auto i = mScopeStack.size(); i > 0; --i)
+    {
+        if (mScopeStack[i - 1] != uint32_t(-1))
+        {
+            parent_index = mScopeStack[i - 1];
+            depth = slot.scopes[parent_index].depth + 1;
+            break;
+        }
+    }
+
+    auto const index = uint32_t(slot.scopes.size());
+    slot.scopes.push_back(pending_scope{appendName(slot.names, name), parent_index, depth, list_index});
+
+    writeTimestamp(writer, slot.queries, index * 2);
+    return index;
+}
+
+void phi::GpuProfiler::resolveSlot(frame_slot& slot)
+{
+    mBackend->waitFenceCPU(mFence, slot.fence_value);
+
+    auto const num_queries = uint32_t(slot.scopes.size()) * 2;
+    std::byte const* const mapped = mBackend->mapBuffer(slot.readback, 0, int(num_queries * sizeof(uint64_t)));
+
+    auto const f_read_timestamp = [&](uint32_t query) -> uint64_t {
+        uint64_t res;
+        std::memcpy(&res, mapped + query * sizeof(uint64_t), sizeof(res));
+        return res;
+    };
+
+    uint64_t frame_begin = uint64_t(-1);
+    for (auto i = 0u; i < slot.scopes.size(); ++i)
+        frame_begin = cc::min(frame_begin, f_read_timestamp(i * 2));
+
+    if (!mHasTimestampOrigin)
+    {
+        mTimestampOrigin = frame_begin;
+        mHasTimestampOrigin = true;
+    }
+
+    gpu_frame_timings& frame = mHistory[mHistoryHead];
+    mHistoryHead = (mHistoryHead + 1) % uint32_t(mHistory.size());
+    mNumResolvedFrames = cc::min(mNumResolvedFrames + 1, uint32_t(mHistory.size()));
+
+    frame.frame_index = slot.frame_index;
+    frame.gpu_time_ms = timestampToMs(mTimestampOrigin, frame_begin, mTimestampFrequency);
+    frame.num_dropped_scopes = slot.num_dropped_scopes;
+
+    frame.names.resize(slot.names.size());
+    std::memcpy(frame.names.data(), slot.names.data(), slot.names.size());
+
+    frame.nodes.clear();
+    for (auto i = 0u; i < slot.scopes.size(); ++i)
+    {
+        pending_scope const& scope = slot.scopes[i];
+
+        gpu_timing_node node;
+        node.name_offset = scope.name_offset;
+        node.parent_index = scope.parent_index;
+        node.depth = scope.depth;
+        node.list_index = scope.list_index;
+        node.begin_ms = timestampToMs(frame_begin, f_read_timestamp(i * 2), mTimestampFrequency);
+        node.end_ms = cc::max(node.begin_ms, timestampToMs(frame_begin, f_read_timestamp(i * 2 + 1), mTimestampFrequency));
+        frame.nodes.push_back(node);
+    }
+
+    // nothing was written by the CPU
+    mBackend->unmapBuffer(slot.readback, 0, 0);
+
+    if (slot.num_dropped_scopes > 0)
+        PHI_LOG_WARN("GPU profiler dropped {} scopes in frame {}, increase gpu_profiler_config::max_scopes_per_frame", slot.num_dropped_scopes, slot.frame_index);
+
+    slot.scopes.clear();
+    slot.names.clear();
+    slot.num_lists = 0;
+    slot.num_dropped_scopes = 0;
+    slot.fence_value = 0;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include <clean-core/alloc_array.hh>
+#include <clean-core/alloc_vector.hh>
+#include <clean-core/allocator.hh>
+#include <clean-core/span.hh>
+
+#include <phantasm-hardware-interface/common/api.hh>
+#include <phantasm-hardware-interface/fwd.hh>
+#include <phantasm-hardware-interface/handles.hh>
+#include <phantasm-hardware-interface/types.hh>
+
+namespace phi
+{
+/// a timed scope of a resolved frame
+struct gpu_timing_node
+{
+    uint32_t name_offset = 0;             ///< into gpu_frame_timings::names, see gpu_frame_timings::get_name
+    uint32_t parent_index = uint32_t(-1); ///< into gpu_frame_timings::nodes, -1 for the root node of a command list
+    uint32_t depth = 0;                   ///< 0 for the root node of a command list
+    uint32_t list_index = 0;              ///< recording order of the command list within the frame
+    double begin_ms = 0.0;                ///< relative to the earliest timestamp of the frame
+    double end_ms = 0.0;
+
+    double get_duration_ms() const { return end_ms - begin_ms; }
+};
+
+/// the timing tree of a frame, the nodes are in depth-first order
+struct gpu_frame_timings
+{
+    uint64_t frame_index = 0;
+    double gpu_time_ms = 0.0;        ///< earliest timestamp of the frame, relative to the first frame resolved by the profiler
+    uint32_t num_dropped_scopes = 0; ///< scopes exceeding gpu_profiler_config::max_scopes_per_frame, these are not timed
+    cc::alloc_vector<gpu_timing_node> nodes;
+    cc::alloc_vector<char> names;
+
+    char const* get_name(gpu_timing_node const& node) const { return names.data() + node.name_offset; }
+};
+
+struct gpu_profiler_config
+{
+    /// amount of timed scopes per frame, including one per command list
+    /// the profiler uses max_scopes_per_frame * 2 * num_frames_in_flight queries of backend_config::num_timestamp_queries
+    uint32_t max_scopes_per_frame = 128;
+
+    /// amount of frames resolved asynchronously, results are available this many frames later at most
+    uint32_t num_frames_in_flight = 3;
+
+    /// amount of resolved frames kept for getResolvedFrame and writeChromeTrace
+    uint32_t num_history_frames = 1;
+
+    cc::allocator* alloc = cc::system_allocator;
+};
+
+/// Times GPU work using the existing debug labels and profile scopes of command lists
+///
+/// command lists recorded through the profiler are instrumented with a timestamp pair around every
+/// cmd::begin_debug_label / cmd::end_debug_label and cmd::begin_profile_scope / cmd::end_profile_scope,
+/// and around the entire list. endFrame resolves them into a ring of readback buffers, results are
+/// turned into a timing tree per frame once the GPU is done with them
+///
+/// all command lists recorded through the profiler must be submitted before the endFrame of their frame,
+/// lists on the compute queue must be synchronized with the direct queue, copy queue lists are not instrumented
+/// recordCommandList is synchronized, the rest is not
+class PHI_API GpuProfiler
+{
+public:
+    void initialize(Backend& backend, gpu_profiler_config const& config = {});
+    void destroy();
+
+    /// instruments the command stream and records it on the backend
+    [[nodiscard]] handle::command_list recordCommandList(std::byte const* buffer, size_t size, queue_type queue = queue_type::direct);
+
+    /// instruments the chunked command stream and records it on the backend
+    [[nodiscard]] handle::command_list recordCommandList(cc::span<command_stream_chunk const> chunks, queue_type queue = queue_type::direct);
+
+    /// resolves the timestamps of this frame on the direct queue, after all lists submitted so far,
+    /// and builds the timing trees of all previous frames the GPU is done with
+    void endFrame();
+
+    /// amount of resolved frames currently available
+    uint32_t getNumResolvedFrames() const { return mNumResolvedFrames; }
+
+    /// returns a resolved frame, 0 is the latest, up to getNumResolvedFrames() - 1
+    gpu_frame_timings const& getResolvedFrame(uint32_t age = 0) const;
+
+    /// writes all resolved frames as a Chrome trace, returns false on failure
+    bool writeChromeTrace(char const* path) const;
+
+private:
+    struct pending_scope
+    {
+        uint32_t name_offset;
+        uint32_t parent_index;
+        uint32_t depth;
+        uint32_t list_index;
+    };
+
+    struct frame_slot
+    {
+        handle::query_range queries = handle::null_query_range;
+        handle::resource readback = handle::null_resource;
+        uint64_t frame_index = 0;
+        uint64_t fence_value = 0; ///< 0 if not in flight
+        uint32_t num_lists = 0;
+        uint32_t num_dropped_scopes = 0;
+        cc::alloc_vector<pending_scope> scopes;
+        cc::alloc_vector<char> names;
+    };
+
+    /// opens a scope and writes its begin timestamp, returns the scope index or -1 if dropped, mMutex must be held
+    uint32_t beginScope(frame_slot& slot, command_stream_writer& writer, char const* name, uint32_t list_index);
+
+    /// builds the timing tree of an in-flight slot, waiting for the GPU if necessary
+    void resolveSlot(frame_slot& slot);
+
+private:
+    Backend* mBackend = nullptr;
+    cc::allocator* mAlloc = nullptr;
+    uint32_t mMaxScopesPerFrame = 0;
+    uint64_t mTimestampFrequency = 0;
+
+    cc::alloc_array<frame_slot> mSlots;
+    uint32_t mCurrentSlot = 0;
+    uint64_t mFrameIndex = 0;
+
+    handle::fence mFence = handle::null_fence;
+    uint64_t mLastFenceValue = 0;
+
+    cc::alloc_array<gpu_frame_timings> mHistory;
+    uint32_t mHistoryHead = 0; ///< the next entry to write
+    uint32_t mNumResolvedFrames = 0;
+
+    bool mHasTimestampOrigin = false;
+    uint64_t mTimestampOrigin = 0;
+
+    // stack of the open scopes of the list being instrumented, -1 for dropped ones
+    cc::alloc_vector<uint32_t> mScopeStack;
+
+    std::mutex mMutex;
+};
+}
@@ -0,0 +1,154 @@
+#include "shader_archive.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <clean-core/assert.hh>
+
+#include <phantasm-hardware-interface/common/log.hh>
+
+namespace
+{
+namespace saf = phi::shader_archive_format;
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+}
+
+bool phi::shader_archive::open(char const* path)
+{
+    close();
+
+    auto file = mapped_file::create_from_binary_file(path);
+    if (!file.is_valid() || file.size() < sizeof(saf::file_header))
+        return false;
+
+    saf::file_header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != saf::file_magic || header.version != saf::file_version)
+    {
+        PHI_LOG_WARN("shader archive at {} is invalid or has an outdated version", path);
+        return false;
+    }
+
+    if (file.size() < sizeof(saf::file_header) + header.num_entries * sizeof(saf::entry))
+    {
+        PHI_LOG_WARN("shader archive at {} is truncated", path);
+        return false;
+    }
+
+    // the mapping is page aligned, the entry table directly follows the header
+    auto const* const entries = reinterpret_cast<saf::entry const*>(file.data() + sizeof(saf::file_header));
+    for (auto i = 0u; i < header.num_entries; ++i)
+    {
+        saf::entry const& e = entries[i];
+        if (uint64_t(e.name_offset) + e.name_length + 1 > file.size() || e.data_offset + e.data_size > file.size())
+        {
+            PHI_LOG_WARN("shader archive at {} is truncated", path);
+            return false;
+        }
+    }
+
+    _file = cc::move(file);
+    _entries = entries;
+    _num_entries = header.num_entries;
+    return true;
+}
+
+void phi::shader_archive::close()
+{
+    _file = mapped_file{};
+    _entries = nullptr;
+    _num_entries = 0;
+}
+
+phi::arg::shader_binary phi::shader_archive::find(char const* name) const
+{
+    auto const name_length = uint32_t(std::strlen(name));
+    uint64_t const hash = saf::hash_name(name, name_length);
+
+    auto const* const end = _entries + _num_entries;
+    auto const* it = std::lower_bound(_entries, end, hash, [](saf::entry const& e, uint64_t h) { return e.name_hash < h; });
+
+    // hashes can collide, compare the names within the range of equal hashes
+    for (; it != end && it->name_hash == hash; ++it)
+    {
+        if (it->name_length == name_length && std::memcmp(_file.data() + it->name_offset, name, name_length) == 0)
+            return arg::shader_binary{_file.data() + it->data_offset, size_t(it->data_size)};
+    }
+
+    return arg::shader_binary{};
+}
+
+char const* phi::shader_archive::get_entry_name(uint32_t index) const
+{
+    CC_ASSERT(index < _num_entries && "shader archive entry OOB");
+    return reinterpret_cast<char const*>(_file.data() + _entries[index].name_offset);
+}
+
+phi::arg::shader_binary phi::shader_archive::get_entry_binary(uint32_t index) const
+{
+    CC_ASSERT(index < _num_entries && "shader archive entry OOB");
+    return arg::shader_binary{_file.data() + _entries[index].data_offset, size_t(_entries[index].data_size)};
+}
+
+void phi::shader_archive_writer::add_entry(char const* name, arg::shader_binary binary)
+{
+    CC_ASSERT(name != nullptr && binary.data != nullptr && "invalid shader archive entry");
+
+    auto const name_length = uint32_t(std::strlen(name));
+    _entries.push_back(pending_entry{name, name_length, saf::hash_name(name, name_length), binary});
+}
+
+bool phi::shader_archive_writer::write_to_file(char const* path)
+{
+    std::sort(_entries.begin(), _entries.end(), [](pending_entry const& a, pending_entry const& b) { return a.name_hash < b.name_hash; });
+
+    saf::file_header header;
+    header.num_entries = uint32_t(_entries.size());
+
+    // lay out the names after the entry table, then the aligned blobs
+    uint64_t offset = sizeof(saf::file_header) + _entries.size() * sizeof(saf::entry);
+    uint64_t const names_offset = offset;
+    for (auto const& pe : _entries)
+        offset += pe.name_length + 1;
+
+    CC_ASSERT(offset <= uint64_t(uint32_t(-1)) && "shader archive names exceed 4GB");
+
+    auto outfile = std::ofstream(path, std::ios::binary);
+    if (!outfile.good())
+        return false;
+
+    outfile.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    uint64_t name_offset = names_offset;
+    uint64_t data_offset = offset;
+    for (auto const& pe : _entries)
+    {
+        data_offset = alignUp(data_offset, saf::blob_alignment);
+
+        saf::entry e;
+        e.name_hash = pe.name_hash;
+        e.name_offset = uint32_t(name_offset);
+        e.name_length = pe.name_length;
+        e.data_offset = data_offset;
+        e.data_size = pe.binary.size;
+        outfile.write(reinterpret_cast<char const*>(&e), sizeof(e));
+
+        name_offset += pe.name_length + 1;
+        data_offset += pe.binary.size;
+    }
+
+    for (auto const& pe : _entries)
+        outfile.write(pe.name, pe.name_length + 1);
+
+    char const padding[saf::blob_alignment] = {};
+    for (auto const& pe : _entries)
+    {
+        uint64_t const current = uint64_t(outfile.tellp());
+        outfile.write(padding, long(alignUp(current, saf::blob_alignment) - current));
+        outfile.write(reinterpret_cast<char const*>(pe.binary.data), long(pe.binary.size));
+    }
+
+    return outfile.good();
+}
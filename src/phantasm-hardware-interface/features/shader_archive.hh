@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+
+#include <clean-core/alloc_vector.hh>
+#include <clean-core/allocator.hh>
+
+#include <phantasm-hardware-interface/arguments.hh>
+#include <phantasm-hardware-interface/common/api.hh>
+#include <phantasm-hardware-interface/common/container/mapped_file.hh>
+
+namespace phi::shader_archive_format
+{
+/// archive file layout:
+/// [file_header] [entry] [entry] .. x num_entries .. [entry] [names] [padding] [blob] [padding] [blob] ..
+/// entries are sorted by name hash, names are null-terminated, blobs start at multiples of blob_alignment
+inline constexpr uint32_t file_magic = 0x41534850; // "PHSA"
+inline constexpr uint32_t file_version = 1;
+inline constexpr uint64_t blob_alignment = 64;
+
+struct file_header
+{
+    uint32_t magic = file_magic;
+    uint32_t version = file_version;
+    uint32_t num_entries = 0;
+    uint32_t _pad = 0;
+};
+
+struct entry
+{
+    uint64_t name_hash = 0;
+    uint32_t name_offset = 0; ///< offset from the start of the file
+    uint32_t name_length = 0; ///< excluding the null terminator
+    uint64_t data_offset = 0; ///< offset from the start of the file
+    uint64_t data_size = 0;
+};
+
+static_assert(sizeof(file_header) == 16 && sizeof(entry) == 32, "archive layout changed");
+
+/// FNV-1a, stable across builds and platforms
+[[nodiscard]] constexpr uint64_t hash_name(char const* name, uint32_t length)
+{
+    uint64_t res = 0xcbf29ce484222325ull;
+    for (auto i = 0u; i < length; ++i)
+    {
+        res ^= uint8_t(name[i]);
+        res *= 0x100000001b3ull;
+    }
+    return res;
+}
+}
+
+namespace phi
+{
+/// read-only archive of named shader binaries, memory-mapped as a whole
+/// binaries returned from it point into the mapping and can be passed to PSO creation without copies,
+/// they are valid as long as the archive is open
+struct PHI_API shader_archive
+{
+    /// maps the archive, returns false if it does not exist or is invalid
+    bool open(char const* path);
+    void close();
+
+    bool is_open() const { return _file.is_valid(); }
+
+    /// returns the binary of the given name, or an empty binary (nullptr data) if not present
+    [[nodiscard]] arg::shader_binary find(char const* name) const;
+
+    uint32_t get_num_entries() const { return _num_entries; }
+    char const* get_entry_name(uint32_t index) const;
+    arg::shader_binary get_entry_binary(uint32_t index) const;
+
+private:
+    mapped_file _file;
+    shader_archive_format::entry const* _entries = nullptr;
+    uint32_t _num_entries = 0;
+};
+
+/// writes archives read by shader_archive
+/// the added names and binaries are not copied and must stay alive until write_to_file
+struct PHI_API shader_archive_writer
+{
+    explicit shader_archive_writer(cc::allocator* alloc = cc::system_allocator) { _entries.reset_reserve(alloc, 64); }
+
+    /// names must be unique within an archive
+    void add_entry(char const* name, arg::shader_binary binary);
+
+    /// returns false on failure
+    bool write_to_file(char const* path);
+
+private:
+    struct pending_entry
+    {
+        char const* name;
+        uint32_t name_length;
+        uint64_t name_hash;
+        arg::shader_binary binary;
+    };
+
+    cc::alloc_vector<pending_entry> _entries;
+};
+}
@@ -42,6 +42,7 @@ struct gpu_indirect_command_draw;
 struct gpu_indirect_command_draw_indexed;
 struct accel_struct_instance;
 struct shader_table_strides;
+struct vram_state_info;
 
 // data enums
 enum class format : uint8_t;
@@ -69,6 +70,9 @@ enum class accel_struct_build_flags : uint8_t;
 // helpers
 struct command_stream_parser;
 struct command_stream_writer;
+struct command_stream_chunk;
+struct command_page_pool;
+struct chunked_command_stream_writer;
 } // namespace phi
 
 namespace phi::arg
@@ -97,6 +101,7 @@ using shader_table_records = cc::span<shader_table_record const>;
 
 struct render_target_description;
 struct texture_description;
+struct transient_texture_description;
 struct buffer_description;
 struct resource_description;
 
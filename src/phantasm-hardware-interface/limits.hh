@@ -42,5 +42,9 @@ enum limits_e : unsigned
 
     /// amount of shader stages in the graphics pipeline
     num_graphics_shader_stages = 5u,
+
+    /// the maximum amount of memory heaps reported in vram_state_info
+    /// NOTE: equal to VK_MAX_MEMORY_HEAPS
+    max_vram_heaps = 16u,
 };
 }
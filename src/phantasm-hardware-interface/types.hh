@@ -6,6 +6,7 @@
 #include <clean-core/flags.hh>
 
 #include <phantasm-hardware-interface/handles.hh>
+#include <phantasm-hardware-interface/limits.hh>
 
 #define PHI_DEFINE_FLAG_TYPE(_flags_t_, _enum_t_, _max_num_)    \
     using _flags_t_ = cc::flags<_enum_t_, uint32_t(_max_num_)>; \
@@ -864,12 +865,40 @@ struct shader_table_strides
     uint32_t stride_callable = 0;
 };
 
+struct vram_heap_info
+{
+    uint64_t budget_bytes = 0;    ///< OS-provided budget of this heap for the process
+    uint64_t usage_bytes = 0;     ///< usage of the process, including memory not allocated by phi (Vulkan: swapchains, pipelines, ...)
+    uint64_t allocated_bytes = 0; ///< memory allocated by phi (Vulkan only)
+    bool is_device_local = false;
+};
+
 struct vram_state_info
 {
     // OS-provided VRAM budget in bytes, usage should stay below this
+    // Vulkan: sums over all device-local heaps, see heaps for the breakdown
     uint64_t os_budget_bytes = 0;
     uint64_t current_usage_bytes = 0;
+
+    // D3D12 only, see IDXGIAdapter3::SetVideoMemoryReservation
     uint64_t available_for_reservation_bytes = 0;
     uint64_t current_reservation_bytes = 0;
+
+    // Vulkan: per memory heap, D3D12: local and non-local memory segment group
+    vram_heap_info heaps[limits::max_vram_heaps] = {};
+    uint32_t num_heaps = 0;
+
+    /// fraction of the device-local budget in use
+    float get_usage_fraction() const { return os_budget_bytes > 0 ? float(double(current_usage_bytes) / double(os_budget_bytes)) : 0.f; }
+};
+
+/// statistics of deferred frees (backend_config::enable_deferred_free)
+struct deferred_free_stats
+{
+    uint64_t num_enqueued = 0;        ///< amount of handles freed in deferred mode
+    uint64_t num_reclaimed = 0;       ///< amount of handles actually destroyed after their submits completed
+    uint64_t num_collections = 0;     ///< amount of collectGarbage calls
+    uint32_t num_pending = 0;         ///< amount of handles currently waiting for the GPU
+    uint32_t num_pending_batches = 0; ///< amount of distinct submit states the pending handles wait on
 };
 } // namespace phi
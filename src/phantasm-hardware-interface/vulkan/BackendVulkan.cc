@@ -31,6 +31,11 @@ struct BackendVulkan::per_thread_component
     CommandAllocatorsPerThread cmdListAllocator;
     cc::alloc_array<std::byte> threadLocalScratchAllocMemory;
     cc::linear_allocator threadLocalScratchAlloc;
+    parallel_translation_plan splitPlan;
+
+    // translates the first segment of split render passes, see ParallelCommandTranslator::translateSegments
+    command_list_translator segmentTranslator;
+    CommandAllocatorBundle secondaryCmdListAllocator;
 };
 } // namespace phi::vk
 
@@ -150,11 +155,17 @@ void phi::vk::BackendVulkan::initialize(const backend_config& config_arg)
         mGPUInfo = gpu_infos[chosen_index];
     }
 
+    // the thread association is required by the per-thread descriptor pool blocks of the resource and shader view pools
+    mThreadAssociation.initialize();
+
     // Pool init
-    mPoolPipelines.initialize(mDevice.getDevice(), config.max_num_pipeline_states, config.static_allocator);
-    mPoolResources.initialize(mDevice.getPhysicalDevice(), mDevice.getDevice(), config.max_num_resources, config.max_num_swapchains, config.static_allocator);
+    mPoolPipelines.initialize(mDevice.getDevice(), mDevice.getDeviceProperties(), config.max_num_pipeline_states, config.pipeline_cache_path,
+                              config.static_allocator, config.dynamic_allocator);
+    mPoolResources.initialize(mInstance, mDevice.getPhysicalDevice(), mDevice.getDevice(), mDevice.hasMemoryBudget(), config.max_num_resources,
+                              config.max_num_swapchains, &mThreadAssociation, config.num_threads, config.static_allocator);
     mPoolShaderViews.initialize(mDevice.getDevice(), &mPoolResources, &mPoolAccelStructs, config.max_num_shader_views, config.max_num_srvs,
-                                config.max_num_uavs, config.max_num_samplers, config.static_allocator);
+                                config.max_num_uavs, config.max_num_samplers, &mThreadAssociation, config.num_threads, config.static_allocator,
+                                config.dynamic_allocator);
     mPoolFences.initialize(mDevice.getDevice(), config.max_num_fences, config.static_allocator);
     mPoolQueries.initialize(mDevice.getDevice(), config.num_timestamp_queries, config.num_occlusion_queries, config.num_pipeline_stat_queries, config.static_allocator);
 
@@ -166,10 +177,34 @@ void phi::vk::BackendVulkan::initialize(const backend_config& config_arg)
 
     mPoolSwapchains.initialize(mInstance, mDevice, config);
 
-    // Per-thread components and command list pool
+    mFramebufferCache.initialize(mDevice.getDevice(), &mPoolShaderViews, config.max_num_cached_framebuffers, config.framebuffer_cache_eviction_age,
+                                 config.dynamic_allocator);
+
+    mVRAMSoftLimit.initialize(config);
+
+    // Deferred free timelines
+    mIsDeferredFreeEnabled = config.enable_deferred_free;
+    if (mIsDeferredFreeEnabled)
     {
-        mThreadAssociation.initialize();
+        mDeferredFreeQueue.initialize(config.dynamic_allocator);
+
+        VkSemaphoreTypeCreateInfo sem_type_info = {};
+        sem_type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        sem_type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        sem_type_info.initialValue = 0;
+
+        VkSemaphoreCreateInfo sem_info = {};
+        sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        sem_info.pNext = &sem_type_info;
+
+        for (auto& timeline : mSubmitTimelines)
+        {
+            PHI_VK_VERIFY_SUCCESS(vkCreateSemaphore(mDevice.getDevice(), &sem_info, nullptr, &timeline));
+        }
+    }
 
+    // Per-thread components and command list pool
+    {
         mThreadComponentAlloc = config.static_allocator;
         mThreadComponents = config.static_allocator->new_array_sized<per_thread_component>(config.num_threads);
         mNumThreadComponents = config.num_threads;
@@ -180,7 +215,7 @@ void phi::vk::BackendVulkan::initialize(const backend_config& config_arg)
         {
             auto& thread_comp = mThreadComponents[i];
             thread_comp.translator.initialize(mDevice.getDevice(), &mPoolShaderViews, &mPoolResources, &mPoolPipelines, &mPoolCmdLists, &mPoolQueries,
-                                              &mPoolAccelStructs, mDevice.hasRaytracing());
+                                              &mPoolAccelStructs, &mFramebufferCache, mDevice.hasRaytracing());
             thread_allocator_ptrs[i] = &thread_comp.cmdListAllocator;
 
             // 5 MB scratch alloc per thread
@@ -188,12 +223,39 @@ void phi::vk::BackendVulkan::initialize(const backend_config& config_arg)
             thread_comp.threadLocalScratchAlloc = cc::linear_allocator(thread_comp.threadLocalScratchAllocMemory);
         }
 
+        mParallelTranslator.initialize(mDevice.getDevice(), config.num_translation_worker_threads, config.parallel_translation_min_draws,
+                                       &mPoolShaderViews, &mPoolResources, &mPoolPipelines, &mPoolCmdLists, &mPoolQueries, &mPoolAccelStructs,
+                                       &mFramebufferCache, mDevice.hasRaytracing(), config.static_allocator);
+
+        // one secondary allocator per worker, and one per recording thread
+        uint32_t const num_secondary_allocators = mParallelTranslator.isEnabled() ? mParallelTranslator.getNumWorkers() + mNumThreadComponents : 0;
+        cc::alloc_array<CommandAllocatorBundle*> secondary_allocator_ptrs(num_secondary_allocators, config.dynamic_allocator);
+        for (auto i = 0u; i < mParallelTranslator.getNumWorkers(); ++i)
+        {
+            secondary_allocator_ptrs[i] = mParallelTranslator.getWorkerAllocator(i);
+        }
+
+        if (mParallelTranslator.isEnabled())
+        {
+            for (auto i = 0u; i < mNumThreadComponents; ++i)
+            {
+                auto& thread_comp = mThreadComponents[i];
+                thread_comp.segmentTranslator.initialize(mDevice.getDevice(), &mPoolShaderViews, &mPoolResources, &mPoolPipelines, &mPoolCmdLists,
+                                                         &mPoolQueries, &mPoolAccelStructs, &mFramebufferCache, mDevice.hasRaytracing());
+                thread_comp.splitPlan.caller_translator = &thread_comp.segmentTranslator;
+                thread_comp.splitPlan.caller_allocator = &thread_comp.secondaryCmdListAllocator;
+                secondary_allocator_ptrs[mParallelTranslator.getNumWorkers() + i] = &thread_comp.secondaryCmdListAllocator;
+            }
+        }
+
         mPoolCmdLists.initialize(mDevice,                                                                                               //
                                  int(config.num_direct_cmdlist_allocators_per_thread), int(config.num_direct_cmdlists_per_allocator),   //
                                  int(config.num_compute_cmdlist_allocators_per_thread), int(config.num_compute_cmdlists_per_allocator), //
                                  int(config.num_copy_cmdlist_allocators_per_thread), int(config.num_copy_cmdlists_per_allocator),
                                  config.max_num_unique_transitions_per_cmdlist, //
-                                 thread_allocator_ptrs, config.static_allocator, config.dynamic_allocator);
+                                 thread_allocator_ptrs,                                                                         //
+                                 secondary_allocator_ptrs, int(config.num_secondary_cmdlists_per_allocator),                    //
+                                 config.static_allocator, config.dynamic_allocator);
     }
 
 #ifdef PHI_HAS_OPTICK
@@ -213,11 +275,27 @@ void phi::vk::BackendVulkan::destroy()
     if (mInstance != nullptr)
     {
         flushGPU();
+        mParallelTranslator.stopWorkers();
+
+        if (mIsDeferredFreeEnabled)
+        {
+            // the GPU is idle, reclaim everything
+            mDeferredFreeQueue.collect(nullptr, [&](deferred_free_queue::entry const& entry) { destroyDeferredFree(entry); });
+            mDeferredFreeQueue.destroy();
+
+            for (auto& timeline : mSubmitTimelines)
+            {
+                vkDestroySemaphore(mDevice.getDevice(), timeline, nullptr);
+                timeline = nullptr;
+            }
+        }
 
         mDiagnostics.free();
 
         mPoolSwapchains.destroy();
 
+        mFramebufferCache.destroy();
+
         mPoolAccelStructs.destroy();
         mPoolQueries.destroy(mDevice.getDevice());
         mPoolFences.destroy();
@@ -230,9 +308,11 @@ void phi::vk::BackendVulkan::destroy()
         {
             auto& thread_comp = mThreadComponents[i];
             thread_comp.cmdListAllocator.destroy(mDevice.getDevice());
+            thread_comp.secondaryCmdListAllocator.destroy(mDevice.getDevice());
             thread_comp.threadLocalScratchAllocMemory = {};
         }
         static_cast<cc::allocator*>(mThreadComponentAlloc)->delete_array_sized(mThreadComponents, mNumThreadComponents);
+        mParallelTranslator.destroy(mDevice.getDevice());
 
         mDevice.destroy();
 
@@ -278,7 +358,10 @@ phi::handle::resource phi::vk::BackendVulkan::acquireBackbuffer(handle::swapchai
     }
 }
 
-void phi::vk::BackendVulkan::present(phi::handle::swapchain sc) { mPoolSwapchains.present(sc); }
+void phi::vk::BackendVulkan::present(phi::handle::swapchain sc)
+{
+    mPoolSwapchains.present(sc);
+}
 
 void phi::vk::BackendVulkan::onResize(handle::swapchain sc, tg::isize2 size)
 {
@@ -293,21 +376,65 @@ phi::format phi::vk::BackendVulkan::getBackbufferFormat(phi::handle::swapchain s
 
 phi::handle::resource phi::vk::BackendVulkan::createTexture(arg::texture_description const& desc, char const* debug_name)
 {
-    return mPoolResources.createTexture(desc, debug_name);
+    auto const res = mPoolResources.createTexture(desc, debug_name);
+
+    // cheap, uses the cached budget
+    if (mVRAMSoftLimit.is_enabled())
+        mVRAMSoftLimit.check(mPoolResources.getVRAMInfo(false));
+
+    return res;
 }
 
 phi::handle::resource phi::vk::BackendVulkan::createBuffer(arg::buffer_description const& desc, char const* debug_name)
 {
-    return mPoolResources.createBuffer(desc, debug_name);
+    auto const res = mPoolResources.createBuffer(desc, debug_name);
+
+    if (mVRAMSoftLimit.is_enabled())
+        mVRAMSoftLimit.check(mPoolResources.getVRAMInfo(false));
+
+    return res;
+}
+
+void phi::vk::BackendVulkan::createTransientTextures(cc::span<arg::transient_texture_description const> descs, cc::span<handle::resource> out_resources, char const* debug_name)
+{
+    mPoolResources.createTransientTextures(descs, out_resources, debug_name, getCurrentScratchAlloc());
+    resetCurrentScratchAlloc();
+
+    if (mVRAMSoftLimit.is_enabled())
+        mVRAMSoftLimit.check(mPoolResources.getVRAMInfo(false));
 }
 
 std::byte* phi::vk::BackendVulkan::mapBuffer(phi::handle::resource res, int begin, int end) { return mPoolResources.mapBuffer(res, begin, end); }
 
 void phi::vk::BackendVulkan::unmapBuffer(phi::handle::resource res, int begin, int end) { return mPoolResources.unmapBuffer(res, begin, end); }
 
-void phi::vk::BackendVulkan::free(phi::handle::resource res) { mPoolResources.free(res); }
+void phi::vk::BackendVulkan::free(phi::handle::resource res)
+{
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.enqueue(deferred_free_queue::handle_type::resource, cc::span{res});
+        return;
+    }
+
+    if (res.is_valid() && mPoolResources.isImage(res))
+    {
+        // cached framebuffers and image views referencing this resource must die alongside it
+        mFramebufferCache.invalidateResources(cc::span{res});
+    }
 
-void phi::vk::BackendVulkan::freeRange(cc::span<const phi::handle::resource> resources) { mPoolResources.free(resources); }
+    mPoolResources.free(res);
+}
+
+void phi::vk::BackendVulkan::freeRange(cc::span<const phi::handle::resource> resources)
+{
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.enqueue(deferred_free_queue::handle_type::resource, resources);
+        return;
+    }
+
+    freeResourcesImmediately(resources);
+}
 
 phi::handle::shader_view phi::vk::BackendVulkan::createShaderView(cc::span<const phi::resource_view> srvs,
                                                                   cc::span<const phi::resource_view> uavs,
@@ -343,9 +470,27 @@ void phi::vk::BackendVulkan::writeShaderViewSamplers(handle::shader_view sv, uin
     resetCurrentScratchAlloc();
 }
 
-void phi::vk::BackendVulkan::free(phi::handle::shader_view sv) { mPoolShaderViews.free(sv); }
+void phi::vk::BackendVulkan::free(phi::handle::shader_view sv)
+{
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.enqueue(deferred_free_queue::handle_type::shader_view, cc::span{sv});
+        return;
+    }
 
-void phi::vk::BackendVulkan::freeRange(cc::span<const phi::handle::shader_view> svs) { mPoolShaderViews.free(svs); }
+    mPoolShaderViews.free(sv);
+}
+
+void phi::vk::BackendVulkan::freeRange(cc::span<const phi::handle::shader_view> svs)
+{
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.enqueue(deferred_free_queue::handle_type::shader_view, svs);
+        return;
+    }
+
+    mPoolShaderViews.free(svs);
+}
 
 phi::handle::pipeline_state phi::vk::BackendVulkan::createPipelineState(phi::arg::vertex_format vertex_format,
                                                                         const phi::arg::framebuffer_config& framebuffer_conf,
@@ -387,9 +532,38 @@ phi::handle::pipeline_state phi::vk::BackendVulkan::createComputePipelineState(c
     return res;
 }
 
-void phi::vk::BackendVulkan::free(phi::handle::pipeline_state ps) { mPoolPipelines.free(ps); }
+void phi::vk::BackendVulkan::createPipelineStates(cc::span<const arg::graphics_pipeline_state_description> descriptions,
+                                                  cc::span<handle::pipeline_state> out_psos,
+                                                  cc::span<char const* const> debug_names)
+{
+    mPoolPipelines.createPipelineStates(descriptions, out_psos, debug_names);
+}
+
+void phi::vk::BackendVulkan::createComputePipelineStates(cc::span<const arg::compute_pipeline_state_description> descriptions,
+                                                         cc::span<handle::pipeline_state> out_psos,
+                                                         cc::span<char const* const> debug_names)
+{
+    mPoolPipelines.createComputePipelineStates(descriptions, out_psos, debug_names);
+}
+
+void phi::vk::BackendVulkan::free(phi::handle::pipeline_state ps)
+{
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.enqueue(deferred_free_queue::handle_type::pipeline_state, cc::span{ps});
+        return;
+    }
+
+    mPoolPipelines.free(ps);
+}
 
 phi::handle::command_list phi::vk::BackendVulkan::recordCommandList(std::byte const* buffer, size_t size, queue_type queue)
+{
+    command_stream_chunk const chunk = {buffer, size};
+    return recordCommandList(cc::span<command_stream_chunk const>(&chunk, 1), queue);
+}
+
+phi::handle::command_list phi::vk::BackendVulkan::recordCommandList(cc::span<command_stream_chunk const> chunks, queue_type queue)
 {
     // possibly fall back to a direct queue
     queue = mDevice.getQueueTypeOrFallback(queue);
@@ -398,7 +572,15 @@ phi::handle::command_list phi::vk::BackendVulkan::recordCommandList(std::byte co
 
     VkCommandBuffer raw_list;
     auto const res = mPoolCmdLists.create(raw_list, thread_comp.cmdListAllocator, queue);
-    thread_comp.translator.translateCommandList(raw_list, res, mPoolCmdLists.getStateCache(res), buffer, size);
+
+    // large render passes are translated by the worker threads, render passes only occur on the direct queue
+    parallel_translation_plan const* split_plan = nullptr;
+    if (queue == queue_type::direct && mParallelTranslator.isEnabled() && mParallelTranslator.planSplits(chunks, thread_comp.splitPlan))
+    {
+        split_plan = &thread_comp.splitPlan;
+    }
+
+    thread_comp.translator.translateCommandList(raw_list, res, mPoolCmdLists.getStateCache(res), chunks, split_plan);
     return res;
 }
 
@@ -422,22 +604,64 @@ void phi::vk::BackendVulkan::submit(cc::span<const phi::handle::command_list> cl
 
     auto& thread_comp = getCurrentThreadComponent();
 
-    for (handle::command_list const cl : cls)
+    // the patch-up barriers of all lists in this submit, batched into as few barrier-only command lists as possible
+    // a barrier can move into an earlier barrier list if no list in between touches its resource
+    growable_barrier_bundle barriers;
+    barriers.initialize(getCurrentScratchAlloc(), 64);
+
+    VkCommandBuffer open_barrier_list = nullptr;
+    size_t open_barrier_list_first_cl = 0; // index into cls of the first list following the open barrier list
+
+    auto f_close_barrier_list = [&]() -> void {
+        if (open_barrier_list == nullptr)
+            return;
+
+        barriers.record(open_barrier_list);
+        vkEndCommandBuffer(open_barrier_list);
+        barriers.reset();
+        open_barrier_list = nullptr;
+    };
+
+    auto f_is_touched_since_barrier_list = [&](handle::resource res, size_t cl_index) -> bool {
+        for (auto i = open_barrier_list_first_cl; i < cl_index; ++i)
+        {
+            if (cls[i] != handle::null_command_list && mPoolCmdLists.getStateCache(cls[i])->contains(res))
+                return true;
+        }
+
+        return false;
+    };
+
+    for (auto cl_index = 0u; cl_index < cls.size(); ++cl_index)
     {
+        handle::command_list const cl = cls[cl_index];
+
         // silently ignore invalid handles
         if (cl == handle::null_command_list)
             continue;
 
         auto const* const state_cache = mPoolCmdLists.getStateCache(cl);
-        barrier_bundle<32, 32, 32> barriers;
 
-        for (auto i = 0u; i < state_cache->num_entries; ++i)
+        for (auto i = 0u; i < state_cache->num_entries(); ++i)
         {
-            auto const& entry = state_cache->entries[i];
+            auto const& entry = state_cache->get_entry(i);
             auto const master_before = mPoolResources.getResourceState(entry.ptr);
 
-            if (master_before != entry.required_initial)
+            // resources activated with cmd::barrier_aliasing in this list require no initial barrier
+            if (entry.required_initial != resource_state::undefined && master_before != entry.required_initial)
             {
+                // a previous list in the same submit uses this resource after the open barrier list, the barrier must go after it
+                if (open_barrier_list != nullptr && f_is_touched_since_barrier_list(entry.ptr, cl_index))
+                    f_close_barrier_list();
+
+                // special barrier-only command list inserted before the proper one
+                if (open_barrier_list == nullptr)
+                {
+                    barrier_lists.push_back(mPoolCmdLists.create(open_barrier_list, thread_comp.cmdListAllocator, queue));
+                    cmd_bufs_to_submit.push_back(open_barrier_list);
+                    open_barrier_list_first_cl = cl_index;
+                }
+
                 auto const master_dep_before = mPoolResources.getResourceStageDependency(entry.ptr);
 
                 // transition to the state required as the initial one
@@ -459,19 +683,11 @@ void phi::vk::BackendVulkan::submit(cc::span<const phi::handle::command_list> cl
             mPoolResources.setResourceState(entry.ptr, entry.current, entry.current_dependency);
         }
 
-        // special barrier-only command list inserted before the proper one
-        if (!barriers.empty())
-        {
-            VkCommandBuffer t_cmd_list;
-            barrier_lists.push_back(mPoolCmdLists.create(t_cmd_list, thread_comp.cmdListAllocator, queue));
-            barriers.record(t_cmd_list);
-            vkEndCommandBuffer(t_cmd_list);
-            cmd_bufs_to_submit.push_back(t_cmd_list);
-        }
-
         cmd_bufs_to_submit.push_back(mPoolCmdLists.getRawBuffer(cl));
     }
 
+    f_close_barrier_list();
+
     // submission
 
     constexpr uint32_t c_max_num_signals_waits = 8;
@@ -479,8 +695,9 @@ void phi::vk::BackendVulkan::submit(cc::span<const phi::handle::command_list> cl
     uint64_t wait_values[c_max_num_signals_waits];
     VkSemaphore wait_semaphores[c_max_num_signals_waits];
 
-    uint64_t signal_values[c_max_num_signals_waits];
-    VkSemaphore signal_semaphores[c_max_num_signals_waits];
+    // one additional signal for the deferred free timeline
+    uint64_t signal_values[c_max_num_signals_waits + 1];
+    VkSemaphore signal_semaphores[c_max_num_signals_waits + 1];
 
     CC_ASSERT(fence_waits_before.size() <= c_max_num_signals_waits && "too many fence waits");
     CC_ASSERT(fence_signals_after.size() <= c_max_num_signals_waits && "too many fence signals");
@@ -497,12 +714,21 @@ void phi::vk::BackendVulkan::submit(cc::span<const phi::handle::command_list> cl
         signal_semaphores[i] = mPoolFences.get(fence_signals_after[i].fence);
     }
 
+    uint32_t num_signals = uint32_t(fence_signals_after.size());
+
+    if (mIsDeferredFreeEnabled)
+    {
+        signal_values[num_signals] = mDeferredFreeQueue.increment_submit_value(queue);
+        signal_semaphores[num_signals] = mSubmitTimelines[static_cast<uint8_t>(queue)];
+        ++num_signals;
+    }
+
     VkTimelineSemaphoreSubmitInfoKHR timeline_info = {};
     timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
     timeline_info.waitSemaphoreValueCount = uint32_t(fence_waits_before.size());
     timeline_info.pWaitSemaphoreValues = fence_waits_before.empty() ? nullptr : wait_values;
-    timeline_info.signalSemaphoreValueCount = uint32_t(fence_signals_after.size());
-    timeline_info.pSignalSemaphoreValues = fence_signals_after.empty() ? nullptr : signal_values;
+    timeline_info.signalSemaphoreValueCount = num_signals;
+    timeline_info.pSignalSemaphoreValues = num_signals == 0 ? nullptr : signal_values;
 
     VkSubmitInfo submit_info = {};
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -515,7 +741,7 @@ void phi::vk::BackendVulkan::submit(cc::span<const phi::handle::command_list> cl
     submit_info.pWaitSemaphores = wait_semaphores;
     submit_info.pWaitDstStageMask = gc_wait_dst_masks;
     // signal semaphores
-    submit_info.signalSemaphoreCount = uint32_t(fence_signals_after.size());
+    submit_info.signalSemaphoreCount = num_signals;
     submit_info.pSignalSemaphores = signal_semaphores;
 
 
@@ -526,6 +752,10 @@ void phi::vk::BackendVulkan::submit(cc::span<const phi::handle::command_list> cl
 
     cc::array<cc::span<handle::command_list const>, 2> submit_spans = {barrier_lists, cls};
     mPoolCmdLists.freeOnSubmit(submit_spans, submit_fence_index);
+
+    // framebuffers are only used on the direct queue, this also covers headless use without present
+    if (queue == queue_type::direct)
+        mFramebufferCache.advanceGeneration();
 }
 
 phi::handle::fence phi::vk::BackendVulkan::createFence() { return mPoolFences.createFence(); }
@@ -594,12 +824,26 @@ void phi::vk::BackendVulkan::writeShaderTable(std::byte* dest, handle::pipeline_
 void phi::vk::BackendVulkan::free(phi::handle::accel_struct as)
 {
     CC_ASSERT(isRaytracingEnabled() && "raytracing is not enabled");
+
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.enqueue(deferred_free_queue::handle_type::accel_struct, cc::span{as});
+        return;
+    }
+
     mPoolAccelStructs.free(as);
 }
 
 void phi::vk::BackendVulkan::freeRange(cc::span<const phi::handle::accel_struct> as)
 {
     CC_ASSERT(isRaytracingEnabled() && "raytracing is not enabled");
+
+    if (mIsDeferredFreeEnabled)
+    {
+        mDeferredFreeQueue.enqueue(deferred_free_queue::handle_type::accel_struct, as);
+        return;
+    }
+
     mPoolAccelStructs.free(as);
 }
 
@@ -639,8 +883,39 @@ bool phi::vk::BackendVulkan::isRaytracingEnabled() const { return mDevice.hasRay
 
 phi::backend_type phi::vk::BackendVulkan::getBackendType() const { return backend_type::vulkan; }
 
+phi::vram_state_info phi::vk::BackendVulkan::getVRAMInfo()
+{
+    auto const res = mPoolResources.getVRAMInfo(true);
+    mVRAMSoftLimit.check(res);
+    return res;
+}
+
 void phi::vk::BackendVulkan::flushGPU() { vkDeviceWaitIdle(mDevice.getDevice()); }
 
+uint32_t phi::vk::BackendVulkan::collectGarbage()
+{
+    if (!mIsDeferredFreeEnabled)
+        return 0;
+
+    uint64_t completed_values[deferred_free_queue::num_queue_types];
+    for (auto i = 0u; i < deferred_free_queue::num_queue_types; ++i)
+    {
+        PHI_VK_VERIFY_SUCCESS(vkGetSemaphoreCounterValue(mDevice.getDevice(), mSubmitTimelines[i], &completed_values[i]));
+    }
+
+    return mDeferredFreeQueue.collect(completed_values, [&](deferred_free_queue::entry const& entry) { destroyDeferredFree(entry); });
+}
+
+phi::vk::RenderPassCache::cache_stats phi::vk::BackendVulkan::nativeGetRenderPassCacheStats() const
+{
+    auto res = mPoolPipelines.getRenderPassCacheStats();
+    for (auto i = 0u; i < mNumThreadComponents; ++i)
+    {
+        res.num_local_hits += mThreadComponents[i].translator.getNumLocalRenderPassHits();
+    }
+    return res;
+}
+
 void phi::vk::BackendVulkan::createDebugMessenger()
 {
     VkDebugUtilsMessengerCreateInfoEXT createInfo = {};
@@ -666,3 +941,32 @@ phi::vk::BackendVulkan::per_thread_component& phi::vk::BackendVulkan::getCurrent
 cc::allocator* phi::vk::BackendVulkan::getCurrentScratchAlloc() { return &getCurrentThreadComponent().threadLocalScratchAlloc; }
 
 void phi::vk::BackendVulkan::resetCurrentScratchAlloc() { getCurrentThreadComponent().threadLocalScratchAlloc.reset(); }
+
+void phi::vk::BackendVulkan::freeResourcesImmediately(cc::span<const phi::handle::resource> resources)
+{
+    // cached framebuffers and image views referencing these resources must die alongside them
+    mFramebufferCache.invalidateResources(resources);
+    mPoolResources.free(resources);
+}
+
+void phi::vk::BackendVulkan::destroyDeferredFree(const deferred_free_queue::entry& entry)
+{
+    switch (entry.type)
+    {
+    case deferred_free_queue::handle_type::resource:
+    {
+        handle::resource const res = {entry.value};
+        freeResourcesImmediately(cc::span{res});
+        break;
+    }
+    case deferred_free_queue::handle_type::shader_view:
+        mPoolShaderViews.free(handle::shader_view{entry.value});
+        break;
+    case deferred_free_queue::handle_type::pipeline_state:
+        mPoolPipelines.free(handle::pipeline_state{entry.value});
+        break;
+    case deferred_free_queue::handle_type::accel_struct:
+        mPoolAccelStructs.free(handle::accel_struct{entry.value});
+        break;
+    }
+}
@@ -1,16 +1,20 @@
 #pragma once
 
 #include <phantasm-hardware-interface/Backend.hh>
+#include <phantasm-hardware-interface/common/deferred_free_queue.hh>
 #include <phantasm-hardware-interface/common/thread_association.hh>
+#include <phantasm-hardware-interface/common/vram_soft_limit.hh>
 #include <phantasm-hardware-interface/features/gpu_info.hh>
 #include <phantasm-hardware-interface/types.hh>
 
 #include "Device.hh"
 
 #include "common/diagnostic_util.hh"
+#include "parallel_translation.hh"
 #include "pools/accel_struct_pool.hh"
 #include "pools/cmd_list_pool.hh"
 #include "pools/fence_pool.hh"
+#include "pools/framebuffer_cache.hh"
 #include "pools/pipeline_pool.hh"
 #include "pools/query_pool.hh"
 #include "pools/resource_pool.hh"
@@ -68,6 +72,8 @@ public:
 
     [[nodiscard]] handle::resource createBuffer(arg::buffer_description const& desc, char const* debug_name = nullptr) override;
 
+    void createTransientTextures(cc::span<arg::transient_texture_description const> descs, cc::span<handle::resource> out_resources, char const* debug_name = nullptr) override;
+
     [[nodiscard]] std::byte* mapBuffer(handle::resource res, int begin = 0, int end = -1) override;
 
     void unmapBuffer(handle::resource res, int begin = 0, int end = -1) override;
@@ -119,13 +125,25 @@ public:
     [[nodiscard]] handle::pipeline_state createComputePipelineState(arg::compute_pipeline_state_description const& description,
                                                                     char const* debug_name = nullptr) override;
 
+    void createPipelineStates(cc::span<arg::graphics_pipeline_state_description const> descriptions,
+                              cc::span<handle::pipeline_state> out_psos,
+                              cc::span<char const* const> debug_names = {}) override;
+
+    void createComputePipelineStates(cc::span<arg::compute_pipeline_state_description const> descriptions,
+                                     cc::span<handle::pipeline_state> out_psos,
+                                     cc::span<char const* const> debug_names = {}) override;
+
     void free(handle::pipeline_state ps) override;
 
+    bool flushPipelineCache() override { return mPoolPipelines.flushPipelineCache(); }
+
     //
     // Command list interface
     //
 
     [[nodiscard]] handle::command_list recordCommandList(std::byte const* buffer, size_t size, queue_type queue = queue_type::direct) override;
+
+    [[nodiscard]] handle::command_list recordCommandList(cc::span<command_stream_chunk const> chunks, queue_type queue = queue_type::direct) override;
     void discard(cc::span<handle::command_list const> cls) override;
 
     void submit(cc::span<handle::command_list const> cls,
@@ -212,12 +230,43 @@ public:
 
     gpu_info const& getGPUInfo() const override { return mGPUInfo; }
 
+    vram_state_info getVRAMInfo() override;
+
+    //
+    // Deferred free interface
+    //
+
+    uint32_t collectGarbage() override;
+
+    deferred_free_stats getDeferredFreeStats() override { return mDeferredFreeQueue.get_stats(); }
+
 public:
     // backend-internal
 
     /// flush all pending work on the GPU
     void flushGPU() override;
 
+public:
+    // non virtual - vulkan specific
+
+    /// hit/miss statistics of the persistent framebuffer cache used for cmd::begin_render_pass
+    FramebufferCache::cache_stats nativeGetFramebufferCacheStats() { return mFramebufferCache.getStats(); }
+
+    /// lock-free vs. locked lookups of the render pass cache used for cmd::begin_render_pass
+    RenderPassCache::cache_stats nativeGetRenderPassCacheStats() const;
+
+    /// hit/miss statistics of the cache of patched and reflected SPIR-V used in pipeline state creation
+    SpirvReflectionCache::cache_stats nativeGetSpirvReflectionCacheStats() { return mPoolPipelines.getSpirvReflectionCacheStats(); }
+
+    /// requested vs. unique sampler statistics of the sampler cache shared by all shader views
+    SamplerCache::cache_stats nativeGetSamplerCacheStats() { return mPoolShaderViews.getSamplerCacheStats(); }
+
+    /// requested vs. unique descriptor set layout statistics of the layout cache shared by all shader views
+    DescriptorSetLayoutCache::cache_stats nativeGetDescriptorSetLayoutCacheStats() { return mPoolShaderViews.getLayoutCacheStats(); }
+
+    /// amount and per-segment CPU time of render passes translated in parallel, see backend_config::num_translation_worker_threads
+    ParallelCommandTranslator::translation_stats nativeGetParallelTranslationStats() { return mParallelTranslator.getStats(); }
+
 private:
     void createDebugMessenger();
 
@@ -227,6 +276,10 @@ private:
     cc::allocator* getCurrentScratchAlloc();
     void resetCurrentScratchAlloc();
 
+    void freeResourcesImmediately(cc::span<handle::resource const> resources);
+
+    void destroyDeferredFree(deferred_free_queue::entry const& entry);
+
 private:
     gpu_info mGPUInfo;
     VkInstance mInstance = nullptr;
@@ -243,6 +296,17 @@ private:
     AccelStructPool mPoolAccelStructs;
     SwapchainPool mPoolSwapchains;
 
+    // Caches
+    FramebufferCache mFramebufferCache;
+
+    // Worker threads translating large render passes into secondary command buffers
+    ParallelCommandTranslator mParallelTranslator;
+
+    // Deferred frees, tracked against a timeline semaphore per queue type signalled on every submit
+    bool mIsDeferredFreeEnabled = false;
+    deferred_free_queue mDeferredFreeQueue;
+    VkSemaphore mSubmitTimelines[deferred_free_queue::num_queue_types] = {};
+
     // Logic
     per_thread_component* mThreadComponents;
     uint32_t mNumThreadComponents;
@@ -252,5 +316,6 @@ private:
 
     // Misc
     util::diagnostic_state mDiagnostics;
+    vram_soft_limit mVRAMSoftLimit;
 };
 }
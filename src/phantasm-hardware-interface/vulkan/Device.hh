@@ -38,6 +38,7 @@ public:
     VkPhysicalDeviceProperties const& getDeviceProperties() const { return mInformation.device_properties; }
     bool hasRaytracing() const { return mHasRaytracing; }
     bool hasConservativeRaster() const { return mHasConservativeRaster; }
+    bool hasMemoryBudget() const { return mHasMemoryBudget; }
 
 public:
     VkPhysicalDevice getPhysicalDevice() const { return mPhysicalDevice; }
@@ -69,6 +70,7 @@ private:
 
     bool mHasRaytracing = false;
     bool mHasConservativeRaster = false;
+    bool mHasMemoryBudget = false;
     void queryDeviceProps2();
 };
 }
@@ -1,5 +1,7 @@
 #include "cmd_buf_translation.hh"
 
+#include <algorithm>
+
 #ifdef PHI_HAS_OPTICK
 #include <optick/optick.h>
 #endif
@@ -14,8 +16,10 @@
 #include "common/native_enum.hh"
 #include "common/util.hh"
 #include "common/verify.hh"
+#include "parallel_translation.hh"
 #include "pools/accel_struct_pool.hh"
 #include "pools/cmd_list_pool.hh"
+#include "pools/framebuffer_cache.hh"
 #include "pools/pipeline_layout_cache.hh"
 #include "pools/pipeline_pool.hh"
 #include "pools/query_pool.hh"
@@ -23,8 +27,11 @@
 #include "pools/shader_view_pool.hh"
 #include "resources/transition_barrier.hh"
 
-void phi::vk::command_list_translator::translateCommandList(
-    VkCommandBuffer list, handle::command_list list_handle, vk_incomplete_state_cache* state_cache, std::byte const* buffer, size_t buffer_size)
+void phi::vk::command_list_translator::translateCommandList(VkCommandBuffer list,
+                                                            handle::command_list list_handle,
+                                                            vk_incomplete_state_cache* state_cache,
+                                                            cc::span<command_stream_chunk const> chunks,
+                                                            parallel_translation_plan const* split_plan)
 {
     _cmd_list = list;
     _cmd_list_handle = list_handle;
@@ -42,11 +49,45 @@ void phi::vk::command_list_translator::translateCommandList(
         OPTICK_GPU_EVENT("PHI Command List");
 #endif
 
+        // queries can only be reset outside of render passes, do it for the entire list up front
+        // and before the render passes of queries written more than once
+        reset_timestamp_queries(chunks);
+
+        // the next render pass to split, and the end of the current one while skipping its body
+        uint32_t next_split_rp = 0;
+        uint32_t const num_split_rps = split_plan ? uint32_t(split_plan->render_passes.size()) : 0u;
+        bool is_skipping_body = false;
+        cmd::detail::cmd_base const* skip_until = nullptr;
+
         // translate all contained commands
-        command_stream_parser parser(buffer, buffer_size);
-        for (auto const& cmd : parser)
+        for (command_stream_chunk const& chunk : chunks)
         {
-            cmd::detail::dynamic_dispatch(cmd, *this);
+            command_stream_parser parser(chunk.buffer, chunk.size);
+            for (auto const& cmd : parser)
+            {
+                if (is_skipping_body)
+                {
+                    // the body was translated into secondaries, resume at the cmd::end_render_pass
+                    if (&cmd != skip_until)
+                        continue;
+
+                    is_skipping_body = false;
+                }
+
+                reset_repeated_timestamp_queries(cmd);
+
+                if (next_split_rp < num_split_rps && &cmd == split_plan->render_passes[next_split_rp].begin_cmd)
+                {
+                    split_render_pass const& split_rp = split_plan->render_passes[next_split_rp++];
+                    execute_split_render_pass(*split_plan, split_rp);
+
+                    is_skipping_body = true;
+                    skip_until = split_rp.end_cmd;
+                    continue;
+                }
+
+                cmd::detail::dynamic_dispatch(cmd, *this);
+            }
         }
 
         // close pending render pass
@@ -72,20 +113,79 @@ void phi::vk::command_list_translator::translateCommandList(
     // done
 }
 
+void phi::vk::command_list_translator::translateRenderPassSegment(VkCommandBuffer list,
+                                                                  handle::command_list primary_handle,
+                                                                  VkRenderPass render_pass,
+                                                                  VkFramebuffer framebuffer,
+                                                                  parallel_translation_plan const& plan,
+                                                                  split_render_pass const& split_rp,
+                                                                  uint32_t segment_index)
+{
+    _cmd_list = list;
+    _cmd_list_handle = primary_handle;
+    // barriers cannot occur inside of render passes
+    _state_cache = nullptr;
+
+    _bound.reset();
+    _bound.raw_render_pass = render_pass;
+    _bound.raw_framebuffer = framebuffer;
+    _last_code_location.reset();
+
+    render_pass_segment const& segment = plan.segments[segment_index];
+
+    // dynamic state is not inherited from the primary
+    vkCmdSetViewport(_cmd_list, 0, 1, &split_rp.viewport);
+    vkCmdSetScissor(_cmd_list, 0, 1, &segment.scissor);
+
+    for (auto i = 0u; i < segment.num_pieces; ++i)
+    {
+        command_stream_chunk const& piece = plan.pieces[segment.first_piece + i];
+        command_stream_parser parser(piece.buffer, piece.size);
+        for (auto const& cmd : parser)
+        {
+            cmd::detail::dynamic_dispatch(cmd, *this);
+        }
+    }
+
+    PHI_VK_VERIFY_SUCCESS(vkEndCommandBuffer(_cmd_list));
+}
+
 void phi::vk::command_list_translator::execute(const phi::cmd::begin_render_pass& begin_rp)
+{
+    begin_render_pass(begin_rp, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+void phi::vk::command_list_translator::execute_split_render_pass(parallel_translation_plan const& plan, split_render_pass const& split_rp)
+{
+    begin_render_pass(*static_cast<cmd::begin_render_pass const*>(split_rp.begin_cmd), VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+    VkCommandBuffer secondaries[ParallelCommandTranslator::max_num_segments];
+    plan.translator->translateSegments(plan, split_rp, _bound.raw_render_pass, _bound.raw_framebuffer, _cmd_list_handle, secondaries);
+
+    // executed in stream order, the result does not depend on which worker recorded which segment
+    vkCmdExecuteCommands(_cmd_list, split_rp.num_segments, secondaries);
+
+    // the secondaries leave the primary's bindings undefined
+    auto const raw_render_pass = _bound.raw_render_pass;
+    auto const raw_framebuffer = _bound.raw_framebuffer;
+    _bound.reset();
+    _bound.raw_render_pass = raw_render_pass;
+    _bound.raw_framebuffer = raw_framebuffer;
+}
+
+void phi::vk::command_list_translator::begin_render_pass(cmd::begin_render_pass const& begin_rp, VkSubpassContents contents)
 {
     CC_ASSERT(_bound.raw_render_pass == nullptr && "double cmd::begin_render_pass - missing cmd::end_render_pass?");
     CC_ASSERT(begin_rp.viewport.width + begin_rp.viewport.height != 0 && "recording begin_render_pass with empty viewport");
 
-    // the image views used in this framebuffer
-    cc::capped_vector<VkImageView, limits::max_render_targets + 1> fb_image_views;
-    // the image views used in this framebuffer, EXCLUDING possible backbuffer views
-    // these are the ones which will get deleted alongside this framebuffer
-    cc::capped_vector<VkImageView, limits::max_render_targets + 1> fb_image_views_to_clean_up;
+    // the resource views of all attachments, in framebuffer order
+    cc::capped_vector<resource_view, limits::max_render_targets + 1> fb_attachments;
     // clear values for the render targets and depth target
     cc::capped_vector<VkClearValue, limits::max_render_targets + 1> clear_values;
     // formats of the render targets
     cc::capped_vector<format, limits::max_render_targets> formats_flat;
+    // whether any of the render targets is a backbuffer, whose views can not be cached
+    bool uses_backbuffer = false;
 
     // inferred info
     int num_fb_samples = 1;
@@ -97,16 +197,8 @@ void phi::vk::command_list_translator::execute(const phi::cmd::begin_render_pass
         // rt format
         formats_flat.push_back(rt.rv.texture_info.pixel_format);
 
-        // image view
-        if (_globals.pool_resources->isBackbuffer(rt.rv.resource))
-        {
-            fb_image_views.push_back(_globals.pool_resources->getBackbufferView(rt.rv.resource));
-        }
-        else
-        {
-            fb_image_views.push_back(_globals.pool_shader_views->makeImageView(rt.rv, false, false));
-            fb_image_views_to_clean_up.push_back(fb_image_views.back());
-        }
+        fb_attachments.push_back(rt.rv);
+        uses_backbuffer = uses_backbuffer || _globals.pool_resources->isBackbuffer(rt.rv.resource);
 
         // clear val
         auto& cv = clear_values.emplace_back();
@@ -115,9 +207,7 @@ void phi::vk::command_list_translator::execute(const phi::cmd::begin_render_pass
 
     if (begin_rp.depth_target.rv.resource.is_valid())
     {
-        // image view
-        fb_image_views.push_back(_globals.pool_shader_views->makeImageView(begin_rp.depth_target.rv, false, false));
-        fb_image_views_to_clean_up.push_back(fb_image_views.back());
+        fb_attachments.push_back(begin_rp.depth_target.rv);
 
         // clear val
         auto& cv = clear_values.emplace_back();
@@ -146,15 +236,39 @@ void phi::vk::command_list_translator::execute(const phi::cmd::begin_render_pass
     }
 
     // create or retrieve a render pass from cache matching the configuration
-    auto const render_pass = _globals.pool_pipeline_states->getOrCreateRenderPass(begin_rp, num_fb_samples, formats_flat);
+    auto const render_pass = _globals.pool_pipeline_states->getOrCreateRenderPass(begin_rp, num_fb_samples, formats_flat, _render_pass_cache);
 
     // a render pass always changes
     //      - The framebuffer
     //      - The vkCmdBeginRenderPass/vkCmdEndRenderPass state
     _bound.raw_render_pass = render_pass;
 
-    // create a new framebuffer on the fly
+    // retrieve a persistent framebuffer from cache, backbuffer views are too short-lived for this
+    _bound.raw_framebuffer = uses_backbuffer ? nullptr : _globals.framebuffer_cache->getOrCreate(render_pass, fb_attachments, fb_size);
+
+    if (_bound.raw_framebuffer == nullptr)
     {
+        // create a new framebuffer on the fly
+
+        // the image views used in this framebuffer
+        cc::capped_vector<VkImageView, limits::max_render_targets + 1> fb_image_views;
+        // the image views used in this framebuffer, EXCLUDING possible backbuffer views
+        // these are the ones which will get deleted alongside this framebuffer
+        cc::capped_vector<VkImageView, limits::max_render_targets + 1> fb_image_views_to_clean_up;
+
+        for (auto const& rv : fb_attachments)
+        {
+            if (_globals.pool_resources->isBackbuffer(rv.resource))
+            {
+                fb_image_views.push_back(_globals.pool_resources->getBackbufferView(rv.resource));
+            }
+            else
+            {
+                fb_image_views.push_back(_globals.pool_shader_views->makeImageView(rv, false, false));
+                fb_image_views_to_clean_up.push_back(fb_image_views.back());
+            }
+        }
+
         VkFramebufferCreateInfo fb_info = {};
         fb_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         fb_info.renderPass = render_pass;
@@ -214,12 +328,13 @@ void phi::vk::command_list_translator::execute(const phi::cmd::begin_render_pass
         vkCmdSetViewport(_cmd_list, 0, 1, &viewport);
         vkCmdSetScissor(_cmd_list, 0, 1, &scissor);
 
-        vkCmdBeginRenderPass(_cmd_list, &rp_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(_cmd_list, &rp_begin_info, contents);
     }
 }
 
 void phi::vk::command_list_translator::execute(const phi::cmd::draw& draw)
 {
+    _bound.is_compute = false;
     if (_bound.update_pso(draw.pipeline_state))
     {
         // a new handle::pipeline_state invalidates (!= always changes)
@@ -231,15 +346,7 @@ void phi::vk::command_list_translator::execute(const phi::cmd::draw& draw)
     }
 
     // Index buffer (optional)
-    if (draw.index_buffer != _bound.index_buffer)
-    {
-        _bound.index_buffer = draw.index_buffer;
-        if (draw.index_buffer.is_valid())
-        {
-            auto const& ind_buf_info = _globals.pool_resources->getBufferInfo(draw.index_buffer);
-            vkCmdBindIndexBuffer(_cmd_list, ind_buf_info.raw_buffer, 0, (ind_buf_info.stride == 4) ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16);
-        }
-    }
+    bind_index_buffer(draw.index_buffer);
 
     // Vertex buffers
     bind_vertex_buffers(draw.vertex_buffers);
@@ -269,6 +376,7 @@ void phi::vk::command_list_translator::execute(const phi::cmd::draw& draw)
 
 void phi::vk::command_list_translator::execute(const phi::cmd::draw_indirect& draw_indirect)
 {
+    _bound.is_compute = false;
     if (_bound.update_pso(draw_indirect.pipeline_state))
     {
         // a new handle::pipeline_state invalidates (!= always changes)
@@ -280,15 +388,7 @@ void phi::vk::command_list_translator::execute(const phi::cmd::draw_indirect& dr
     }
 
     // Index buffer (optional)
-    if (draw_indirect.index_buffer != _bound.index_buffer)
-    {
-        _bound.index_buffer = draw_indirect.index_buffer;
-        if (draw_indirect.index_buffer.is_valid())
-        {
-            auto const& ind_buf_info = _globals.pool_resources->getBufferInfo(draw_indirect.index_buffer);
-            vkCmdBindIndexBuffer(_cmd_list, ind_buf_info.raw_buffer, 0, (ind_buf_info.stride == 4) ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16);
-        }
-    }
+    bind_index_buffer(draw_indirect.index_buffer);
 
     // Vertex buffer
     bind_vertex_buffers(draw_indirect.vertex_buffers);
@@ -319,10 +419,80 @@ void phi::vk::command_list_translator::execute(const phi::cmd::draw_indirect& dr
     }
 }
 
+void phi::vk::command_list_translator::execute(const phi::cmd::draw_batch& batch)
+{
+    CC_ASSERT(_bound.raw_render_pass != nullptr && "cmd::draw_batch must occur inside of a render pass");
+    CC_ASSERT(batch.records != nullptr || batch.num_records == 0);
+    CC_ASSERT(batch.num_root_constant_bytes <= limits::max_root_constant_bytes && batch.num_root_constant_bytes % 4 == 0 && "invalid root constant size");
+
+    auto const& pso_node = _globals.pool_pipeline_states->get(batch.pipeline_state);
+    pipeline_layout const& pipeline_layout = *pso_node.associated_pipeline_layout;
+
+    _bound.is_compute = false;
+    if (_bound.update_pso(batch.pipeline_state))
+    {
+        _bound.update_pipeline_layout(pipeline_layout.raw_layout);
+        vkCmdBindPipeline(_cmd_list, VK_PIPELINE_BIND_POINT_GRAPHICS, pso_node.raw_pipeline);
+    }
+
+    bind_index_buffer(batch.index_buffer);
+    bind_vertex_buffers(batch.vertex_buffers);
+
+    // shared shader arguments, root constants are set per draw
+    bind_shader_arguments(batch.pipeline_state, nullptr, batch.shader_arguments, VK_PIPELINE_BIND_POINT_GRAPHICS, 0);
+
+    // per-draw state
+    bool const set_root_constants = batch.num_root_constant_bytes > 0 && pipeline_layout.has_push_constants();
+
+    bool const set_cbv_offset = batch.cbv_argument_index != uint8_t(-1);
+    VkDescriptorSet cbv_desc_set = nullptr;
+    if (set_cbv_offset)
+    {
+        CC_ASSERT(batch.cbv_argument_index < batch.shader_arguments.size() && "cbv_argument_index out of bounds");
+        handle::resource const cbv = batch.shader_arguments[batch.cbv_argument_index].constant_buffer;
+        CC_ASSERT(cbv.is_valid() && "draw_batch argument CBV is missing");
+        cbv_desc_set = _globals.pool_resources->getRawCBVDescriptorSet(cbv);
+    }
+
+    bool const is_indexed = batch.index_buffer.is_valid();
+
+    for (auto i = 0u; i < batch.num_records; ++i)
+    {
+        cmd::draw_batch::draw_record const& draw = batch.records[i];
+
+        if (set_root_constants)
+        {
+            vkCmdPushConstants(_cmd_list, pipeline_layout.raw_layout, pipeline_layout.push_constant_stages, 0, batch.num_root_constant_bytes, draw.root_constants);
+        }
+
+        if (set_cbv_offset)
+        {
+            vkCmdBindDescriptorSets(_cmd_list, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout.raw_layout,
+                                    batch.cbv_argument_index + limits::max_shader_arguments, 1, &cbv_desc_set, 1, &draw.cbv_offset);
+        }
+
+        if (is_indexed)
+        {
+            vkCmdDrawIndexed(_cmd_list, draw.num_indices, draw.num_instances, draw.index_offset, draw.vertex_offset, 0);
+        }
+        else
+        {
+            vkCmdDraw(_cmd_list, draw.num_indices, draw.num_instances, draw.index_offset, 0);
+        }
+    }
+
+    // keep the bound CBV offset in sync
+    if (set_cbv_offset && batch.num_records > 0)
+    {
+        _bound.shader_args[batch.cbv_argument_index].cbv_offset = batch.records[batch.num_records - 1].cbv_offset;
+    }
+}
+
 void phi::vk::command_list_translator::execute(const phi::cmd::dispatch& dispatch)
 {
     auto const& pso_node = _globals.pool_pipeline_states->get(dispatch.pipeline_state);
 
+    _bound.is_compute = true;
     if (_bound.update_pso(dispatch.pipeline_state))
     {
         // a new handle::pipeline_state invalidates (!= always changes)
@@ -344,6 +514,7 @@ void phi::vk::command_list_translator::execute(const phi::cmd::dispatch_indirect
 {
     auto const& pso_node = _globals.pool_pipeline_states->get(dispatch_indirect.pipeline_state);
 
+    _bound.is_compute = true;
     if (_bound.update_pso(dispatch_indirect.pipeline_state))
     {
         // a new handle::pipeline_state invalidates (!= always changes)
@@ -375,6 +546,68 @@ void phi::vk::command_list_translator::execute(const phi::cmd::dispatch_indirect
     }
 }
 
+void phi::vk::command_list_translator::execute(const phi::cmd::set_pipeline_state& set_pso)
+{
+    CC_ASSERT(set_pso.pipeline_state.is_valid() && "invalid PSO handle");
+    CC_ASSERT(set_pso.is_compute == (_bound.raw_render_pass == nullptr) && "graphics PSOs must be set inside of render passes, compute PSOs outside");
+
+    _bound.is_compute = set_pso.is_compute;
+
+    if (_bound.update_pso(set_pso.pipeline_state))
+    {
+        auto const& pso_node = _globals.pool_pipeline_states->get(set_pso.pipeline_state);
+        _bound.update_pipeline_layout(pso_node.associated_pipeline_layout->raw_layout);
+        vkCmdBindPipeline(_cmd_list, set_pso.is_compute ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS, pso_node.raw_pipeline);
+    }
+}
+
+void phi::vk::command_list_translator::execute(const phi::cmd::set_shader_arguments& set_args)
+{
+    CC_ASSERT(_bound.pipeline_state.is_valid() && "cmd::set_shader_arguments requires a previous cmd::set_pipeline_state");
+
+    bind_shader_arguments(_bound.pipeline_state, set_args.get_root_constants(),
+                          cc::span<shader_argument const>(set_args.get_shader_arguments(), set_args.num_shader_arguments),
+                          _bound.is_compute ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS, set_args.num_root_constant_bytes);
+}
+
+void phi::vk::command_list_translator::execute(const phi::cmd::set_vertex_buffers& set_buffers)
+{
+    bind_index_buffer(set_buffers.index_buffer);
+    bind_vertex_buffers(set_buffers.vertex_buffers);
+}
+
+void phi::vk::command_list_translator::execute(const phi::cmd::set_scissor& scissor_cmd)
+{
+    CC_ASSERT(_bound.raw_render_pass != nullptr && "cmd::set_scissor must occur inside of a render pass");
+
+    VkRect2D scissor_rect;
+    scissor_rect.offset = VkOffset2D{scissor_cmd.scissor.min.x, scissor_cmd.scissor.min.y};
+    scissor_rect.extent = VkExtent2D{uint32_t(scissor_cmd.scissor.max.x - scissor_cmd.scissor.min.x), uint32_t(scissor_cmd.scissor.max.y - scissor_cmd.scissor.min.y)};
+    vkCmdSetScissor(_cmd_list, 0, 1, &scissor_rect);
+}
+
+void phi::vk::command_list_translator::execute(const phi::cmd::draw_only& draw)
+{
+    CC_ASSERT(_bound.raw_render_pass != nullptr && "cmd::draw_only must occur inside of a render pass");
+    CC_ASSERT(_bound.pipeline_state.is_valid() && !_bound.is_compute && "cmd::draw_only requires a previous graphics cmd::set_pipeline_state");
+
+    if (_bound.index_buffer.is_valid())
+    {
+        vkCmdDrawIndexed(_cmd_list, draw.num_indices, draw.num_instances, draw.index_offset, draw.vertex_offset, 0);
+    }
+    else
+    {
+        vkCmdDraw(_cmd_list, draw.num_indices, draw.num_instances, draw.index_offset, 0);
+    }
+}
+
+void phi::vk::command_list_translator::execute(const phi::cmd::dispatch_only& dispatch)
+{
+    CC_ASSERT(_bound.pipeline_state.is_valid() && _bound.is_compute && "cmd::dispatch_only requires a previous compute cmd::set_pipeline_state");
+
+    vkCmdDispatch(_cmd_list, dispatch.dispatch_x, dispatch.dispatch_y, dispatch.dispatch_z);
+}
+
 void phi::vk::command_list_translator::execute(const phi::cmd::end_render_pass&)
 {
     CC_ASSERT(_bound.raw_render_pass != nullptr && "cmd::end_render_pass while no render pass is active");
@@ -489,6 +722,45 @@ void phi::vk::command_list_translator::execute(const phi::cmd::barrier_uav&)
     vkCmdPipelineBarrier(_cmd_list, src_stage, dst_stage, 0, 1u, &desc, 0, nullptr, 0, nullptr);
 }
 
+void phi::vk::command_list_translator::execute(const phi::cmd::barrier_aliasing& barrier)
+{
+    CC_ASSERT(_bound.raw_render_pass == nullptr && "Vulkan aliasing barriers must not occur during render passes");
+
+    barrier_bundle<limits::max_resource_transitions, limits::max_resource_transitions, 1> barriers;
+
+    for (auto const& activation : barrier.resources)
+    {
+        auto const after_dep = util::to_pipeline_stage_dependency(activation.target_state, util::to_pipeline_stage_flags_bitwise(activation.dependent_shaders));
+        CC_ASSERT(after_dep != 0 && "Transition shader dependencies must be specified if transitioning to a CBV/SRV/UAV");
+
+        _state_cache->activate_resource(activation.resource, activation.target_state, after_dep);
+
+        // the previous contents are discarded, always transition from undefined
+        state_change const change = state_change(resource_state::undefined, activation.target_state, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, after_dep);
+
+        if (_globals.pool_resources->isImage(activation.resource))
+        {
+            auto const& img_info = _globals.pool_resources->getImageInfo(activation.resource);
+            barriers.add_image_barrier(img_info.raw_image, change, util::to_native_image_aspect(img_info.pixel_format));
+        }
+        else
+        {
+            auto const& buf_info = _globals.pool_resources->getBufferInfo(activation.resource);
+            barriers.add_buffer_barrier(buf_info.raw_buffer, change, buf_info.width);
+        }
+    }
+
+    // wait on all previous work, any of it might have used the shared memory through another resource
+    VkMemoryBarrier& mem_barrier = barriers.barriers_mem.emplace_back();
+    mem_barrier = {};
+    mem_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    mem_barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    mem_barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    barriers.dependencies.stages_before |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+    barriers.record(_cmd_list);
+}
+
 void phi::vk::command_list_translator::execute(const phi::cmd::copy_buffer& copy_buf)
 {
     CC_ASSERT(_globals.pool_resources->isBufferAccessInBounds(copy_buf.source, copy_buf.source_offset_bytes, copy_buf.size) && "copy_buffer source OOB");
@@ -598,11 +870,7 @@ void phi::vk::command_list_translator::execute(const phi::cmd::write_timestamp&
     VkQueryPool pool;
     uint32_t const query_index = _globals.pool_queries->getQuery(timestamp.query_range, query_type::timestamp, timestamp.index, pool);
 
-    // NOTE: this is likely wildly inefficient on some non-desktop IHV, revisit when necessary
-    // it could be moved to the tail of cmd::resolve_queries without breaking API, which would at least reset in ranges > 1
-    // however then we'd need an initial command list resetting all queries on backend launch, skipping that for now
-    vkCmdResetQueryPool(_cmd_list, pool, query_index, 1);
-
+    // queries are reset outside of render passes, see reset_timestamp_queries
     vkCmdWriteTimestamp(_cmd_list, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool, query_index);
 }
 
@@ -725,6 +993,7 @@ void phi::vk::command_list_translator::execute(const cmd::dispatch_rays& dispatc
 {
     auto const& pso_node = _globals.pool_pipeline_states->get(dispatch_rays.pso);
 
+    _bound.is_compute = false; // raytracing bind point, cmd::dispatch_only requires a new compute cmd::set_pipeline_state
     if (_bound.update_pso(dispatch_rays.pso))
     {
         _bound.update_pipeline_layout(pso_node.associated_pipeline_layout->raw_layout);
@@ -815,18 +1084,19 @@ void phi::vk::command_list_translator::bind_vertex_buffers(handle::resource cons
 void phi::vk::command_list_translator::bind_shader_arguments(phi::handle::pipeline_state pso,
                                                              const std::byte* root_consts,
                                                              cc::span<const phi::shader_argument> shader_args,
-                                                             VkPipelineBindPoint bind_point)
+                                                             VkPipelineBindPoint bind_point,
+                                                             uint32_t root_consts_size)
 {
     auto const& pso_node = _globals.pool_pipeline_states->get(pso);
     pipeline_layout const& pipeline_layout = *pso_node.associated_pipeline_layout;
 
-    if (pipeline_layout.has_push_constants())
+    if (pipeline_layout.has_push_constants() && root_consts_size > 0)
     {
         static_assert(sizeof(cmd::draw::root_constants) == sizeof(std::byte[limits::max_root_constant_bytes]), "root constants have wrong size");
         static_assert(sizeof(cmd::draw::root_constants) == sizeof(cmd::dispatch::root_constants), "root constants have wrong size");
+        CC_ASSERT(root_consts_size <= limits::max_root_constant_bytes && "root constants too large");
 
-        vkCmdPushConstants(_cmd_list, pipeline_layout.raw_layout, pipeline_layout.push_constant_stages, 0,
-                           sizeof(std::byte[limits::max_root_constant_bytes]), root_consts);
+        vkCmdPushConstants(_cmd_list, pipeline_layout.raw_layout, pipeline_layout.push_constant_stages, 0, root_consts_size, root_consts);
     }
 
     for (uint8_t i = 0; i < shader_args.size(); ++i)
@@ -860,6 +1130,19 @@ void phi::vk::command_list_translator::bind_shader_arguments(phi::handle::pipeli
     }
 }
 
+void phi::vk::command_list_translator::bind_index_buffer(phi::handle::resource index_buffer)
+{
+    if (index_buffer != _bound.index_buffer)
+    {
+        _bound.index_buffer = index_buffer;
+        if (index_buffer.is_valid())
+        {
+            auto const& ind_buf_info = _globals.pool_resources->getBufferInfo(index_buffer);
+            vkCmdBindIndexBuffer(_cmd_list, ind_buf_info.raw_buffer, 0, (ind_buf_info.stride == 4) ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16);
+        }
+    }
+}
+
 VkBuffer phi::vk::command_list_translator::get_buffer_or_null(phi::handle::resource buf) const
 {
     if (!buf.is_valid())
@@ -867,3 +1150,105 @@ VkBuffer phi::vk::command_list_translator::get_buffer_or_null(phi::handle::resou
 
     return _globals.pool_resources->getRawBuffer(buf);
 }
+
+void phi::vk::command_list_translator::reset_timestamp_queries(cc::span<command_stream_chunk const> chunks)
+{
+    _timestamp_writes.clear();
+    _timestamp_query_indices.clear();
+    _repeated_timestamp_resets.clear();
+    _next_repeated_timestamp_reset = 0;
+
+    // all timestamp query ranges live in the same pool
+    _timestamp_pool = nullptr;
+
+    // the open render pass and its ordinal, writes within the same render pass cannot be separated by a reset
+    cmd::detail::cmd_base const* begin_rp = nullptr;
+    uint32_t num_render_passes = 0;
+
+    for (command_stream_chunk const& chunk : chunks)
+    {
+        command_stream_parser parser(chunk.buffer, chunk.size);
+        for (auto const& cmd : parser)
+        {
+            switch (cmd.s_internal_type)
+            {
+            case cmd::detail::cmd_type::begin_render_pass:
+                begin_rp = &cmd;
+                ++num_render_passes;
+                break;
+            case cmd::detail::cmd_type::end_render_pass:
+                begin_rp = nullptr;
+                break;
+            case cmd::detail::cmd_type::write_timestamp:
+            {
+                auto const& timestamp = static_cast<cmd::write_timestamp const&>(cmd);
+
+                timestamp_write& write = _timestamp_writes.emplace_back();
+                write.stream_order = uint32_t(_timestamp_writes.size() - 1);
+                write.query_index = _globals.pool_queries->getQuery(timestamp.query_range, query_type::timestamp, timestamp.index, _timestamp_pool);
+                write.render_pass = begin_rp != nullptr ? num_render_passes : 0;
+                write.reset_point = begin_rp != nullptr ? begin_rp : &cmd;
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+
+    if (_timestamp_writes.empty())
+        return;
+
+    // group writes by query, stable to keep the stream order within each group
+    std::stable_sort(_timestamp_writes.begin(), _timestamp_writes.end(),
+                     [](timestamp_write const& lhs, timestamp_write const& rhs) { return lhs.query_index < rhs.query_index; });
+
+    for (auto i = 0u; i < _timestamp_writes.size(); ++i)
+    {
+        timestamp_write const& write = _timestamp_writes[i];
+
+        if (i == 0 || _timestamp_writes[i - 1].query_index != write.query_index)
+        {
+            // first write of this query, reset up front
+            _timestamp_query_indices.push_back(write.query_index);
+            continue;
+        }
+
+        // written again, reset after the previous write at the nearest point outside of a render pass
+        CC_ASSERT((write.render_pass == 0 || write.render_pass != _timestamp_writes[i - 1].render_pass)
+                  && "a timestamp query cannot be written more than once within the same render pass");
+
+        _repeated_timestamp_resets.push_back({write.reset_point, write.query_index, write.stream_order});
+    }
+
+    // the grouping reordered the writes, restore the stream order of their reset points
+    std::sort(_repeated_timestamp_resets.begin(), _repeated_timestamp_resets.end(),
+              [](repeated_timestamp_reset const& lhs, repeated_timestamp_reset const& rhs) { return lhs.stream_order < rhs.stream_order; });
+
+    // coalesce consecutive indices into one reset each
+    uint32_t range_start = _timestamp_query_indices[0];
+    uint32_t range_end = range_start + 1;
+    for (auto i = 1u; i < _timestamp_query_indices.size(); ++i)
+    {
+        uint32_t const index = _timestamp_query_indices[i];
+        if (index != range_end)
+        {
+            vkCmdResetQueryPool(_cmd_list, _timestamp_pool, range_start, range_end - range_start);
+            range_start = index;
+        }
+
+        range_end = index + 1;
+    }
+
+    vkCmdResetQueryPool(_cmd_list, _timestamp_pool, range_start, range_end - range_start);
+}
+
+void phi::vk::command_list_translator::reset_repeated_timestamp_queries(cmd::detail::cmd_base const& next_cmd)
+{
+    while (_next_repeated_timestamp_reset < _repeated_timestamp_resets.size()
+           && _repeated_timestamp_resets[_next_repeated_timestamp_reset].reset_point == &next_cmd)
+    {
+        vkCmdResetQueryPool(_cmd_list, _timestamp_pool, _repeated_timestamp_resets[_next_repeated_timestamp_reset].query_index, 1);
+        ++_next_repeated_timestamp_reset;
+    }
+}
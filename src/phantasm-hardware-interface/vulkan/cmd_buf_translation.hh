@@ -1,11 +1,13 @@
 #pragma once
 
 #include <clean-core/array.hh>
+#include <clean-core/vector.hh>
 
 #include <phantasm-hardware-interface/commands.hh>
 
 #include <phantasm-hardware-interface/vulkan/common/vk_incomplete_state_cache.hh>
 #include <phantasm-hardware-interface/vulkan/loader/volk.hh>
+#include <phantasm-hardware-interface/vulkan/pools/render_pass_cache.hh>
 
 #ifdef PHI_HAS_OPTICK
 namespace Optick
@@ -22,6 +24,9 @@ class PipelinePool;
 class CommandListPool;
 class AccelStructPool;
 class QueryPool;
+class FramebufferCache;
+struct parallel_translation_plan;
+struct split_render_pass;
 
 struct translator_global_memory
 {
@@ -32,6 +37,7 @@ struct translator_global_memory
                     CommandListPool* cmd_pool,
                     QueryPool* query_pool,
                     AccelStructPool* as_pool,
+                    FramebufferCache* fb_cache,
                     bool has_rt)
     {
         this->device = device;
@@ -41,6 +47,7 @@ struct translator_global_memory
         this->pool_cmd_lists = cmd_pool;
         this->pool_queries = query_pool;
         this->pool_accel_structs = as_pool;
+        this->framebuffer_cache = fb_cache;
         this->has_raytracing = has_rt;
     }
 
@@ -51,6 +58,7 @@ struct translator_global_memory
     CommandListPool* pool_cmd_lists = nullptr;
     QueryPool* pool_queries = nullptr;
     AccelStructPool* pool_accel_structs = nullptr;
+    FramebufferCache* framebuffer_cache = nullptr;
     bool has_raytracing = false;
 
     translator_global_memory() = default;
@@ -66,12 +74,31 @@ struct command_list_translator
                     CommandListPool* cmd_pool,
                     QueryPool* query_pool,
                     AccelStructPool* as_pool,
+                    FramebufferCache* fb_cache,
                     bool has_rt)
     {
-        _globals.initialize(device, sv_pool, resource_pool, pso_pool, cmd_pool, query_pool, as_pool, has_rt);
+        _globals.initialize(device, sv_pool, resource_pool, pso_pool, cmd_pool, query_pool, as_pool, fb_cache, has_rt);
     }
 
-    void translateCommandList(VkCommandBuffer list, handle::command_list list_handle, vk_incomplete_state_cache* state_cache, std::byte const* buffer, size_t buffer_size);
+    /// translates a command stream into a primary command buffer
+    /// render passes contained in the optional split plan are translated into secondary command buffers in parallel
+    void translateCommandList(VkCommandBuffer list,
+                              handle::command_list list_handle,
+                              vk_incomplete_state_cache* state_cache,
+                              cc::span<command_stream_chunk const> chunks,
+                              parallel_translation_plan const* split_plan = nullptr);
+
+    /// translates a segment of a split render pass into a secondary command buffer,
+    /// which must have been begun as a continuation of the given render pass
+    void translateRenderPassSegment(VkCommandBuffer list,
+                                    handle::command_list primary_handle,
+                                    VkRenderPass render_pass,
+                                    VkFramebuffer framebuffer,
+                                    parallel_translation_plan const& plan,
+                                    split_render_pass const& split_rp,
+                                    uint32_t segment_index);
+
+    [[nodiscard]] uint64_t getNumLocalRenderPassHits() const { return _render_pass_cache.num_hits.load(std::memory_order_relaxed); }
 
     void execute(cmd::begin_render_pass const& begin_rp);
 
@@ -79,10 +106,24 @@ struct command_list_translator
 
     void execute(cmd::draw_indirect const& draw_indirect);
 
+    void execute(cmd::draw_batch const& batch);
+
     void execute(cmd::dispatch const& dispatch);
 
     void execute(cmd::dispatch_indirect const& dispatch_indirect);
 
+    void execute(cmd::set_pipeline_state const& set_pso);
+
+    void execute(cmd::set_shader_arguments const& set_args);
+
+    void execute(cmd::set_vertex_buffers const& set_buffers);
+
+    void execute(cmd::set_scissor const& scissor_cmd);
+
+    void execute(cmd::draw_only const& draw);
+
+    void execute(cmd::dispatch_only const& dispatch);
+
     void execute(cmd::end_render_pass const& end_rp);
 
     void execute(cmd::transition_resources const& transition_res);
@@ -91,6 +132,8 @@ struct command_list_translator
 
     void execute(cmd::barrier_uav const& barrier);
 
+    void execute(cmd::barrier_aliasing const& barrier);
+
     void execute(cmd::copy_buffer const& copy_buf);
 
     void execute(cmd::copy_texture const& copy_tex);
@@ -124,12 +167,31 @@ struct command_list_translator
     void execute(cmd::code_location_marker const& marker);
 
 private:
+    void begin_render_pass(cmd::begin_render_pass const& begin_rp, VkSubpassContents contents);
+
+    /// begins the render pass, translates its body in parallel and executes the resulting secondaries
+    void execute_split_render_pass(parallel_translation_plan const& plan, split_render_pass const& split_rp);
+
     void bind_vertex_buffers(handle::resource const vertex_buffers[limits::max_vertex_buffers]);
 
-    void bind_shader_arguments(handle::pipeline_state pso, std::byte const* root_consts, cc::span<shader_argument const> shader_args, VkPipelineBindPoint bind_point);
+    void bind_shader_arguments(handle::pipeline_state pso,
+                               std::byte const* root_consts,
+                               cc::span<shader_argument const> shader_args,
+                               VkPipelineBindPoint bind_point,
+                               uint32_t root_consts_size = limits::max_root_constant_bytes);
+
+    void bind_index_buffer(handle::resource index_buffer);
 
     VkBuffer get_buffer_or_null(handle::resource buf) const;
 
+    /// resets all timestamp queries written by the command stream (in all chunks), coalesced into ranges
+    /// repeated writes of a query are reset individually right before them, or before their render pass if inside one,
+    /// a query must not be written more than once within the same render pass
+    void reset_timestamp_queries(cc::span<command_stream_chunk const> chunks);
+
+    /// records the resets of repeated timestamp query writes which must precede the given command
+    void reset_repeated_timestamp_queries(cmd::detail::cmd_base const& next_cmd);
+
 private:
     // non-owning constant (global)
     translator_global_memory _globals;
@@ -139,12 +201,42 @@ private:
     VkCommandBuffer _cmd_list = nullptr;
     handle::command_list _cmd_list_handle = handle::null_command_list;
 
+    // persistent thread-local L1 of the render pass cache
+    RenderPassCache::thread_cache _render_pass_cache;
+
+    struct timestamp_write
+    {
+        uint32_t query_index;
+        uint32_t stream_order;
+        // 1-based ordinal of the enclosing render pass, 0 if outside of one
+        uint32_t render_pass;
+        // the command before which a repeated write is reset, the write itself or the begin of its render pass
+        cmd::detail::cmd_base const* reset_point;
+    };
+
+    struct repeated_timestamp_reset
+    {
+        cmd::detail::cmd_base const* reset_point;
+        uint32_t query_index;
+        uint32_t stream_order;
+    };
+
+    // persistent scratch memory for reset_timestamp_queries
+    cc::vector<timestamp_write> _timestamp_writes;
+    cc::vector<uint32_t> _timestamp_query_indices;
+
+    // resets of repeated timestamp query writes in stream order, recorded during translation
+    cc::vector<repeated_timestamp_reset> _repeated_timestamp_resets;
+    size_t _next_repeated_timestamp_reset = 0;
+    VkQueryPool _timestamp_pool = nullptr;
+
     // dynamic state
     struct
     {
         handle::pipeline_state pipeline_state = handle::null_pipeline_state;
         handle::resource index_buffer = handle::null_resource;
         uint64_t vertex_buffer_hash = uint64_t(-1);
+        bool is_compute = false; // bind point of the last command that set pipeline_state
 
         struct shader_arg_info
         {
@@ -195,6 +287,7 @@ private:
             pipeline_state = handle::null_pipeline_state;
             index_buffer = handle::null_resource;
             vertex_buffer_hash = uint64_t(-1);
+            is_compute = false;
 
             raw_render_pass = nullptr;
             raw_framebuffer = nullptr;
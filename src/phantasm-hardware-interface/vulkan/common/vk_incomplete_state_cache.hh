@@ -1,11 +1,10 @@
 #pragma once
 
-#include <clean-core/capped_vector.hh>
+#include <phantasm-hardware-interface/common/incomplete_state_cache.hh>
+#include <phantasm-hardware-interface/types.hh>
 
 #include <phantasm-hardware-interface/vulkan/loader/volk.hh>
 
-#include <phantasm-hardware-interface/types.hh>
-
 namespace phi::vk
 {
 struct vk_incomplete_state_cache
@@ -28,35 +27,46 @@ struct vk_incomplete_state_cache
     /// returns true if the before state is known, or false otherwise
     bool transition_resource(handle::resource res, resource_state after, VkPipelineStageFlags after_dependencies, resource_state& out_before, VkPipelineStageFlags& out_before_dependency)
     {
-        for (auto i = 0u; i < num_entries; ++i)
+        if (cache_entry* const entry = _storage.find(res))
         {
-            cache_entry& entry = entries[i];
-            if (entry.ptr == res)
-            {
-                // resource is in cache
-                out_before = entry.current;
-                out_before_dependency = entry.current_dependency;
-                entry.current = after;
-                entry.current_dependency = after_dependencies;
-                return true;
-            }
+            // resource is in cache
+            out_before = entry->current;
+            out_before_dependency = entry->current_dependency;
+            entry->current = after;
+            entry->current_dependency = after_dependencies;
+            return true;
         }
 
-        CC_ASSERT(num_entries < entries.size() && "state cache full, increase PHI config : max_num_unique_transitions_per_cmdlist");
-        entries[num_entries++] = {res, after, after, after_dependencies, after_dependencies};
+        _storage.insert({res, after, after, after_dependencies, after_dependencies});
         return false;
     }
 
-    void reset() { num_entries = 0; }
-
-    void initialize(cc::span<cache_entry> memory)
+    /// signal the activation of an aliased resource, which discards its previous state
+    /// if the resource is not yet in the cache, no initial barrier is required at submission (required_initial is undefined)
+    void activate_resource(handle::resource res, resource_state after, VkPipelineStageFlags after_dependencies)
     {
-        num_entries = 0;
-        entries = memory;
+        if (cache_entry* const entry = _storage.find(res))
+        {
+            entry->current = after;
+            entry->current_dependency = after_dependencies;
+            return;
+        }
+
+        _storage.insert({res, resource_state::undefined, after, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, after_dependencies});
     }
 
-    // linear map for now
-    unsigned num_entries = 0;
-    cc::span<cache_entry> entries;
+    void reset() { _storage.reset(); }
+
+    void initialize(cc::allocator* alloc, uint32_t initial_capacity) { _storage.initialize(alloc, initial_capacity); }
+    void destroy() { _storage.destroy(); }
+
+    /// returns true if the resource was transitioned in this cache
+    [[nodiscard]] bool contains(handle::resource res) const { return _storage.contains(res); }
+
+    [[nodiscard]] uint32_t num_entries() const { return _storage.num_entries; }
+    [[nodiscard]] cache_entry const& get_entry(uint32_t i) const { return _storage.entries[i]; }
+
+private:
+    phi::detail::generic_incomplete_state_cache<cache_entry> _storage;
 };
 }
@@ -246,7 +246,8 @@ phi::vk::LayerExtensionArray phi::vk::getUsedInstanceExtensions(const phi::vk::L
 phi::vk::LayerExtensionArray phi::vk::getUsedDeviceExtensions(const phi::vk::LayerExtensionSet& available,
                                                               const phi::backend_config& config,
                                                               bool& outHasRaytracing,
-                                                              bool& outHasConservativeRaster)
+                                                              bool& outHasConservativeRaster,
+                                                              bool& outHasMemoryBudget)
 {
     LayerExtensionArray used_res;
 
@@ -295,6 +296,15 @@ phi::vk::LayerExtensionArray phi::vk::getUsedDeviceExtensions(const phi::vk::Lay
         outHasConservativeRaster = true;
     }
 
+    // VK_EXT_memory_budget
+    // https://www.khronos.org/registry/vulkan/specs/1.2-extensions/man/html/VK_EXT_memory_budget.html
+    // precise per-heap budget and usage for Backend::getVRAMInfo
+    outHasMemoryBudget = false;
+    if (f_add_ext(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+    {
+        outHasMemoryBudget = true;
+    }
+
     outHasRaytracing = false;
     if (config.enable_raytracing)
     {
@@ -40,6 +40,6 @@ LayerExtensionSet getAvailableInstanceExtensions();
 LayerExtensionSet getAvailableDeviceExtensions(VkPhysicalDevice physical);
 
 LayerExtensionArray getUsedInstanceExtensions(LayerExtensionSet const& available, backend_config const& config);
-LayerExtensionArray getUsedDeviceExtensions(LayerExtensionSet const& available, backend_config const& config, bool& outHasRaytracing, bool& outHasConservativeRaster);
+LayerExtensionArray getUsedDeviceExtensions(LayerExtensionSet const& available, backend_config const& config, bool& outHasRaytracing, bool& outHasConservativeRaster, bool& outHasMemoryBudget);
 
 }
@@ -1,6 +1,7 @@
 #include "spirv_patch_util.hh"
 
 #include <cstdio>
+#include <cstring>
 
 #include <algorithm>
 #include <fstream>
@@ -168,7 +169,8 @@ void patchSpvReflectShader(SpvReflectShaderModule& module,
 }
 
 
-constexpr uint32_t gc_patched_spirv_binary_version = 0xDEAD0001;
+// 0002: entrypoint string is null-terminated
+constexpr uint32_t gc_patched_spirv_binary_version = 0xDEAD0002;
 } // namespace
 
 phi::vk::util::patched_spirv_stage phi::vk::util::create_patched_spirv(std::byte const* bytecode, size_t bytecode_size, spirv_refl_info& out_info, cc::allocator* scratch_alloc)
@@ -367,8 +369,8 @@ bool phi::vk::util::write_patched_spirv(const phi::vk::util::patched_spirv_stage
     outfile.write((char const*)&spirv.size, sizeof(spirv.size)); // size of patched SPIR-V
     outfile.write((char const*)spirv.data, spirv.size);          // patched SPIR-V
 
-    // write entrypoint string
-    size_t const entrypoint_size = spirv.entrypoint_name.size();
+    // write entrypoint string, including the null terminator
+    size_t const entrypoint_size = spirv.entrypoint_name.size() + 1;
     outfile.write((char const*)&entrypoint_size, sizeof(entrypoint_size)); // size of entrypoint string
     outfile.write(spirv.entrypoint_name.c_str(), entrypoint_size);         // entrypoint string
 
@@ -391,36 +393,97 @@ bool phi::vk::util::parse_patched_spirv(cc::span<const std::byte> data, phi::vk:
     if (data.empty())
         return false;
 
+    // the data can be any user-provided binary, every read is bounds-checked at runtime (byte_reader only asserts)
     auto reader = byte_reader{data};
 
     uint32_t version_number = 0;
+    if (reader.size_left() < sizeof(version_number))
+        return false;
     reader.read_t(version_number);
 
     if (version_number != gc_patched_spirv_binary_version)
         return false;
 
     // read patched SPIR-V
+    if (reader.size_left() < sizeof(out_parsed.binary_size_bytes))
+        return false;
     reader.read_t(out_parsed.binary_size_bytes);
+    if (out_parsed.binary_size_bytes == 0 || reader.size_left() < out_parsed.binary_size_bytes)
+        return false;
     out_parsed.binary_data = reader.head();
     reader.skip(out_parsed.binary_size_bytes);
 
-    // read entrypoint string
+    // read entrypoint string, which must be null-terminated
     size_t string_length = 0;
+    if (reader.size_left() < sizeof(string_length))
+        return false;
     reader.read_t(string_length);
+    if (string_length == 0 || reader.size_left() < string_length || reader.head()[string_length - 1] != std::byte{0})
+        return false;
     out_parsed.entrypoint_name = reinterpret_cast<char const*>(reader.head());
     reader.skip(string_length);
 
     // read shader stage
+    if (reader.size_left() < sizeof(out_parsed.stage))
+        return false;
     reader.read_t(out_parsed.stage);
 
     // read descriptor infos
     size_t num_descriptor_infos = 0u;
+    if (reader.size_left() < sizeof(num_descriptor_infos))
+        return false;
     reader.read_t(num_descriptor_infos);
+    if (num_descriptor_infos > reader.size_left() / sizeof(spirv_desc_info))
+        return false;
     out_parsed.descriptor_infos = {reinterpret_cast<spirv_desc_info const*>(reader.head()), num_descriptor_infos};
     reader.skip(out_parsed.descriptor_infos.size_bytes());
 
     // read root constant flag
+    if (reader.size_left() < sizeof(out_parsed.has_root_constants))
+        return false;
     reader.read_t(out_parsed.has_root_constants);
 
     return true;
 }
+
+bool phi::vk::util::is_patched_spirv_container(std::byte const* data, size_t size)
+{
+    if (size < sizeof(gc_patched_spirv_binary_version))
+        return false;
+
+    uint32_t version_number = 0;
+    std::memcpy(&version_number, data, sizeof(version_number));
+    return version_number == gc_patched_spirv_binary_version;
+}
+
+phi::vk::util::patched_spirv_stage phi::vk::util::use_patched_spirv_container(std::byte const* data, size_t size, phi::vk::util::spirv_refl_info& out_info)
+{
+    patched_spirv_data_nonowning parsed;
+    if (!parse_patched_spirv({data, size}, parsed))
+    {
+        PHI_LOG_ERROR("invalid or truncated patched SPIR-V container ({} bytes)", size);
+        return {};
+    }
+
+    patched_spirv_stage res;
+    res.data = const_cast<std::byte*>(parsed.binary_data);
+    res.size = parsed.binary_size_bytes;
+    res.stage = parsed.stage;
+    res.entrypoint_name = parsed.entrypoint_name;
+
+    for (auto i = 0u; i < parsed.descriptor_infos.size(); ++i)
+    {
+        // the descriptor infos in the container are not necessarily aligned
+        spirv_desc_info info;
+        std::memcpy(&info, reinterpret_cast<std::byte const*>(parsed.descriptor_infos.data()) + i * sizeof(spirv_desc_info), sizeof(info));
+
+        // undo the CBV conversion of merge_spirv_descriptors, it is applied again when merging with the other stages
+        if (info.set >= limits::max_shader_arguments && info.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+            info.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+        out_info.descriptor_infos.push_back(info);
+    }
+
+    out_info.has_push_constants = out_info.has_push_constants || parsed.has_root_constants;
+    return res;
+}
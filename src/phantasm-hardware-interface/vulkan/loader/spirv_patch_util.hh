@@ -7,6 +7,7 @@
 #include <clean-core/string.hh>
 
 #include <phantasm-hardware-interface/arguments.hh>
+#include <phantasm-hardware-interface/common/api.hh>
 #include <phantasm-hardware-interface/limits.hh>
 #include <phantasm-hardware-interface/types.hh>
 
@@ -43,8 +44,8 @@ enum spv_constants_e : uint32_t
     // (this is required as there are no "root descriptors" in vulkan)
 
     // Unlike the binding offsets, these set shifts cannot be caused by DXC and must be patched post-compile
-    // (currently always online, but this would eventually be part of asset bake)
-    // this is currently done using spirv-reflect, see loader/spirv_patch_util for details
+    // this is done using spirv-reflect, see loader/spirv_patch_util for details
+    // either online during PSO creation, or offline using the phi-spirv-bake tool which writes the patched container (see write_patched_spirv)
 };
 }
 
@@ -85,12 +86,12 @@ struct patched_spirv_stage
 // we have to shift all CBVs up by [max num shader args] sets to make our API work in vulkan
 // unlike the register-to-binding shift with -fvk-[x]-shift, this cannot be done with DXC flags
 // instead we provide these helpers which use the spirv-reflect library to do the same
-[[nodiscard]] patched_spirv_stage create_patched_spirv(std::byte const* bytecode, size_t bytecode_size, spirv_refl_info& out_info, cc::allocator* scratch_alloc);
+[[nodiscard]] PHI_API patched_spirv_stage create_patched_spirv(std::byte const* bytecode, size_t bytecode_size, spirv_refl_info& out_info, cc::allocator* scratch_alloc);
 
-void free_patched_spirv(patched_spirv_stage const& val);
+PHI_API void free_patched_spirv(patched_spirv_stage const& val);
 
 // merge descriptor infos per entrypoint into a sorted, deduplicated list, with visiblity flags OR-d together per descriptor
-cc::alloc_vector<spirv_desc_info> merge_spirv_descriptors(cc::span<spirv_desc_info> desc_infos, cc::allocator* alloc);
+PHI_API cc::alloc_vector<spirv_desc_info> merge_spirv_descriptors(cc::span<spirv_desc_info> desc_infos, cc::allocator* alloc);
 
 void print_spirv_info(cc::span<spirv_desc_info const> info);
 
@@ -100,7 +101,7 @@ void warnIfReflectionIsIncosistent(cc::span<spirv_desc_info const> reflected_des
 //
 // serialization of fully processed SPIR-V
 
-bool write_patched_spirv(patched_spirv_stage const& spirv, cc::span<spirv_desc_info const> merged_descriptor_info, bool has_root_consts, char const* out_path);
+PHI_API bool write_patched_spirv(patched_spirv_stage const& spirv, cc::span<spirv_desc_info const> merged_descriptor_info, bool has_root_consts, char const* out_path);
 
 struct patched_spirv_data_nonowning
 {
@@ -112,6 +113,16 @@ struct patched_spirv_data_nonowning
     bool has_root_constants;
 };
 
-bool parse_patched_spirv(cc::span<std::byte const> data, patched_spirv_data_nonowning& out_parsed);
+// returns false if the data is not a valid container, all reads are bounds-checked
+PHI_API bool parse_patched_spirv(cc::span<std::byte const> data, patched_spirv_data_nonowning& out_parsed);
+
+// whether the binary is a container written by write_patched_spirv instead of plain SPIR-V
+[[nodiscard]] PHI_API bool is_patched_spirv_container(std::byte const* data, size_t size);
+
+// the fast path for pre-patched containers, skipping spirv-reflect entirely
+// the returned stage points into data and must not be freed
+// appends the descriptor infos in their unmerged form, so they can be merged with those of other stages
+// returns a stage with data == nullptr if the container is invalid
+[[nodiscard]] PHI_API patched_spirv_stage use_patched_spirv_container(std::byte const* data, size_t size, spirv_refl_info& out_info);
 
 }
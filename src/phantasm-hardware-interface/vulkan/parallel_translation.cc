@@ -0,0 +1,450 @@
+#include "parallel_translation.hh"
+
+#include <chrono>
+#include <thread>
+
+#include <clean-core/allocator.hh>
+#include <clean-core/capped_vector.hh>
+#include <clean-core/utility.hh>
+
+#include <phantasm-hardware-interface/common/command_reading.hh>
+
+#include "cmd_buf_translation.hh"
+#include "pools/cmd_list_pool.hh"
+
+namespace phi::vk
+{
+struct ParallelCommandTranslator::worker
+{
+    command_list_translator translator;
+    CommandAllocatorBundle secondaryAllocator;
+    std::thread thread;
+};
+} // namespace phi::vk
+
+namespace
+{
+VkRect2D get_vk_rect(tg::iaabb2 const& rect)
+{
+    VkRect2D res;
+    res.offset = VkOffset2D{rect.min.x, rect.min.y};
+    res.extent = VkExtent2D{uint32_t(rect.max.x - rect.min.x), uint32_t(rect.max.y - rect.min.y)};
+    return res;
+}
+
+struct stream_position
+{
+    uint32_t chunk_index = 0;
+    uint32_t offset = 0;
+};
+
+void add_segment_pieces(cc::span<phi::command_stream_chunk const> chunks, stream_position begin, stream_position end, phi::vk::parallel_translation_plan& plan)
+{
+    for (auto chunk_i = begin.chunk_index; chunk_i <= end.chunk_index && chunk_i < chunks.size(); ++chunk_i)
+    {
+        size_t const piece_begin = chunk_i == begin.chunk_index ? begin.offset : 0;
+        size_t const piece_end = chunk_i == end.chunk_index ? end.offset : chunks[chunk_i].size;
+
+        if (piece_end > piece_begin)
+            plan.pieces.push_back(phi::command_stream_chunk{chunks[chunk_i].buffer + piece_begin, piece_end - piece_begin});
+    }
+}
+}
+
+void phi::vk::ParallelCommandTranslator::initialize(VkDevice device,
+                                                    uint32_t num_workers,
+                                                    uint32_t min_draws_per_render_pass,
+                                                    ShaderViewPool* sv_pool,
+                                                    ResourcePool* resource_pool,
+                                                    PipelinePool* pso_pool,
+                                                    CommandListPool* cmd_pool,
+                                                    QueryPool* query_pool,
+                                                    AccelStructPool* as_pool,
+                                                    FramebufferCache* fb_cache,
+                                                    bool has_rt,
+                                                    cc::allocator* static_alloc)
+{
+    CC_ASSERT(mWorkers == nullptr && "double init");
+
+    mDevice = device;
+    mPoolCmdLists = cmd_pool;
+    mMinDrawsPerRenderPass = cc::max(min_draws_per_render_pass, 1u);
+
+    // the recording thread translates one segment itself, a single worker already splits render passes in two
+    mNumWorkers = cc::min(num_workers, max_num_workers);
+    if (mNumWorkers == 0)
+        return;
+
+    mWorkerAlloc = static_alloc;
+    mWorkers = static_alloc->new_array_sized<worker>(mNumWorkers);
+    mJobs.reserve(max_num_workers * 4);
+
+    for (auto i = 0u; i < mNumWorkers; ++i)
+    {
+        mWorkers[i].translator.initialize(device, sv_pool, resource_pool, pso_pool, cmd_pool, query_pool, as_pool, fb_cache, has_rt);
+    }
+
+    // the workers only touch their allocators once jobs arrive, which is after the CommandListPool initialized them
+    for (auto i = 0u; i < mNumWorkers; ++i)
+    {
+        mWorkers[i].thread = std::thread([this, i] { workerMain(i); });
+    }
+}
+
+void phi::vk::ParallelCommandTranslator::stopWorkers()
+{
+    if (mNumWorkers == 0)
+        return;
+
+    {
+        auto lg = std::lock_guard(mMutex);
+        mIsShuttingDown = true;
+    }
+    mCVJobs.notify_all();
+
+    for (auto i = 0u; i < mNumWorkers; ++i)
+    {
+        if (mWorkers[i].thread.joinable())
+            mWorkers[i].thread.join();
+    }
+}
+
+void phi::vk::ParallelCommandTranslator::destroy(VkDevice device)
+{
+    if (mWorkers == nullptr)
+        return;
+
+    for (auto i = 0u; i < mNumWorkers; ++i)
+    {
+        CC_ASSERT(!mWorkers[i].thread.joinable() && "stopWorkers must be called before destroy");
+        mWorkers[i].secondaryAllocator.destroy(device);
+    }
+
+    mWorkerAlloc->delete_array_sized(mWorkers, mNumWorkers);
+    mWorkers = nullptr;
+    mNumWorkers = 0;
+}
+
+phi::vk::CommandAllocatorBundle* phi::vk::ParallelCommandTranslator::getWorkerAllocator(uint32_t worker_index)
+{
+    CC_ASSERT(worker_index < mNumWorkers && "worker index out of bounds");
+    return &mWorkers[worker_index].secondaryAllocator;
+}
+
+bool phi::vk::ParallelCommandTranslator::planSplits(cc::span<command_stream_chunk const> chunks, parallel_translation_plan& out_plan)
+{
+    out_plan.clear();
+    out_plan.translator = this;
+
+    // state of the currently open render pass
+    cmd::begin_render_pass const* begin_rp = nullptr;
+    stream_position body_start;
+    uint32_t num_draws = 0;
+    int label_depth = 0;
+    bool is_splittable = true;
+    VkRect2D scissor = {};
+
+    auto f_close_render_pass = [&](cmd::detail::cmd_base const* end_cmd, stream_position body_end) {
+        if (!is_splittable || label_depth != 0 || num_draws < mMinDrawsPerRenderPass)
+            return;
+
+        uint32_t const num_target_segments = mNumWorkers + 1;
+
+        // choose the split points closest to equal amounts of draws per segment
+        cc::capped_vector<uint32_t, max_num_workers> cuts;
+        uint32_t num_draws_at_last_cut = 0;
+        for (auto i = 0u; i < out_plan.candidates.size() && cuts.size() + 1 < num_target_segments; ++i)
+        {
+            auto const& candidate = out_plan.candidates[i];
+            uint64_t const boundary = uint64_t(cuts.size() + 1) * num_draws;
+
+            if (candidate.num_draws_before > num_draws_at_last_cut && uint64_t(candidate.num_draws_before) * num_target_segments >= boundary)
+            {
+                cuts.push_back(i);
+                num_draws_at_last_cut = candidate.num_draws_before;
+            }
+        }
+
+        if (cuts.empty())
+            return;
+
+        split_render_pass& rp = out_plan.render_passes.emplace_back();
+        rp.begin_cmd = begin_rp;
+        rp.end_cmd = end_cmd;
+        rp.first_segment = uint32_t(out_plan.segments.size());
+        rp.num_segments = uint32_t(cuts.size()) + 1;
+
+        rp.viewport.x = float(begin_rp->viewport_offset.x);
+        rp.viewport.y = float(begin_rp->viewport_offset.y);
+        rp.viewport.width = float(begin_rp->viewport.width);
+        rp.viewport.height = float(begin_rp->viewport.height);
+        rp.viewport.minDepth = 0.0f;
+        rp.viewport.maxDepth = 1.0f;
+
+        stream_position segment_start = body_start;
+        VkRect2D segment_scissor = {};
+        segment_scissor.extent.width = unsigned(begin_rp->viewport.width + begin_rp->viewport_offset.x);
+        segment_scissor.extent.height = unsigned(begin_rp->viewport.height + begin_rp->viewport_offset.y);
+
+        for (auto i = 0u; i < rp.num_segments; ++i)
+        {
+            stream_position segment_end = body_end;
+            if (i < cuts.size())
+            {
+                auto const& cut = out_plan.candidates[cuts[i]];
+                segment_end = {cut.chunk_index, cut.offset};
+            }
+
+            render_pass_segment& segment = out_plan.segments.emplace_back();
+            segment.first_piece = uint32_t(out_plan.pieces.size());
+            segment.scissor = segment_scissor;
+            add_segment_pieces(chunks, segment_start, segment_end, out_plan);
+            segment.num_pieces = uint32_t(out_plan.pieces.size()) - segment.first_piece;
+
+            if (i < cuts.size())
+            {
+                segment_start = segment_end;
+                segment_scissor = out_plan.candidates[cuts[i]].scissor;
+            }
+        }
+    };
+
+    for (auto chunk_i = 0u; chunk_i < chunks.size(); ++chunk_i)
+    {
+        command_stream_chunk const& chunk = chunks[chunk_i];
+        command_stream_parser parser(chunk.buffer, chunk.size);
+
+        for (auto const& cmd : parser)
+        {
+            auto const offset = uint32_t(reinterpret_cast<std::byte const*>(&cmd) - chunk.buffer);
+
+            if (begin_rp == nullptr)
+            {
+                if (cmd.s_internal_type == cmd::detail::cmd_type::begin_render_pass)
+                {
+                    begin_rp = static_cast<cmd::begin_render_pass const*>(&cmd);
+                    body_start = {chunk_i, offset + uint32_t(cmd::detail::get_command_size(cmd))};
+                    num_draws = 0;
+                    label_depth = 0;
+                    is_splittable = true;
+                    out_plan.candidates.clear();
+
+                    scissor = {};
+                    scissor.extent.width = unsigned(begin_rp->viewport.width + begin_rp->viewport_offset.x);
+                    scissor.extent.height = unsigned(begin_rp->viewport.height + begin_rp->viewport_offset.y);
+                }
+
+                continue;
+            }
+
+            // split points are only placed before self-contained draws, outside of debug labels
+            auto const f_add_candidate = [&] {
+                if (label_depth == 0)
+                    out_plan.candidates.push_back({chunk_i, offset, num_draws, scissor});
+            };
+
+            switch (cmd.s_internal_type)
+            {
+            case cmd::detail::cmd_type::draw:
+            {
+                auto const& draw = static_cast<cmd::draw const&>(cmd);
+                f_add_candidate();
+                ++num_draws;
+
+                if (draw.scissor.min.x != -1)
+                    scissor = get_vk_rect(draw.scissor);
+                break;
+            }
+            case cmd::detail::cmd_type::draw_indirect:
+                f_add_candidate();
+                ++num_draws;
+                break;
+            case cmd::detail::cmd_type::draw_batch:
+                f_add_candidate();
+                num_draws += static_cast<cmd::draw_batch const&>(cmd).num_records;
+                break;
+            case cmd::detail::cmd_type::draw_only:
+                ++num_draws;
+                break;
+            case cmd::detail::cmd_type::set_scissor:
+                scissor = get_vk_rect(static_cast<cmd::set_scissor const&>(cmd).scissor);
+                break;
+            case cmd::detail::cmd_type::begin_debug_label:
+                ++label_depth;
+                break;
+            case cmd::detail::cmd_type::end_debug_label:
+                // labels opened before the render pass cannot be closed in a secondary
+                if (--label_depth < 0)
+                    is_splittable = false;
+                break;
+            case cmd::detail::cmd_type::begin_profile_scope:
+            case cmd::detail::cmd_type::end_profile_scope:
+                // profiler GPU events are tied to the primary command buffer
+                is_splittable = false;
+                break;
+            case cmd::detail::cmd_type::end_render_pass:
+                f_close_render_pass(&cmd, {chunk_i, offset});
+                begin_rp = nullptr;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    // a render pass left open is closed at the end of the list
+    if (begin_rp != nullptr && !chunks.empty())
+    {
+        auto const last_chunk = uint32_t(chunks.size()) - 1;
+        f_close_render_pass(nullptr, {last_chunk, uint32_t(chunks[last_chunk].size)});
+    }
+
+    return !out_plan.render_passes.empty();
+}
+
+void phi::vk::ParallelCommandTranslator::translateSegments(parallel_translation_plan const& plan,
+                                                           split_render_pass const& render_pass,
+                                                           VkRenderPass raw_render_pass,
+                                                           VkFramebuffer raw_framebuffer,
+                                                           handle::command_list primary,
+                                                           VkCommandBuffer* out_buffers)
+{
+    CC_ASSERT(render_pass.num_segments <= max_num_segments && "too many segments");
+    CC_ASSERT(plan.caller_translator != nullptr && plan.caller_allocator != nullptr && "plan without caller resources");
+
+    VkCommandBufferInheritanceInfo inheritance = {};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = raw_render_pass;
+    inheritance.subpass = 0;
+    inheritance.framebuffer = raw_framebuffer;
+
+    cmd_allocator_node* allocators[max_num_segments] = {};
+    render_pass_timing timing;
+    timing.num_segments = render_pass.num_segments;
+
+    // the first segment is translated by the calling thread
+    uint32_t num_pending = render_pass.num_segments - 1;
+
+    {
+        auto lg = std::lock_guard(mMutex);
+
+        for (auto i = 1u; i < render_pass.num_segments; ++i)
+        {
+            segment_job& job = mJobs.emplace_back();
+            job.plan = &plan;
+            job.render_pass = &render_pass;
+            job.segment_index = render_pass.first_segment + i;
+            job.inheritance = &inheritance;
+            job.primary = primary;
+            job.out_buffer = &out_buffers[i];
+            job.out_allocator = &allocators[i];
+            job.out_ms = &timing.segment_ms[i];
+            job.num_pending = &num_pending;
+        }
+    }
+    mCVJobs.notify_all();
+
+    {
+        auto const start = std::chrono::high_resolution_clock::now();
+
+        VkCommandBuffer raw_buffer;
+        allocators[0] = plan.caller_allocator->acquireMemory(mDevice, raw_buffer, &inheritance);
+
+        plan.caller_translator->translateRenderPassSegment(raw_buffer, primary, raw_render_pass, raw_framebuffer, plan, render_pass, render_pass.first_segment);
+        out_buffers[0] = raw_buffer;
+
+        auto const end = std::chrono::high_resolution_clock::now();
+        timing.segment_ms[0] = std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    {
+        auto const wait_start = std::chrono::high_resolution_clock::now();
+
+        auto lk = std::unique_lock(mMutex);
+        mCVDone.wait(lk, [&] { return num_pending == 0; });
+
+        auto const wait_end = std::chrono::high_resolution_clock::now();
+        timing.wait_ms = std::chrono::duration<double, std::milli>(wait_end - wait_start).count();
+
+        ++mStats.num_segments;
+        mStats.segment_ms_total += timing.segment_ms[0];
+        mStats.segment_ms_max = cc::max(mStats.segment_ms_max, timing.segment_ms[0]);
+        mStats.wait_ms_total += timing.wait_ms;
+
+        mStats.recent_render_passes[mStats.num_split_render_passes % num_recent_render_passes] = timing;
+        ++mStats.num_split_render_passes;
+    }
+
+    // the secondaries stay alive until the primary is submitted and completed, or discarded
+    for (auto i = 0u; i < render_pass.num_segments; ++i)
+    {
+        mPoolCmdLists->addSecondaryAllocator(primary, allocators[i]);
+    }
+}
+
+phi::vk::ParallelCommandTranslator::translation_stats phi::vk::ParallelCommandTranslator::getStats()
+{
+    auto lg = std::lock_guard(mMutex);
+
+    // unroll the ring, oldest first
+    translation_stats res = mStats;
+    auto const num_recent = uint32_t(cc::min<uint64_t>(mStats.num_split_render_passes, num_recent_render_passes));
+    for (auto i = 0u; i < num_recent; ++i)
+    {
+        res.recent_render_passes[i] = mStats.recent_render_passes[(mStats.num_split_render_passes - num_recent + i) % num_recent_render_passes];
+    }
+
+    return res;
+}
+
+void phi::vk::ParallelCommandTranslator::workerMain(uint32_t worker_index)
+{
+    worker& self = mWorkers[worker_index];
+
+    while (true)
+    {
+        segment_job job;
+
+        {
+            auto lk = std::unique_lock(mMutex);
+            mCVJobs.wait(lk, [&] { return mIsShuttingDown || mNextJob < mJobs.size(); });
+
+            if (mNextJob == mJobs.size())
+                return; // shutting down, no work left
+
+            job = mJobs[mNextJob++];
+
+            if (mNextJob == mJobs.size())
+            {
+                mJobs.clear();
+                mNextJob = 0;
+            }
+        }
+
+        auto const start = std::chrono::high_resolution_clock::now();
+
+        VkCommandBuffer raw_buffer;
+        *job.out_allocator = self.secondaryAllocator.acquireMemory(mDevice, raw_buffer, job.inheritance);
+
+        self.translator.translateRenderPassSegment(raw_buffer, job.primary, job.inheritance->renderPass, job.inheritance->framebuffer, *job.plan,
+                                                   *job.render_pass, job.segment_index);
+        *job.out_buffer = raw_buffer;
+
+        auto const end = std::chrono::high_resolution_clock::now();
+        double const ms = std::chrono::duration<double, std::milli>(end - start).count();
+        *job.out_ms = ms;
+
+        bool is_last_of_call;
+        {
+            auto lg = std::lock_guard(mMutex);
+            ++mStats.num_segments;
+            mStats.segment_ms_total += ms;
+            mStats.segment_ms_max = cc::max(mStats.segment_ms_max, ms);
+
+            is_last_of_call = --(*job.num_pending) == 0;
+        }
+
+        if (is_last_of_call)
+            mCVDone.notify_all();
+    }
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include <clean-core/span.hh>
+#include <clean-core/vector.hh>
+
+#include <phantasm-hardware-interface/commands.hh>
+
+#include <phantasm-hardware-interface/vulkan/loader/volk.hh>
+
+namespace phi::vk
+{
+class ShaderViewPool;
+class ResourcePool;
+class PipelinePool;
+class CommandListPool;
+class CommandAllocatorBundle;
+struct cmd_allocator_node;
+class AccelStructPool;
+class QueryPool;
+class FramebufferCache;
+class ParallelCommandTranslator;
+struct command_list_translator;
+
+/// a section of a render pass body, translated into its own secondary command buffer
+struct render_pass_segment
+{
+    // range in parallel_translation_plan::pieces
+    uint32_t first_piece = 0;
+    uint32_t num_pieces = 0;
+
+    // the scissor in effect at the start of the segment, secondary command buffers do not inherit dynamic state
+    VkRect2D scissor = {};
+};
+
+/// a render pass whose body is split into segments
+struct split_render_pass
+{
+    cmd::detail::cmd_base const* begin_cmd = nullptr;
+    // nullptr if the render pass is closed implicitly at the end of the command stream
+    cmd::detail::cmd_base const* end_cmd = nullptr;
+
+    // range in parallel_translation_plan::segments
+    uint32_t first_segment = 0;
+    uint32_t num_segments = 0;
+
+    VkViewport viewport = {};
+};
+
+/// the render passes of a command stream that are translated in parallel, see ParallelCommandTranslator::planSplits
+/// memory is kept across uses, 1 per thread
+struct parallel_translation_plan
+{
+    // the command stream sections of all segments, segments straddling chunks consist of multiple pieces
+    cc::vector<command_stream_chunk> pieces;
+    cc::vector<render_pass_segment> segments;
+    cc::vector<split_render_pass> render_passes;
+
+    // the executor of this plan
+    ParallelCommandTranslator* translator = nullptr;
+
+    // the recording thread's own resources to translate the first segment of each split render pass, set once and kept by clear()
+    command_list_translator* caller_translator = nullptr;
+    CommandAllocatorBundle* caller_allocator = nullptr;
+
+    struct split_candidate
+    {
+        uint32_t chunk_index;
+        uint32_t offset;
+        uint32_t num_draws_before;
+        VkRect2D scissor;
+    };
+
+    // scratch memory of planSplits
+    cc::vector<split_candidate> candidates;
+
+    void clear()
+    {
+        pieces.clear();
+        segments.clear();
+        render_passes.clear();
+        candidates.clear();
+        translator = nullptr;
+    }
+};
+
+/// Translates large render passes of a command list into secondary command buffers on backend-owned worker threads
+/// A render pass is split before self-contained draw commands (which rebind all state except the scissor),
+/// the first segment is recorded by the recording thread, each other one by a single worker using its own translator and command allocators,
+/// and the secondaries are executed from the primary in stream order, independent of scheduling
+/// Synchronized - 1 per application
+class ParallelCommandTranslator
+{
+public:
+    /// maximum amount of worker threads
+    static constexpr uint32_t max_num_workers = 16;
+    /// maximum amount of segments per render pass, one per worker and one for the recording thread
+    static constexpr uint32_t max_num_segments = max_num_workers + 1;
+    /// amount of most recent split render passes whose per-segment timings are kept
+    static constexpr uint32_t num_recent_render_passes = 8;
+
+    struct render_pass_timing
+    {
+        uint32_t num_segments = 0;
+        /// CPU time spent translating each segment, the first one on the recording thread
+        double segment_ms[max_num_segments] = {};
+        /// CPU time the recording thread spent waiting for the workers after its own segment
+        double wait_ms = 0.0;
+    };
+
+    struct translation_stats
+    {
+        uint64_t num_split_render_passes = 0;
+        uint64_t num_segments = 0;
+        /// CPU time spent translating segments, summed and maximum of a single segment
+        double segment_ms_total = 0.0;
+        double segment_ms_max = 0.0;
+        /// CPU time the recording threads spent waiting for the workers
+        double wait_ms_total = 0.0;
+
+        /// the most recent split render passes, oldest first, min(num_split_render_passes, num_recent_render_passes) are valid
+        render_pass_timing recent_render_passes[num_recent_render_passes];
+    };
+
+public:
+    void initialize(VkDevice device,
+                    uint32_t num_workers,
+                    uint32_t min_draws_per_render_pass,
+                    ShaderViewPool* sv_pool,
+                    ResourcePool* resource_pool,
+                    PipelinePool* pso_pool,
+                    CommandListPool* cmd_pool,
+                    QueryPool* query_pool,
+                    AccelStructPool* as_pool,
+                    FramebufferCache* fb_cache,
+                    bool has_rt,
+                    cc::allocator* static_alloc);
+
+    /// stops all worker threads, to be called before the command list pool is destroyed
+    void stopWorkers();
+
+    /// destroys the secondary command allocators, to be called after the command list pool is destroyed
+    void destroy(VkDevice device);
+
+    [[nodiscard]] bool isEnabled() const { return mNumWorkers > 0; }
+
+    [[nodiscard]] uint32_t getNumWorkers() const { return mNumWorkers; }
+
+    /// the secondary command allocators of the workers, initialized by the CommandListPool
+    [[nodiscard]] CommandAllocatorBundle* getWorkerAllocator(uint32_t worker_index);
+
+    /// scans a command stream for render passes large enough to split
+    /// returns false if there are none, in which case the stream is translated serially
+    [[nodiscard]] bool planSplits(cc::span<command_stream_chunk const> chunks, parallel_translation_plan& out_plan);
+
+    /// translates all segments of a split render pass into secondary command buffers, blocks until all of them are recorded
+    /// the calling thread translates the first segment itself using the caller resources of the plan
+    /// the secondaries are associated with the given primary command list and written to out_buffers in segment order
+    void translateSegments(parallel_translation_plan const& plan,
+                           split_render_pass const& render_pass,
+                           VkRenderPass raw_render_pass,
+                           VkFramebuffer raw_framebuffer,
+                           handle::command_list primary,
+                           VkCommandBuffer* out_buffers);
+
+    [[nodiscard]] translation_stats getStats();
+
+private:
+    struct worker;
+
+    struct segment_job
+    {
+        parallel_translation_plan const* plan;
+        split_render_pass const* render_pass;
+        uint32_t segment_index;
+        VkCommandBufferInheritanceInfo const* inheritance;
+        handle::command_list primary;
+
+        // outputs, written by the worker
+        VkCommandBuffer* out_buffer;
+        cmd_allocator_node** out_allocator;
+        double* out_ms;
+        // the amount of unfinished jobs of the translateSegments call, guarded by mMutex
+        uint32_t* num_pending;
+    };
+
+    void workerMain(uint32_t worker_index);
+
+private:
+    VkDevice mDevice = nullptr;
+    CommandListPool* mPoolCmdLists = nullptr;
+    uint32_t mMinDrawsPerRenderPass = 0;
+
+    worker* mWorkers = nullptr;
+    uint32_t mNumWorkers = 0;
+    cc::allocator* mWorkerAlloc = nullptr;
+
+    // pending jobs, FIFO
+    cc::vector<segment_job> mJobs;
+    size_t mNextJob = 0;
+    bool mIsShuttingDown = false;
+
+    std::mutex mMutex;
+    std::condition_variable mCVJobs;
+    std::condition_variable mCVDone;
+
+    // mStats.recent_render_passes is a ring, the next entry is at num_split_render_passes % num_recent_render_passes
+    translation_stats mStats;
+};
+}
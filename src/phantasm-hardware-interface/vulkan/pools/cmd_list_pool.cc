@@ -10,10 +10,16 @@
 #include <phantasm-hardware-interface/vulkan/BackendVulkan.hh>
 #include <phantasm-hardware-interface/vulkan/common/util.hh>
 
-void phi::vk::cmd_allocator_node::initialize(
-    VkDevice device, unsigned num_cmd_lists, unsigned queue_family_index, FenceRingbuffer* fence_ring, cc::allocator* static_alloc, cc::allocator* dynamic_alloc)
+void phi::vk::cmd_allocator_node::initialize(VkDevice device,
+                                             unsigned num_cmd_lists,
+                                             unsigned queue_family_index,
+                                             FenceRingbuffer* fence_ring,
+                                             cc::allocator* static_alloc,
+                                             cc::allocator* dynamic_alloc,
+                                             VkCommandBufferLevel level)
 {
     _fence_ring = fence_ring;
+    _is_secondary = level == VK_COMMAND_BUFFER_LEVEL_SECONDARY;
 
     // create pool
     {
@@ -30,7 +36,7 @@ void phi::vk::cmd_allocator_node::initialize(
         VkCommandBufferAllocateInfo info = {};
         info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         info.commandPool = _cmd_pool;
-        info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        info.level = level;
         info.commandBufferCount = num_cmd_lists;
 
         PHI_VK_VERIFY_SUCCESS(vkAllocateCommandBuffers(device, &info, _cmd_buffers.data()));
@@ -51,8 +57,10 @@ void phi::vk::cmd_allocator_node::destroy(VkDevice device)
     vkDestroyCommandPool(device, _cmd_pool, nullptr);
 }
 
-VkCommandBuffer phi::vk::cmd_allocator_node::acquire(VkDevice device)
+VkCommandBuffer phi::vk::cmd_allocator_node::acquire(VkDevice device, VkCommandBufferInheritanceInfo const* inheritance)
 {
+    CC_ASSERT(_is_secondary == (inheritance != nullptr) && "secondary command buffers require inheritance info, primaries must not have any");
+
     if (is_full())
     {
         // the allocator is full, we are almost dead but might be able to reset
@@ -67,6 +75,13 @@ VkCommandBuffer phi::vk::cmd_allocator_node::acquire(VkDevice device)
     VkCommandBufferBeginInfo info = {};
     info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (inheritance != nullptr)
+    {
+        info.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        info.pInheritanceInfo = inheritance;
+    }
+
     PHI_VK_VERIFY_SUCCESS(vkBeginCommandBuffer(res, &info));
 
     return res;
@@ -268,7 +283,8 @@ void phi::vk::CommandAllocatorBundle::initialize(VkDevice device,
                                                  unsigned queue_family_index,
                                                  phi::vk::FenceRingbuffer* fence_ring,
                                                  cc::allocator* static_alloc,
-                                                 cc::allocator* dynamic_alloc)
+                                                 cc::allocator* dynamic_alloc,
+                                                 VkCommandBufferLevel level)
 {
     CC_ASSERT(mAllocators.empty() && "double init");
     mAllocators = mAllocators.defaulted(num_allocators, static_alloc);
@@ -276,7 +292,7 @@ void phi::vk::CommandAllocatorBundle::initialize(VkDevice device,
 
     for (cmd_allocator_node& alloc_node : mAllocators)
     {
-        alloc_node.initialize(device, num_cmdlists_per_allocator, queue_family_index, fence_ring, static_alloc, dynamic_alloc);
+        alloc_node.initialize(device, num_cmdlists_per_allocator, queue_family_index, fence_ring, static_alloc, dynamic_alloc, level);
     }
 }
 
@@ -286,12 +302,12 @@ void phi::vk::CommandAllocatorBundle::destroy(VkDevice device)
         alloc_node.destroy(device);
 }
 
-phi::vk::cmd_allocator_node* phi::vk::CommandAllocatorBundle::acquireMemory(VkDevice device, VkCommandBuffer& out_buffer)
+phi::vk::cmd_allocator_node* phi::vk::CommandAllocatorBundle::acquireMemory(VkDevice device, VkCommandBuffer& out_buffer, VkCommandBufferInheritanceInfo const* inheritance)
 {
     CC_ASSERT(!mAllocators.empty() && "uninitalized command allocator bundle");
     updateActiveIndex(device);
     auto& active_alloc = mAllocators[mActiveAllocator];
-    out_buffer = active_alloc.acquire(device);
+    out_buffer = active_alloc.acquire(device, inheritance);
     return &active_alloc;
 }
 
@@ -333,7 +349,9 @@ phi::handle::command_list phi::vk::CommandListPool::create(VkCommandBuffer& out_
 
     cmd_list_node& new_node = mPool.get(res);
     new_node.responsible_allocator = thread_allocator.get(type).acquireMemory(mDevice, new_node.raw_buffer);
-    new_node.state_cache.initialize(cc::span(mFlatStateCacheEntries).subspan(res_index * mNumStateCacheEntriesPerCmdlist, mNumStateCacheEntriesPerCmdlist));
+    new_node.state_cache = &mStateCaches[res_index];
+    new_node.state_cache->reset();
+    new_node.secondary_allocators.clear();
 
     out_cmdlist = new_node.raw_buffer;
     return {res};
@@ -344,14 +362,21 @@ void phi::vk::CommandListPool::freeOnSubmit(phi::handle::command_list cl, unsign
     cmd_list_node& freed_node = mPool.get(cl._value);
     {
         auto lg = std::lock_guard(mMutex);
+
+        // the given fence_index has a reference count of 1, one more for each secondary allocator
+        if (!freed_node.secondary_allocators.empty())
+            mFenceRing.incrementRefcount(fence_index, int(freed_node.secondary_allocators.size()));
+
         freed_node.responsible_allocator->on_submit(1, fence_index);
+        for (auto const& secondary : freed_node.secondary_allocators)
+            secondary.allocator->on_submit(secondary.num_buffers, fence_index);
     }
     mPool.release(cl._value);
 }
 
 void phi::vk::CommandListPool::freeOnSubmit(cc::span<const phi::handle::command_list> cls, unsigned fence_index)
 {
-    phi::detail::capped_flat_map<cmd_allocator_node*, unsigned, 24> unique_allocators;
+    phi::detail::capped_flat_map<cmd_allocator_node*, unsigned, 64> unique_allocators;
 
     // free the cls in the pool and gather the unique allocators
     {
@@ -363,6 +388,8 @@ void phi::vk::CommandListPool::freeOnSubmit(cc::span<const phi::handle::command_
 
             cmd_list_node& freed_node = mPool.get(cl._value);
             unique_allocators.get_value(freed_node.responsible_allocator, 0u) += 1;
+            for (auto const& secondary : freed_node.secondary_allocators)
+                unique_allocators.get_value(secondary.allocator, 0u) += secondary.num_buffers;
             mPool.release(cl._value);
         }
     }
@@ -383,7 +410,7 @@ void phi::vk::CommandListPool::freeOnSubmit(cc::span<const phi::handle::command_
 
 void phi::vk::CommandListPool::freeOnSubmit(cc::span<const cc::span<const phi::handle::command_list>> cls_nested, unsigned fence_index)
 {
-    phi::detail::capped_flat_map<cmd_allocator_node*, unsigned, 24> unique_allocators;
+    phi::detail::capped_flat_map<cmd_allocator_node*, unsigned, 64> unique_allocators;
 
     // free the cls in the pool and gather the unique allocators
     {
@@ -396,6 +423,8 @@ void phi::vk::CommandListPool::freeOnSubmit(cc::span<const cc::span<const phi::h
 
                 cmd_list_node& freed_node = mPool.get(cl._value);
                 unique_allocators.get_value(freed_node.responsible_allocator, 0u) += 1;
+                for (auto const& secondary : freed_node.secondary_allocators)
+                    unique_allocators.get_value(secondary.allocator, 0u) += secondary.num_buffers;
                 mPool.release(cl._value);
             }
     }
@@ -422,12 +451,32 @@ void phi::vk::CommandListPool::freeAndDiscard(cc::span<const handle::command_lis
     {
         if (cl.is_valid())
         {
-            mPool.get(cl._value).responsible_allocator->on_discard();
+            cmd_list_node& node = mPool.get(cl._value);
+            node.responsible_allocator->on_discard();
+            discardSecondaries(node);
             mPool.release(cl._value);
         }
     }
 }
 
+void phi::vk::CommandListPool::addSecondaryAllocator(handle::command_list cl, cmd_allocator_node* secondary_allocator)
+{
+    // only called from the thread recording the list
+    cmd_list_node& node = getCommandListNode(cl);
+
+    for (auto& secondary : node.secondary_allocators)
+    {
+        if (secondary.allocator == secondary_allocator)
+        {
+            ++secondary.num_buffers;
+            return;
+        }
+    }
+
+    CC_RUNTIME_ASSERT(node.secondary_allocators.size() < max_num_secondary_allocators && "command list executes secondaries from too many allocators");
+    node.secondary_allocators.push_back(secondary_allocator_ref{secondary_allocator, 1});
+}
+
 unsigned phi::vk::CommandListPool::discardAndFreeAll()
 {
     auto lg = std::lock_guard(mMutex);
@@ -436,6 +485,7 @@ unsigned phi::vk::CommandListPool::discardAndFreeAll()
     mPool.iterate_allocated_nodes([&](cmd_list_node& leaked_node) {
         ++num_freed;
         leaked_node.responsible_allocator->on_discard();
+        discardSecondaries(leaked_node);
         mPool.unsafe_release_node(&leaked_node);
     });
 
@@ -451,6 +501,8 @@ void phi::vk::CommandListPool::initialize(phi::vk::Device& device,
                                           int num_copy_lists_per_alloc,
                                           int max_num_unique_transitions_per_cmdlist,
                                           cc::span<CommandAllocatorsPerThread*> thread_allocators,
+                                          cc::span<CommandAllocatorBundle*> secondary_allocators,
+                                          int num_secondary_lists_per_alloc,
                                           cc::allocator* static_alloc,
                                           cc::allocator* dynamic_alloc)
 {
@@ -468,10 +520,13 @@ void phi::vk::CommandListPool::initialize(phi::vk::Device& device,
 
     mPool.initialize(num_lists_total, static_alloc);
 
-    mNumStateCacheEntriesPerCmdlist = max_num_unique_transitions_per_cmdlist;
-    mFlatStateCacheEntries = mFlatStateCacheEntries.uninitialized(num_lists_total * max_num_unique_transitions_per_cmdlist, static_alloc);
+    mStateCaches = mStateCaches.defaulted(num_lists_total, static_alloc);
+    for (vk_incomplete_state_cache& state_cache : mStateCaches)
+        state_cache.initialize(dynamic_alloc, uint32_t(max_num_unique_transitions_per_cmdlist));
 
-    mFenceRing.initialize(mDevice, unsigned(thread_allocators.size()) * (num_direct_allocs + num_compute_allocs + num_copy_allocs) + 5, static_alloc); // arbitrary safety buffer, should never be required
+    auto const num_allocators_total = unsigned(thread_allocators.size()) * (num_direct_allocs + num_compute_allocs + num_copy_allocs)
+                                      + unsigned(secondary_allocators.size()) * num_direct_allocs;
+    mFenceRing.initialize(mDevice, num_allocators_total + 5, static_alloc); // arbitrary safety buffer, should never be required
 
     auto const direct_queue_family = unsigned(device.getQueueFamilyDirect());
     auto const compute_queue_family = unsigned(device.getQueueFamilyCompute());
@@ -496,6 +551,21 @@ void phi::vk::CommandListPool::initialize(phi::vk::Device& device,
                                                          static_alloc, dynamic_alloc);
         }
     }
+
+    // secondary command buffers are only used inside of render passes, on the direct queue
+    for (CommandAllocatorBundle* const secondary_bundle : secondary_allocators)
+    {
+        secondary_bundle->initialize(mDevice, num_direct_allocs, num_secondary_lists_per_alloc, direct_queue_family, &mFenceRing, static_alloc,
+                                     dynamic_alloc, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    }
+}
+
+void phi::vk::CommandListPool::discardSecondaries(cmd_list_node& node)
+{
+    for (auto const& secondary : node.secondary_allocators)
+        secondary.allocator->on_discard(secondary.num_buffers);
+
+    node.secondary_allocators.clear();
 }
 
 void phi::vk::CommandListPool::destroy()
@@ -506,5 +576,8 @@ void phi::vk::CommandListPool::destroy()
         PHI_LOG("leaked {} handle::command_list object{}", num_leaks, (num_leaks == 1 ? "" : "s"));
     }
 
+    for (vk_incomplete_state_cache& state_cache : mStateCaches)
+        state_cache.destroy();
+
     mFenceRing.destroy(mDevice);
 }
@@ -6,6 +6,7 @@
 #include <clean-core/alloc_array.hh>
 #include <clean-core/alloc_vector.hh>
 #include <clean-core/atomic_linked_pool.hh>
+#include <clean-core/capped_vector.hh>
 
 #include <phantasm-hardware-interface/vulkan/common/verify.hh>
 #include <phantasm-hardware-interface/vulkan/common/vk_incomplete_state_cache.hh>
@@ -74,7 +75,13 @@ private:
 struct cmd_allocator_node
 {
 public:
-    void initialize(VkDevice device, unsigned num_cmd_lists, unsigned queue_family_index, FenceRingbuffer* fence_ring, cc::allocator* static_alloc, cc::allocator* dynamic_alloc);
+    void initialize(VkDevice device,
+                    unsigned num_cmd_lists,
+                    unsigned queue_family_index,
+                    FenceRingbuffer* fence_ring,
+                    cc::allocator* static_alloc,
+                    cc::allocator* dynamic_alloc,
+                    VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
     void destroy(VkDevice device);
 
 public:
@@ -86,7 +93,8 @@ public:
 
     /// acquire a command buffer from this allocator
     /// do not call if full (best case: blocking, worst case: crash)
-    [[nodiscard]] VkCommandBuffer acquire(VkDevice device);
+    /// secondary command buffers are begun as a continuation of the render pass given in the inheritance info
+    [[nodiscard]] VkCommandBuffer acquire(VkDevice device, VkCommandBufferInheritanceInfo const* inheritance = nullptr);
 
     /// to be called when a command buffer backed by this allocator
     /// is being dicarded (will never result in a submit)
@@ -132,6 +140,7 @@ private:
 
     VkCommandPool _cmd_pool;
     cc::alloc_array<VkCommandBuffer> _cmd_buffers;
+    bool _is_secondary = false;
 
     /// amount of cmdbufs given out
     unsigned _num_in_flight = 0;
@@ -166,12 +175,13 @@ public:
                     unsigned queue_family_index,
                     FenceRingbuffer* fence_ring,
                     cc::allocator* static_alloc,
-                    cc::allocator* dynamic_alloc);
+                    cc::allocator* dynamic_alloc,
+                    VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
     void destroy(VkDevice device);
 
     /// Resets the given command list to use memory by an appropriate allocator
     /// Returns a pointer to the backing allocator node
-    cmd_allocator_node* acquireMemory(VkDevice device, VkCommandBuffer& out_buffer);
+    cmd_allocator_node* acquireMemory(VkDevice device, VkCommandBuffer& out_buffer, VkCommandBufferInheritanceInfo const* inheritance = nullptr);
 
 private:
     void updateActiveIndex(VkDevice device);
@@ -236,6 +246,10 @@ public:
     /// the cmdlists are now consumed and must not be reused
     void freeAndDiscard(cc::span<handle::command_list const> cls);
 
+    /// to be called when a secondary command buffer acquired from the given allocator is executed by the given command list
+    /// the allocator is informed alongside the list on submit or discard
+    void addSecondaryAllocator(handle::command_list cl, cmd_allocator_node* secondary_allocator);
+
     /// discards all command lists that are currently alive
     /// all cmdlists acquired before this call are now consumed and must not be reused
     /// returns the amount of cmdlists that were freed
@@ -243,14 +257,26 @@ public:
 
 
 public:
+    /// maximum amount of unique secondary command buffer allocators a single command list can depend on
+    static constexpr unsigned max_num_secondary_allocators = 32;
+
+    struct secondary_allocator_ref
+    {
+        cmd_allocator_node* allocator;
+        unsigned num_buffers;
+    };
+
     struct cmd_list_node
     {
         // an allocated node is always in the following state:
         // - the command list is freshly reset using an appropriate allocator
         // - the responsible_allocator must be informed on submit or discard
         cmd_allocator_node* responsible_allocator;
-        vk_incomplete_state_cache state_cache;
+        // points into mStateCaches
+        vk_incomplete_state_cache* state_cache;
         VkCommandBuffer raw_buffer;
+        // allocators of the secondary command buffers executed by this list, see addSecondaryAllocator
+        cc::capped_vector<secondary_allocator_ref, max_num_secondary_allocators> secondary_allocators;
     };
 
     using cmdlist_linked_pool_t = cc::atomic_linked_pool<cmd_list_node>;
@@ -263,7 +289,7 @@ public:
 
     [[nodiscard]] VkCommandBuffer getRawBuffer(handle::command_list cl) const { return getCommandListNode(cl).raw_buffer; }
 
-    [[nodiscard]] vk_incomplete_state_cache* getStateCache(handle::command_list cl) { return &getCommandListNode(cl).state_cache; }
+    [[nodiscard]] vk_incomplete_state_cache* getStateCache(handle::command_list cl) { return getCommandListNode(cl).state_cache; }
 
     void addAssociatedFramebuffer(handle::command_list cl, VkFramebuffer fb, cc::span<VkImageView const> imgviews)
     {
@@ -280,10 +306,16 @@ public:
                     int num_copy_lists_per_alloc,
                     int max_num_unique_transitions_per_cmdlist,
                     cc::span<CommandAllocatorsPerThread*> thread_allocators,
+                    cc::span<CommandAllocatorBundle*> secondary_allocators,
+                    int num_secondary_lists_per_alloc,
                     cc::allocator* static_alloc,
                     cc::allocator* dynamic_alloc);
     void destroy();
 
+private:
+    /// informs the allocators of the given node's secondary command buffers of a discard
+    static void discardSecondaries(cmd_list_node& node);
+
 private:
     // non-owning
     VkDevice mDevice;
@@ -294,9 +326,9 @@ private:
     // the linked pool
     cmdlist_linked_pool_t mPool;
 
-    // flat memory for the state caches
-    int mNumStateCacheEntriesPerCmdlist;
-    cc::alloc_array<vk_incomplete_state_cache::cache_entry> mFlatStateCacheEntries;
+    // the state caches, parallel to the pool and identically indexed
+    // their memory grows on demand and is kept across uses
+    cc::alloc_array<vk_incomplete_state_cache> mStateCaches;
 
     std::mutex mMutex;
 };
@@ -0,0 +1,185 @@
+#include "descriptor_set_layout_cache.hh"
+
+#include <cstring>
+
+#include <phantasm-hardware-interface/common/log.hh>
+#include <phantasm-hardware-interface/common/sse_hash.hh>
+
+#include <phantasm-hardware-interface/vulkan/common/verify.hh>
+
+namespace
+{
+constexpr uint32_t gc_words_per_binding = 4;
+
+void writeBindingWords(VkDescriptorSetLayoutBinding const& binding, uint32_t* out_words)
+{
+    CC_ASSERT(binding.pImmutableSamplers == nullptr && "immutable samplers are not supported");
+    out_words[0] = binding.binding;
+    out_words[1] = uint32_t(binding.descriptorType);
+    out_words[2] = binding.descriptorCount;
+    out_words[3] = binding.stageFlags;
+}
+}
+
+void phi::vk::DescriptorSetLayoutCache::initialize(VkDevice device, unsigned max_num_unique_layouts, cc::allocator* static_alloc, cc::allocator* dynamic_alloc)
+{
+    CC_ASSERT(mDevice == nullptr && "double init");
+    mDevice = device;
+    mDynamicAlloc = dynamic_alloc;
+
+    mPool.initialize(max_num_unique_layouts, static_alloc);
+    mIndex.initialize(max_num_unique_layouts, dynamic_alloc);
+}
+
+void phi::vk::DescriptorSetLayoutCache::destroy()
+{
+    if (mDevice == nullptr)
+        return;
+
+    auto num_leaks = 0;
+    mPool.iterate_allocated_nodes([&](layout_node& leaked_node) {
+        ++num_leaks;
+        vkDestroyDescriptorSetLayout(mDevice, leaked_node.raw_layout, nullptr);
+    });
+
+    if (num_leaks > 0)
+    {
+        PHI_LOG_WARN("leaked {} cached descriptor set layout{} on shutdown", num_leaks, num_leaks == 1 ? "" : "s");
+    }
+
+    mIndex.destroy();
+    mDevice = nullptr;
+}
+
+phi::vk::DescriptorSetLayoutCache::handle_t phi::vk::DescriptorSetLayoutCache::acquire(cc::span<const VkDescriptorSetLayoutBinding> bindings)
+{
+    auto lg = std::lock_guard(mMutex);
+    ++mNumRequested;
+
+    bool is_new = false;
+    auto const& elem = mIndex.get_or_create(layout_key_readonly{bindings, mDynamicAlloc}, [&](handle_t& new_handle) {
+        CC_RUNTIME_ASSERTF(!mPool.is_full(),
+                           "Reached limit for unique shader view layouts, increase max_num_shader_views in the PHI backend config\n"
+                           "Current limit: {}",
+                           mPool.max_size());
+
+        new_handle = mPool.acquire();
+        layout_node& new_node = mPool.get(new_handle);
+
+        VkDescriptorSetLayoutCreateInfo layout_info = {};
+        layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layout_info.bindingCount = uint32_t(bindings.size());
+        layout_info.pBindings = bindings.data();
+        PHI_VK_VERIFY_SUCCESS(vkCreateDescriptorSetLayout(mDevice, &layout_info, nullptr, &new_node.raw_layout));
+
+        new_node.refcount = 1;
+
+        ++mNumCreated;
+        ++mNumUnique;
+        is_new = true;
+    });
+
+    layout_node& node = mPool.get(elem.value);
+    if (is_new)
+    {
+        node.key = &elem.key;
+    }
+    else
+    {
+        ++node.refcount;
+    }
+
+    return elem.value;
+}
+
+void phi::vk::DescriptorSetLayoutCache::release(handle_t handle)
+{
+    if (handle == invalid_handle)
+        return;
+
+    auto lg = std::lock_guard(mMutex);
+
+    layout_node& node = mPool.get(handle);
+    CC_ASSERT(node.refcount > 0 && "released unreferenced descriptor set layout");
+
+    if (--node.refcount > 0)
+        return;
+
+    vkDestroyDescriptorSetLayout(mDevice, node.raw_layout, nullptr);
+
+    // destroys the key node.key points to
+    bool const was_erased = mIndex.erase(*node.key);
+    CC_ASSERT(was_erased && "descriptor set layout missing from cache index");
+    (void)was_erased;
+
+    node.key = nullptr;
+    mPool.release(handle);
+    --mNumUnique;
+}
+
+phi::vk::DescriptorSetLayoutCache::cache_stats phi::vk::DescriptorSetLayoutCache::getStats()
+{
+    auto lg = std::lock_guard(mMutex);
+
+    cache_stats res;
+    res.num_requested = mNumRequested;
+    res.num_created = mNumCreated;
+    res.num_unique_layouts = mNumUnique;
+    return res;
+}
+
+uint64_t phi::vk::DescriptorSetLayoutCache::hashBindings(cc::span<const VkDescriptorSetLayoutBinding> bindings)
+{
+    uint64_t res = 2166136261U;
+    for (auto const& binding : bindings)
+    {
+        uint32_t words[gc_words_per_binding];
+        writeBindingWords(binding, words);
+        res = phi::util::sse_hash(words, words + gc_words_per_binding, res);
+    }
+
+    return res;
+}
+
+uint64_t phi::vk::DescriptorSetLayoutCache::hashWords(cc::span<const uint32_t> words)
+{
+    // equal to hashBindings of the bindings the words were flattened from
+    uint64_t res = 2166136261U;
+    for (auto i = 0u; i < words.size(); i += gc_words_per_binding)
+    {
+        res = phi::util::sse_hash(words.data() + i, words.data() + i + gc_words_per_binding, res);
+    }
+
+    return res;
+}
+
+phi::vk::DescriptorSetLayoutCache::layout_key::layout_key(const layout_key_readonly& ro)
+{
+    words.reset(ro.alloc, ro.bindings.size() * gc_words_per_binding);
+    for (auto i = 0u; i < ro.bindings.size(); ++i)
+    {
+        writeBindingWords(ro.bindings[i], words.data() + i * gc_words_per_binding);
+    }
+}
+
+bool phi::vk::DescriptorSetLayoutCache::layout_key::operator==(const layout_key_readonly& rhs) const noexcept
+{
+    if (words.size() != rhs.bindings.size() * gc_words_per_binding)
+        return false;
+
+    for (auto i = 0u; i < rhs.bindings.size(); ++i)
+    {
+        uint32_t binding_words[gc_words_per_binding];
+        writeBindingWords(rhs.bindings[i], binding_words);
+
+        if (std::memcmp(binding_words, words.data() + i * gc_words_per_binding, sizeof(binding_words)) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+bool phi::vk::DescriptorSetLayoutCache::layout_key::operator==(const layout_key& rhs) const noexcept
+{
+    return words.size() == rhs.words.size() && std::memcmp(words.data(), rhs.words.data(), words.size_bytes()) == 0;
+}
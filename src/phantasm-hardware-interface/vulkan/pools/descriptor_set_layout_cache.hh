@@ -0,0 +1,99 @@
+#pragma once
+
+#include <mutex>
+
+#include <clean-core/alloc_array.hh>
+#include <clean-core/atomic_linked_pool.hh>
+#include <clean-core/span.hh>
+
+#include <phantasm-hardware-interface/common/container/growable_map.hh>
+
+#include <phantasm-hardware-interface/vulkan/loader/volk.hh>
+
+namespace phi::vk
+{
+/// Deduplicating, refcounted cache of the VkDescriptorSetLayouts used by shader views
+/// Layouts are keyed by their flattened binding signature (binding, type, count, stages) and destroyed once unreferenced
+/// Synchronized
+class DescriptorSetLayoutCache
+{
+public:
+    // handles of the underlying pool, 0 is never a valid handle
+    using handle_t = uint32_t;
+    static constexpr handle_t invalid_handle = 0;
+
+    struct cache_stats
+    {
+        uint64_t num_requested = 0;      ///< amount of acquire calls
+        uint64_t num_created = 0;        ///< amount of VkDescriptorSetLayouts created
+        uint32_t num_unique_layouts = 0; ///< amount of VkDescriptorSetLayouts currently alive
+    };
+
+public:
+    /// the node pool is fixed-size, the index grows at runtime and requires the thread-safe dynamic allocator
+    void initialize(VkDevice device, unsigned max_num_unique_layouts, cc::allocator* static_alloc, cc::allocator* dynamic_alloc);
+    void destroy();
+
+    /// receive a layout matching the bindings, creating it if required, and increment its refcount
+    /// bindings must not use immutable samplers
+    [[nodiscard]] handle_t acquire(cc::span<VkDescriptorSetLayoutBinding const> bindings);
+
+    /// decrement the refcount of a layout, destroying it once unreferenced
+    void release(handle_t handle);
+
+    [[nodiscard]] VkDescriptorSetLayout get(handle_t handle) const { return mPool.get(handle).raw_layout; }
+
+    [[nodiscard]] cache_stats getStats();
+
+private:
+    struct layout_key_readonly
+    {
+        cc::span<VkDescriptorSetLayoutBinding const> bindings;
+        // allocates the words of a stored key created from this one
+        cc::allocator* alloc;
+    };
+
+    struct layout_key
+    {
+        // flattened binding signature, 4 words per binding
+        cc::alloc_array<uint32_t> words;
+
+        layout_key() = default;
+        layout_key(layout_key_readonly const& ro);
+        bool operator==(layout_key_readonly const& rhs) const noexcept;
+        bool operator==(layout_key const& rhs) const noexcept;
+    };
+
+    struct layout_key_hasher
+    {
+        uint64_t operator()(layout_key_readonly const& v) const noexcept { return hashBindings(v.bindings); }
+        uint64_t operator()(layout_key const& v) const noexcept { return hashWords(v.words); }
+    };
+
+    struct layout_node
+    {
+        layout_key const* key; ///< stored in mIndex, stable until erased
+        VkDescriptorSetLayout raw_layout;
+        uint32_t refcount;
+    };
+
+    static uint64_t hashBindings(cc::span<VkDescriptorSetLayoutBinding const> bindings);
+    static uint64_t hashWords(cc::span<uint32_t const> words);
+
+private:
+    VkDevice mDevice = nullptr;
+    cc::allocator* mDynamicAlloc = nullptr;
+
+    /// the layout nodes, handles are stable
+    cc::atomic_linked_pool<layout_node> mPool;
+
+    /// index from binding signature to node handle
+    phi::detail::growable_map<layout_key, handle_t, layout_key_hasher> mIndex;
+
+    uint64_t mNumRequested = 0;
+    uint64_t mNumCreated = 0;
+    uint32_t mNumUnique = 0;
+
+    std::mutex mMutex;
+};
+}
@@ -0,0 +1,259 @@
+#include "framebuffer_cache.hh"
+
+#include <cstring>
+
+#include <clean-core/hash.hh>
+
+#include <phantasm-hardware-interface/common/sse_hash.hh>
+#include <phantasm-hardware-interface/vulkan/common/verify.hh>
+#include <phantasm-hardware-interface/vulkan/loader/volk.hh>
+
+#include "shader_view_pool.hh"
+
+namespace
+{
+// whether the resource of the attachment at the given index already occurs at a lower index
+bool isRepeatedResource(cc::span<phi::resource_view const> attachments, size_t index)
+{
+    for (auto i = 0u; i < index; ++i)
+    {
+        if (attachments[i].resource == attachments[index].resource)
+            return true;
+    }
+
+    return false;
+}
+}
+
+void phi::vk::FramebufferCache::initialize(
+    VkDevice device, ShaderViewPool* sv_pool, unsigned max_elements, unsigned eviction_age, cc::allocator* dynamic_alloc)
+{
+    CC_ASSERT(mDevice == nullptr && "double init");
+    CC_ASSERT(eviction_age > 0 && "framebuffers in flight must not be evicted");
+    mDevice = device;
+    mPoolShaderViews = sv_pool;
+    mDynamicAlloc = dynamic_alloc;
+
+    mMaxNumElements = max_elements;
+    mEvictionAge = eviction_age;
+    mCache.initialize(max_elements, dynamic_alloc);
+    mEntriesByResource.initialize(max_elements, dynamic_alloc);
+}
+
+void phi::vk::FramebufferCache::destroy()
+{
+    if (mDevice == nullptr)
+        return;
+
+    mCache.iterate_elements([&](framebuffer_entry& entry) {
+        vkDestroyFramebuffer(mDevice, entry.framebuffer, nullptr);
+        for (VkImageView const iv : entry.image_views)
+        {
+            vkDestroyImageView(mDevice, iv, nullptr);
+        }
+    });
+
+    mCache.destroy();
+    mEntriesByResource.destroy();
+    mLRUHead = nullptr;
+    mLRUTail = nullptr;
+    mDevice = nullptr;
+}
+
+VkFramebuffer phi::vk::FramebufferCache::getOrCreate(VkRenderPass render_pass, cc::span<const resource_view> attachments, tg::isize2 size)
+{
+    auto const readonly_key = framebuffer_key_readonly{render_pass, attachments, size};
+
+    auto lg = std::lock_guard(mMutex);
+
+    if (framebuffer_entry* const hit = mCache.find(readonly_key))
+    {
+        ++mNumHits;
+
+        unlink(*hit);
+        linkFront(*hit);
+        hit->last_used_generation = mGeneration;
+        return hit->framebuffer;
+    }
+
+    ++mNumMisses;
+
+    if (mCache.size() >= mMaxNumElements && !evictLeastRecentlyUsed())
+    {
+        // full and all entries might still be in flight, the caller falls back to a transient framebuffer
+        return nullptr;
+    }
+
+    auto& elem = mCache.get_or_create(readonly_key, [](framebuffer_entry&) {});
+    framebuffer_entry& entry = elem.value;
+    entry.key = &elem.key;
+
+    for (auto const& rv : attachments)
+    {
+        entry.image_views.push_back(mPoolShaderViews->makeImageView(rv, false, false));
+    }
+
+    VkFramebufferCreateInfo fb_info = {};
+    fb_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    fb_info.renderPass = render_pass;
+    fb_info.attachmentCount = uint32_t(entry.image_views.size());
+    fb_info.pAttachments = entry.image_views.data();
+    fb_info.width = uint32_t(size.width);
+    fb_info.height = uint32_t(size.height);
+    fb_info.layers = 1;
+
+    PHI_VK_VERIFY_SUCCESS(vkCreateFramebuffer(mDevice, &fb_info, nullptr, &entry.framebuffer));
+
+    linkFront(entry);
+    entry.last_used_generation = mGeneration;
+
+    for (auto i = 0u; i < attachments.size(); ++i)
+    {
+        if (isRepeatedResource(attachments, i))
+            continue;
+
+        auto& referencing_entries = mEntriesByResource.get_or_create(attachments[i].resource, [&](cc::alloc_vector<framebuffer_entry*>& list) {
+            list.reset_reserve(mDynamicAlloc, 4);
+        });
+        referencing_entries.value.push_back(&entry);
+    }
+
+    return entry.framebuffer;
+}
+
+void phi::vk::FramebufferCache::invalidateResources(cc::span<const handle::resource> resources)
+{
+    if (resources.empty())
+        return;
+
+    auto lg = std::lock_guard(mMutex);
+
+    for (auto const res : resources)
+    {
+        // the list is erased along with the last entry referencing the resource
+        while (auto* const referencing_entries = mEntriesByResource.find(res))
+        {
+            removeEntry(*referencing_entries->back());
+            ++mNumInvalidations;
+        }
+    }
+}
+
+void phi::vk::FramebufferCache::advanceGeneration()
+{
+    auto lg = std::lock_guard(mMutex);
+    ++mGeneration;
+}
+
+phi::vk::FramebufferCache::cache_stats phi::vk::FramebufferCache::getStats()
+{
+    auto lg = std::lock_guard(mMutex);
+
+    cache_stats res;
+    res.num_hits = mNumHits;
+    res.num_misses = mNumMisses;
+    res.num_invalidations = mNumInvalidations;
+    res.num_evictions = mNumEvictions;
+    res.num_cached_framebuffers = uint32_t(mCache.size());
+    return res;
+}
+
+uint64_t phi::vk::FramebufferCache::hashKey(VkRenderPass render_pass, cc::span<const resource_view> attachments, tg::isize2 size)
+{
+    uint64_t res = cc::make_hash(render_pass, size.width, size.height);
+    return phi::util::sse_hash_type<resource_view>(attachments.data(), uint32_t(attachments.size()), res);
+}
+
+bool phi::vk::FramebufferCache::evictLeastRecentlyUsed()
+{
+    // entries used within the last eviction_age generations might still be referenced by command lists in flight
+    if (mLRUTail == nullptr || mGeneration - mLRUTail->last_used_generation <= mEvictionAge)
+        return false;
+
+    removeEntry(*mLRUTail);
+    ++mNumEvictions;
+    return true;
+}
+
+void phi::vk::FramebufferCache::removeEntry(framebuffer_entry& entry)
+{
+    unlink(entry);
+
+    auto const attachments = cc::span<resource_view const>(entry.key->attachments);
+    for (auto i = 0u; i < attachments.size(); ++i)
+    {
+        if (isRepeatedResource(attachments, i))
+            continue;
+
+        auto* const referencing_entries = mEntriesByResource.find(attachments[i].resource);
+        CC_ASSERT(referencing_entries != nullptr && "framebuffer missing from resource index");
+
+        auto& list = *referencing_entries;
+        for (auto j = 0u; j < list.size(); ++j)
+        {
+            if (list[j] == &entry)
+            {
+                list[j] = list.back();
+                list.pop_back();
+                break;
+            }
+        }
+
+        if (list.empty())
+        {
+            mEntriesByResource.erase(attachments[i].resource);
+        }
+    }
+
+    vkDestroyFramebuffer(mDevice, entry.framebuffer, nullptr);
+    for (VkImageView const iv : entry.image_views)
+    {
+        vkDestroyImageView(mDevice, iv, nullptr);
+    }
+
+    // destroys the entry along with its key
+    mCache.erase(*entry.key);
+}
+
+void phi::vk::FramebufferCache::linkFront(framebuffer_entry& entry)
+{
+    entry.lru_prev = nullptr;
+    entry.lru_next = mLRUHead;
+
+    if (mLRUHead != nullptr)
+        mLRUHead->lru_prev = &entry;
+    else
+        mLRUTail = &entry;
+
+    mLRUHead = &entry;
+}
+
+void phi::vk::FramebufferCache::unlink(framebuffer_entry& entry)
+{
+    if (entry.lru_prev != nullptr)
+        entry.lru_prev->lru_next = entry.lru_next;
+    else
+        mLRUHead = entry.lru_next;
+
+    if (entry.lru_next != nullptr)
+        entry.lru_next->lru_prev = entry.lru_prev;
+    else
+        mLRUTail = entry.lru_prev;
+
+    entry.lru_prev = nullptr;
+    entry.lru_next = nullptr;
+}
+
+bool phi::vk::FramebufferCache::framebuffer_key::operator==(framebuffer_key_readonly const& rhs) const noexcept
+{
+    if (render_pass != rhs.render_pass || size != rhs.size || attachments.size() != rhs.attachments.size())
+        return false;
+
+    // resource_view zeroes its padding on construction and can be memcmp'd
+    return std::memcmp(attachments.data(), rhs.attachments.data(), rhs.attachments.size_bytes()) == 0;
+}
+
+bool phi::vk::FramebufferCache::framebuffer_key::operator==(framebuffer_key const& rhs) const noexcept
+{
+    return *this == framebuffer_key_readonly{rhs.render_pass, rhs.attachments, rhs.size};
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include <clean-core/alloc_vector.hh>
+#include <clean-core/capped_vector.hh>
+#include <clean-core/span.hh>
+
+#include <typed-geometry/types/size.hh>
+
+#include <phantasm-hardware-interface/common/container/growable_map.hh>
+#include <phantasm-hardware-interface/limits.hh>
+#include <phantasm-hardware-interface/types.hh>
+
+#include <phantasm-hardware-interface/vulkan/loader/vulkan_fwd.hh>
+
+namespace phi::vk
+{
+class ShaderViewPool;
+
+/// Persistent cache for framebuffers and the image views of their attachments
+/// Keyed by render pass, attachment resource views and size
+/// Entries are destroyed once any of their attachment resources are freed
+/// Once full, the least recently used entry is evicted if it has not been used for more than eviction_age generations (direct queue submits)
+/// Synchronized
+class FramebufferCache
+{
+public:
+    struct cache_stats
+    {
+        uint64_t num_hits = 0;
+        uint64_t num_misses = 0;
+        uint64_t num_invalidations = 0;
+        uint64_t num_evictions = 0;
+        uint32_t num_cached_framebuffers = 0;
+    };
+
+public:
+    /// the cache and its resource index grow at runtime, the allocator must be thread-safe
+    void initialize(VkDevice device, ShaderViewPool* sv_pool, unsigned max_elements, unsigned eviction_age, cc::allocator* dynamic_alloc);
+    void destroy();
+
+    /// receive an existing framebuffer matching the render pass, attachments and size, or create a new one
+    /// attachments must not contain backbuffers, their views have a shorter lifetime than the resource handle
+    /// returns nullptr if the cache is full and no entry can be evicted yet,
+    /// in which case the caller is responsible for creating a transient framebuffer
+    [[nodiscard]] VkFramebuffer getOrCreate(VkRenderPass render_pass, cc::span<resource_view const> attachments, tg::isize2 size);
+
+    /// destroys all cached framebuffers and image views which use any of the given resources as an attachment
+    /// must be called before the resource is destroyed, the GPU must no longer be using it
+    void invalidateResources(cc::span<handle::resource const> resources);
+
+    /// advances the generation, called once per submit to the direct queue
+    /// entries unused for more than eviction_age generations are no longer in flight and can be evicted
+    void advanceGeneration();
+
+    [[nodiscard]] cache_stats getStats();
+
+private:
+    struct framebuffer_key_readonly
+    {
+        VkRenderPass render_pass;
+        cc::span<resource_view const> attachments;
+        tg::isize2 size;
+    };
+
+    struct framebuffer_key
+    {
+        VkRenderPass render_pass = nullptr;
+        tg::isize2 size = {0, 0};
+        cc::capped_vector<resource_view, limits::max_render_targets + 1> attachments;
+
+        framebuffer_key() = default;
+        framebuffer_key(framebuffer_key_readonly const& ro) : render_pass(ro.render_pass), size(ro.size), attachments(ro.attachments) {}
+        bool operator==(framebuffer_key_readonly const& rhs) const noexcept;
+        bool operator==(framebuffer_key const& rhs) const noexcept;
+    };
+
+    struct framebuffer_hasher
+    {
+        uint64_t operator()(framebuffer_key_readonly const& v) const noexcept { return hashKey(v.render_pass, v.attachments, v.size); }
+        uint64_t operator()(framebuffer_key const& v) const noexcept { return hashKey(v.render_pass, v.attachments, v.size); }
+    };
+
+    struct framebuffer_entry
+    {
+        framebuffer_key const* key = nullptr; ///< stored in mCache, stable until erased
+        VkFramebuffer framebuffer = nullptr;
+        cc::capped_vector<VkImageView, limits::max_render_targets + 1> image_views;
+
+        uint64_t last_used_generation = 0;
+        framebuffer_entry* lru_prev = nullptr; ///< more recently used
+        framebuffer_entry* lru_next = nullptr; ///< less recently used
+    };
+
+    struct resource_hasher
+    {
+        uint64_t operator()(handle::resource res) const noexcept { return res._value; }
+    };
+
+    static uint64_t hashKey(VkRenderPass render_pass, cc::span<resource_view const> attachments, tg::isize2 size);
+
+    /// evicts the least recently used entry if it is old enough, returns false otherwise
+    bool evictLeastRecentlyUsed();
+
+    /// destroys the entry and removes it from the cache, the LRU list and the resource index
+    void removeEntry(framebuffer_entry& entry);
+
+    void linkFront(framebuffer_entry& entry);
+    void unlink(framebuffer_entry& entry);
+
+private:
+    VkDevice mDevice = nullptr;
+    ShaderViewPool* mPoolShaderViews = nullptr;
+    cc::allocator* mDynamicAlloc = nullptr;
+
+    phi::detail::growable_map<framebuffer_key, framebuffer_entry, framebuffer_hasher> mCache;
+
+    /// the entries referencing each attachment resource, used for invalidation
+    phi::detail::growable_map<handle::resource, cc::alloc_vector<framebuffer_entry*>, resource_hasher> mEntriesByResource;
+
+    framebuffer_entry* mLRUHead = nullptr;
+    framebuffer_entry* mLRUTail = nullptr;
+
+    uint64_t mGeneration = 0;
+    uint32_t mMaxNumElements = 0;
+    uint32_t mEvictionAge = 0;
+
+    uint64_t mNumHits = 0;
+    uint64_t mNumMisses = 0;
+    uint64_t mNumInvalidations = 0;
+    uint64_t mNumEvictions = 0;
+
+    std::mutex mMutex;
+};
+}
@@ -2,9 +2,13 @@
 
 #include <phantasm-hardware-interface/common/hash.hh>
 
-void phi::vk::PipelineLayoutCache::initialize(unsigned max_elements, cc::allocator* static_alloc) { mCache.initialize(max_elements, static_alloc); }
+void phi::vk::PipelineLayoutCache::initialize(unsigned max_elements, cc::allocator* dynamic_alloc) { mCache.initialize(max_elements, dynamic_alloc); }
 
-void phi::vk::PipelineLayoutCache::destroy(VkDevice device) { reset(device); }
+void phi::vk::PipelineLayoutCache::destroy(VkDevice device)
+{
+    reset(device);
+    mCache.destroy();
+}
 
 phi::vk::pipeline_layout* phi::vk::PipelineLayoutCache::getOrCreate(VkDevice device, cc::span<const util::spirv_desc_info> reflected_ranges, bool has_push_constants)
 {
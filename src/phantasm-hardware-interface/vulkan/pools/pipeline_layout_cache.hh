@@ -3,7 +3,7 @@
 #include <clean-core/vector.hh>
 
 #include <phantasm-hardware-interface/arguments.hh>
-#include <phantasm-hardware-interface/common/container/stable_map.hh>
+#include <phantasm-hardware-interface/common/container/growable_map.hh>
 
 #include <phantasm-hardware-interface/vulkan/loader/spirv_patch_util.hh>
 #include <phantasm-hardware-interface/vulkan/loader/vulkan_fwd.hh>
@@ -18,7 +18,8 @@ class DescriptorAllocator;
 class PipelineLayoutCache
 {
 public:
-    void initialize(unsigned max_elements, cc::allocator* static_alloc);
+    /// the map grows at runtime, requires the thread-safe dynamic allocator
+    void initialize(unsigned max_elements, cc::allocator* dynamic_alloc);
     void destroy(VkDevice device);
 
     /// receive an existing root signature matching the shape, or create a new one
@@ -76,7 +77,7 @@ private:
         }
     };
 
-    phi::detail::stable_map<pipeline_layout_key, pipeline_layout, pipeline_layout_hasher> mCache;
+    phi::detail::growable_map<pipeline_layout_key, pipeline_layout, pipeline_layout_hasher> mCache;
 };
 
 }
@@ -1,8 +1,10 @@
 #include "pipeline_pool.hh"
 
+#include <clean-core/alloc_array.hh>
 #include <clean-core/defer.hh>
 
 #include <phantasm-hardware-interface/common/log.hh>
+#include <phantasm-hardware-interface/common/parallel_for.hh>
 
 #include <phantasm-hardware-interface/vulkan/common/util.hh>
 #include <phantasm-hardware-interface/vulkan/loader/spirv_patch_util.hh>
@@ -35,6 +37,30 @@ void verifyReflectionDataConsistencyInDebug(cc::span<const phi::vk::util::spirv_
     (void)shouldHavePushConstants;
 #endif
 }
+
+// whether all stages were loaded, invalid pre-patched containers result in stages without data
+bool areShaderStagesValid(cc::span<phi::vk::util::patched_spirv_stage const> stages)
+{
+    for (auto const& stage : stages)
+    {
+        if (stage.data == nullptr)
+            return false;
+    }
+    return true;
+}
+
+// the intermediate state of a single PSO during batched creation
+struct pending_pso_intermediates
+{
+    cc::capped_vector<phi::vk::util::patched_spirv_stage, 6> patched_shader_stages; ///< owned by the SPIR-V reflection cache
+    phi::vk::util::spirv_refl_info spirv_info;
+    cc::alloc_vector<phi::vk::util::spirv_desc_info> shader_descriptor_ranges;
+    phi::vk::pipeline_layout* layout = nullptr;
+    bool is_valid = false; ///< false if a shader binary could not be loaded, no pipeline is created
+};
+
+// amount of compute pipelines created per vkCreateComputePipelines call in batched creation
+constexpr uint32_t gc_compute_pipeline_batch_size = 16;
 } // namespace
 
 phi::handle::pipeline_state phi::vk::PipelinePool::createPipelineState(phi::arg::vertex_format vertex_format,
@@ -46,15 +72,10 @@ phi::handle::pipeline_state phi::vk::PipelinePool::createPipelineState(phi::arg:
                                                                        cc::allocator* scratch_alloc,
                                                                        char const* dbg_name)
 {
-    // Patch and reflect SPIR-V binaries
+    // Patch and reflect SPIR-V binaries, or retrieve them from cache
     cc::capped_vector<util::patched_spirv_stage, 6> patched_shader_stages;
     cc::alloc_vector<util::spirv_desc_info> shader_descriptor_ranges;
     bool has_push_constants = false;
-    CC_DEFER
-    {
-        for (auto const& ps : patched_shader_stages)
-            util::free_patched_spirv(ps);
-    };
 
     {
         util::spirv_refl_info spirv_info;
@@ -62,7 +83,13 @@ phi::handle::pipeline_state phi::vk::PipelinePool::createPipelineState(phi::arg:
 
         for (auto const& shader : shader_stages)
         {
-            patched_shader_stages.push_back(util::create_patched_spirv(shader.binary.data, shader.binary.size, spirv_info, scratch_alloc));
+            patched_shader_stages.push_back(mSpirvCache.getOrCreate(shader.binary.data, shader.binary.size, spirv_info, scratch_alloc));
+        }
+
+        if (!areShaderStagesValid(patched_shader_stages))
+        {
+            PHI_LOG_ERROR(R"(createPipelineState: failed to load shader binaries of graphics PSO "{}")", dbg_name ? dbg_name : "");
+            return handle::null_pipeline_state;
         }
 
         shader_descriptor_ranges = util::merge_spirv_descriptors(spirv_info.descriptor_infos, scratch_alloc);
@@ -116,7 +143,7 @@ phi::handle::pipeline_state phi::vk::PipelinePool::createPipelineState(phi::arg:
 
         VkRenderPass dummy_render_pass = create_render_pass(mDevice, framebuffer_config, primitive_config);
 
-        new_node.raw_pipeline = create_pipeline(mDevice, dummy_render_pass, new_node.associated_pipeline_layout->raw_layout, patched_shader_stages,
+        new_node.raw_pipeline = create_pipeline(mDevice, mPipelineCache, dummy_render_pass, new_node.associated_pipeline_layout->raw_layout, patched_shader_stages,
                                                 primitive_config, vert_format_native, vertex_format.vertex_sizes_bytes, framebuffer_config);
 
         util::set_object_name(mDevice, new_node.raw_pipeline, "phi graphics pso %s", dbg_name ? dbg_name : "");
@@ -133,17 +160,22 @@ phi::handle::pipeline_state phi::vk::PipelinePool::createComputePipelineState(ph
                                                                               cc::allocator* scratch_alloc,
                                                                               char const* dbg_name)
 {
-    // Patch and reflect SPIR-V binary
+    // Patch and reflect SPIR-V binary, or retrieve it from cache
     util::patched_spirv_stage patched_shader_stage;
     cc::alloc_vector<util::spirv_desc_info> shader_descriptor_ranges;
     bool has_push_constants = false;
-    CC_DEFER { util::free_patched_spirv(patched_shader_stage); };
 
     {
         util::spirv_refl_info spirv_info;
         spirv_info.descriptor_infos.reset_reserve(scratch_alloc, 10);
 
-        patched_shader_stage = util::create_patched_spirv(compute_shader.data, compute_shader.size, spirv_info, scratch_alloc);
+        patched_shader_stage = mSpirvCache.getOrCreate(compute_shader.data, compute_shader.size, spirv_info, scratch_alloc);
+        if (patched_shader_stage.data == nullptr)
+        {
+            PHI_LOG_ERROR(R"(createComputePipelineState: failed to load shader binary of compute PSO "{}")", dbg_name ? dbg_name : "");
+            return handle::null_pipeline_state;
+        }
+
         shader_descriptor_ranges = util::merge_spirv_descriptors(spirv_info.descriptor_infos, scratch_alloc);
         has_push_constants = spirv_info.has_push_constants;
 
@@ -165,12 +197,193 @@ phi::handle::pipeline_state phi::vk::PipelinePool::createComputePipelineState(ph
     new_node.associated_pipeline_layout = layout;
 
 
-    new_node.raw_pipeline = create_compute_pipeline(mDevice, new_node.associated_pipeline_layout->raw_layout, patched_shader_stage);
+    new_node.raw_pipeline = create_compute_pipeline(mDevice, mPipelineCache, new_node.associated_pipeline_layout->raw_layout, patched_shader_stage);
     util::set_object_name(mDevice, new_node.raw_pipeline, "phi compute pso %s", dbg_name ? dbg_name : "");
 
     return {pool_index};
 }
 
+void phi::vk::PipelinePool::createPipelineStates(cc::span<const arg::graphics_pipeline_state_description> descriptions,
+                                                 cc::span<handle::pipeline_state> out_psos,
+                                                 cc::span<char const* const> dbg_names)
+{
+    CC_ASSERT(out_psos.size() == descriptions.size() && "output span must have the same size as descriptions");
+    CC_ASSERT((dbg_names.empty() || dbg_names.size() == descriptions.size()) && "debug name span must be empty or have the same size as descriptions");
+
+    uint32_t const num_psos = uint32_t(descriptions.size());
+    if (num_psos == 0)
+        return;
+
+    // the calling thread's scratch allocator is not thread-safe, worker threads use the system allocator
+    cc::allocator* const worker_alloc = cc::system_allocator;
+
+    cc::alloc_array<pending_pso_intermediates> intermediates(num_psos, worker_alloc);
+
+    // Patch and reflect SPIR-V binaries in parallel, or retrieve them from cache
+    phi::util::parallel_for(num_psos, [&](uint32_t i) {
+        auto const& desc = descriptions[i];
+        auto& interm = intermediates[i];
+
+        interm.spirv_info.descriptor_infos.reset_reserve(worker_alloc, desc.shader_binaries.size() * 8);
+
+        for (auto const& shader : desc.shader_binaries)
+        {
+            interm.patched_shader_stages.push_back(mSpirvCache.getOrCreate(shader.binary.data, shader.binary.size, interm.spirv_info, worker_alloc));
+        }
+
+        interm.is_valid = areShaderStagesValid(interm.patched_shader_stages);
+        if (!interm.is_valid)
+            return;
+
+        interm.shader_descriptor_ranges = util::merge_spirv_descriptors(interm.spirv_info.descriptor_infos, worker_alloc);
+
+        verifyReflectionDataConsistencyInDebug(interm.shader_descriptor_ranges, desc.shader_arg_shapes, interm.spirv_info.has_push_constants,
+                                               desc.has_root_constants);
+    });
+
+    // Resolve all layouts with a single lock, identical ones are deduplicated by the cache
+    {
+        auto lg = std::lock_guard(mMutex);
+        for (auto& interm : intermediates)
+        {
+            if (interm.is_valid)
+                interm.layout = mLayoutCache.getOrCreate(mDevice, interm.shader_descriptor_ranges, interm.spirv_info.has_push_constants);
+        }
+    }
+
+    for (auto i = 0u; i < num_psos; ++i)
+    {
+        if (!intermediates[i].is_valid)
+        {
+            char const* const dbg_name = dbg_names.empty() ? nullptr : dbg_names[i];
+            PHI_LOG_ERROR(R"(createPipelineStates: failed to load shader binaries of graphics PSO #{} "{}")", i, dbg_name ? dbg_name : "");
+            out_psos[i] = handle::null_pipeline_state;
+            continue;
+        }
+
+        uint32_t const pool_index = mPool.acquire();
+        mPool.get(pool_index).associated_pipeline_layout = intermediates[i].layout;
+        out_psos[i] = {pool_index};
+    }
+
+    // Compile pipelines in parallel, VkPipelineCache is internally synchronized
+    phi::util::parallel_for(num_psos, [&](uint32_t i) {
+        if (!intermediates[i].is_valid)
+            return;
+
+        auto const& desc = descriptions[i];
+        CC_ASSERT(desc.config.samples > 0 && "invalid amount of MSAA samples");
+
+        pso_node& node = mPool.get(out_psos[i]._value);
+
+        auto const vert_format_native = util::get_native_vertex_format(desc.vertices.attributes);
+        VkRenderPass dummy_render_pass = create_render_pass(mDevice, desc.framebuffer, desc.config);
+
+        node.raw_pipeline = create_pipeline(mDevice, mPipelineCache, dummy_render_pass, node.associated_pipeline_layout->raw_layout,
+                                            intermediates[i].patched_shader_stages, desc.config, vert_format_native, desc.vertices.vertex_sizes_bytes,
+                                            desc.framebuffer);
+
+        char const* const dbg_name = dbg_names.empty() ? nullptr : dbg_names[i];
+        util::set_object_name(mDevice, node.raw_pipeline, "phi graphics pso %s", dbg_name ? dbg_name : "");
+
+        vkDestroyRenderPass(mDevice, dummy_render_pass, nullptr);
+    });
+}
+
+void phi::vk::PipelinePool::createComputePipelineStates(cc::span<const arg::compute_pipeline_state_description> descriptions,
+                                                        cc::span<handle::pipeline_state> out_psos,
+                                                        cc::span<char const* const> dbg_names)
+{
+    CC_ASSERT(out_psos.size() == descriptions.size() && "output span must have the same size as descriptions");
+    CC_ASSERT((dbg_names.empty() || dbg_names.size() == descriptions.size()) && "debug name span must be empty or have the same size as descriptions");
+
+    uint32_t const num_psos = uint32_t(descriptions.size());
+    if (num_psos == 0)
+        return;
+
+    // the calling thread's scratch allocator is not thread-safe, worker threads use the system allocator
+    cc::allocator* const worker_alloc = cc::system_allocator;
+
+    cc::alloc_array<pending_pso_intermediates> intermediates(num_psos, worker_alloc);
+
+    // Patch and reflect SPIR-V binaries in parallel, or retrieve them from cache
+    phi::util::parallel_for(num_psos, [&](uint32_t i) {
+        auto const& desc = descriptions[i];
+        auto& interm = intermediates[i];
+
+        interm.spirv_info.descriptor_infos.reset_reserve(worker_alloc, 10);
+        interm.patched_shader_stages.push_back(mSpirvCache.getOrCreate(desc.shader.data, desc.shader.size, interm.spirv_info, worker_alloc));
+
+        interm.is_valid = areShaderStagesValid(interm.patched_shader_stages);
+        if (!interm.is_valid)
+            return;
+
+        interm.shader_descriptor_ranges = util::merge_spirv_descriptors(interm.spirv_info.descriptor_infos, worker_alloc);
+
+        verifyReflectionDataConsistencyInDebug(interm.shader_descriptor_ranges, desc.shader_arg_shapes, interm.spirv_info.has_push_constants,
+                                               desc.has_root_constants);
+    });
+
+    // flat arrays for the batched native calls, only containing PSOs whose shader was loaded
+    cc::alloc_array<uint32_t> valid_indices(num_psos, worker_alloc);
+    cc::alloc_array<VkPipelineLayout> raw_layouts(num_psos, worker_alloc);
+    cc::alloc_array<util::patched_spirv_stage> flat_shader_stages(num_psos, worker_alloc);
+    cc::alloc_array<VkPipeline> raw_pipelines(num_psos, worker_alloc);
+    uint32_t num_valid = 0;
+
+    // Resolve all layouts with a single lock, identical ones are deduplicated by the cache
+    {
+        auto lg = std::lock_guard(mMutex);
+        for (auto i = 0u; i < num_psos; ++i)
+        {
+            auto& interm = intermediates[i];
+            if (!interm.is_valid)
+                continue;
+
+            interm.layout = mLayoutCache.getOrCreate(mDevice, interm.shader_descriptor_ranges, interm.spirv_info.has_push_constants);
+            valid_indices[num_valid] = i;
+            raw_layouts[num_valid] = interm.layout->raw_layout;
+            flat_shader_stages[num_valid] = interm.patched_shader_stages[0];
+            ++num_valid;
+        }
+    }
+
+    // Create pipelines in batches, batches are distributed across threads
+    uint32_t const num_batches = (num_valid + gc_compute_pipeline_batch_size - 1) / gc_compute_pipeline_batch_size;
+    phi::util::parallel_for(num_batches, [&](uint32_t batch_i) {
+        uint32_t const offset = batch_i * gc_compute_pipeline_batch_size;
+        uint32_t const batch_size = cc::min(gc_compute_pipeline_batch_size, num_valid - offset);
+
+        create_compute_pipelines(mDevice, mPipelineCache, cc::span{raw_layouts}.subspan(offset, batch_size),
+                                 cc::span{flat_shader_stages}.subspan(offset, batch_size), cc::span{raw_pipelines}.subspan(offset, batch_size), worker_alloc);
+    });
+
+    for (auto i = 0u; i < num_psos; ++i)
+    {
+        if (!intermediates[i].is_valid)
+        {
+            char const* const dbg_name = dbg_names.empty() ? nullptr : dbg_names[i];
+            PHI_LOG_ERROR(R"(createComputePipelineStates: failed to load shader binary of compute PSO #{} "{}")", i, dbg_name ? dbg_name : "");
+            out_psos[i] = handle::null_pipeline_state;
+        }
+    }
+
+    for (auto valid_i = 0u; valid_i < num_valid; ++valid_i)
+    {
+        uint32_t const i = valid_indices[valid_i];
+        uint32_t const pool_index = mPool.acquire();
+
+        pso_node& new_node = mPool.get(pool_index);
+        new_node.associated_pipeline_layout = intermediates[i].layout;
+        new_node.raw_pipeline = raw_pipelines[valid_i];
+
+        char const* const dbg_name = dbg_names.empty() ? nullptr : dbg_names[i];
+        util::set_object_name(mDevice, new_node.raw_pipeline, "phi compute pso %s", dbg_name ? dbg_name : "");
+
+        out_psos[i] = {pool_index};
+    }
+}
+
 phi::handle::pipeline_state phi::vk::PipelinePool::createRaytracingPipelineState(cc::span<const arg::raytracing_shader_library> libraries,
                                                                                  cc::span<const arg::raytracing_argument_association> arg_assocs,
                                                                                  cc::span<const arg::raytracing_hit_group> hit_groups,
@@ -202,7 +415,7 @@ phi::handle::pipeline_state phi::vk::PipelinePool::createRaytracingPipelineState
     // Populate new node
     pso_node& new_node = mPool.get(pool_index);
     new_node.associated_pipeline_layout = layout;
-    new_node.raw_pipeline = create_raytracing_pipeline(mDevice, shader_intermediates, new_node.associated_pipeline_layout->raw_layout, arg_assocs,
+    new_node.raw_pipeline = create_raytracing_pipeline(mDevice, mPipelineCache, shader_intermediates, new_node.associated_pipeline_layout->raw_layout, arg_assocs,
                                                        hit_groups, max_recursion, max_payload_size_bytes, max_attribute_size_bytes, scratch_alloc);
 
     return {pool_index};
@@ -210,6 +423,9 @@ phi::handle::pipeline_state phi::vk::PipelinePool::createRaytracingPipelineState
 
 void phi::vk::PipelinePool::free(phi::handle::pipeline_state ps)
 {
+    if (!ps.is_valid())
+        return;
+
     // This requires no synchronization, as VMA internally syncs
     pso_node& freed_node = mPool.get(ps._value);
     vkDestroyPipeline(mDevice, freed_node.raw_pipeline, nullptr);
@@ -217,17 +433,33 @@ void phi::vk::PipelinePool::free(phi::handle::pipeline_state ps)
     mPool.release(ps._value);
 }
 
-void phi::vk::PipelinePool::initialize(VkDevice device, unsigned max_num_psos, cc::allocator* static_alloc)
+void phi::vk::PipelinePool::initialize(VkDevice device,
+                                      VkPhysicalDeviceProperties const& device_props,
+                                      unsigned max_num_psos,
+                                      char const* pipeline_cache_path,
+                                      cc::allocator* static_alloc,
+                                      cc::allocator* dynamic_alloc)
 {
     mDevice = device;
     mPool.initialize(max_num_psos, static_alloc);
 
-    // almost arbitrary, revisit upon crashes
-    mLayoutCache.initialize(max_num_psos, static_alloc);
-    mRenderPassCache.initialize(max_num_psos, static_alloc);
+    mPipelineCache = create_pipeline_cache(mDevice, device_props, pipeline_cache_path);
+    if (pipeline_cache_path != nullptr)
+    {
+        mPipelineCachePath = pipeline_cache_path;
+    }
+
+    // initial capacities, all caches grow on demand
+    mLayoutCache.initialize(max_num_psos, dynamic_alloc);
+    mRenderPassCache.initialize(max_num_psos, dynamic_alloc);
+    mSpirvCache.initialize(max_num_psos, dynamic_alloc);
 
-    // precise
-    mDescriptorAllocator.initialize(mDevice, 0, 0, 0, max_num_psos);
+    if (!mPipelineCachePath.empty())
+    {
+        mSpirvCachePath = mPipelineCachePath;
+        mSpirvCachePath += ".spirv";
+        mSpirvCache.readFromFile(mSpirvCachePath.c_str());
+    }
 }
 
 void phi::vk::PipelinePool::destroy()
@@ -244,16 +476,44 @@ void phi::vk::PipelinePool::destroy()
         PHI_LOG("leaked {} handle::pipeline_state object{}", num_leaks, (num_leaks == 1 ? "" : "s"));
     }
 
+    if (!mPipelineCachePath.empty())
+    {
+        flushPipelineCache();
+    }
+    vkDestroyPipelineCache(mDevice, mPipelineCache, nullptr);
+    mPipelineCache = nullptr;
+
     mLayoutCache.destroy(mDevice);
     mRenderPassCache.destroy(mDevice);
-    mDescriptorAllocator.destroy();
+    mSpirvCache.destroy();
+}
+
+bool phi::vk::PipelinePool::flushPipelineCache()
+{
+    if (mPipelineCachePath.empty())
+        return false;
+
+    // VkPipelineCache is internally synchronized, no lock required
+    bool const success = write_pipeline_cache(mDevice, mPipelineCache, mPipelineCachePath.c_str());
+    if (!success)
+    {
+        PHI_LOG_WARN("failed to write pipeline cache to {}", mPipelineCachePath.c_str());
+    }
+
+    bool const success_spirv = mSpirvCache.writeToFile(mSpirvCachePath.c_str());
+    if (!success_spirv)
+    {
+        PHI_LOG_WARN("failed to write SPIR-V reflection cache to {}", mSpirvCachePath.c_str());
+    }
+
+    return success && success_spirv;
 }
 
-VkRenderPass phi::vk::PipelinePool::getOrCreateRenderPass(const phi::cmd::begin_render_pass& brp_cmd, int num_samples, cc::span<const format> rt_formats)
+VkRenderPass phi::vk::PipelinePool::getOrCreateRenderPass(const phi::cmd::begin_render_pass& brp_cmd,
+                                                          int num_samples,
+                                                          cc::span<const format> rt_formats,
+                                                          RenderPassCache::thread_cache& local_cache)
 {
-    // NOTE: This is a mutex acquire on the hot path (in cmd::begin_render_pass)
-    // Its not quite trivial to fix this, all solutions involve tradeoffs,
-    // either restricting API free-threadedness, or making clear types part of the handle::pipeline_state
-    auto lg = std::lock_guard(mMutex);
-    return mRenderPassCache.getOrCreate(mDevice, brp_cmd, num_samples, rt_formats);
+    // hot path (in cmd::begin_render_pass), the render pass cache is synchronized independently of mMutex
+    return mRenderPassCache.getOrCreate(mDevice, brp_cmd, num_samples, rt_formats, local_cache);
 }
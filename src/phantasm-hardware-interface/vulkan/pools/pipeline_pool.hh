@@ -4,6 +4,7 @@
 
 #include <clean-core/atomic_linked_pool.hh>
 #include <clean-core/capped_vector.hh>
+#include <clean-core/string.hh>
 
 #include <phantasm-hardware-interface/arguments.hh>
 #include <phantasm-hardware-interface/types.hh>
@@ -13,6 +14,7 @@
 
 #include "pipeline_layout_cache.hh"
 #include "render_pass_cache.hh"
+#include "spirv_reflection_cache.hh"
 
 namespace phi::vk
 {
@@ -46,8 +48,22 @@ public:
                                                                        unsigned max_attribute_size_bytes,
                                                                        cc::allocator* scratch_alloc);
 
+    /// create multiple graphics PSOs, SPIR-V patching, reflection and pipeline compilation run in parallel
+    /// pipeline layouts are resolved in a single synchronized pass, deduplicating identical layouts
+    void createPipelineStates(cc::span<arg::graphics_pipeline_state_description const> descriptions,
+                              cc::span<handle::pipeline_state> out_psos,
+                              cc::span<char const* const> dbg_names);
+
+    /// create multiple compute PSOs, SPIR-V patching and reflection run in parallel, pipelines are created in batched native calls
+    void createComputePipelineStates(cc::span<arg::compute_pipeline_state_description const> descriptions,
+                                     cc::span<handle::pipeline_state> out_psos,
+                                     cc::span<char const* const> dbg_names);
+
     void free(handle::pipeline_state ps);
 
+    /// writes the pipeline cache to the path given on init, returns false if there is none or writing failed
+    bool flushPipelineCache();
+
 public:
     struct pso_node
     {
@@ -58,18 +74,36 @@ public:
 public:
     // internal API
 
-    void initialize(VkDevice device, unsigned max_num_psos, cc::allocator* static_alloc);
+    /// pipeline_cache_path can be nullptr, in which case the pipeline cache is not persisted
+    /// the node pool is fixed-size, the caches grow at runtime and require the thread-safe dynamic allocator
+    void initialize(VkDevice device,
+                    VkPhysicalDeviceProperties const& device_props,
+                    unsigned max_num_psos,
+                    char const* pipeline_cache_path,
+                    cc::allocator* static_alloc,
+                    cc::allocator* dynamic_alloc);
     void destroy();
 
     [[nodiscard]] pso_node const& get(handle::pipeline_state ps) const { return mPool.get(ps._value); }
 
-    [[nodiscard]] VkRenderPass getOrCreateRenderPass(cmd::begin_render_pass const& brp_cmd, int num_samples, cc::span<format const> rt_formats);
+    /// lock-free if the configuration was already used with this thread cache
+    [[nodiscard]] VkRenderPass getOrCreateRenderPass(cmd::begin_render_pass const& brp_cmd,
+                                                     int num_samples,
+                                                     cc::span<format const> rt_formats,
+                                                     RenderPassCache::thread_cache& local_cache);
+
+    [[nodiscard]] RenderPassCache::cache_stats getRenderPassCacheStats() const { return mRenderPassCache.getStats(); }
+
+    [[nodiscard]] SpirvReflectionCache::cache_stats getSpirvReflectionCacheStats() { return mSpirvCache.getStats(); }
 
 private:
     VkDevice mDevice;
+    VkPipelineCache mPipelineCache = nullptr;
+    cc::string mPipelineCachePath;
+    cc::string mSpirvCachePath;
     PipelineLayoutCache mLayoutCache;
     RenderPassCache mRenderPassCache;
-    DescriptorAllocator mDescriptorAllocator;
+    SpirvReflectionCache mSpirvCache;
     cc::atomic_linked_pool<pso_node> mPool;
     std::mutex mMutex;
 };
@@ -4,7 +4,7 @@
 
 #include <clean-core/atomic_linked_pool.hh>
 
-#include <phantasm-hardware-interface/common/page_allocator.hh>
+#include <phantasm-hardware-interface/common/bitmap_page_allocator.hh>
 #include <phantasm-hardware-interface/types.hh>
 
 #include <phantasm-hardware-interface/vulkan/loader/volk.hh>
@@ -59,7 +59,7 @@ public:
 
 private:
     VkQueryPool mHeap;
-    phi::page_allocator mPageAllocator;
+    phi::bitmap_page_allocator mPageAllocator;
     VkQueryType mType;
 };
 
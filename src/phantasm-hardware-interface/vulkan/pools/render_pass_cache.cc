@@ -3,32 +3,70 @@
 #include <phantasm-hardware-interface/common/hash.hh>
 #include <phantasm-hardware-interface/vulkan/render_pass_pipeline.hh>
 
-void phi::vk::RenderPassCache::initialize(unsigned max_elements, cc::allocator* static_alloc)
+void phi::vk::RenderPassCache::initialize(unsigned max_elements, cc::allocator* dynamic_alloc)
 {
-    mCache.initialize(max_elements, static_alloc);
-    mCache.memset_values_zero(); // we're dealing with plain pointers, memset to nullptr
+    mCache.initialize(max_elements, dynamic_alloc);
 }
 
-void phi::vk::RenderPassCache::destroy(VkDevice device) { reset(device); }
+void phi::vk::RenderPassCache::destroy(VkDevice device)
+{
+    reset(device);
+    mCache.destroy();
+}
 
-VkRenderPass phi::vk::RenderPassCache::getOrCreate(VkDevice device, cmd::begin_render_pass const& brp, unsigned num_samples, cc::span<const format> override_rt_formats)
+VkRenderPass phi::vk::RenderPassCache::getOrCreate(
+    VkDevice device, cmd::begin_render_pass const& brp, unsigned num_samples, cc::span<const format> override_rt_formats, thread_cache& local_cache)
 {
     auto const readonly_key = render_pass_key_readonly{brp, num_samples, override_rt_formats};
+    auto const hash = hashKey(brp, num_samples, override_rt_formats);
+    auto const slot = unsigned(hash % thread_cache::num_entries);
 
-    VkRenderPass& val = mCache[readonly_key];
-    if (val == nullptr)
+    // L1, lock-free as the thread cache is owned by the calling thread
+    if (local_cache.hashes[slot] == hash && local_cache.keys[slot] != nullptr && *local_cache.keys[slot] == readonly_key)
     {
-        val = create_render_pass(device, brp, num_samples, override_rt_formats);
+        local_cache.num_hits.store(local_cache.num_hits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return local_cache.values[slot];
     }
 
-    return val;
+    // L2, shared across threads
+    render_pass_key const* stored_key = nullptr;
+    VkRenderPass const res = getOrCreateShared(device, brp, num_samples, override_rt_formats, stored_key);
+
+    local_cache.hashes[slot] = hash;
+    local_cache.keys[slot] = stored_key;
+    local_cache.values[slot] = res;
+    return res;
 }
 
 void phi::vk::RenderPassCache::reset(VkDevice device)
 {
     mCache.iterate_elements([&](VkRenderPass elem) { vkDestroyRenderPass(device, elem, nullptr); });
     mCache.reset();
-    mCache.memset_values_zero();
+}
+
+phi::vk::RenderPassCache::cache_stats phi::vk::RenderPassCache::getStats() const
+{
+    cache_stats res;
+    res.num_shared_lookups = mNumSharedLookups.load(std::memory_order_relaxed);
+    res.num_contended = mCache.get_num_contended_locks();
+    res.num_created = mNumCreated.load(std::memory_order_relaxed);
+    return res;
+}
+
+VkRenderPass phi::vk::RenderPassCache::getOrCreateShared(
+    VkDevice device, cmd::begin_render_pass const& brp, unsigned num_samples, cc::span<const format> override_rt_formats, render_pass_key const*& out_key)
+{
+    mNumSharedLookups.fetch_add(1, std::memory_order_relaxed);
+
+    auto const readonly_key = render_pass_key_readonly{brp, num_samples, override_rt_formats};
+
+    auto const& elem = mCache.get_or_create(readonly_key, [&](VkRenderPass& val) {
+        val = create_render_pass(device, brp, num_samples, override_rt_formats);
+        mNumCreated.fetch_add(1, std::memory_order_relaxed);
+    });
+
+    out_key = &elem.key;
+    return elem.value;
 }
 
 uint64_t phi::vk::RenderPassCache::hashKey(cmd::begin_render_pass const& brp, unsigned num_samples, cc::span<const format> override_rt_formats)
@@ -78,6 +116,6 @@ bool phi::vk::RenderPassCache::render_pass_key::operator==(const phi::vk::Render
     }
     else
     {
-        return true;
+        return false;
     }
 }
@@ -1,10 +1,12 @@
 #pragma once
 
+#include <atomic>
+
 #include <clean-core/capped_vector.hh>
 #include <clean-core/span.hh>
 
 #include <phantasm-hardware-interface/commands.hh>
-#include <phantasm-hardware-interface/common/container/stable_map.hh>
+#include <phantasm-hardware-interface/common/container/growable_map.hh>
 #include <phantasm-hardware-interface/limits.hh>
 #include <phantasm-hardware-interface/types.hh>
 
@@ -18,24 +20,62 @@ struct begin_render_pass;
 namespace phi::vk
 {
 /// Persistent cache for render passes
-/// Unsynchronized, only used inside of pipeline pool
+/// Two levels: an unsynchronized L1 per recording thread (thread_cache) in front of the shared, synchronized map
+/// L1 hits are lock-free, the shared map is only locked on the first use of a configuration per thread
 class RenderPassCache
 {
+private:
+    struct render_pass_key;
+
 public:
-    void initialize(unsigned max_elements, cc::allocator* static_alloc);
+    struct cache_stats
+    {
+        uint64_t num_local_hits = 0;     ///< lookups served by a thread_cache, without locking
+        uint64_t num_shared_lookups = 0; ///< lookups which missed the thread_cache and locked the shared map
+        uint64_t num_contended = 0;      ///< shared lookups which had to wait for the lock
+        uint64_t num_created = 0;        ///< render passes created
+    };
+
+    /// direct-mapped L1 owned by a single recording thread
+    /// entries stay valid until the RenderPassCache is reset
+    struct thread_cache
+    {
+        static constexpr unsigned num_entries = 32;
+
+        uint64_t hashes[num_entries] = {};
+        render_pass_key const* keys[num_entries] = {};
+        VkRenderPass values[num_entries] = {};
+
+        /// only written by the owning thread, readable from others for statistics
+        std::atomic<uint64_t> num_hits = {0};
+    };
+
+public:
+    /// the map grows at runtime, requires the thread-safe dynamic allocator
+    void initialize(unsigned max_elements, cc::allocator* dynamic_alloc);
     void destroy(VkDevice device);
 
     /// receive an existing render pass matching the framebuffer formats and config, or create a new one
     /// While pixel format information IS present in cmd::begin_render_pass, it is invalid if that RT is a backbuffer, which is why
     /// the additional override_rt_formats span is passed
-    [[nodiscard]] VkRenderPass getOrCreate(VkDevice device, cmd::begin_render_pass const& brp, unsigned num_samples, cc::span<format const> override_rt_formats);
+    /// the thread cache must be owned by the calling thread
+    [[nodiscard]] VkRenderPass getOrCreate(
+        VkDevice device, cmd::begin_render_pass const& brp, unsigned num_samples, cc::span<format const> override_rt_formats, thread_cache& local_cache);
 
     /// destroys all elements inside, and clears the map
+    /// invalidates all thread caches, must not be called concurrently with getOrCreate
     void reset(VkDevice device);
 
+    /// statistics of the shared map, num_local_hits has to be summed up from the thread caches
+    [[nodiscard]] cache_stats getStats() const;
+
 private:
     static uint64_t hashKey(cmd::begin_render_pass const& brp, unsigned num_samples, cc::span<const format> override_rt_formats);
 
+    /// the shared lookup, synchronized internally by mCache
+    VkRenderPass getOrCreateShared(
+        VkDevice device, cmd::begin_render_pass const& brp, unsigned num_samples, cc::span<format const> override_rt_formats, render_pass_key const*& out_key);
+
     struct render_pass_key_readonly
     {
         cmd::begin_render_pass const& brp;
@@ -60,7 +100,10 @@ private:
         uint64_t operator()(render_pass_key const& v) const noexcept { return hashKey(v.brp, v.num_samples, v.override_formats); }
     };
 
-    phi::detail::stable_map<render_pass_key, VkRenderPass, render_pass_hasher> mCache;
+    phi::detail::growable_map<render_pass_key, VkRenderPass, render_pass_hasher, true> mCache;
+
+    std::atomic<uint64_t> mNumSharedLookups = {0};
+    std::atomic<uint64_t> mNumCreated = {0};
 };
 
 }
@@ -7,6 +7,7 @@
 
 #include <phantasm-hardware-interface/common/format_size.hh>
 #include <phantasm-hardware-interface/common/log.hh>
+#include <phantasm-hardware-interface/common/transient_placement.hh>
 
 #include <phantasm-hardware-interface/util.hh>
 #include <phantasm-hardware-interface/vulkan/common/native_enum.hh>
@@ -62,62 +63,68 @@ constexpr char const* vk_get_heap_type_literal(phi::resource_heap heap)
 
     return "unknown_heap_type";
 }
-}
 
-phi::handle::resource phi::vk::ResourcePool::createTexture(arg::texture_description const& description, char const* dbg_name)
+VkImageCreateInfo vk_get_image_create_info(phi::arg::texture_description const& description)
 {
-    CC_CONTRACT(description.width > 0 && description.height > 0);
     VkImageCreateInfo image_info = {};
     image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     image_info.pNext = nullptr;
 
-    image_info.imageType = util::to_native(description.dim);
-    image_info.format = util::to_vk_format(description.fmt);
+    image_info.imageType = phi::vk::util::to_native(description.dim);
+    image_info.format = phi::vk::util::to_vk_format(description.fmt);
 
     image_info.extent.width = description.width;
     image_info.extent.height = description.height;
-    image_info.extent.depth = description.dim == texture_dimension::t3d ? description.depth_or_array_size : 1;
+    image_info.extent.depth = description.dim == phi::texture_dimension::t3d ? description.depth_or_array_size : 1;
     image_info.mipLevels = description.num_mips < 1 ? phi::util::get_num_mips(description.width, description.height) : description.num_mips;
-    image_info.arrayLayers = description.dim == texture_dimension::t3d ? 1 : description.depth_or_array_size;
+    image_info.arrayLayers = description.dim == phi::texture_dimension::t3d ? 1 : description.depth_or_array_size;
 
-    image_info.samples = util::to_native_sample_flags(description.num_samples);
+    image_info.samples = phi::vk::util::to_native_sample_flags(description.num_samples);
     image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
     // TRANSFER_DST/SRC: can be copied
     image_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
-    if (description.usage & resource_usage_flags::allow_uav)
+    if (description.usage & phi::resource_usage_flags::allow_uav)
     {
         // STORAGE: can be used as a UAV in shaders
         image_info.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
     }
-    if (description.usage & resource_usage_flags::allow_depth_stencil)
+    if (description.usage & phi::resource_usage_flags::allow_depth_stencil)
     {
         image_info.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
     }
-    if (description.usage & resource_usage_flags::allow_render_target)
+    if (description.usage & phi::resource_usage_flags::allow_render_target)
     {
         image_info.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
     }
-    if ((description.usage & resource_usage_flags::deny_shader_resource) == 0)
+    if ((description.usage & phi::resource_usage_flags::deny_shader_resource) == 0)
     {
         // SAMPLED: can be read with a sampler;
         image_info.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
     }
 
-
     image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
 
     // MUTABLE_FORMAT: can be viewed with a different format
     image_info.flags = VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
 
-    if (description.dim == texture_dimension::t2d && description.depth_or_array_size == 6)
+    if (description.dim == phi::texture_dimension::t2d && description.depth_or_array_size == 6)
     {
         // t2d[6] is likely used as a cubemap
         image_info.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
     }
 
+    return image_info;
+}
+}
+
+phi::handle::resource phi::vk::ResourcePool::createTexture(arg::texture_description const& description, char const* dbg_name)
+{
+    CC_CONTRACT(description.width > 0 && description.height > 0);
+    VkImageCreateInfo const image_info = vk_get_image_create_info(description);
+
     VmaAllocationCreateInfo alloc_info = {};
     alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
 
@@ -129,6 +136,70 @@ phi::handle::resource phi::vk::ResourcePool::createTexture(arg::texture_descript
     return acquireImage(res_alloc, res_image, description, image_info.mipLevels);
 }
 
+void phi::vk::ResourcePool::createTransientTextures(cc::span<arg::transient_texture_description const> descriptions,
+                                                   cc::span<handle::resource> out_resources,
+                                                   char const* dbg_name,
+                                                   cc::allocator* scratch_alloc)
+{
+    CC_CONTRACT(descriptions.size() == out_resources.size());
+    if (descriptions.empty())
+        return;
+
+    auto images = cc::alloc_array<VkImage>::uninitialized(descriptions.size(), scratch_alloc);
+    auto num_mips = cc::alloc_array<uint32_t>::uninitialized(descriptions.size(), scratch_alloc);
+    auto requests = cc::alloc_array<transient_placement_request>::uninitialized(descriptions.size(), scratch_alloc);
+    auto offsets = cc::alloc_array<uint64_t>::uninitialized(descriptions.size(), scratch_alloc);
+
+    // the memory block must satisfy the requirements of all images
+    VkMemoryRequirements block_requirements = {};
+    block_requirements.alignment = 1;
+    block_requirements.memoryTypeBits = uint32_t(-1);
+
+    for (auto i = 0u; i < descriptions.size(); ++i)
+    {
+        auto const& description = descriptions[i].desc;
+        CC_CONTRACT(description.width > 0 && description.height > 0);
+
+        VkImageCreateInfo const image_info = vk_get_image_create_info(description);
+        PHI_VK_VERIFY_SUCCESS(vkCreateImage(mDevice, &image_info, nullptr, &images[i]));
+        num_mips[i] = image_info.mipLevels;
+
+        VkMemoryRequirements mem_reqs;
+        vkGetImageMemoryRequirements(mDevice, images[i], &mem_reqs);
+
+        requests[i] = transient_placement_request{mem_reqs.size, mem_reqs.alignment, descriptions[i].first_use, descriptions[i].last_use};
+        block_requirements.alignment = cc::max(block_requirements.alignment, mem_reqs.alignment);
+        block_requirements.memoryTypeBits &= mem_reqs.memoryTypeBits;
+    }
+
+    CC_ASSERT(block_requirements.memoryTypeBits != 0 && "transient textures have no memory type in common, create them in separate calls");
+    block_requirements.size = compute_transient_placement(requests, offsets, scratch_alloc);
+
+    VmaAllocationCreateInfo alloc_info = {};
+    alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+    VmaAllocation block_alloc;
+    PHI_VK_VERIFY_SUCCESS(vmaAllocateMemory(mAllocator, &block_requirements, &alloc_info, &block_alloc, nullptr));
+
+    uint32_t const block_index = mAliasingBlocks.acquire();
+    aliasing_block& block = mAliasingBlocks.get(block_index);
+    block.allocation = block_alloc;
+    block.num_alive_resources.store(uint32_t(descriptions.size()), std::memory_order_relaxed);
+
+    for (auto i = 0u; i < descriptions.size(); ++i)
+    {
+        auto const& description = descriptions[i].desc;
+
+        PHI_VK_VERIFY_SUCCESS(vmaBindImageMemory2(mAllocator, block_alloc, offsets[i], images[i], nullptr));
+        util::set_object_name(mDevice, images[i], "phi transient tex%s[%u] %s (%ux%u, %u mips, +%uB)", vk_get_tex_dim_literal(description.dim),
+                              description.depth_or_array_size, dbg_name ? dbg_name : "", description.width, description.height, num_mips[i],
+                              unsigned(offsets[i]));
+
+        out_resources[i] = acquireImage(block_alloc, images[i], description, num_mips[i]);
+        internalGet(out_resources[i]).aliasing_block = block_index;
+    }
+}
+
 phi::handle::resource phi::vk::ResourcePool::createBuffer(arg::buffer_description const& desc, char const* dbg_name)
 {
     CC_CONTRACT(desc.size_bytes > 0);
@@ -271,18 +342,39 @@ void phi::vk::ResourcePool::setDebugName(phi::handle::resource res, const char*
     }
 }
 
-void phi::vk::ResourcePool::initialize(VkPhysicalDevice physical, VkDevice device, unsigned max_num_resources, unsigned max_num_swapchains, cc::allocator* static_alloc)
+void phi::vk::ResourcePool::initialize(VkInstance instance,
+                                       VkPhysicalDevice physical,
+                                       VkDevice device,
+                                       bool has_memory_budget_ext,
+                                       unsigned max_num_resources,
+                                       unsigned max_num_swapchains,
+                                       phi::thread_association* thread_assoc,
+                                       unsigned num_threads,
+                                       cc::allocator* static_alloc)
 {
     mDevice = device;
     {
         VmaAllocatorCreateInfo create_info = {};
         create_info.physicalDevice = physical;
         create_info.device = device;
+        create_info.instance = instance;
+
+        // VMA only loads vkGetPhysicalDeviceMemoryProperties2KHR (the extension entrypoint) when targeting Vulkan 1.0,
+        // provide the core 1.1 version instead, all GPUs used are at least 1.1
+        VmaVulkanFunctions vulkan_functions = {};
+        if (has_memory_budget_ext)
+        {
+            create_info.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+            vulkan_functions.vkGetPhysicalDeviceMemoryProperties2KHR = vkGetPhysicalDeviceMemoryProperties2;
+            create_info.pVulkanFunctions = &vulkan_functions;
+        }
+
         PHI_VK_VERIFY_SUCCESS(vmaCreateAllocator(&create_info, &mAllocator));
     }
 
-    mAllocatorDescriptors.initialize(device, max_num_resources, 0, 0, 0);
+    mAllocatorDescriptors.initialize(device, max_num_resources, 0, 0, 0, thread_assoc, num_threads, static_alloc);
     mPool.initialize(max_num_resources + max_num_swapchains, static_alloc); // additional resources for swapchain backbuffers
+    mAliasingBlocks.initialize(max_num_resources, static_alloc);
 
     mParallelResourceDescriptions.reset(static_alloc, mPool.max_size());
 
@@ -293,6 +385,7 @@ void phi::vk::ResourcePool::initialize(VkPhysicalDevice physical, VkDevice devic
         auto backbuffer_reserved = mPool.acquire();
         resource_node& backbuffer_node = mPool.get(backbuffer_reserved);
         backbuffer_node.type = resource_node::resource_type::image;
+        backbuffer_node.aliasing_block = uint32_t(-1);
         backbuffer_node.master_state = resource_state::undefined;
         backbuffer_node.heap = resource_heap::gpu;
         backbuffer_node.image.raw_image = nullptr;
@@ -325,6 +418,7 @@ void phi::vk::ResourcePool::destroy()
     }
 
     mPool.destroy();
+    mAliasingBlocks.destroy();
     mParallelResourceDescriptions = {};
 
     vmaDestroyAllocator(mAllocator);
@@ -336,6 +430,42 @@ void phi::vk::ResourcePool::destroy()
     mAllocatorDescriptors.destroy();
 }
 
+phi::vram_state_info phi::vk::ResourcePool::getVRAMInfo(bool refresh)
+{
+    if (refresh)
+    {
+        // the budget is refetched whenever the frame index changes
+        vmaSetCurrentFrameIndex(mAllocator, mBudgetFrameIndex.fetch_add(1, std::memory_order_relaxed) + 1);
+    }
+
+    VkPhysicalDeviceMemoryProperties const* mem_props = nullptr;
+    vmaGetMemoryProperties(mAllocator, &mem_props);
+
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS] = {};
+    vmaGetBudget(mAllocator, budgets);
+
+    static_assert(VK_MAX_MEMORY_HEAPS <= limits::max_vram_heaps, "vram_state_info::heaps too small");
+
+    vram_state_info res = {};
+    res.num_heaps = mem_props->memoryHeapCount;
+    for (auto i = 0u; i < mem_props->memoryHeapCount; ++i)
+    {
+        vram_heap_info& heap = res.heaps[i];
+        heap.budget_bytes = budgets[i].budget;
+        heap.usage_bytes = budgets[i].usage;
+        heap.allocated_bytes = budgets[i].allocationBytes;
+        heap.is_device_local = (mem_props->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+
+        if (heap.is_device_local)
+        {
+            res.os_budget_bytes += heap.budget_bytes;
+            res.current_usage_bytes += heap.usage_bytes;
+        }
+    }
+
+    return res;
+}
+
 VkDeviceMemory phi::vk::ResourcePool::getRawDeviceMemory(phi::handle::resource res) const
 {
     VmaAllocationInfo alloc_info;
@@ -371,13 +501,16 @@ phi::handle::resource phi::vk::ResourcePool::acquireBuffer(VmaAllocation alloc,
 
     VkDescriptorSet cbv_desc_set = nullptr;
     VkDescriptorSet cbv_desc_set_compute = nullptr;
+    uint32_t cbv_desc_set_owner = 0;
 
     if (create_cbv_desc)
     {
-        // This is a write access to mAllocatorDescriptors
-        auto lg = std::lock_guard(mMutex);
-        cbv_desc_set = mAllocatorDescriptors.allocDescriptor(mSingleCBVLayout);
-        cbv_desc_set_compute = mAllocatorDescriptors.allocDescriptor(mSingleCBVLayoutCompute);
+        // both sets are allocated from the same block, which is stored once
+        VkDescriptorSetLayout const layouts[] = {mSingleCBVLayout, mSingleCBVLayoutCompute};
+        VkDescriptorSet sets[2];
+        mAllocatorDescriptors.allocDescriptors(layouts, sets, cbv_desc_set_owner);
+        cbv_desc_set = sets[0];
+        cbv_desc_set_compute = sets[1];
     }
 
     // Perform the initial update to the CBV descriptor set
@@ -417,11 +550,13 @@ phi::handle::resource phi::vk::ResourcePool::acquireBuffer(VmaAllocation alloc,
 
     resource_node& new_node = mPool.get(res);
     new_node.allocation = alloc;
+    new_node.aliasing_block = uint32_t(-1);
     new_node.type = resource_node::resource_type::buffer;
     new_node.heap = desc.heap;
     new_node.buffer.raw_buffer = buffer;
     new_node.buffer.raw_uniform_dynamic_ds = cbv_desc_set;
     new_node.buffer.raw_uniform_dynamic_ds_compute = cbv_desc_set_compute;
+    new_node.buffer.uniform_dynamic_ds_owner = cbv_desc_set_owner;
     new_node.buffer.width = desc.size_bytes;
     new_node.buffer.stride = desc.stride_bytes;
     new_node.buffer.num_vma_maps = 0;
@@ -442,6 +577,7 @@ phi::handle::resource phi::vk::ResourcePool::acquireImage(VmaAllocation alloc, V
 
     resource_node& new_node = mPool.get(res);
     new_node.allocation = alloc;
+    new_node.aliasing_block = uint32_t(-1);
     new_node.type = resource_node::resource_type::image;
     new_node.heap = resource_heap::gpu;
     new_node.image.raw_image = image;
@@ -464,7 +600,22 @@ void phi::vk::ResourcePool::internalFree(resource_node& node)
     // This requires no synchronization, as VMA internally syncs
     if (node.type == resource_node::resource_type::image)
     {
-        vmaDestroyImage(mAllocator, node.image.raw_image, node.allocation);
+        if (node.aliasing_block != uint32_t(-1))
+        {
+            // transient, the memory block is shared and freed along with the last resource
+            vkDestroyImage(mDevice, node.image.raw_image, nullptr);
+
+            aliasing_block& block = mAliasingBlocks.get(node.aliasing_block);
+            if (block.num_alive_resources.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                vmaFreeMemory(mAllocator, block.allocation);
+                mAliasingBlocks.release(node.aliasing_block);
+            }
+        }
+        else
+        {
+            vmaDestroyImage(mAllocator, node.image.raw_image, node.allocation);
+        }
     }
     else
     {
@@ -476,12 +627,11 @@ void phi::vk::ResourcePool::internalFree(resource_node& node)
 
         vmaDestroyBuffer(mAllocator, node.buffer.raw_buffer, node.allocation);
 
-        // This does require synchronization
+        // The allocator locks the block of the sets, no sync required
         if (node.buffer.raw_uniform_dynamic_ds != nullptr)
         {
-            auto lg = std::lock_guard(mMutex);
-            mAllocatorDescriptors.free(node.buffer.raw_uniform_dynamic_ds);
-            mAllocatorDescriptors.free(node.buffer.raw_uniform_dynamic_ds_compute);
+            mAllocatorDescriptors.free(node.buffer.raw_uniform_dynamic_ds, node.buffer.uniform_dynamic_ds_owner);
+            mAllocatorDescriptors.free(node.buffer.raw_uniform_dynamic_ds_compute, node.buffer.uniform_dynamic_ds_owner);
         }
     }
 }
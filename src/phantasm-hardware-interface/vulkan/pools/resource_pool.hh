@@ -1,6 +1,7 @@
 #pragma once
 
-#include <mutex>
+#include <atomic>
+#include <cstddef>
 
 #include <clean-core/alloc_array.hh>
 #include <clean-core/atomic_linked_pool.hh>
@@ -28,6 +29,12 @@ public:
     /// create a buffer, with an element stride if its an index or vertex buffer
     handle::resource createBuffer(arg::buffer_description const& desc, char const* dbg_name);
 
+    /// create textures placed in a single shared memory block, aliasing where their lifetimes do not overlap
+    void createTransientTextures(cc::span<arg::transient_texture_description const> descriptions,
+                                 cc::span<handle::resource> out_resources,
+                                 char const* dbg_name,
+                                 cc::allocator* scratch_alloc);
+
     std::byte* mapBuffer(handle::resource res, int begin = 0, int end = -1);
 
     void unmapBuffer(handle::resource res, int begin = 0, int end = -1);
@@ -57,6 +64,8 @@ public:
             /// unconditionally created for all qualified buffers
             VkDescriptorSet raw_uniform_dynamic_ds;
             VkDescriptorSet raw_uniform_dynamic_ds_compute;
+            /// the descriptor allocator block both descriptor sets were allocated from
+            uint32_t uniform_dynamic_ds_owner;
 
             // vertex size or index size
             uint32_t stride; 
@@ -86,14 +95,29 @@ public:
         resource_state master_state;
         resource_type type;
         phi::resource_heap heap;
+
+        /// index into the aliasing block pool for transient resources (which share their allocation), or -1
+        uint32_t aliasing_block;
     };
 
 public:
     // internal API
 
-    void initialize(VkPhysicalDevice physical, VkDevice device, unsigned max_num_resources, unsigned max_num_swapchains, cc::allocator* static_alloc);
+    void initialize(VkInstance instance,
+                    VkPhysicalDevice physical,
+                    VkDevice device,
+                    bool has_memory_budget_ext,
+                    unsigned max_num_resources,
+                    unsigned max_num_swapchains,
+                    phi::thread_association* thread_assoc,
+                    unsigned num_threads,
+                    cc::allocator* static_alloc);
     void destroy();
 
+    /// returns the budget and usage of all memory heaps, refetching the budget from the driver if refresh is set
+    /// otherwise VMA's cached values are used, which are only updated on refreshes and every few allocations
+    [[nodiscard]] vram_state_info getVRAMInfo(bool refresh);
+
     //
     // Raw VkBuffer / VkImage access
     //
@@ -197,10 +221,21 @@ private:
 
     void internalFree(resource_node& node);
 
+private:
+    /// a memory block shared by transient resources, freed along with the last of them
+    struct aliasing_block
+    {
+        VmaAllocation allocation;
+        std::atomic<uint32_t> num_alive_resources;
+    };
+
 private:
     /// The main pool data
     cc::atomic_linked_pool<resource_node> mPool;
 
+    /// Shared memory blocks of transient resources, sized like the main pool
+    cc::atomic_linked_pool<aliasing_block> mAliasingBlocks;
+
     /// Amount of handles (from the start) reserved for backbuffer injection
     unsigned mNumReservedBackbuffers;
     /// The image view of the currently injected backbuffer, stored separately to
@@ -221,8 +256,9 @@ private:
     /// "Backing" allocators
     VkDevice mDevice = nullptr;
     VmaAllocator mAllocator = nullptr;
+    /// the VMA frame index, incremented to refetch the memory budget
+    std::atomic<uint32_t> mBudgetFrameIndex = {0};
     DescriptorAllocator mAllocatorDescriptors;
-    std::mutex mMutex;
 };
 
 }
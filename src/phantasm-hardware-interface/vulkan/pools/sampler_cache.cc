@@ -0,0 +1,153 @@
+#include "sampler_cache.hh"
+
+#include <cstring>
+
+#include <clean-core/bit_cast.hh>
+
+#include <phantasm-hardware-interface/common/log.hh>
+#include <phantasm-hardware-interface/common/sse_hash.hh>
+
+#include <phantasm-hardware-interface/vulkan/common/native_enum.hh>
+#include <phantasm-hardware-interface/vulkan/common/verify.hh>
+#include <phantasm-hardware-interface/vulkan/loader/volk.hh>
+
+void phi::vk::SamplerCache::initialize(VkDevice device, unsigned max_num_unique_samplers, cc::allocator* static_alloc, cc::allocator* dynamic_alloc)
+{
+    CC_ASSERT(mDevice == nullptr && "double init");
+    mDevice = device;
+
+    mPool.initialize(max_num_unique_samplers, static_alloc);
+    mIndex.initialize(max_num_unique_samplers, dynamic_alloc);
+}
+
+void phi::vk::SamplerCache::destroy()
+{
+    if (mDevice == nullptr)
+        return;
+
+    auto num_leaks = 0;
+    mPool.iterate_allocated_nodes([&](sampler_node& leaked_node) {
+        ++num_leaks;
+        vkDestroySampler(mDevice, leaked_node.raw_sampler, nullptr);
+    });
+
+    if (num_leaks > 0)
+    {
+        PHI_LOG_WARN("leaked {} cached sampler{} on shutdown", num_leaks, num_leaks == 1 ? "" : "s");
+    }
+
+    mIndex.destroy();
+    mDevice = nullptr;
+}
+
+phi::vk::SamplerCache::handle_t phi::vk::SamplerCache::acquire(const phi::sampler_config& config)
+{
+    sampler_key const key = makeKey(config);
+
+    auto lg = std::lock_guard(mMutex);
+    ++mNumRequested;
+
+    bool is_new = false;
+    auto const& elem = mIndex.get_or_create(key, [&](handle_t& new_handle) {
+        CC_RUNTIME_ASSERTF(!mPool.is_full(),
+                           "Reached limit for unique samplers, increase max_num_samplers in the PHI backend config\n"
+                           "Current limit: {}",
+                           mPool.max_size());
+
+        new_handle = mPool.acquire();
+        sampler_node& new_node = mPool.get(new_handle);
+        new_node.key = key;
+        new_node.raw_sampler = createSampler(config);
+        new_node.refcount = 1;
+
+        ++mNumCreated;
+        ++mNumUnique;
+        is_new = true;
+    });
+
+    if (!is_new)
+    {
+        ++mPool.get(elem.value).refcount;
+    }
+
+    return elem.value;
+}
+
+void phi::vk::SamplerCache::release(handle_t handle)
+{
+    if (handle == invalid_handle)
+        return;
+
+    auto lg = std::lock_guard(mMutex);
+
+    sampler_node& node = mPool.get(handle);
+    CC_ASSERT(node.refcount > 0 && "released unreferenced sampler");
+
+    if (--node.refcount > 0)
+        return;
+
+    bool const was_erased = mIndex.erase(node.key);
+    CC_ASSERT(was_erased && "sampler missing from cache index");
+    (void)was_erased;
+
+    vkDestroySampler(mDevice, node.raw_sampler, nullptr);
+    mPool.release(handle);
+    --mNumUnique;
+}
+
+phi::vk::SamplerCache::cache_stats phi::vk::SamplerCache::getStats()
+{
+    auto lg = std::lock_guard(mMutex);
+
+    cache_stats res;
+    res.num_requested = mNumRequested;
+    res.num_created = mNumCreated;
+    res.num_unique_samplers = mNumUnique;
+    return res;
+}
+
+phi::vk::SamplerCache::sampler_key phi::vk::SamplerCache::makeKey(const phi::sampler_config& config)
+{
+    sampler_key res;
+    res.words[0] = uint32_t(config.filter) | uint32_t(config.address_u) << 8 | uint32_t(config.address_v) << 16 | uint32_t(config.address_w) << 24;
+    res.words[1] = cc::bit_cast<uint32_t>(config.min_lod);
+    res.words[2] = cc::bit_cast<uint32_t>(config.max_lod);
+    res.words[3] = cc::bit_cast<uint32_t>(config.lod_bias);
+    res.words[4] = config.max_anisotropy;
+    res.words[5] = uint32_t(config.compare_func) | uint32_t(config.border_color) << 8;
+    return res;
+}
+
+uint64_t phi::vk::SamplerCache::hashKey(const sampler_key& key)
+{
+    return phi::util::sse_hash(key.words, key.words + sizeof(key.words) / sizeof(key.words[0]));
+}
+
+VkSampler phi::vk::SamplerCache::createSampler(const phi::sampler_config& config) const
+{
+    VkSamplerCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    info.minFilter = util::to_min_filter(config.filter);
+    info.magFilter = util::to_mag_filter(config.filter);
+    info.mipmapMode = util::to_mipmap_filter(config.filter);
+    info.addressModeU = util::to_native(config.address_u);
+    info.addressModeV = util::to_native(config.address_v);
+    info.addressModeW = util::to_native(config.address_w);
+    info.minLod = config.min_lod;
+    info.maxLod = config.max_lod;
+    info.mipLodBias = config.lod_bias;
+    info.anisotropyEnable = config.filter == sampler_filter::anisotropic ? VK_TRUE : VK_FALSE;
+    info.maxAnisotropy = float(config.max_anisotropy);
+    info.borderColor = util::to_native(config.border_color);
+    info.compareEnable = config.compare_func != sampler_compare_func::disabled ? VK_TRUE : VK_FALSE;
+    info.compareOp = util::to_native(config.compare_func);
+
+    VkSampler res;
+    PHI_VK_VERIFY_SUCCESS(vkCreateSampler(mDevice, &info, nullptr, &res));
+    return res;
+}
+
+bool phi::vk::SamplerCache::sampler_key::operator==(const sampler_key& rhs) const noexcept
+{
+    return std::memcmp(words, rhs.words, sizeof(words)) == 0;
+}
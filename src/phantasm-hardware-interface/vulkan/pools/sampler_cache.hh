@@ -0,0 +1,87 @@
+#pragma once
+
+#include <mutex>
+
+#include <clean-core/atomic_linked_pool.hh>
+
+#include <phantasm-hardware-interface/common/container/growable_map.hh>
+#include <phantasm-hardware-interface/types.hh>
+
+#include <phantasm-hardware-interface/vulkan/loader/vulkan_fwd.hh>
+
+namespace phi::vk
+{
+/// Deduplicating, refcounted cache of VkSamplers shared across all shader views
+/// Samplers are keyed by the contents of their sampler_config and destroyed once unreferenced
+/// Synchronized
+class SamplerCache
+{
+public:
+    // handles of the underlying pool, 0 is never a valid handle
+    using handle_t = uint32_t;
+    static constexpr handle_t invalid_handle = 0;
+
+    struct cache_stats
+    {
+        uint64_t num_requested = 0;       ///< amount of acquire calls
+        uint64_t num_created = 0;         ///< amount of VkSamplers created
+        uint32_t num_unique_samplers = 0; ///< amount of VkSamplers currently alive
+    };
+
+public:
+    /// the node pool is fixed-size, the index grows at runtime and requires the thread-safe dynamic allocator
+    void initialize(VkDevice device, unsigned max_num_unique_samplers, cc::allocator* static_alloc, cc::allocator* dynamic_alloc);
+    void destroy();
+
+    /// receive a sampler matching the config, creating it if required, and increment its refcount
+    [[nodiscard]] handle_t acquire(sampler_config const& config);
+
+    /// decrement the refcount of a sampler, destroying it once unreferenced
+    void release(handle_t handle);
+
+    [[nodiscard]] VkSampler get(handle_t handle) const { return mPool.get(handle).raw_sampler; }
+
+    [[nodiscard]] cache_stats getStats();
+
+private:
+    // sampler_config has padding, the key is a packed, padding-free copy
+    struct sampler_key
+    {
+        uint32_t words[6];
+
+        bool operator==(sampler_key const& rhs) const noexcept;
+    };
+
+    struct sampler_key_hasher
+    {
+        uint64_t operator()(sampler_key const& key) const noexcept { return hashKey(key); }
+    };
+
+    struct sampler_node
+    {
+        sampler_key key;
+        VkSampler raw_sampler;
+        uint32_t refcount;
+    };
+
+    static sampler_key makeKey(sampler_config const& config);
+    static uint64_t hashKey(sampler_key const& key);
+
+    VkSampler createSampler(sampler_config const& config) const;
+
+private:
+    VkDevice mDevice = nullptr;
+
+    /// the sampler nodes, handles are stable
+    cc::atomic_linked_pool<sampler_node> mPool;
+
+    /// index from key to node handle
+    phi::detail::growable_map<sampler_key, handle_t, sampler_key_hasher> mIndex;
+
+    uint64_t mNumRequested = 0;
+    uint64_t mNumCreated = 0;
+    uint32_t mNumUnique = 0;
+
+    std::mutex mMutex;
+};
+}
@@ -27,7 +27,10 @@ phi::handle::shader_view phi::vk::ShaderViewPool::create(cc::span<resource_view
     // UAV:
     //      Texture* -> VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
     //      Buffer   -> VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
-    auto const layout = mAllocator.createLayoutFromShaderViewArgs(srvs, uavs, uint32_t(sampler_configs.size()), usage_compute);
+    // Layouts are deduplicated, shader views with identical bindings share a single VkDescriptorSetLayout
+    detail::pipeline_layout_params::descriptor_set_params params;
+    DescriptorAllocator::fillLayoutParamsFromShaderViewArgs(params, srvs, uavs, uint32_t(sampler_configs.size()), usage_compute);
+    auto const layout = mLayoutCache.acquire(params.bindings);
 
     auto const newSV
         = createShaderViewFromLayout(layout, uint32_t(srvs.size()), uint32_t(uavs.size()), uint32_t(sampler_configs.size()), cc::system_allocator, nullptr);
@@ -52,7 +55,9 @@ phi::handle::shader_view phi::vk::ShaderViewPool::create(cc::span<resource_view
 
 phi::handle::shader_view phi::vk::ShaderViewPool::createEmpty(arg::shader_view_description const& desc, bool usageCompute)
 {
-    auto const layout = mAllocator.createLayoutFromDescription(desc, usageCompute);
+    detail::pipeline_layout_params::descriptor_set_params params;
+    DescriptorAllocator::fillLayoutParamsFromDescription(params, desc, usageCompute);
+    auto const layout = mLayoutCache.acquire(params.bindings);
 
     return createShaderViewFromLayout(layout, desc.num_srvs, desc.num_uavs, desc.num_samplers, cc::system_allocator, &desc);
 }
@@ -261,23 +266,19 @@ void phi::vk::ShaderViewPool::writeShaderViewSamplers(handle::shader_view sv, ui
     {
         auto const binding = spv::sampler_binding_start + offset + i;
 
-        VkSampler newSampler = makeSampler(samplers[i]);
+        SamplerCache::handle_t const newSampler = mSamplerCache.acquire(samplers[i]);
 
         VkDescriptorImageInfo* img_info = scratch->new_t<VkDescriptorImageInfo>();
         img_info->imageView = nullptr;
         img_info->imageLayout = util::to_image_layout(resource_state::shader_resource);
-        img_info->sampler = newSampler;
+        img_info->sampler = mSamplerCache.get(newSampler);
 
         F_AddWrite(VK_DESCRIPTOR_TYPE_SAMPLER, binding);
         writes.back().pImageInfo = img_info;
 
-        // free and replace the previous image view at this slot
+        // release and replace the previous sampler at this slot
         uint32_t linearSamplerIndex = offset + i;
-        VkSampler prevSampler = node.samplers[linearSamplerIndex];
-        if (prevSampler)
-        {
-            vkDestroySampler(mAllocator.getDevice(), prevSampler, nullptr);
-        }
+        mSamplerCache.release(node.samplers[linearSamplerIndex]);
         node.samplers[linearSamplerIndex] = newSampler;
     }
 
@@ -292,11 +293,8 @@ void phi::vk::ShaderViewPool::free(phi::handle::shader_view sv)
     ShaderViewNode& freed_node = mPool.get(sv._value);
     internalFree(freed_node);
 
-    {
-        // This is a write access to the allocator, and must be synced
-        auto lg = std::lock_guard(mMutex);
-        mAllocator.free(freed_node.descriptorSet);
-    }
+    // no sync required, the allocator locks the block of the set
+    mAllocator.free(freed_node.descriptorSet, freed_node.descriptorSetOwner);
 
     mPool.release(sv._value);
 }
@@ -309,15 +307,28 @@ void phi::vk::ShaderViewPool::free(cc::span<const phi::handle::shader_view> svs)
     }
 }
 
-void phi::vk::ShaderViewPool::initialize(
-    VkDevice device, ResourcePool* res_pool, AccelStructPool* as_pool, unsigned num_cbvs, unsigned num_srvs, unsigned num_uavs, unsigned num_samplers, cc::allocator* static_alloc)
+void phi::vk::ShaderViewPool::initialize(VkDevice device,
+                                         ResourcePool* res_pool,
+                                         AccelStructPool* as_pool,
+                                         unsigned num_cbvs,
+                                         unsigned num_srvs,
+                                         unsigned num_uavs,
+                                         unsigned num_samplers,
+                                         phi::thread_association* thread_assoc,
+                                         unsigned num_threads,
+                                         cc::allocator* static_alloc,
+                                         cc::allocator* dynamic_alloc)
 {
     CC_ASSERT(mDevice == nullptr && "double init");
     mDevice = device;
     mResourcePool = res_pool;
     mAccelStructPool = as_pool;
 
-    mAllocator.initialize(mDevice, num_cbvs, num_srvs, num_uavs, num_samplers);
+    mAllocator.initialize(mDevice, num_cbvs, num_srvs, num_uavs, num_samplers, thread_assoc, num_threads, static_alloc);
+    // the amount of unique samplers can't exceed the total amount of sampler descriptors
+    mSamplerCache.initialize(mDevice, num_samplers, static_alloc, dynamic_alloc);
+    // each shader view references a single layout, so there can't be more unique layouts than shader views
+    mLayoutCache.initialize(mDevice, num_cbvs, static_alloc, dynamic_alloc);
     // Due to the fact that each shader argument represents up to one CBV, this is the upper limit for the amount of shader_view handles
     mPool.initialize(num_cbvs, static_alloc);
 }
@@ -329,7 +340,7 @@ void phi::vk::ShaderViewPool::destroy()
         ++num_leaks;
 
         internalFree(leaked_node);
-        mAllocator.free(leaked_node.descriptorSet);
+        mAllocator.free(leaked_node.descriptorSet, leaked_node.descriptorSetOwner);
     });
 
     if (num_leaks > 0)
@@ -337,6 +348,8 @@ void phi::vk::ShaderViewPool::destroy()
         PHI_LOG("leaked {} handle::shader_view object{}", num_leaks, num_leaks == 1 ? "" : "s");
     }
 
+    mLayoutCache.destroy();
+    mSamplerCache.destroy();
     mAllocator.destroy();
 }
 
@@ -389,19 +402,16 @@ VkImageView phi::vk::ShaderViewPool::makeImageView(const resource_view& sve, boo
     return res;
 }
 
-phi::handle::shader_view phi::vk::ShaderViewPool::createShaderViewFromLayout(VkDescriptorSetLayout layout,
+phi::handle::shader_view phi::vk::ShaderViewPool::createShaderViewFromLayout(DescriptorSetLayoutCache::handle_t layout,
                                                                              uint32_t numSRVs,
                                                                              uint32_t numUAVs,
                                                                              uint32_t numSamplers,
                                                                              cc::allocator* dynamicAlloc,
                                                                              phi::arg::shader_view_description const* optDescription)
 {
-    // Do acquires requiring synchronization
-    VkDescriptorSet res_raw;
-    {
-        auto lg = std::lock_guard(mMutex);
-        res_raw = mAllocator.allocDescriptor(layout);
-    }
+    // allocated from the calling thread's descriptor pool, no sync required
+    uint32_t res_owner;
+    VkDescriptorSet const res_raw = mAllocator.allocDescriptor(mLayoutCache.get(layout), res_owner);
 
     CC_RUNTIME_ASSERTF(!mPool.is_full(),
                        "Reached limit for shader_views, increase max_num_shader_views in the PHI backend config\n"
@@ -413,6 +423,7 @@ phi::handle::shader_view phi::vk::ShaderViewPool::createShaderViewFromLayout(VkD
     // Populate new node
     ShaderViewNode& new_node = mPool.get(pool_index);
     new_node.descriptorSet = res_raw;
+    new_node.descriptorSetOwner = res_owner;
     new_node.descriptorSetLayout = layout;
     new_node.numSRVs = numSRVs;
     new_node.imageViews.reset(dynamicAlloc, numSRVs + numUAVs);
@@ -445,31 +456,7 @@ phi::handle::shader_view phi::vk::ShaderViewPool::createShaderViewFromLayout(VkD
     return {pool_index};
 }
 
-VkSampler phi::vk::ShaderViewPool::makeSampler(const phi::sampler_config& config) const
-{
-    VkSamplerCreateInfo info = {};
-    info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    info.minFilter = util::to_min_filter(config.filter);
-    info.magFilter = util::to_mag_filter(config.filter);
-    info.mipmapMode = util::to_mipmap_filter(config.filter);
-    info.addressModeU = util::to_native(config.address_u);
-    info.addressModeV = util::to_native(config.address_v);
-    info.addressModeW = util::to_native(config.address_w);
-    info.minLod = config.min_lod;
-    info.maxLod = config.max_lod;
-    info.mipLodBias = config.lod_bias;
-    info.anisotropyEnable = config.filter == sampler_filter::anisotropic ? VK_TRUE : VK_FALSE;
-    info.maxAnisotropy = float(config.max_anisotropy);
-    info.borderColor = util::to_native(config.border_color);
-    info.compareEnable = config.compare_func != sampler_compare_func::disabled ? VK_TRUE : VK_FALSE;
-    info.compareOp = util::to_native(config.compare_func);
-
-    VkSampler res;
-    PHI_VK_VERIFY_SUCCESS(vkCreateSampler(mDevice, &info, nullptr, &res));
-    return res;
-}
-
-void phi::vk::ShaderViewPool::internalFree(phi::vk::ShaderViewPool::ShaderViewNode& node) const
+void phi::vk::ShaderViewPool::internalFree(phi::vk::ShaderViewPool::ShaderViewNode& node)
 {
     // Destroy the contained image views
     for (auto const iv : node.imageViews)
@@ -481,18 +468,16 @@ void phi::vk::ShaderViewPool::internalFree(phi::vk::ShaderViewPool::ShaderViewNo
     }
     node.imageViews = {};
 
-    // Destroy the contained samplers
+    // Release the contained samplers
     for (auto const s : node.samplers)
     {
-        if (s == nullptr)
-            continue;
-
-        vkDestroySampler(mDevice, s, nullptr);
+        mSamplerCache.release(s);
     }
     node.samplers = {};
 
-    // destroy the descriptor set layout used for creation
-    vkDestroyDescriptorSetLayout(mDevice, node.descriptorSetLayout, nullptr);
+    // release the descriptor set layout used for creation
+    mLayoutCache.release(node.descriptorSetLayout);
+    node.descriptorSetLayout = DescriptorSetLayoutCache::invalid_handle;
 }
 
 bool phi::vk::ShaderViewPool::flatSRVIndexToBindingAndArrayIndex(ShaderViewNode const& node, uint32_t flatIdx, uint32_t& outBinding, uint32_t& outArrayIndex) const
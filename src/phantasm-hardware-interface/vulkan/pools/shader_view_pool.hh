@@ -1,7 +1,5 @@
 #pragma once
 
-#include <mutex>
-
 #include <clean-core/alloc_array.hh>
 #include <clean-core/atomic_linked_pool.hh>
 #include <clean-core/span.hh>
@@ -11,6 +9,9 @@
 
 #include <phantasm-hardware-interface/vulkan/resources/descriptor_allocator.hh>
 
+#include "descriptor_set_layout_cache.hh"
+#include "sampler_cache.hh"
+
 namespace phi::vk
 {
 class ResourcePool;
@@ -42,23 +43,39 @@ public:
 
 public:
     // internal API
-    void initialize(VkDevice device, ResourcePool* res_pool, AccelStructPool* as_pool, unsigned num_cbvs, unsigned num_srvs, unsigned num_uavs, unsigned num_samplers, cc::allocator* static_alloc);
+    void initialize(VkDevice device,
+                    ResourcePool* res_pool,
+                    AccelStructPool* as_pool,
+                    unsigned num_cbvs,
+                    unsigned num_srvs,
+                    unsigned num_uavs,
+                    unsigned num_samplers,
+                    phi::thread_association* thread_assoc,
+                    unsigned num_threads,
+                    cc::allocator* static_alloc,
+                    cc::allocator* dynamic_alloc);
     void destroy();
 
     [[nodiscard]] VkDescriptorSet get(handle::shader_view sv) const { return mPool.get(sv._value).descriptorSet; }
 
     [[nodiscard]] VkImageView makeImageView(resource_view const& sve, bool is_uav, bool restrict_usage_for_shader) const;
 
+    [[nodiscard]] SamplerCache::cache_stats getSamplerCacheStats() { return mSamplerCache.getStats(); }
+
+    [[nodiscard]] DescriptorSetLayoutCache::cache_stats getLayoutCacheStats() { return mLayoutCache.getStats(); }
 
 private:
     struct ShaderViewNode
     {
         VkDescriptorSet descriptorSet;
+        // the descriptor allocator block the set was allocated from
+        uint32_t descriptorSetOwner;
 
         // the descriptor set layout used to create the descriptor set proper
         // This MUST stay alive, if it isn't alive, no warnings are emitted but
         // vkCmdBindDescriptorSets spuriously crashes the driver with compute binding points
-        VkDescriptorSetLayout descriptorSetLayout;
+        // handle into the shared layout cache, the reference held by this node keeps it alive
+        DescriptorSetLayoutCache::handle_t descriptorSetLayout;
 
         uint32_t numSRVs = 0;
 
@@ -66,8 +83,8 @@ private:
         // we do not semantically require these, they just have to stay alive
         // image views in use by this shader view
         cc::alloc_array<VkImageView> imageViews;
-        // samplers in use by this shader view
-        cc::alloc_array<VkSampler> samplers;
+        // samplers in use by this shader view, as handles into the shared sampler cache
+        cc::alloc_array<SamplerCache::handle_t> samplers;
 
         // optionally contains the descriptor entries for shader views that were created empty
         // this is required for a mapping from flat SRV/UAV descriptor indices to binding and array index
@@ -76,22 +93,20 @@ private:
     };
 
 private:
-    handle::shader_view createShaderViewFromLayout(VkDescriptorSetLayout layout,
+    handle::shader_view createShaderViewFromLayout(DescriptorSetLayoutCache::handle_t layout,
                                                    uint32_t numSRVs,
                                                    uint32_t numUAVs,
                                                    uint32_t numSamplers,
                                                    cc::allocator* dynamicAlloc,
                                                    phi::arg::shader_view_description const* optDescription);
 
-    [[nodiscard]] VkSampler makeSampler(sampler_config const& config) const;
-
     ShaderViewNode& internalGet(handle::shader_view res)
     {
         CC_ASSERT(res.is_valid() && "invalid shader_view handle");
         return mPool.get(res._value);
     }
 
-    void internalFree(ShaderViewNode& node) const;
+    void internalFree(ShaderViewNode& node);
 
     // translates a flat index into a shader view's SRVs into the corresponding binding and array index
     // returns true on success
@@ -112,7 +127,10 @@ private:
 
     /// "Backing" allocator
     DescriptorAllocator mAllocator;
-    std::mutex mMutex;
+    /// Samplers are deduplicated across all shader views
+    SamplerCache mSamplerCache;
+    /// Descriptor set layouts are deduplicated across all shader views
+    DescriptorSetLayoutCache mLayoutCache;
 };
 
 } // namespace phi::vk
@@ -0,0 +1,279 @@
+#include "spirv_reflection_cache.hh"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include <clean-core/assert.hh>
+
+#include <phantasm-hardware-interface/common/byte_reader.hh>
+#include <phantasm-hardware-interface/common/byte_writer.hh>
+#include <phantasm-hardware-interface/common/container/unique_buffer.hh>
+#include <phantasm-hardware-interface/common/log.hh>
+#include <phantasm-hardware-interface/common/sse_hash.hh>
+
+namespace
+{
+constexpr uint32_t gc_spirv_cache_file_version = 0x5EC40001;
+
+// the file is untrusted, all reads are checked against the remaining size instead of asserting
+
+template <class T>
+bool tryRead(phi::byte_reader& reader, T& out_value)
+{
+    if (reader.size_left() < sizeof(T))
+        return false;
+
+    reader.read_t(out_value);
+    return true;
+}
+
+template <class T>
+bool tryReadSizedArray(phi::byte_reader& reader, cc::span<T const>& out_array)
+{
+    size_t num_elems = 0;
+    if (!tryRead(reader, num_elems) || num_elems > reader.size_left() / sizeof(T))
+        return false;
+
+    out_array = reader.read_unsized_array<T>(num_elems);
+    return true;
+}
+
+struct file_entry
+{
+    cc::span<std::byte const> original;
+    cc::span<std::byte const> patched_binary;
+    cc::span<char const> entrypoint;
+    phi::shader_stage stage = phi::shader_stage::none;
+    cc::span<phi::vk::util::spirv_desc_info const> descriptor_infos;
+    bool has_push_constants = false;
+};
+
+// smallest possible entry: four array sizes, the stage and the push constant flag
+constexpr size_t gc_min_file_entry_size = 4 * sizeof(size_t) + sizeof(phi::shader_stage) + sizeof(bool);
+
+bool tryReadEntry(phi::byte_reader& reader, file_entry& out_entry)
+{
+    if (!tryReadSizedArray(reader, out_entry.original) || !tryReadSizedArray(reader, out_entry.patched_binary)
+        || !tryReadSizedArray(reader, out_entry.entrypoint))
+        return false;
+
+    // both binaries are SPIR-V, a non-empty sequence of words
+    if (out_entry.original.empty() || out_entry.original.size() % sizeof(uint32_t) != 0 || out_entry.patched_binary.empty()
+        || out_entry.patched_binary.size() % sizeof(uint32_t) != 0)
+        return false;
+
+    if (!tryRead(reader, out_entry.stage) || !phi::is_valid_shader_stage(out_entry.stage))
+        return false;
+
+    if (!tryReadSizedArray(reader, out_entry.descriptor_infos))
+        return false;
+
+    // read as a byte, not every value is a valid bool
+    uint8_t has_push_constants = 0;
+    if (!tryRead(reader, has_push_constants) || has_push_constants > 1)
+        return false;
+
+    out_entry.has_push_constants = has_push_constants != 0;
+    return true;
+}
+}
+
+void phi::vk::SpirvReflectionCache::initialize(unsigned initial_capacity, cc::allocator* dynamic_alloc)
+{
+    mDynamicAlloc = dynamic_alloc;
+    mCache.initialize(initial_capacity, dynamic_alloc);
+}
+
+void phi::vk::SpirvReflectionCache::destroy()
+{
+    mCache.iterate_elements([](cache_entry& entry) { util::free_patched_spirv(entry.patched); });
+    mCache.destroy();
+}
+
+phi::vk::util::patched_spirv_stage phi::vk::SpirvReflectionCache::getOrCreate(std::byte const* bytecode,
+                                                                               size_t bytecode_size,
+                                                                               util::spirv_refl_info& out_info,
+                                                                               cc::allocator* scratch_alloc)
+{
+    if (util::is_patched_spirv_container(bytecode, bytecode_size))
+    {
+        mNumPrepatched.fetch_add(1, std::memory_order_relaxed);
+        return util::use_patched_spirv_container(bytecode, bytecode_size, out_info);
+    }
+
+    auto const key = makeKey(bytecode, bytecode_size);
+
+    auto const f_output_entry = [&](cache_entry const& entry) -> util::patched_spirv_stage {
+        for (auto const& info : entry.descriptor_infos)
+            out_info.descriptor_infos.push_back(info);
+
+        out_info.has_push_constants = out_info.has_push_constants || entry.has_push_constants;
+        return entry.patched;
+    };
+
+    {
+        auto lg = std::lock_guard(mMutex);
+        if (cache_entry const* const entry = mCache.find(key))
+        {
+            ++mNumHits;
+            return f_output_entry(*entry);
+        }
+
+        ++mNumMisses;
+    }
+
+    // patch and reflect outside of the lock, this is the expensive part
+    util::spirv_refl_info new_info;
+    new_info.descriptor_infos.reset_reserve(scratch_alloc, 16);
+    auto const patched = util::create_patched_spirv(bytecode, bytecode_size, new_info, scratch_alloc);
+
+    auto lg = std::lock_guard(mMutex);
+    return f_output_entry(insertEntry(key, patched, new_info.descriptor_infos, new_info.has_push_constants));
+}
+
+bool phi::vk::SpirvReflectionCache::writeToFile(char const* path)
+{
+    byte_writer writer(mDynamicAlloc, 1024 * 64);
+
+    {
+        auto lg = std::lock_guard(mMutex);
+
+        writer.write_t(gc_spirv_cache_file_version);
+        writer.write_t(size_t(mCache.size()));
+
+        mCache.iterate_elements([&](cache_entry const& entry) {
+            writer.write_sized_array(cc::span<std::byte const>(entry.original_bytecode));
+            writer.write_sized_array(cc::span<std::byte const>(entry.patched.data, entry.patched.size));
+            writer.write_sized_array(cc::span<char const>(entry.patched.entrypoint_name.c_str(), entry.patched.entrypoint_name.size()));
+            writer.write_t(entry.patched.stage);
+            writer.write_sized_array(cc::span<util::spirv_desc_info const>(entry.descriptor_infos.data(), entry.descriptor_infos.size()));
+            writer.write_t(entry.has_push_constants);
+        });
+    }
+
+    auto outfile = std::fstream(path, std::ios::out | std::ios::binary);
+    if (!outfile.good())
+        return false;
+
+    outfile.write(reinterpret_cast<char const*>(writer.data()), long(writer.size()));
+    return outfile.good();
+}
+
+bool phi::vk::SpirvReflectionCache::readFromFile(char const* path)
+{
+    auto const file = unique_buffer::create_from_binary_file(path);
+    if (!file.is_valid())
+        return false;
+
+    auto reader = byte_reader{cc::span<std::byte const>(file.data(), file.size())};
+
+    uint32_t version = 0;
+    if (!tryRead(reader, version) || version != gc_spirv_cache_file_version)
+    {
+        PHI_LOG_WARN("SPIR-V reflection cache at {} has an outdated version, ignoring it", path);
+        return false;
+    }
+
+    size_t num_entries = 0;
+    if (!tryRead(reader, num_entries) || num_entries > reader.size_left() / gc_min_file_entry_size)
+    {
+        PHI_LOG_WARN("SPIR-V reflection cache at {} is corrupt, ignoring it", path);
+        return false;
+    }
+
+    // validate all entries before adding any of them
+    byte_reader const entries_begin = reader;
+    for (auto i = 0u; i < num_entries; ++i)
+    {
+        file_entry entry;
+        if (!tryReadEntry(reader, entry))
+        {
+            PHI_LOG_WARN("SPIR-V reflection cache at {} is corrupt, ignoring it", path);
+            return false;
+        }
+    }
+
+    reader = entries_begin;
+
+    auto lg = std::lock_guard(mMutex);
+    for (auto i = 0u; i < num_entries; ++i)
+    {
+        file_entry entry;
+        bool const is_valid = tryReadEntry(reader, entry);
+        CC_ASSERT(is_valid && "entry changed between validation and insertion");
+        (void)is_valid;
+
+        // the patched binary is freed with util::free_patched_spirv, allocate it the same way spirv-reflect does
+        util::patched_spirv_stage patched;
+        patched.size = entry.patched_binary.size();
+        patched.data = static_cast<std::byte*>(std::malloc(patched.size));
+        std::memcpy(patched.data, entry.patched_binary.data(), patched.size);
+        patched.entrypoint_name = cc::string_view(entry.entrypoint.data(), entry.entrypoint.size());
+        patched.stage = entry.stage;
+
+        insertEntry(makeKey(entry.original.data(), entry.original.size()), patched, entry.descriptor_infos, entry.has_push_constants);
+    }
+
+    return true;
+}
+
+phi::vk::SpirvReflectionCache::cache_stats phi::vk::SpirvReflectionCache::getStats()
+{
+    auto lg = std::lock_guard(mMutex);
+
+    cache_stats res;
+    res.num_hits = mNumHits;
+    res.num_misses = mNumMisses;
+    res.num_prepatched = mNumPrepatched.load(std::memory_order_relaxed);
+    res.num_entries = uint32_t(mCache.size());
+    return res;
+}
+
+bool phi::vk::SpirvReflectionCache::spirv_key::operator==(const spirv_key& rhs) const noexcept
+{
+    return hash == rhs.hash && size == rhs.size && std::memcmp(data, rhs.data, size) == 0;
+}
+
+phi::vk::SpirvReflectionCache::spirv_key phi::vk::SpirvReflectionCache::makeKey(std::byte const* bytecode, size_t bytecode_size)
+{
+    CC_ASSERT(bytecode_size % sizeof(uint32_t) == 0 && "SPIR-V size is not a multiple of the word size");
+
+    spirv_key res;
+    res.hash = phi::util::sse_hash(reinterpret_cast<uint32_t const*>(bytecode), reinterpret_cast<uint32_t const*>(bytecode + bytecode_size));
+    res.size = bytecode_size;
+    res.data = bytecode;
+    return res;
+}
+
+phi::vk::SpirvReflectionCache::cache_entry& phi::vk::SpirvReflectionCache::insertEntry(spirv_key const& key,
+                                                                                       util::patched_spirv_stage const& patched,
+                                                                                       cc::span<util::spirv_desc_info const> descriptor_infos,
+                                                                                       bool has_push_constants)
+{
+    // the stored key refers to the copy of the bytecode owned by the entry
+    auto bytecode_copy = cc::alloc_array<std::byte>::uninitialized(key.size, mDynamicAlloc);
+    std::memcpy(bytecode_copy.data(), key.data, key.size);
+
+    spirv_key stored_key = key;
+    stored_key.data = bytecode_copy.data();
+
+    bool inserted = false;
+    auto& elem = mCache.get_or_create(stored_key, [&](cache_entry& entry) {
+        entry.original_bytecode = cc::move(bytecode_copy);
+        entry.patched = patched;
+        entry.descriptor_infos.reset_reserve(mDynamicAlloc, descriptor_infos.size());
+        for (auto const& info : descriptor_infos)
+            entry.descriptor_infos.push_back(info);
+        entry.has_push_constants = has_push_constants;
+        inserted = true;
+    });
+
+    if (!inserted)
+    {
+        // another thread created the same entry in the meantime
+        util::free_patched_spirv(patched);
+    }
+
+    return elem.value;
+}
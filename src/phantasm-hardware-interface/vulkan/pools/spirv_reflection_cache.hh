@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include <clean-core/alloc_array.hh>
+#include <clean-core/alloc_vector.hh>
+
+#include <phantasm-hardware-interface/common/container/growable_map.hh>
+
+#include <phantasm-hardware-interface/vulkan/loader/spirv_patch_util.hh>
+
+namespace phi::vk
+{
+/// Content-addressed cache of patched SPIR-V and its reflection data
+/// Keyed by a hash of the input bytecode, hits are verified against a copy of it
+/// Pre-patched containers (see util::write_patched_spirv) bypass the cache and are used without reflection
+/// Entries live until destroy, can be persisted to and restored from a file
+/// Synchronized, patching and reflection on misses runs outside of the lock
+class SpirvReflectionCache
+{
+public:
+    struct cache_stats
+    {
+        uint64_t num_hits = 0;
+        uint64_t num_misses = 0;
+        uint64_t num_prepatched = 0; ///< amount of pre-patched containers used directly
+        uint32_t num_entries = 0;
+    };
+
+public:
+    /// entries are created on misses from any thread, the map and entry storage require the thread-safe dynamic allocator
+    void initialize(unsigned initial_capacity, cc::allocator* dynamic_alloc);
+    void destroy();
+
+    /// returns the patched SPIR-V of the bytecode, appends its descriptor infos to out_info and ORs in its push constant flag
+    /// the returned stage is owned by the cache (or points into the bytecode if it is a pre-patched container) and must not be freed
+    /// if the bytecode is an invalid pre-patched container, the returned stage has data == nullptr
+    [[nodiscard]] util::patched_spirv_stage getOrCreate(std::byte const* bytecode, size_t bytecode_size, util::spirv_refl_info& out_info, cc::allocator* scratch_alloc);
+
+    /// writes all entries to a file, returns false on failure
+    bool writeToFile(char const* path);
+
+    /// adds all entries of a file written by writeToFile, returns false if it does not exist or is invalid
+    bool readFromFile(char const* path);
+
+    [[nodiscard]] cache_stats getStats();
+
+private:
+    struct spirv_key
+    {
+        uint64_t hash = 0;
+        size_t size = 0;
+        std::byte const* data = nullptr; ///< the input bytecode for lookups, the copy owned by the entry when stored
+
+        bool operator==(spirv_key const& rhs) const noexcept;
+    };
+
+    struct spirv_key_hasher
+    {
+        uint64_t operator()(spirv_key const& v) const noexcept { return v.hash; }
+    };
+
+    struct cache_entry
+    {
+        cc::alloc_array<std::byte> original_bytecode;
+        util::patched_spirv_stage patched = {};
+        cc::alloc_vector<util::spirv_desc_info> descriptor_infos;
+        bool has_push_constants = false;
+    };
+
+    static spirv_key makeKey(std::byte const* bytecode, size_t bytecode_size);
+
+    /// inserts an entry, or frees the given patched stage if the key is already present, mMutex must be held
+    cache_entry& insertEntry(spirv_key const& key, util::patched_spirv_stage const& patched, cc::span<util::spirv_desc_info const> descriptor_infos, bool has_push_constants);
+
+private:
+    cc::allocator* mDynamicAlloc = nullptr;
+    phi::detail::growable_map<spirv_key, cache_entry, spirv_key_hasher> mCache;
+
+    uint64_t mNumHits = 0;
+    uint64_t mNumMisses = 0;
+    std::atomic<uint64_t> mNumPrepatched = {0};
+
+    std::mutex mMutex;
+};
+}
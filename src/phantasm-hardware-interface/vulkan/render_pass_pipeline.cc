@@ -1,9 +1,12 @@
 #include "render_pass_pipeline.hh"
 
+#include <cstring>
+
 #include <clean-core/alloc_array.hh>
 #include <clean-core/alloc_vector.hh>
 #include <clean-core/array.hh>
 
+#include <phantasm-hardware-interface/common/container/unique_buffer.hh>
 #include <phantasm-hardware-interface/common/log.hh>
 #include <phantasm-hardware-interface/limits.hh>
 
@@ -172,6 +175,7 @@ VkRenderPass phi::vk::create_render_pass(VkDevice device, const phi::cmd::begin_
 }
 
 VkPipeline phi::vk::create_pipeline(VkDevice device,
+                                    VkPipelineCache pipeline_cache,
                                     VkRenderPass render_pass,
                                     VkPipelineLayout pipeline_layout,
                                     cc::span<const util::patched_spirv_stage> shaders,
@@ -347,7 +351,7 @@ VkPipeline phi::vk::create_pipeline(VkDevice device,
     pipelineInfo.basePipelineIndex = -1;       // Optional
 
     VkPipeline res;
-    PHI_VK_VERIFY_SUCCESS(vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineInfo, nullptr, &res));
+    PHI_VK_VERIFY_SUCCESS(vkCreateGraphicsPipelines(device, pipeline_cache, 1, &pipelineInfo, nullptr, &res));
 
     for (auto& shader : shader_stages)
     {
@@ -357,7 +361,10 @@ VkPipeline phi::vk::create_pipeline(VkDevice device,
     return res;
 }
 
-VkPipeline phi::vk::create_compute_pipeline(VkDevice device, VkPipelineLayout pipeline_layout, const util::patched_spirv_stage& compute_shader)
+VkPipeline phi::vk::create_compute_pipeline(VkDevice device,
+                                            VkPipelineCache pipeline_cache,
+                                            VkPipelineLayout pipeline_layout,
+                                            const util::patched_spirv_stage& compute_shader)
 {
     shader shader_stage;
     initialize_shader(shader_stage, device, compute_shader.data, compute_shader.size, compute_shader.entrypoint_name.c_str(), shader_stage::compute);
@@ -368,12 +375,46 @@ VkPipeline phi::vk::create_compute_pipeline(VkDevice device, VkPipelineLayout pi
     pipeline_info.stage = get_shader_create_info(shader_stage);
 
     VkPipeline res;
-    PHI_VK_VERIFY_SUCCESS(vkCreateComputePipelines(device, nullptr, 1, &pipeline_info, nullptr, &res));
+    PHI_VK_VERIFY_SUCCESS(vkCreateComputePipelines(device, pipeline_cache, 1, &pipeline_info, nullptr, &res));
     shader_stage.free(device);
     return res;
 }
 
+void phi::vk::create_compute_pipelines(VkDevice device,
+                                       VkPipelineCache pipeline_cache,
+                                       cc::span<VkPipelineLayout const> pipeline_layouts,
+                                       cc::span<util::patched_spirv_stage const> compute_shaders,
+                                       cc::span<VkPipeline> out_pipelines,
+                                       cc::allocator* scratch_alloc)
+{
+    CC_ASSERT(pipeline_layouts.size() == compute_shaders.size() && out_pipelines.size() == compute_shaders.size() && "span size mismatch");
+
+    auto const num_pipelines = compute_shaders.size();
+    cc::alloc_array<shader> shader_stages(num_pipelines, scratch_alloc);
+    cc::alloc_array<VkComputePipelineCreateInfo> pipeline_infos(num_pipelines, scratch_alloc);
+
+    for (auto i = 0u; i < num_pipelines; ++i)
+    {
+        auto const& compute_shader = compute_shaders[i];
+        initialize_shader(shader_stages[i], device, compute_shader.data, compute_shader.size, compute_shader.entrypoint_name.c_str(), shader_stage::compute);
+
+        VkComputePipelineCreateInfo& pipeline_info = pipeline_infos[i];
+        pipeline_info = {};
+        pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipeline_info.layout = pipeline_layouts[i];
+        pipeline_info.stage = get_shader_create_info(shader_stages[i]);
+    }
+
+    PHI_VK_VERIFY_SUCCESS(vkCreateComputePipelines(device, pipeline_cache, uint32_t(num_pipelines), pipeline_infos.data(), nullptr, out_pipelines.data()));
+
+    for (auto& shader : shader_stages)
+    {
+        shader.free(device);
+    }
+}
+
 VkPipeline phi::vk::create_raytracing_pipeline(VkDevice device,
+                                               VkPipelineCache pipeline_cache,
                                                patched_shader_intermediates const& shader_intermediates,
                                                VkPipelineLayout pipeline_layout,
                                                cc::span<const arg::raytracing_argument_association> arg_assocs,
@@ -422,7 +463,86 @@ VkPipeline phi::vk::create_raytracing_pipeline(VkDevice device,
     pso_info.basePipelineIndex = -1;
 
     VkPipeline res;
-    PHI_VK_VERIFY_SUCCESS(vkCreateRayTracingPipelinesNV(device, nullptr, 1, &pso_info, nullptr, &res));
+    PHI_VK_VERIFY_SUCCESS(vkCreateRayTracingPipelinesNV(device, pipeline_cache, 1, &pso_info, nullptr, &res));
 
     return res;
 }
+
+VkPipelineCache phi::vk::create_pipeline_cache(VkDevice device, VkPhysicalDeviceProperties const& device_props, const char* path)
+{
+    unique_buffer initial_data;
+
+    if (path != nullptr)
+    {
+        initial_data = unique_buffer::create_from_binary_file(path);
+
+        if (initial_data.is_valid())
+        {
+            // some drivers do not validate the initial data properly and crash on caches from other GPUs or driver versions
+            // the header layout is defined by the spec (VkPipelineCacheHeaderVersionOne)
+            bool is_compatible = false;
+
+            if (initial_data.size() >= 16 + VK_UUID_SIZE)
+            {
+                uint32_t header[4];
+                std::memcpy(header, initial_data.data(), sizeof(header));
+
+                is_compatible = header[0] >= 16 + VK_UUID_SIZE                      // header length
+                                && header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE // header version
+                                && header[2] == device_props.vendorID                //
+                                && header[3] == device_props.deviceID                //
+                                && std::memcmp(initial_data.data() + 16, device_props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+            }
+
+            if (!is_compatible)
+            {
+                PHI_LOG_WARN("pipeline cache at {} is incompatible with the current GPU or driver, discarding", path);
+                initial_data = unique_buffer{};
+            }
+        }
+    }
+
+    VkPipelineCacheCreateInfo cache_info = {};
+    cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_info.initialDataSize = initial_data.is_valid() ? initial_data.size() : 0;
+    cache_info.pInitialData = initial_data.data();
+
+    VkPipelineCache res;
+    PHI_VK_VERIFY_SUCCESS(vkCreatePipelineCache(device, &cache_info, nullptr, &res));
+    return res;
+}
+
+bool phi::vk::write_pipeline_cache(VkDevice device, VkPipelineCache pipeline_cache, const char* path)
+{
+    CC_CONTRACT(path != nullptr);
+
+    // the cache can grow concurrently between the size query and the retrieval, which returns VK_INCOMPLETE, retry a few times
+    constexpr int max_num_attempts = 4;
+
+    for (auto attempt = 0; attempt < max_num_attempts; ++attempt)
+    {
+        size_t data_size = 0;
+        if (vkGetPipelineCacheData(device, pipeline_cache, &data_size, nullptr) != VK_SUCCESS)
+            return false;
+
+        unique_buffer data(data_size);
+        VkResult const res = vkGetPipelineCacheData(device, pipeline_cache, &data_size, data.data());
+
+        if (res == VK_INCOMPLETE)
+            continue;
+
+        if (res != VK_SUCCESS)
+            return false;
+
+        if (data_size == data.size())
+            return data.write_to_binary_file(path);
+
+        // less than queried was written, only write the valid prefix
+        unique_buffer written_data(data_size);
+        std::memcpy(written_data.data(), data.data(), data_size);
+        return written_data.write_to_binary_file(path);
+    }
+
+    PHI_LOG_WARN("pipeline cache kept growing while being written to {}, skipping", path);
+    return false;
+}
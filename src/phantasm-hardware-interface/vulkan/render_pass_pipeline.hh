@@ -22,6 +22,7 @@ struct patched_shader_intermediates;
 [[nodiscard]] VkRenderPass create_render_pass(VkDevice device, const phi::cmd::begin_render_pass& begin_rp, unsigned num_samples, cc::span<const format> override_rt_formats);
 
 [[nodiscard]] VkPipeline create_pipeline(VkDevice device,
+                                         VkPipelineCache pipeline_cache,
                                          VkRenderPass render_pass,
                                          VkPipelineLayout pipeline_layout,
                                          cc::span<util::patched_spirv_stage const> shaders,
@@ -30,9 +31,21 @@ struct patched_shader_intermediates;
                                          uint32_t vertex_sizes[limits::max_vertex_buffers],
                                          const arg::framebuffer_config& framebuf_config);
 
-[[nodiscard]] VkPipeline create_compute_pipeline(VkDevice device, VkPipelineLayout pipeline_layout, const util::patched_spirv_stage& compute_shader);
+[[nodiscard]] VkPipeline create_compute_pipeline(VkDevice device,
+                                                 VkPipelineCache pipeline_cache,
+                                                 VkPipelineLayout pipeline_layout,
+                                                 const util::patched_spirv_stage& compute_shader);
+
+/// creates multiple compute pipelines in a single native call
+void create_compute_pipelines(VkDevice device,
+                              VkPipelineCache pipeline_cache,
+                              cc::span<VkPipelineLayout const> pipeline_layouts,
+                              cc::span<util::patched_spirv_stage const> compute_shaders,
+                              cc::span<VkPipeline> out_pipelines,
+                              cc::allocator* scratch_alloc);
 
 VkPipeline create_raytracing_pipeline(VkDevice device,
+                                      VkPipelineCache pipeline_cache,
                                       const phi::vk::patched_shader_intermediates& shader_intermediates,
                                       VkPipelineLayout pipeline_layout,
                                       cc::span<phi::arg::raytracing_argument_association const> arg_assocs,
@@ -41,4 +54,12 @@ VkPipeline create_raytracing_pipeline(VkDevice device,
                                       unsigned max_payload_size_bytes,
                                       unsigned max_attribute_size_bytes,
                                       cc::allocator* scratch_alloc);
+
+/// creates a pipeline cache, initialized with the contents of the file at the given path if it exists
+/// and its header matches the given physical device (vendor, device and pipeline cache UUID)
+/// path can be nullptr, resulting in an empty cache
+[[nodiscard]] VkPipelineCache create_pipeline_cache(VkDevice device, VkPhysicalDeviceProperties const& device_props, char const* path);
+
+/// writes the contents of a pipeline cache to the file at the given path, returns true on success
+bool write_pipeline_cache(VkDevice device, VkPipelineCache pipeline_cache, char const* path);
 }
@@ -4,6 +4,8 @@
 #include <clean-core/assert.hh>
 #include <clean-core/capped_vector.hh>
 
+#include <phantasm-hardware-interface/common/thread_association.hh>
+
 #include <phantasm-hardware-interface/vulkan/Device.hh>
 #include <phantasm-hardware-interface/vulkan/common/native_enum.hh>
 #include <phantasm-hardware-interface/vulkan/common/verify.hh>
@@ -12,66 +14,213 @@
 
 namespace phi::vk
 {
-void DescriptorAllocator::initialize(VkDevice device, uint32_t num_cbvs, uint32_t num_srvs, uint32_t num_uavs, uint32_t num_samplers)
+void DescriptorAllocator::initialize(VkDevice device,
+                                     uint32_t num_cbvs,
+                                     uint32_t num_srvs,
+                                     uint32_t num_uavs,
+                                     uint32_t num_samplers,
+                                     phi::thread_association* thread_assoc,
+                                     uint32_t num_threads,
+                                     cc::allocator* static_alloc)
 {
     mDevice = device;
+    mThreadAssociation = thread_assoc;
+    mStaticAlloc = static_alloc;
+    CC_ASSERT(num_threads > 0);
+
+    // the totals are split into one block per thread, rounded up
+    fillPoolConfig(mBlockConfig, num_cbvs, num_srvs, num_uavs, num_samplers, num_threads);
+    // sets larger than a block use a single shared pool with the full limits, as if there was only one thread
+    fillPoolConfig(mOversizeConfig, num_cbvs, num_srvs, num_uavs, num_samplers, 1);
+
+    mNumThreads = num_threads;
+    mThreadBlocks = static_alloc->new_array_sized<per_thread_blocks>(num_threads);
+
+    // the pools of blocks are created once claimed, blocks that are never needed don't pay for them
+    // the last block is the oversize one, it is created on first use and shared by all threads
+    mNumBlocks = num_threads;
+    mBlocks = static_alloc->new_array_sized<pool_block>(mNumBlocks + 1);
+    mNumClaimedBlocks.store(0, std::memory_order_relaxed);
+}
+
+void DescriptorAllocator::destroy()
+{
+    if (mBlocks == nullptr)
+        return;
+
+    for (auto i = 0u; i < mNumBlocks + 1; ++i)
+    {
+        // destroying the pool implicitly frees all sets
+        if (mBlocks[i].pool != nullptr)
+            vkDestroyDescriptorPool(mDevice, mBlocks[i].pool, nullptr);
+    }
 
-    cc::capped_vector<VkDescriptorPoolSize, 6> type_sizes;
+    mStaticAlloc->delete_array_sized(mBlocks, mNumBlocks + 1);
+    mStaticAlloc->delete_array_sized(mThreadBlocks, mNumThreads);
+    mBlocks = nullptr;
+    mThreadBlocks = nullptr;
+    mNumBlocks = 0;
+    mNumThreads = 0;
+}
+
+VkDescriptorSet DescriptorAllocator::allocDescriptor(VkDescriptorSetLayout layout, uint32_t& out_block_index)
+{
+    VkDescriptorSet res;
+    allocDescriptors(cc::span{layout}, &res, out_block_index);
+    return res;
+}
+
+void DescriptorAllocator::allocDescriptors(cc::span<VkDescriptorSetLayout const> layouts, VkDescriptorSet* out_sets, uint32_t& out_block_index)
+{
+    per_thread_blocks& thread_blocks = mThreadBlocks[getCurrentThreadIndex()];
+
+    // the block that last succeeded first, then the rest of the thread's blocks
+    if (thread_blocks.current_block != invalid_block && tryAllocFromBlock(thread_blocks.current_block, layouts, out_sets))
+    {
+        out_block_index = thread_blocks.current_block;
+        return;
+    }
+
+    for (uint32_t block = thread_blocks.first_block; block != invalid_block; block = mBlocks[block].next_block_of_owner)
+    {
+        if (block != thread_blocks.current_block && tryAllocFromBlock(block, layouts, out_sets))
+        {
+            thread_blocks.current_block = block;
+            out_block_index = block;
+            return;
+        }
+    }
+
+    // all blocks of this thread are full, claim a new one
+    uint32_t const new_block = mNumClaimedBlocks.fetch_add(1, std::memory_order_relaxed);
+    if (new_block < mNumBlocks)
+    {
+        pool_block& block = mBlocks[new_block];
+        block.pool = createPool(mBlockConfig);
+        block.next_block_of_owner = thread_blocks.first_block;
+        thread_blocks.first_block = new_block;
+        thread_blocks.current_block = new_block;
+
+        if (tryAllocFromBlock(new_block, layouts, out_sets))
+        {
+            out_block_index = new_block;
+            return;
+        }
+
+        // the sets do not even fit into an empty block
+    }
+
+    bool const success = tryAllocOversize(layouts, out_sets);
+    CC_RUNTIME_ASSERTF(success,
+                       "Reached limit for descriptors, increase the shader view or resource limits in the PHI backend config\n"
+                       "Current limit: {} descriptor sets in {} blocks",
+                       mBlockConfig.max_num_sets * mNumBlocks, mNumBlocks);
+    out_block_index = mNumBlocks;
+}
+
+void DescriptorAllocator::free(VkDescriptorSet descriptor_set, uint32_t block_index)
+{
+    CC_ASSERT(block_index <= mNumBlocks && "invalid descriptor set block");
+    pool_block& block = mBlocks[block_index];
+
+    auto lg = std::lock_guard(block.mutex);
+    vkFreeDescriptorSets(mDevice, block.pool, 1, &descriptor_set);
+}
+
+uint32_t DescriptorAllocator::getCurrentThreadIndex() const
+{
+    auto const current_index = mThreadAssociation->get_current_index();
+    CC_ASSERT_MSG(current_index < mNumThreads,
+                  "Accessed phi Backend from more OS threads than configured in backend_config\n"
+                  "Backend calls must only be made from at most backend_config::num_threads unique OS threads in total");
+    return current_index;
+}
+
+void DescriptorAllocator::fillPoolConfig(pool_config& out_config, uint32_t num_cbvs, uint32_t num_srvs, uint32_t num_uavs, uint32_t num_samplers, uint32_t num_blocks)
+{
+    auto const f_per_block = [&](uint32_t total) { return (total + num_blocks - 1) / num_blocks; };
+
+    out_config.sizes.clear();
 
     if (num_cbvs > 0)
-        type_sizes.push_back(VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, num_cbvs});
+        out_config.sizes.push_back(VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, f_per_block(num_cbvs)});
 
     if (num_samplers > 0)
-        type_sizes.push_back(VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_SAMPLER, num_samplers});
+        out_config.sizes.push_back(VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_SAMPLER, f_per_block(num_samplers)});
 
     if (num_srvs > 0)
     {
         // SRV-only types
-        type_sizes.push_back(VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, num_srvs});
-        type_sizes.push_back(VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_NV, num_srvs});
+        out_config.sizes.push_back(VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, f_per_block(num_srvs)});
+        out_config.sizes.push_back(VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_NV, f_per_block(num_srvs)});
     }
 
     if (num_uavs > 0)
     {
         // UAV-only types
-        type_sizes.push_back(VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, num_uavs});
+        out_config.sizes.push_back(VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, f_per_block(num_uavs)});
     }
 
     if (num_srvs + num_uavs > 0)
     {
         // SRV or UAV types
-        type_sizes.push_back(VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, num_srvs + num_uavs});
+        out_config.sizes.push_back(VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, f_per_block(num_srvs + num_uavs)});
     }
 
+    out_config.max_num_sets = f_per_block(num_srvs + num_uavs + num_cbvs + num_samplers);
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(pool_config const& config) const
+{
     VkDescriptorPoolCreateInfo descriptor_pool = {};
     descriptor_pool.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     descriptor_pool.pNext = nullptr;
     descriptor_pool.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-    descriptor_pool.maxSets = num_srvs + num_uavs + num_cbvs + num_samplers;
-    descriptor_pool.poolSizeCount = uint32_t(type_sizes.size());
-    descriptor_pool.pPoolSizes = type_sizes.data();
+    descriptor_pool.maxSets = config.max_num_sets;
+    descriptor_pool.poolSizeCount = uint32_t(config.sizes.size());
+    descriptor_pool.pPoolSizes = config.sizes.data();
 
-    PHI_VK_VERIFY_SUCCESS(vkCreateDescriptorPool(mDevice, &descriptor_pool, nullptr, &mPool));
+    VkDescriptorPool res;
+    PHI_VK_VERIFY_SUCCESS(vkCreateDescriptorPool(mDevice, &descriptor_pool, nullptr, &res));
+    return res;
 }
 
-void DescriptorAllocator::destroy() { vkDestroyDescriptorPool(mDevice, mPool, nullptr); }
-
-
-VkDescriptorSet DescriptorAllocator::allocDescriptor(VkDescriptorSetLayout layout)
+bool DescriptorAllocator::tryAllocFromBlock(uint32_t block_index, cc::span<VkDescriptorSetLayout const> layouts, VkDescriptorSet* out_sets)
 {
+    pool_block& block = mBlocks[block_index];
+
     VkDescriptorSetAllocateInfo alloc_info;
     alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     alloc_info.pNext = nullptr;
-    alloc_info.descriptorPool = mPool;
-    alloc_info.descriptorSetCount = 1;
-    alloc_info.pSetLayouts = &layout;
+    alloc_info.descriptorPool = block.pool;
+    alloc_info.descriptorSetCount = uint32_t(layouts.size());
+    alloc_info.pSetLayouts = layouts.data();
 
-    VkDescriptorSet res;
-    PHI_VK_VERIFY_SUCCESS(vkAllocateDescriptorSets(mDevice, &alloc_info, &res));
-    return res;
+    VkResult alloc_res;
+    {
+        auto lg = std::lock_guard(block.mutex);
+        alloc_res = vkAllocateDescriptorSets(mDevice, &alloc_info, out_sets);
+    }
+
+    if (alloc_res == VK_ERROR_OUT_OF_POOL_MEMORY || alloc_res == VK_ERROR_FRAGMENTED_POOL)
+        return false;
+
+    PHI_VK_ASSERT_SUCCESS(alloc_res);
+    return true;
 }
 
-void DescriptorAllocator::free(VkDescriptorSet descriptor_set) { vkFreeDescriptorSets(mDevice, mPool, 1, &descriptor_set); }
+bool DescriptorAllocator::tryAllocOversize(cc::span<VkDescriptorSetLayout const> layouts, VkDescriptorSet* out_sets)
+{
+    pool_block& block = mBlocks[mNumBlocks];
+
+    {
+        auto lg = std::lock_guard(block.mutex);
+        if (block.pool == nullptr)
+            block.pool = createPool(mOversizeConfig);
+    }
+
+    return tryAllocFromBlock(mNumBlocks, layouts, out_sets);
+}
 
 VkDescriptorSetLayout DescriptorAllocator::createSingleCBVLayout(bool usage_compute) const
 {
@@ -101,16 +250,15 @@ VkDescriptorSetLayout DescriptorAllocator::createSingleCBVLayout(bool usage_comp
     return layout;
 }
 
-VkDescriptorSetLayout DescriptorAllocator::createLayoutFromShaderViewArgs(cc::span<const resource_view> srvs,
-                                                                          cc::span<const resource_view> uavs,
-                                                                          unsigned num_samplers,
-                                                                          bool usage_compute) const
+void DescriptorAllocator::fillLayoutParamsFromShaderViewArgs(detail::pipeline_layout_params::descriptor_set_params& params,
+                                                             cc::span<const resource_view> srvs,
+                                                             cc::span<const resource_view> uavs,
+                                                             unsigned num_samplers,
+                                                             bool usage_compute)
 {
     // NOTE: Eventually arguments could be constrained to stages in a more fine-grained manner
     auto const argument_visibility = usage_compute ? VK_SHADER_STAGE_COMPUTE_BIT : VK_SHADER_STAGE_ALL_GRAPHICS;
 
-    detail::pipeline_layout_params::descriptor_set_params params;
-
     for (auto i = 0u; i < srvs.size(); ++i)
     {
         auto const native_type = util::to_native_srv_desc_type(srvs[i].dimension);
@@ -127,24 +275,15 @@ VkDescriptorSetLayout DescriptorAllocator::createLayoutFromShaderViewArgs(cc::sp
     {
         params.add_descriptor(VK_DESCRIPTOR_TYPE_SAMPLER, spv::sampler_binding_start + i, 1, argument_visibility);
     }
-
-    VkDescriptorSetLayoutCreateInfo layout_info = {};
-    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layout_info.bindingCount = uint32_t(params.bindings.size());
-    layout_info.pBindings = params.bindings.data();
-
-    VkDescriptorSetLayout layout;
-    PHI_VK_VERIFY_SUCCESS(vkCreateDescriptorSetLayout(mDevice, &layout_info, nullptr, &layout));
-
-    return layout;
 }
-VkDescriptorSetLayout DescriptorAllocator::createLayoutFromDescription(arg::shader_view_description const& desc, bool usageCompute)
+
+void DescriptorAllocator::fillLayoutParamsFromDescription(detail::pipeline_layout_params::descriptor_set_params& params,
+                                                          arg::shader_view_description const& desc,
+                                                          bool usageCompute)
 {
     // NOTE: Eventually arguments could be constrained to stages in a more fine-grained manner
     auto const argument_visibility = usageCompute ? VK_SHADER_STAGE_COMPUTE_BIT : VK_SHADER_STAGE_ALL_GRAPHICS;
 
-    detail::pipeline_layout_params::descriptor_set_params params;
-
     uint32_t srvHead = 0u;
     uint32_t numSRVsInEntries = 0u;
     for (auto const& entry : desc.srv_entries)
@@ -179,15 +318,5 @@ VkDescriptorSetLayout DescriptorAllocator::createLayoutFromDescription(arg::shad
     {
         params.add_descriptor(VK_DESCRIPTOR_TYPE_SAMPLER, spv::sampler_binding_start + i, 1, argument_visibility);
     }
-
-    VkDescriptorSetLayoutCreateInfo layout_info = {};
-    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layout_info.bindingCount = uint32_t(params.bindings.size());
-    layout_info.pBindings = params.bindings.data();
-
-    VkDescriptorSetLayout layout;
-    PHI_VK_VERIFY_SUCCESS(vkCreateDescriptorSetLayout(mDevice, &layout_info, nullptr, &layout));
-
-    return layout;
 }
 } // namespace phi::vk
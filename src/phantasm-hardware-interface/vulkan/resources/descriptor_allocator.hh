@@ -1,39 +1,117 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <mutex>
+
+#include <clean-core/capped_vector.hh>
+#include <clean-core/fwd.hh>
+
+#include <phantasm-hardware-interface/common/common_fwd.hh>
 
 #include <phantasm-hardware-interface/vulkan/loader/volk.hh>
+#include <phantasm-hardware-interface/vulkan/pipeline_layout.hh>
 
 #include <phantasm-hardware-interface/arguments.hh>
 
 namespace phi::vk
 {
-/// Unsynchronized
+/// Allocates descriptor sets from VkDescriptorPool blocks owned by the allocating thread (see thread_association)
+/// The configured amounts are totals, split into num_threads equally sized blocks which threads claim on demand
+/// Sets that do not fit into an empty block are allocated from a shared pool holding the full totals, created on first use
+/// Each block has its own lock, only contended by frees from other threads and by the shared pool
+/// Synchronized
 class DescriptorAllocator
 {
 public:
-    void initialize(VkDevice device, uint32_t num_cbvs, uint32_t num_srvs, uint32_t num_uavs, uint32_t num_samplers);
+    void initialize(VkDevice device,
+                    uint32_t num_cbvs,
+                    uint32_t num_srvs,
+                    uint32_t num_uavs,
+                    uint32_t num_samplers,
+                    phi::thread_association* thread_assoc,
+                    uint32_t num_threads,
+                    cc::allocator* static_alloc);
     void destroy();
 
-    // requires sync
-    [[nodiscard]] VkDescriptorSet allocDescriptor(VkDescriptorSetLayout descriptorLayout);
+    /// allocates from one of the calling thread's blocks, writes the index of the block (required for freeing)
+    [[nodiscard]] VkDescriptorSet allocDescriptor(VkDescriptorSetLayout descriptorLayout, uint32_t& out_block_index);
 
-    // requires sync
-    void free(VkDescriptorSet descriptor_set);
+    /// allocates one set per layout from the same block, writes the index of the block (required for freeing)
+    void allocDescriptors(cc::span<VkDescriptorSetLayout const> layouts, VkDescriptorSet* out_sets, uint32_t& out_block_index);
+
+    /// frees the set immediately, from any thread
+    void free(VkDescriptorSet descriptor_set, uint32_t block_index);
 
     // free-threaded
     VkDescriptorSetLayout createSingleCBVLayout(bool usage_compute) const;
 
-    VkDescriptorSetLayout createLayoutFromShaderViewArgs(cc::span<resource_view const> srvs, cc::span<resource_view const> uavs, unsigned num_samplers, bool usage_compute) const;
+    // free-threaded, fills the bindings of a shader view layout without creating it (see DescriptorSetLayoutCache)
+    static void fillLayoutParamsFromShaderViewArgs(detail::pipeline_layout_params::descriptor_set_params& params,
+                                                   cc::span<resource_view const> srvs,
+                                                   cc::span<resource_view const> uavs,
+                                                   unsigned num_samplers,
+                                                   bool usage_compute);
 
-    VkDescriptorSetLayout createLayoutFromDescription(arg::shader_view_description const& desc, bool usageCompute);
+    static void fillLayoutParamsFromDescription(detail::pipeline_layout_params::descriptor_set_params& params,
+                                                arg::shader_view_description const& desc,
+                                                bool usageCompute);
 
 
     VkDevice getDevice() const { return mDevice; }
 
+private:
+    static constexpr uint32_t invalid_block = uint32_t(-1);
+
+    struct pool_block
+    {
+        // guards the pool, locked by the owner to allocate and by any thread to free
+        std::mutex mutex;
+        VkDescriptorPool pool = nullptr;
+        // the next block claimed by the same thread, only accessed by the owner
+        uint32_t next_block_of_owner = invalid_block;
+    };
+
+    struct pool_config
+    {
+        cc::capped_vector<VkDescriptorPoolSize, 6> sizes;
+        uint32_t max_num_sets = 0;
+    };
+
+    struct per_thread_blocks
+    {
+        // the block allocated from last, the start of the thread's chain of blocks, only accessed by the owning thread
+        uint32_t current_block = invalid_block;
+        uint32_t first_block = invalid_block;
+    };
+
+    uint32_t getCurrentThreadIndex() const;
+
+    static void fillPoolConfig(pool_config& out_config, uint32_t num_cbvs, uint32_t num_srvs, uint32_t num_uavs, uint32_t num_samplers, uint32_t num_blocks);
+
+    VkDescriptorPool createPool(pool_config const& config) const;
+
+    /// attempts to allocate from the given block, returns false if it is out of memory
+    bool tryAllocFromBlock(uint32_t block_index, cc::span<VkDescriptorSetLayout const> layouts, VkDescriptorSet* out_sets);
+
+    /// attempts to allocate from the shared oversize block at index mNumBlocks, creating its pool if required
+    bool tryAllocOversize(cc::span<VkDescriptorSetLayout const> layouts, VkDescriptorSet* out_sets);
+
 private:
     VkDevice mDevice = nullptr;
-    VkDescriptorPool mPool;
+    phi::thread_association* mThreadAssociation = nullptr;
+    cc::allocator* mStaticAlloc = nullptr;
+
+    per_thread_blocks* mThreadBlocks = nullptr;
+    uint32_t mNumThreads = 0;
+
+    // mNumBlocks per-thread blocks followed by the shared oversize block
+    pool_block* mBlocks = nullptr;
+    uint32_t mNumBlocks = 0;
+    std::atomic<uint32_t> mNumClaimedBlocks = {0};
+
+    pool_config mBlockConfig;
+    pool_config mOversizeConfig;
 };
 
 } // namespace phi::vk
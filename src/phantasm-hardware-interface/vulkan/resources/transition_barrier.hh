@@ -1,5 +1,6 @@
 #pragma once
 
+#include <clean-core/alloc_vector.hh>
 #include <clean-core/capped_vector.hh>
 #include <clean-core/span.hh>
 
@@ -137,5 +138,49 @@ struct barrier_bundle
     }
 };
 
+/// unbounded variant of barrier_bundle, backed by growable memory from the given allocator
+struct growable_barrier_bundle
+{
+    stage_dependencies dependencies;
+    cc::alloc_vector<VkImageMemoryBarrier> barriers_img;
+    cc::alloc_vector<VkBufferMemoryBarrier> barriers_buf;
+
+    void initialize(cc::allocator* alloc, size_t num_reserved_barriers)
+    {
+        barriers_img.reset_reserve(alloc, num_reserved_barriers);
+        barriers_buf.reset_reserve(alloc, num_reserved_barriers);
+    }
+
+    // entire subresource barrier
+    void add_image_barrier(VkImage image, state_change const& state_change, VkImageAspectFlags aspect)
+    {
+        dependencies.add_change(state_change);
+        barriers_img.push_back(get_image_memory_barrier(image, state_change, aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS));
+    }
+
+    void add_buffer_barrier(VkBuffer buffer, state_change const& state_change, uint64_t buffer_size)
+    {
+        dependencies.add_change(state_change);
+        barriers_buf.push_back(get_buffer_memory_barrier(buffer, state_change, buffer_size));
+    }
+
+    [[nodiscard]] bool empty() const { return barriers_img.empty() && barriers_buf.empty(); }
+
+    /// Record contained barriers to the given cmd buffer
+    void record(VkCommandBuffer cmd_buf)
+    {
+        if (!empty())
+            submit_barriers(cmd_buf, dependencies, barriers_img, barriers_buf);
+    }
+
+    void reset()
+    {
+        dependencies.reset();
+        barriers_img.clear();
+        barriers_buf.clear();
+    }
+};
+
+
 
 }
@@ -0,0 +1,144 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include <clean-core/allocator.hh>
+#include <clean-core/hash.hh>
+#include <clean-core/utility.hh>
+#include <clean-core/vector.hh>
+
+#include <phantasm-hardware-interface/common/container/growable_map.hh>
+#include <phantasm-hardware-interface/common/container/stable_map.hh>
+
+// compares detail::stable_map against detail::growable_map using a key of the size of a typical cache key
+// usage: phi-map_bench [num elements]
+
+namespace
+{
+struct bench_key
+{
+    uint64_t values[4] = {};
+
+    bool operator==(bench_key const& rhs) const noexcept
+    {
+        return values[0] == rhs.values[0] && values[1] == rhs.values[1] && values[2] == rhs.values[2] && values[3] == rhs.values[3];
+    }
+};
+
+struct bench_hasher
+{
+    uint64_t operator()(bench_key const& v) const noexcept { return cc::make_hash(v.values[0], v.values[1], v.values[2], v.values[3]); }
+};
+
+bench_key makeKey(uint64_t i) { return bench_key{{i, i * 31, i ^ 0xABCDu, i + 7}}; }
+
+template <class F>
+double measureMs(F&& func)
+{
+    auto const start = std::chrono::high_resolution_clock::now();
+    func();
+    auto const end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+struct bench_result
+{
+    double insert_ms = 0;
+    double hit_ms = 0;
+    double miss_ms = 0;
+};
+
+void printResult(char const* name, uint32_t num_elements, bench_result const& res)
+{
+    std::printf("%-28s %10u %12.3f %12.3f %12.3f\n", name, num_elements, res.insert_ms, res.hit_ms, res.miss_ms);
+}
+
+template <class MapT>
+bench_result runSingleThreaded(MapT& map, uint32_t num_elements)
+{
+    bench_result res;
+    uint64_t checksum = 0;
+
+    res.insert_ms = measureMs([&] {
+        for (auto i = 0u; i < num_elements; ++i)
+            map[makeKey(i)] = i;
+    });
+
+    res.hit_ms = measureMs([&] {
+        for (auto i = 0u; i < num_elements; ++i)
+            checksum += map[makeKey(i)];
+    });
+
+    res.miss_ms = measureMs([&] {
+        for (auto i = 0u; i < num_elements; ++i)
+            checksum += map.contains_key(makeKey(num_elements + i)) ? 1 : 0;
+    });
+
+    // keep the loops from being optimized out
+    if (checksum == uint64_t(-1))
+        std::printf("unreachable\n");
+
+    return res;
+}
+
+double runConcurrentLookups(phi::detail::growable_map<bench_key, uint64_t, bench_hasher, true>& map, uint32_t num_elements, uint32_t num_threads)
+{
+    return measureMs([&] {
+        cc::vector<std::thread> threads;
+        for (auto t = 0u; t < num_threads; ++t)
+        {
+            threads.emplace_back([&map, num_elements, t] {
+                uint64_t checksum = 0;
+                for (auto i = 0u; i < num_elements; ++i)
+                    checksum += map[makeKey((i + t * 97) % num_elements)];
+
+                if (checksum == uint64_t(-1))
+                    std::printf("unreachable\n");
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+    });
+}
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t const num_elements = argc >= 2 ? uint32_t(std::strtoul(argv[1], nullptr, 10)) : 4096u;
+
+    std::printf("%-28s %10s %12s %12s %12s\n", "container", "elements", "insert ms", "hit ms", "miss ms");
+
+    // stable_map cannot grow, size it with the same load factor growable_map ends up at
+    {
+        phi::detail::stable_map<bench_key, uint64_t, bench_hasher> map;
+        map.initialize(num_elements * 2, cc::system_allocator);
+        printResult("stable_map (presized)", num_elements, runSingleThreaded(map, num_elements));
+    }
+
+    {
+        phi::detail::growable_map<bench_key, uint64_t, bench_hasher> map;
+        map.initialize(num_elements, cc::system_allocator);
+        printResult("growable_map (presized)", num_elements, runSingleThreaded(map, num_elements));
+    }
+
+    {
+        phi::detail::growable_map<bench_key, uint64_t, bench_hasher> map;
+        map.initialize(16, cc::system_allocator);
+        printResult("growable_map (growing)", num_elements, runSingleThreaded(map, num_elements));
+    }
+
+    {
+        phi::detail::growable_map<bench_key, uint64_t, bench_hasher, true> map;
+        map.initialize(num_elements, cc::system_allocator);
+        printResult("growable_map (concurrent)", num_elements, runSingleThreaded(map, num_elements));
+
+        uint32_t const num_threads = cc::max(std::thread::hardware_concurrency(), 2u);
+        double const ms = runConcurrentLookups(map, num_elements, num_threads);
+        std::printf("concurrent lookups: %u threads, %.3f ms, %llu contended locks\n", num_threads, ms, (unsigned long long)map.get_num_contended_locks());
+    }
+
+    return 0;
+}
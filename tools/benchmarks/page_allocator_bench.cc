@@ -0,0 +1,140 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include <clean-core/allocator.hh>
+#include <clean-core/vector.hh>
+
+#include <phantasm-hardware-interface/common/bitmap_page_allocator.hh>
+#include <phantasm-hardware-interface/common/page_allocator.hh>
+
+// compares page_allocator against bitmap_page_allocator with the allocation pattern of per-draw occlusion queries:
+// a pool with a page size of 2, mostly single-query ranges with some larger ones, a long-lived part and constant churn
+// both are first-fit, their results are verified to be identical
+// usage: phi-page_allocator_bench [num queries] [num frames]
+
+namespace
+{
+struct xorshift
+{
+    uint32_t state = 0x2545F491u;
+    uint32_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+};
+
+struct allocation_op
+{
+    bool is_free;
+    int size_or_index; ///< the size for allocations, the index of the allocation to free otherwise
+};
+
+/// records the operations once so both allocators see the exact same sequence
+cc::vector<allocation_op> generatePattern(int num_queries, int num_frames)
+{
+    cc::vector<allocation_op> ops;
+    xorshift rng;
+
+    int num_live_allocations = 0;
+    int num_live_queries = 0;
+    cc::vector<int> live_sizes;
+
+    int const num_per_frame = num_queries / 8;
+    for (auto frame = 0; frame < num_frames; ++frame)
+    {
+        // allocate until roughly three quarters of the pool are used
+        for (auto i = 0; i < num_per_frame && num_live_queries < num_queries * 3 / 4; ++i)
+        {
+            uint32_t const r = rng.next() % 100;
+            int const size = r < 80 ? 1 : (r < 95 ? 2 : int(4 + rng.next() % 28));
+            ops.push_back({false, size});
+            live_sizes.push_back(size);
+            num_live_queries += size;
+            ++num_live_allocations;
+        }
+
+        // free a random subset, the older allocations tend to survive
+        for (auto i = 0; i < num_per_frame && num_live_allocations > 0; ++i)
+        {
+            int const index = int(rng.next() % uint32_t(num_live_allocations));
+            ops.push_back({true, index});
+            num_live_queries -= live_sizes[size_t(index)];
+            live_sizes[size_t(index)] = live_sizes.back();
+            live_sizes.pop_back();
+            --num_live_allocations;
+        }
+    }
+
+    return ops;
+}
+
+template <class AllocatorT>
+double runPattern(AllocatorT& allocator, cc::vector<allocation_op> const& ops, cc::vector<int>& out_results)
+{
+    cc::vector<int> live;
+    live.reserve(ops.size());
+    out_results.clear();
+    out_results.reserve(ops.size());
+
+    auto const start = std::chrono::high_resolution_clock::now();
+    for (auto const& op : ops)
+    {
+        if (op.is_free)
+        {
+            // swap-remove, mirroring generatePattern
+            allocator.free(live[size_t(op.size_or_index)]);
+            live[size_t(op.size_or_index)] = live.back();
+            live.pop_back();
+        }
+        else
+        {
+            int const page = allocator.allocate(op.size_or_index);
+            out_results.push_back(page);
+            live.push_back(page);
+        }
+    }
+    auto const end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+}
+
+int main(int argc, char** argv)
+{
+    int const num_queries = argc >= 2 ? int(std::strtol(argv[1], nullptr, 10)) : 8192;
+    int const num_frames = argc >= 3 ? int(std::strtol(argv[2], nullptr, 10)) : 500;
+    constexpr unsigned page_size = 2;
+
+    auto const ops = generatePattern(num_queries, num_frames);
+
+    cc::vector<int> linear_results;
+    cc::vector<int> bitmap_results;
+
+    phi::page_allocator linear;
+    linear.initialize(unsigned(num_queries), page_size, cc::system_allocator);
+    double const linear_ms = runPattern(linear, ops, linear_results);
+
+    phi::bitmap_page_allocator bitmap;
+    bitmap.initialize(unsigned(num_queries), page_size, cc::system_allocator);
+    double const bitmap_ms = runPattern(bitmap, ops, bitmap_results);
+
+    for (auto i = 0u; i < linear_results.size(); ++i)
+    {
+        if (linear_results[i] != bitmap_results[i])
+        {
+            std::fprintf(stderr, "mismatch at allocation %u: page_allocator returned %d, bitmap_page_allocator returned %d\n", i,
+                         linear_results[i], bitmap_results[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::printf("%zu operations on %d queries (%d pages), %d frames\n", ops.size(), num_queries, linear.get_num_pages(), num_frames);
+    std::printf("%-24s %12s %14s\n", "allocator", "total ms", "ns per op");
+    std::printf("%-24s %12.3f %14.1f\n", "page_allocator", linear_ms, linear_ms * 1e6 / double(ops.size()));
+    std::printf("%-24s %12.3f %14.1f\n", "bitmap_page_allocator", bitmap_ms, bitmap_ms * 1e6 / double(ops.size()));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <clean-core/unique_ptr.hh>
+
+#include <phantasm-hardware-interface/Backend.hh>
+#include <phantasm-hardware-interface/common/container/unique_buffer.hh>
+#include <phantasm-hardware-interface/config.hh>
+#include <phantasm-hardware-interface/features/command_capture.hh>
+#include <phantasm-hardware-interface/features/command_replay.hh>
+
+#ifdef PHI_BACKEND_VULKAN
+#include <phantasm-hardware-interface/vulkan/BackendVulkan.hh>
+#endif
+
+#ifdef PHI_BACKEND_D3D12
+#include <phantasm-hardware-interface/d3d12/BackendD3D12.hh>
+#endif
+
+// replays a capture written by phi::CaptureBackend and prints the CPU translation time per command list
+// usage: phi-replay <capture file> [num iterations]
+
+namespace
+{
+char const* queueName(phi::queue_type queue)
+{
+    switch (queue)
+    {
+    case phi::queue_type::direct:
+        return "direct";
+    case phi::queue_type::compute:
+        return "compute";
+    case phi::queue_type::copy:
+        return "copy";
+    }
+    return "unknown";
+}
+
+cc::unique_ptr<phi::Backend> createBackend(phi::backend_type type)
+{
+    switch (type)
+    {
+    case phi::backend_type::vulkan:
+#ifdef PHI_BACKEND_VULKAN
+        return cc::make_unique<phi::vk::BackendVulkan>();
+#else
+        return nullptr;
+#endif
+    case phi::backend_type::d3d12:
+#ifdef PHI_BACKEND_D3D12
+        return cc::make_unique<phi::d3d12::BackendD3D12>();
+#else
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s <capture file> [num iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t const num_iterations = argc >= 3 ? uint32_t(std::strtoul(argv[2], nullptr, 10)) : 10u;
+
+    auto const capture = phi::unique_buffer::create_from_binary_file(argv[1]);
+    if (!capture.is_valid() || capture.size() < sizeof(phi::capture::file_header))
+    {
+        std::fprintf(stderr, "failed to read capture file %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    phi::capture::file_header header;
+    std::memcpy(&header, capture.data(), sizeof(header));
+
+    auto backend = createBackend(header.backend);
+    if (backend == nullptr)
+    {
+        std::fprintf(stderr, "the backend of this capture is not enabled in this build\n");
+        return EXIT_FAILURE;
+    }
+
+    phi::backend_config config;
+    backend->initialize(config);
+
+    auto const result = phi::replay_capture(*backend, cc::span{capture.data(), capture.size()}, num_iterations);
+
+    if (result.success)
+    {
+        double total_ms = 0.0;
+        std::printf("%8s %8s %10s %10s %14s\n", "list", "queue", "bytes", "commands", "translation ms");
+        for (auto const& timing : result.list_timings)
+        {
+            std::printf("%8u %8s %10u %10u %14.4f\n", timing.list_index, queueName(timing.queue), timing.num_bytes, timing.num_commands, timing.translation_ms);
+            total_ms += timing.translation_ms;
+        }
+
+        std::printf("replayed %u lists (%u skipped), total translation time %.4f ms (minimum of %u iterations per list)\n",
+                    result.num_lists_replayed, result.num_lists_skipped, total_ms, num_iterations);
+    }
+
+    backend->destroy();
+    return result.success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
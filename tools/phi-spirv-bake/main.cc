@@ -0,0 +1,50 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include <clean-core/allocator.hh>
+
+#include <phantasm-hardware-interface/common/container/unique_buffer.hh>
+#include <phantasm-hardware-interface/vulkan/loader/spirv_patch_util.hh>
+
+// patches and reflects a SPIR-V binary offline, writing a container the Vulkan backend uses without running spirv-reflect
+// usage: phi-spirv-bake <input.spv> <output>
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::fprintf(stderr, "usage: %s <input.spv> <output>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    auto const input = phi::unique_buffer::create_from_binary_file(argv[1]);
+    if (!input.is_valid() || input.size() < sizeof(uint32_t) || input.size() % sizeof(uint32_t) != 0)
+    {
+        std::fprintf(stderr, "failed to read SPIR-V from %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (phi::vk::util::is_patched_spirv_container(input.data(), input.size()))
+    {
+        std::fprintf(stderr, "%s is already a patched container\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    phi::vk::util::spirv_refl_info info;
+    info.descriptor_infos.reset_reserve(cc::system_allocator, 16);
+
+    auto const patched = phi::vk::util::create_patched_spirv(input.data(), input.size(), info, cc::system_allocator);
+    auto const merged = phi::vk::util::merge_spirv_descriptors(info.descriptor_infos, cc::system_allocator);
+
+    bool const success = phi::vk::util::write_patched_spirv(patched, merged, info.has_push_constants, argv[2]);
+    phi::vk::util::free_patched_spirv(patched);
+
+    if (!success)
+    {
+        std::fprintf(stderr, "failed to write %s\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    std::printf("baked %s (%zu descriptors%s) to %s\n", argv[1], merged.size(), info.has_push_constants ? ", push constants" : "", argv[2]);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include <clean-core/span.hh>
+
+#include <phantasm-hardware-interface/arguments.hh>
+#include <phantasm-hardware-interface/config.hh>
+#include <phantasm-hardware-interface/vulkan/BackendVulkan.hh>
+
+// allocates shader views larger than one per-thread descriptor pool block (max_num_srvs / num_threads),
+// which must fall back to the shared oversize pool instead of failing
+// usage: phi-descriptor_allocator_test
+
+namespace
+{
+bool check(bool condition, char const* message)
+{
+    if (!condition)
+        std::fprintf(stderr, "FAILED: %s\n", message);
+    return condition;
+}
+}
+
+int main()
+{
+    phi::backend_config config;
+    config.num_threads = 4;
+
+    phi::vk::BackendVulkan backend;
+    backend.initialize(config);
+
+    uint32_t const block_srvs = (config.max_num_srvs + config.num_threads - 1) / config.num_threads;
+    bool success = true;
+
+    // a regular view claims the first block of this thread
+    phi::descriptor_entry const small_entry = {phi::descriptor_category::texture, 16};
+    phi::arg::shader_view_description small_desc;
+    small_desc.num_srvs = small_entry.array_size;
+    small_desc.srv_entries = cc::span{small_entry};
+
+    auto const small_sv = backend.createEmptyShaderView(small_desc);
+    success &= check(small_sv.is_valid(), "regular shader view");
+
+    // larger than a block, but within the total limit
+    phi::descriptor_entry const large_entry = {phi::descriptor_category::texture, block_srvs + 1};
+    phi::arg::shader_view_description large_desc;
+    large_desc.num_srvs = large_entry.array_size;
+    large_desc.srv_entries = cc::span{large_entry};
+
+    auto const large_sv = backend.createEmptyShaderView(large_desc);
+    success &= check(large_sv.is_valid(), "shader view larger than a descriptor pool block");
+
+    // the oversize pool is shared, a second one fits as long as the totals allow it
+    auto const large_sv_2 = backend.createEmptyShaderView(large_desc);
+    success &= check(large_sv_2.is_valid(), "second shader view larger than a descriptor pool block");
+
+    // freed oversize sets are returned to the shared pool
+    backend.free(large_sv);
+    backend.free(large_sv_2);
+    auto const large_sv_3 = backend.createEmptyShaderView(large_desc);
+    success &= check(large_sv_3.is_valid(), "shader view larger than a descriptor pool block after free");
+
+    backend.free(large_sv_3);
+    backend.free(small_sv);
+    backend.destroy();
+
+    if (success)
+        std::printf("descriptor allocator test passed\n");
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}